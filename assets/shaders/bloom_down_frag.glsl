@@ -0,0 +1,50 @@
+#version 330 core
+out vec4 color;
+in vec2 fragTexCoord;
+
+uniform sampler2D image;
+// The first downsample weights each 2x2 box by 1 / (1 + luma), so a single
+// very bright texel can't flicker as it moves from texel to texel
+uniform bool karis;
+
+float KarisWeight(vec3 box) {
+  return 1.0 / (1.0 + dot(box, vec3(0.2126, 0.7152, 0.0722)));
+}
+
+vec3 Tap(vec2 offset, vec2 texel) {
+  return texture(image, fragTexCoord + offset * texel).rgb;
+}
+
+// 13 bilinear taps read as five overlapping 2x2 boxes, one in the middle
+// weighted 0.5 and four in the corners weighted 0.125 (Jimenez, Next
+// Generation Post Processing in Call of Duty: Advanced Warfare)
+void main() {
+  vec2 texel = 1.0 / textureSize(image, 0);
+  vec3 a = Tap(vec2(-2, 2), texel);
+  vec3 b = Tap(vec2(0, 2), texel);
+  vec3 c = Tap(vec2(2, 2), texel);
+  vec3 d = Tap(vec2(-2, 0), texel);
+  vec3 e = Tap(vec2(0, 0), texel);
+  vec3 f = Tap(vec2(2, 0), texel);
+  vec3 g = Tap(vec2(-2, -2), texel);
+  vec3 h = Tap(vec2(0, -2), texel);
+  vec3 i = Tap(vec2(2, -2), texel);
+  vec3 j = Tap(vec2(-1, 1), texel);
+  vec3 k = Tap(vec2(1, 1), texel);
+  vec3 l = Tap(vec2(-1, -1), texel);
+  vec3 m = Tap(vec2(1, -1), texel);
+
+  vec3 boxes[5] = vec3[](
+      (j + k + l + m) * 0.25, (a + b + d + e) * 0.25, (b + c + e + f) * 0.25,
+      (d + e + g + h) * 0.25, (e + f + h + i) * 0.25);
+  float weights[5] = float[](0.5, 0.125, 0.125, 0.125, 0.125);
+
+  vec3 result = vec3(0.0);
+  float total = 0.0;
+  for (int n = 0; n < 5; n++) {
+    float weight = karis ? weights[n] * KarisWeight(boxes[n]) : weights[n];
+    result += boxes[n] * weight;
+    total += weight;
+  }
+  color = vec4(result / total, 1.0);
+}
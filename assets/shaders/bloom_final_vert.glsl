@@ -1,6 +1,6 @@
 #version 330 core
 layout (location = 0) in vec4 vertPos;
-layout (location = 1) in vec2 vertTex;
+layout (location = 2) in vec2 vertTex;
 
 out vec2 fragTexCoord;
 
@@ -0,0 +1,20 @@
+#version 330 core
+out vec4 color;
+in vec2 fragTexCoord;
+
+uniform sampler2D image;
+
+// 3x3 tent filter over the smaller level, added onto the larger one
+void main() {
+  vec2 texel = 1.0 / textureSize(image, 0);
+  vec3 result = texture(image, fragTexCoord).rgb * 4.0;
+  result += texture(image, fragTexCoord + vec2(-texel.x, 0)).rgb * 2.0;
+  result += texture(image, fragTexCoord + vec2(texel.x, 0)).rgb * 2.0;
+  result += texture(image, fragTexCoord + vec2(0, -texel.y)).rgb * 2.0;
+  result += texture(image, fragTexCoord + vec2(0, texel.y)).rgb * 2.0;
+  result += texture(image, fragTexCoord + vec2(-texel.x, -texel.y)).rgb;
+  result += texture(image, fragTexCoord + vec2(texel.x, -texel.y)).rgb;
+  result += texture(image, fragTexCoord + vec2(-texel.x, texel.y)).rgb;
+  result += texture(image, fragTexCoord + vec2(texel.x, texel.y)).rgb;
+  color = vec4(result / 16.0, 1.0);
+}
@@ -0,0 +1,60 @@
+#version 430 core
+layout(local_size_x = 64) in;
+
+struct Box {
+  vec4 min;
+  vec4 max;
+};
+
+struct IndirectDraw {
+  uint count;
+  uint instanceCount;
+  uint firstIndex;
+  int baseVertex;
+  uint baseInstance;
+};
+
+layout(std430, binding = 0) readonly buffer Boxes {
+  Box boxes[];
+};
+layout(std430, binding = 1) readonly buffer ObjectDraws {
+  uint objectDraws[];
+};
+layout(std430, binding = 2) buffer Draws {
+  IndirectDraw draws[];
+};
+layout(std430, binding = 3) writeonly buffer VisibleIndices {
+  uint visibleIndices[];
+};
+// how many objects are visible, and then which, in no order
+layout(std430, binding = 4) buffer Visible {
+  uint visibleCount;
+  uint visible[];
+};
+
+uniform vec4 planes[6];
+uniform uint objectCount;
+
+void main()
+{
+  uint object = gl_GlobalInvocationID.x;
+  if (object >= objectCount) {
+    return;
+  }
+  Box box = boxes[object];
+  bool inside = true;
+  for (int i = 0; i < 6; i++) {
+    // the corner farthest along the plane's normal
+    vec3 corner = mix(box.min.xyz, box.max.xyz, greaterThan(planes[i].xyz, vec3(0.0)));
+    if (dot(planes[i].xyz, corner) + planes[i].w <= 0.0) {
+      inside = false;
+      break;
+    }
+  }
+  if (inside) {
+    visible[atomicAdd(visibleCount, 1u)] = object;
+    uint draw = objectDraws[object];
+    uint instance = atomicAdd(draws[draw].instanceCount, 1u);
+    visibleIndices[draws[draw].baseInstance + instance] = object;
+  }
+}
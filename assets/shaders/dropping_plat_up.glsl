@@ -20,11 +20,13 @@ uniform struct Light {
    float direction;
 } allLights[MAX_LIGHTS];
 
+#include "shadows.glsl"
+
 vec3 ComputeLight(Light light, vec4 surfaceColor, vec3 normal, vec4 position) {
    vec3 surfaceToLight;
    float attenuation = 1.0;
    surfaceToLight = normalize(light.position.xyz);
-   attenuation = 1.0;
+   attenuation = ShadowVisibility(position);
    vec3 ambient = light.ambient * surfaceColor.rgb * light.color;
    float diffuseCoef = max(0.0, dot(normal, surfaceToLight));
    vec3 diffuse = diffuseCoef * surfaceColor.rgb * light.color;
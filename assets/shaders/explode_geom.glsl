@@ -5,16 +5,15 @@ layout(triangle_strip, max_vertices = 3) out;
 in vec3 geomNor [];
 in vec4 geomPos [];
 in vec3 obj_color [];
+flat in int geomCollected [];
+flat in int geomTimeCollected [];
 
 out vec3 fragNor;
 out vec4 fragPos;
 out vec3 obj_color_out;
 
-uniform int isCollected;
-uniform int timeCollected;
-
 vec4 explode(vec4 position, vec3 normal) {
-   vec3 direction = normal * timeCollected/3.0;
+   vec3 direction = normal * geomTimeCollected[0]/3.0;
    return position + vec4(direction, 0.0f); 
 }
 
@@ -23,7 +22,7 @@ void main() {
    fragPos = geomPos[0];
    obj_color_out = obj_color[0];
 
-   if (isCollected == 1) {   
+   if (geomCollected[0] == 1) {   
       gl_Position = explode(gl_in[0].gl_Position, geomNor[0]);
       EmitVertex();
 
@@ -0,0 +1,14 @@
+#version 330 core
+flat in vec3 fragColor;
+
+uniform bool sprites;
+
+out vec4 color;
+
+void main() {
+  // round sprites
+  if (sprites && length(gl_PointCoord - vec2(0.5)) > 0.5) {
+    discard;
+  }
+  color = vec4(fragColor, 1.0);
+}
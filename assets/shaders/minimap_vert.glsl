@@ -0,0 +1,23 @@
+#version 330 core
+layout(location = 0) in vec3 vertPos;
+layout(location = 4) in vec3 boxCenter;
+layout(location = 5) in vec3 boxExtent;
+layout(location = 6) in vec3 flatColor;
+
+uniform mat4 P;
+uniform mat4 V;
+// Sprites are points at boxCenter, boxExtent.x pixels across. Otherwise
+// vertPos is a corner of the unit cube, stretched over each instance's box.
+uniform bool sprites;
+
+flat out vec3 fragColor;
+
+void main() {
+  fragColor = flatColor;
+  if (sprites) {
+    gl_Position = P * V * vec4(boxCenter, 1.0);
+    gl_PointSize = boxExtent.x;
+  } else {
+    gl_Position = P * V * vec4(boxCenter + vertPos * boxExtent, 1.0);
+  }
+}
@@ -2,6 +2,7 @@
 layout(location = 0) in vec4 vertPos;
 layout(location = 1) in vec3 vertNor;
 layout(location = 2) in vec2 vertTex;
+layout(location = 3) in int objectIndex;
 
 uniform mat4 P;
 uniform mat4 V;
@@ -10,10 +11,15 @@ uniform mat4 MV;
 out vec3 fragNor;
 out vec4 fragPos;
 out vec2 fragTexCoord;
+// computed exactly as the depth pre-pass does, so its depth is equal
+invariant gl_Position;
+
+#include "objects.glsl"
 
 void main() {
-  gl_Position = P * V * MV * vertPos;
-  fragNor = (MV * vec4(vertNor, 0.0)).xyz;
-  fragPos = vec4(MV * vec4(vertPos.xyz, 1.0));
+  mat4 model = ObjectMV();
+  gl_Position = P * V * model * vertPos;
+  fragNor = (model * vec4(vertNor, 0.0)).xyz;
+  fragPos = vec4(model * vec4(vertPos.xyz, 1.0));
   fragTexCoord = vertTex;
 }
@@ -1,6 +1,7 @@
 #version 330 core
 layout(location = 0) in vec4 vertPos;
 layout(location = 1) in vec3 vertNor;
+layout(location = 3) in int objectIndex;
 uniform mat4 P;
 uniform mat4 V;
 uniform mat4 MV;
@@ -10,10 +11,26 @@ uniform int timeCollected;
 out vec3 obj_color;
 out vec3 geomNor;
 out vec4 geomPos;
+flat out int geomCollected;
+flat out int geomTimeCollected;
 
+#include "objects.glsl"
+
+// Batched notes read their color and collected state from the objects buffer
+// too
 void main() {
-  gl_Position = P * V * MV * vertPos;
-  geomNor = (MV * vec4(vertNor, 0.0)).xyz;
-  geomPos = vec4(MV * vec4(vertPos.xyz, 1.0));
+  mat4 model = ObjectMV();
   obj_color = in_obj_color;
+  geomCollected = isCollected;
+  geomTimeCollected = timeCollected;
+  if (batched) {
+    obj_color = ObjectTexel(OBJECT_COLOR_TEXEL).rgb;
+    vec4 collected = ObjectTexel(OBJECT_COLLECTED_TEXEL);
+    geomCollected = int(collected.x);
+    geomTimeCollected = int(collected.y);
+  }
+
+  gl_Position = P * V * model * vertPos;
+  geomNor = (model * vec4(vertNor, 0.0)).xyz;
+  geomPos = vec4(model * vec4(vertPos.xyz, 1.0));
 }
@@ -0,0 +1,17 @@
+// Batched draws read each object's data from the objects buffer instead of
+// uniforms, OBJECT_TEXELS texels an object in the layout RenderQueue writes.
+// Program defines the OBJECT_ constants from RenderQueue.h. Needs MV and
+// objectIndex declared first.
+uniform bool batched;
+uniform samplerBuffer objects;
+
+vec4 ObjectTexel(int texel) {
+  return texelFetch(objects, objectIndex * OBJECT_TEXELS + texel);
+}
+
+mat4 ObjectMV() {
+  if (!batched) {
+    return MV;
+  }
+  return mat4(ObjectTexel(0), ObjectTexel(1), ObjectTexel(2), ObjectTexel(3));
+}
@@ -0,0 +1,10 @@
+#version 330 core
+layout (location = 0) out vec4 color;
+layout (location = 1) out vec4 brightColor;
+
+// Added up by blending, so a pixel is as bright as the times it was shaded:
+// dim red once, going orange and then yellow as it adds up
+void main() {
+  color = vec4(0.1, 0.04, 0.01, 1.0);
+  brightColor = vec4(0.0);
+}
@@ -1,26 +1,19 @@
 #version 330 core
+layout(location = 0) in vec4 vertPos;
+layout(location = 3) in int objectIndex;
 
-// Input vertex data, different for all executions of this shader.
-layout(location = 0) in vec3 vertexPosition_modelspace;
-layout(location = 1) in vec2 vertexUV;
-layout(location = 2) in vec3 vertexNormal_modelspace;
+uniform mat4 P;
+uniform mat4 V;
+uniform mat4 MV;
 
-// Output data ; will be interpolated for each fragment.
-out vec2 UV;
-out vec4 ShadowCoord;
+#include "objects.glsl"
 
-// Values that stay constant for the whole mesh.
-uniform mat4 MVP;
-uniform mat4 DepthBiasMVP;
+// Only the position, for ShadowMaps, where P and V are the light's, and for
+// RenderQueue's depth pre-pass and overdraw view. It's computed the way the
+// lit programs compute it, so the pre-pass depth equals theirs.
+invariant gl_Position;
 
-
-void main(){
-
-  // Output position of the vertex, in clip space : MVP * position
-  gl_Position =  MVP * vec4(vertexPosition_modelspace,1);
-  
-  ShadowCoord = DepthBiasMVP * vec4(vertexPosition_modelspace,1);
-  
-  // UV of the vertex. No special space for this one.
-  UV = vertexUV;
-}
\ No newline at end of file
+void main() {
+  mat4 model = ObjectMV();
+  gl_Position = P * V * model * vertPos;
+}
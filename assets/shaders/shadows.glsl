@@ -0,0 +1,45 @@
+// The shadows of the level's static geometry and of whatever moves, for the
+// shaders lit by the sun. Program defines SHADOW_MAX_CASCADES from
+// ShadowMaps.h in every shader.
+//
+// Set by ShadowMaps. Light space is s along the level, t across it and depth
+// along the light. The cascades wrap around in s, so a point's column is its s
+// modulo the cascade's width.
+uniform int shadowCascadeCount;
+uniform sampler2DArrayShadow shadowCascades;
+uniform sampler2DShadow shadowDynamic;
+uniform mat4 shadowView;
+// s and t of each map's corner, then its width and height
+uniform vec4 shadowWindows[SHADOW_MAX_CASCADES];
+uniform vec4 shadowDynamicWindow;
+// the depths the maps' 0 and 1 stand for
+uniform vec2 shadowDepth;
+
+bool InShadowWindow(vec2 uv) {
+  return all(greaterThan(uv, vec2(0.0))) && all(lessThan(uv, vec2(1.0)));
+}
+
+// 0 where the light can't reach, from the finest cascade that has the point
+// and whatever moves
+float ShadowVisibility(vec4 position) {
+  if (shadowCascadeCount == 0) {
+    return 1.0;
+  }
+  vec3 light = (shadowView * position).xyz;
+  float depth = clamp((-light.z - shadowDepth.x) /
+                      (shadowDepth.y - shadowDepth.x), 0.0, 1.0);
+  float visibility = 1.0;
+  for (int i = 0; i < shadowCascadeCount; i++) {
+    vec2 uv = (light.xy - shadowWindows[i].xy) / shadowWindows[i].zw;
+    if (InShadowWindow(uv)) {
+      float s = fract(light.x / shadowWindows[i].z);
+      visibility = texture(shadowCascades, vec4(s, uv.y, i, depth));
+      break;
+    }
+  }
+  vec2 uv = (light.xy - shadowDynamicWindow.xy) / shadowDynamicWindow.zw;
+  if (InShadowWindow(uv)) {
+    visibility = min(visibility, texture(shadowDynamic, vec3(uv, depth)));
+  }
+  return visibility;
+}
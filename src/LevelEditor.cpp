@@ -19,6 +19,7 @@
 #include "Platform.h"
 #include "LevelEditorUpdater.h"
 #include "LevelEditorState.h"
+#include "Profiler.h"
 
 #define MUSIC "music/4.wav"
 #define LEVEL "levels/level_2"
@@ -129,6 +130,8 @@ int main(int argc, char** argv) {
         return EXIT_SUCCESS;
       }
     }
+
+    PROFILE_END_FRAME();
   }
   RendererSetup::Close(window);
   return EXIT_SUCCESS;
@@ -22,6 +22,9 @@
 #include "VideoTexture.h"
 #include "FileSystemUtils.h"
 #include "ParticleGenerator.h"
+#include "Profiler.h"
+#include "GpuProfiler.h"
+#include "Replay.h"
 
 #define MUSIC "music/4.wav"
 #define LEVEL "levels/level_2"
@@ -48,9 +51,61 @@ void PrintStatus() {
 #endif
 }
 
+// Plays back a replay without rendering and checks the final state
+int PlayReplay(const std::string& replay_path) {
+  Replay replay;
+  if (!replay.Load(replay_path)) {
+    return EXIT_FAILURE;
+  }
+
+  GLFWwindow* window = RendererSetup::InitOpenGL(false);
+  InputBindings::Bind(window);
+
+  GameUpdater game_updater;
+  std::shared_ptr<GameState> game_state = std::make_shared<GameState>(
+      LevelGenerator::LoadLevel(replay.music_path, replay.level_path),
+      std::make_shared<GameCamera>(), std::make_shared<Player>(),
+      std::make_shared<Sky>(), window);
+  game_state->SetMuted(true);
+  game_updater.Init(game_state);
+
+  ReplayPlayer replay_player;
+  bool matched = replay_player.Play(replay, game_state, game_updater);
+  std::cout << replay_path << ": " << replay.steps.size() << " steps in "
+            << replay_player.GetElapsedSeconds() << "s, score "
+            << game_state->GetPlayer()->GetScore() << ", checksum "
+            << std::hex << replay_player.GetFinalChecksum();
+  if (!matched) {
+    std::cout << " expected " << replay.final_checksum;
+  }
+  std::cout << std::dec << std::endl;
+
+  RendererSetup::Close(window);
+  return matched ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
 int main(int argc, char** argv) {
+  // --record <path> saves every attempt to path, the last one wins
+  // --replay <path> plays path back headless and exits
+  // --gpu-csv <path> logs per render pass timings to path
+  std::string record_path;
+  std::string gpu_csv_path;
+  for (int i = 1; i + 1 < argc; i++) {
+    if (std::string(argv[i]) == "--record") {
+      record_path = argv[++i];
+    } else if (std::string(argv[i]) == "--replay") {
+      return PlayReplay(argv[++i]);
+    } else if (std::string(argv[i]) == "--gpu-csv") {
+      gpu_csv_path = argv[++i];
+    }
+  }
+
   GLFWwindow* window = RendererSetup::InitOpenGL();
+  if (!gpu_csv_path.empty()) {
+    GpuProfiler::OpenCsvLog(gpu_csv_path);
+  }
   InputBindings::Bind(window);
+  ReplayRecorder replay_recorder;
 
   MainProgramMode program_mode;
 
@@ -69,29 +124,16 @@ int main(int argc, char** argv) {
   while (!glfwWindowShouldClose(window)) {
     switch (program_mode) {
       case MainProgramMode::CREATE_NEW_GAME: {
-        LevelGenerator* level_generator;
-        if (FileSystemUtils::FileExists(menu_state->GetLevelPath())) {
-          std::ifstream input(menu_state->GetLevelPath());
-          nlohmann::json leveljson;
-          input >> leveljson;
-
-          std::vector<std::shared_ptr<GameObject>> level = leveljson;
-          std::shared_ptr<std::vector<std::shared_ptr<GameObject>>> lvl =
-              std::make_shared<std::vector<std::shared_ptr<GameObject>>>(level);
-
-          level_generator = new LevelGenerator(menu_state->GetMusicPath(), lvl);
-        } else {
-          level_generator = new LevelGenerator(menu_state->GetMusicPath());
-        }
         game_state = std::make_shared<GameState>(
-            level_generator->generateLevel(), std::make_shared<GameCamera>(),
-            std::make_shared<Player>(), std::make_shared<Sky>(), window);
+            LevelGenerator::LoadLevel(menu_state->GetMusicPath(),
+                                      menu_state->GetLevelPath()),
+            std::make_shared<GameCamera>(), std::make_shared<Player>(),
+            std::make_shared<Sky>(), window);
         // Only Video texture we have right now
         std::shared_ptr<VideoTexture> vid = std::make_shared<VideoTexture>(
             std::string(ASSET_DIR) + "/textures/sky");
         game_state->AddVideoTexture("sky", vid);
         game_updater.Init(game_state);
-        delete level_generator;
         program_mode = MainProgramMode::SET_CAMERA;
 
         // continue to SET_CAMERA
@@ -110,6 +152,10 @@ int main(int argc, char** argv) {
         game_updater.Reset(game_state);
         // lock cursor when starting game
         InputBindings::SetCursorMode(InputBindings::CursorMode::LOCKED);
+        if (!record_path.empty()) {
+          replay_recorder.Start(game_state, menu_state->GetMusicPath(),
+                                menu_state->GetLevelPath());
+        }
       // continue to GAME_SCREEN
       case MainProgramMode::GAME_SCREEN: {
         switch (game_state->GetPlayingState()) {
@@ -128,13 +174,29 @@ int main(int argc, char** argv) {
             // Update().
             //  What if the music starts/stops during one of multiple Updates?
             while (game_state->GetElapsedTicks() < target_tick_count) {
-              game_updater.Update(game_state);
+              if (replay_recorder.IsRecording()) {
+                replay_recorder.BeginStep(game_state);
+                game_updater.Update(game_state);
+                replay_recorder.EndStep(game_state);
+              } else {
+                game_updater.Update(game_state);
+              }
             }
             break;
           }
         }
 
         program_mode = game_renderer.Render(window, game_state);
+
+        // the attempt is over once the game is won/lost or left
+        if (replay_recorder.IsRecording() &&
+            (program_mode != MainProgramMode::GAME_SCREEN ||
+             game_state->GetPlayingState() ==
+                 GameState::PlayingState::FAILURE ||
+             game_state->GetPlayingState() ==
+                 GameState::PlayingState::SUCCESS)) {
+          replay_recorder.Finish(game_state, record_path);
+        }
         break;
       }
 
@@ -148,6 +210,7 @@ int main(int argc, char** argv) {
     }
 
     PrintStatus();
+    PROFILE_END_FRAME();
   }
 
   RendererSetup::Close(window);
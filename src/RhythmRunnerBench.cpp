@@ -0,0 +1,589 @@
+// Frame time benchmark. Plays every level in assets/levels for a fixed number
+// of frames with scripted input and writes the results as JSON, so runs from
+// different commits can be diffed.
+//
+//   RhythmRunnerBench [--frames N] [--sim-only] [--software] [--no-batching]
+//                     [--no-lod] [--depth-prepass] [--no-front-to-back]
+//                     [--gpu-cull] [--verify-culling]
+//                     [--minimap-interval N] [--gaussian-bloom]
+//                     [--bloom-quality low|medium|high]
+//                     [--shadow-quality off|low|medium|high]
+//                     [--dynamic-resolution ms] [--sync-loading]
+//                     [--no-mesh-cache] [--no-texture-cache]
+//                     [--no-program-binaries] [--music path] [--video folder]
+//                     [--out path] [level paths...]
+//
+// --sim-only runs GameUpdater and the view culling the simulation depends on,
+// but never draws. A hidden GL context is still created, since GameState
+// allocates particle buffers. --software asks Mesa for llvmpipe. On a box
+// without a display, run under xvfb-run, or point GLFW_DIR at a GLFW built
+// with GLFW_USE_OSMESA.
+//
+// --no-batching draws every object on its own instead of batching runs of
+// objects that share a program and textures, to compare the two. --no-lod
+// draws every mesh at full detail, to compare triangles per frame.
+// --depth-prepass draws the opaque depth before shading it, and
+// --no-front-to-back leaves opaque draws unsorted by depth band. Rendering
+// runs report the fragments the scene drew per pixel, to compare overdraw.
+// --minimap-interval redraws the minimap every N frames rather than at
+// MinimapRenderer's default rate, and 1 redraws it every frame.
+// --gaussian-bloom blurs with the original eight Gaussian passes instead of
+// the mip chain, and --bloom-quality sets how far down the mip chain goes.
+// --shadow-quality picks the ShadowMaps budget, and rendering runs report
+// the cascade strips and dynamic maps each level drew and their draw calls.
+// --dynamic-resolution scales the scene so it takes about ms on the GPU, and
+// reports the scales each level was drawn at. Without it the scene is drawn
+// at the window's size, so runs compare.
+//
+// Rendering runs start by timing startup the way RhythmRunner starts: the
+// window, GameRenderer::Init() and menu frames until every asset is uploaded.
+// --sync-loading loads every asset on the spot instead of on AssetLoader's
+// workers, --no-mesh-cache parses every OBJ instead of reading MeshCache,
+// --no-texture-cache cooks every texture instead of reading TextureCache and
+// --no-program-binaries compiles every shader instead of loading the binaries
+// ProgramCache saved, to compare. Rendering runs also time building every
+// program cold, compiling and saving binaries, and warm from the binaries.
+//
+// --gpu-cull culls the level with the compute shader in GpuCulling instead of
+// walking the Octree. --verify-culling also culls the main camera's view
+// with both after every frame, outside the timing, and counts the objects
+// they disagree on. It should always be 0, and it checks the compute shader
+// when the driver has one (llvmpipe does).
+//
+// --video streams the sky from another folder of frames than
+// assets/textures/sky, and rendering runs report how many frames of it were
+// shown and dropped.
+//
+// Rendering runs also time uniform updates by name against Uniform ids, and
+// after each level, time each bloom on the level's last frame and compare the
+// images the mip chain makes to the Gaussian one (run it with --software for
+// the same images on any machine). They end by storming the window with
+// resizes and checking that the render targets don't leak GL objects. Every
+// run times the frustum culling kernels against the original eight corner
+// test on random boxes and views, and counts the boxes they disagree on, and
+// checks them again on every box of each level from every frame's view.
+// Every run also loads each model from its OBJ and from MeshCache, times both
+// and checks they agree, and counts vertex cache misses before and after
+// VertexCache orders the triangles. It cooks each texture to BC1 and to RGB8
+// and reads it back from TextureCache, timing each, and reports the video
+// memory BC1 saves and the PSNR it costs.
+//
+// The report is written either way, but the exit status is a failure if any
+// of the checks above failed.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <new>
+
+#include "RendererSetup.h"
+#include "GameCamera.h"
+#include "GameRenderer.h"
+#include "GameState.h"
+#include "GameUpdater.h"
+#include "GpuCulling.h"
+#include "AssetLoader.h"
+#include "BenchTiming.h"
+#include "BloomBench.h"
+#include "CullingBench.h"
+#include "DynamicResolution.h"
+#include "InputBindings.h"
+#include "LevelGenerator.h"
+#include "MeshBench.h"
+#include "MeshCache.h"
+#include "MenuRenderer.h"
+#include "MenuState.h"
+#include "MinimapRenderer.h"
+#include "FileSystemUtils.h"
+#include "ProgramBench.h"
+#include "ProgramCache.h"
+#include "Profiler.h"
+#include "RenderQueue.h"
+#include "RenderStats.h"
+#include "ShadowMaps.h"
+#include "Sky.h"
+#include "TargetBench.h"
+#include "TextureBench.h"
+#include "TextureCache.h"
+#include "VideoTexture.h"
+#include "json.hpp"
+
+#define MUSIC "music/2.wav"
+#define BENCH_OUTPUT "bench.json"
+#define BENCH_FRAMES 3000
+// not measured, covers shader warm up and the first octree walks
+#define WARMUP_FRAMES 120
+// the scripted player holds jump for JUMP_HOLD_TICKS every JUMP_PERIOD_TICKS
+#define JUMP_PERIOD_TICKS 90
+#define JUMP_HOLD_TICKS 30
+// menu frames to wait for the assets before giving up
+#define STARTUP_MAX_MENU_FRAMES 10000
+
+static std::atomic<uint64_t> allocation_count(0);
+
+void* operator new(std::size_t size) {
+  allocation_count++;
+  void* p = std::malloc(size ? size : 1);
+  if (!p) {
+    throw std::bad_alloc();
+  }
+  return p;
+}
+
+void* operator new[](std::size_t size) {
+  return operator new(size);
+}
+
+void operator delete(void* p) noexcept {
+  std::free(p);
+}
+
+void operator delete[](void* p) noexcept {
+  std::free(p);
+}
+
+namespace {
+
+struct BenchOptions {
+  int frames = BENCH_FRAMES;
+  bool sim_only = false;
+  bool software = false;
+  bool batching = true;
+  bool lod = true;
+  bool depth_prepass = false;
+  bool front_to_back = true;
+  bool gpu_culling = false;
+  bool verify_culling = false;
+  int minimap_interval = 0;  // MinimapRenderer's default
+  bool gaussian_bloom = false;
+  BloomQuality bloom_quality = BloomQuality::MEDIUM;
+  ShadowQuality shadow_quality = ShadowQuality::MEDIUM;
+  double dynamic_resolution_ms = 0;  // off
+  bool sync_loading = false;
+  bool mesh_cache = true;
+  bool texture_cache = true;
+  bool program_binaries = true;
+  std::string music_path = ASSET_DIR "/" MUSIC;
+  std::string video_path = ASSET_DIR "/textures/sky";
+  std::string output_path = BENCH_OUTPUT;
+  std::vector<std::string> level_paths;
+};
+
+// Nearest rank percentile of sorted
+double Percentile(const std::vector<double>& sorted, double percent) {
+  if (sorted.empty()) {
+    return 0;
+  }
+  size_t rank = (size_t)std::ceil(percent / 100.0 * sorted.size());
+  return sorted[std::max<size_t>(rank, 1) - 1];
+}
+
+InputBindings::InputTick ScriptedInput(uint64_t tick) {
+  uint32_t space = InputBindings::RecordedKeyBit(GLFW_KEY_SPACE);
+  InputBindings::InputTick input = {0, 0, 0, 0};
+  uint64_t phase = tick % JUMP_PERIOD_TICKS;
+  if (phase < JUMP_HOLD_TICKS) {
+    input.keys_down = space;
+  }
+  if (phase == 0) {
+    input.keys_pressed = space;
+  }
+  return input;
+}
+
+std::shared_ptr<GameState> LoadGameState(const BenchOptions& options,
+                                         const std::string& level_path,
+                                         GLFWwindow* window) {
+  std::shared_ptr<GameState> game_state = std::make_shared<GameState>(
+      LevelGenerator::LoadLevel(options.music_path, level_path),
+      std::make_shared<GameCamera>(), std::make_shared<Player>(),
+      std::make_shared<Sky>(), window);
+  game_state->SetMuted(true);
+  if (!options.sim_only) {
+    game_state->AddVideoTexture(
+        "sky", std::make_shared<VideoTexture>(options.video_path));
+    // frames are timed with every asset in place
+    AssetLoader::WaitAll();
+  }
+  return game_state;
+}
+
+// Milliseconds from start, before the window was made, to the end of
+// GameRenderer::Init(), to the first menu frame, and to the frame that
+// uploaded the last asset
+nlohmann::json RunStartup(GLFWwindow* window,
+                          std::chrono::steady_clock::time_point start) {
+  nlohmann::json result;
+  result["init_ms"] = BenchTiming::MillisecondsSince(start);
+  result["assets_pending_after_init"] = AssetLoader::GetPending();
+  MenuRenderer menu_renderer;
+  std::shared_ptr<MenuState> menu_state = std::make_shared<MenuState>();
+  menu_renderer.Render(window, menu_state);
+  result["first_menu_frame_ms"] = BenchTiming::MillisecondsSince(start);
+  int menu_frames = 1;
+  while (AssetLoader::GetPending() && menu_frames < STARTUP_MAX_MENU_FRAMES) {
+    menu_renderer.Render(window, menu_state);
+    menu_frames++;
+  }
+  result["all_loaded_ms"] = BenchTiming::MillisecondsSince(start);
+  result["menu_frames"] = menu_frames;
+  std::cout << "startup: first menu frame "
+            << result["first_menu_frame_ms"].get<double>()
+            << " ms, everything loaded "
+            << result["all_loaded_ms"].get<double>() << " ms" << std::endl;
+  return result;
+}
+
+nlohmann::json RunLevel(const BenchOptions& options,
+                        const std::string& level_path,
+                        GLFWwindow* window,
+                        GameRenderer& game_renderer) {
+  std::shared_ptr<GameState> game_state =
+      LoadGameState(options, level_path, window);
+
+  GameUpdater game_updater;
+  game_updater.Init(game_state);
+  game_updater.UpdateCamera(game_state);
+  game_updater.Reset(game_state);
+
+  int width, height;
+  glfwGetFramebufferSize(window, &width, &height);
+  float aspect = width / (float)height;
+
+  std::vector<double> frame_ms;
+  uint64_t ticks = 0;
+  uint64_t draw_calls = 0;
+  uint64_t triangles = 0;
+  uint64_t state_changes = 0;
+  uint64_t state_changes_elided = 0;
+  uint64_t allocations = 0;
+  uint64_t kernel_mismatches = 0;
+  uint64_t culling_mismatches = 0;
+  double scale_total = 0;
+  float scale_min = 1.0f;
+  double fragments_per_pixel = 0;
+  int attempts = 1;
+
+  InputBindings::SetInputMode(InputBindings::InputMode::REPLAYING);
+  for (int frame = 0; frame < WARMUP_FRAMES + options.frames; frame++) {
+    // a new attempt isn't part of any frame
+    if (game_state->GetPlayingState() != GameState::PlayingState::PLAYING) {
+      game_updater.Reset(game_state);
+      attempts++;
+    }
+    uint64_t allocations_before = allocation_count;
+    std::chrono::steady_clock::time_point start =
+        std::chrono::steady_clock::now();
+
+    InputBindings::SetInputTick(ScriptedInput(game_state->GetElapsedTicks()));
+    game_updater.Update(game_state);
+    if (options.sim_only) {
+      GameRenderer::UpdateMinimapView(game_state, aspect);
+    } else {
+      game_renderer.Render(window, game_state);
+    }
+
+    double elapsed_ms = std::chrono::duration<double, std::milli>(
+                            std::chrono::steady_clock::now() - start)
+                            .count();
+    if (options.sim_only) {
+      RenderStats::EndFrame();  // Render() does this when drawing
+    }
+    const RenderStats::Counters& counters = RenderStats::GetLastFrame();
+    PROFILE_END_FRAME();
+    if (frame < WARMUP_FRAMES) {
+      // the cascades are drawn whole in the first frame, and only then
+      // follow the player a strip at a time
+      ShadowMaps::ResetStats();
+      continue;
+    }
+    frame_ms.push_back(elapsed_ms);
+    ticks++;
+    draw_calls += counters.draw_calls;
+    triangles += counters.triangles;
+    state_changes += counters.state_changes;
+    state_changes_elided += counters.state_changes_elided;
+    allocations += allocation_count - allocations_before;
+    scale_total += DynamicResolution::GetScale();
+    scale_min = std::min(scale_min, DynamicResolution::GetScale());
+    fragments_per_pixel += game_renderer.GetFragmentsPerPixel();
+    // after the allocations are counted
+    kernel_mismatches += CullingBench::KernelMismatches(game_state, aspect);
+    if (options.verify_culling) {
+      culling_mismatches += CullingBench::Mismatches(game_state, aspect);
+    }
+  }
+  InputBindings::SetInputMode(InputBindings::InputMode::LIVE);
+
+  double total_ms = 0;
+  for (double ms : frame_ms) {
+    total_ms += ms;
+  }
+  std::vector<double> sorted(frame_ms);
+  std::sort(sorted.begin(), sorted.end());
+  double frames = std::max<size_t>(frame_ms.size(), 1);
+
+  nlohmann::json result;
+  result["level"] = level_path.substr(level_path.find_last_of("/\\") + 1);
+  result["frames"] = frame_ms.size();
+  result["attempts"] = attempts;
+  result["frame_ms"]["mean"] = total_ms / frames;
+  result["frame_ms"]["p50"] = Percentile(sorted, 50);
+  result["frame_ms"]["p95"] = Percentile(sorted, 95);
+  result["frame_ms"]["p99"] = Percentile(sorted, 99);
+  result["frame_ms"]["max"] = sorted.empty() ? 0 : sorted.back();
+  result["ticks_per_second"] = total_ms > 0 ? ticks * 1000.0 / total_ms : 0;
+  result["draw_calls_per_frame"] = draw_calls / frames;
+  result["triangles_per_frame"] = triangles / frames;
+  result["state_changes_per_frame"] = state_changes / frames;
+  result["state_changes_elided_per_frame"] = state_changes_elided / frames;
+  result["allocations_per_frame"] = allocations / frames;
+  if (options.dynamic_resolution_ms > 0 && !options.sim_only) {
+    result["scale"]["mean"] = scale_total / frames;
+    result["scale"]["min"] = scale_min;
+  }
+  if (!options.sim_only) {
+    std::shared_ptr<VideoTexture> video = game_state->GetVideoTextures()["sky"];
+    result["video"]["frames"] = video->GetFrameCount();
+    result["video"]["shown"] = video->GetShownFrames();
+    result["video"]["dropped"] = video->GetDroppedFrames();
+    result["fragments_per_pixel"] = fragments_per_pixel / frames;
+    const ShadowMaps::Stats& shadow_stats = ShadowMaps::GetStats();
+    result["shadows"]["strips"] = shadow_stats.strips;
+    result["shadows"]["static_casters"] = shadow_stats.static_casters;
+    result["shadows"]["dynamic_maps"] = shadow_stats.dynamic_maps;
+    result["shadows"]["dynamic_casters"] = shadow_stats.dynamic_casters;
+    result["shadows"]["draw_calls_per_frame"] =
+        shadow_stats.draw_calls / frames;
+    result["bloom"] = BloomBench::Run(window, game_renderer);
+  }
+  result["kernel_mismatches"] = kernel_mismatches;
+  if (kernel_mismatches) {
+    std::cerr << result["level"].get<std::string>() << ": the culling "
+              << "kernels disagreed on " << kernel_mismatches
+              << " of the level's boxes" << std::endl;
+  }
+  if (options.verify_culling) {
+    result["culling_mismatches"] = culling_mismatches;
+    if (culling_mismatches) {
+      std::cerr << result["level"].get<std::string>() << ": GPU culling "
+                << "disagreed with the reference on " << culling_mismatches
+                << " objects" << std::endl;
+    }
+  }
+
+  std::cout << result["level"].get<std::string>() << ": p50 "
+            << Percentile(sorted, 50) << " ms, p95 " << Percentile(sorted, 95)
+            << " ms, p99 " << Percentile(sorted, 99) << " ms, "
+            << result["ticks_per_second"].get<double>() << " ticks/s"
+            << std::endl;
+  return result;
+}
+
+// Whether every check in report passed. The ones that didn't have already
+// said what they found on std::cerr.
+bool Passed(const nlohmann::json& report) {
+  const nlohmann::json& kernel = report["culling_kernel"];
+  if (kernel["kernel_mismatches"].get<uint64_t>() ||
+      kernel["plane_mask_mismatches"].get<uint64_t>() ||
+      kernel["legacy_mismatches_beyond_rounding"].get<uint64_t>()) {
+    return false;
+  }
+  if (report["meshes"]["load_mismatches"].get<uint64_t>() ||
+      report["meshes"]["box_mismatches"].get<uint64_t>()) {
+    return false;
+  }
+  if (report["textures"]["cache_mismatches"].get<uint64_t>()) {
+    return false;
+  }
+  if (report.count("resize_storm") &&
+      report["resize_storm"]["handle_growth"].get<int>()) {
+    return false;
+  }
+  for (const nlohmann::json& level : report["levels"]) {
+    if (level["kernel_mismatches"].get<uint64_t>() ||
+        level.value("culling_mismatches", (uint64_t)0)) {
+      return false;
+    }
+    if (level.count("bloom")) {
+      for (const nlohmann::json& mip_chain : level["bloom"]["mip_chain"]) {
+        if (!mip_chain["matches"].get<bool>()) {
+          return false;
+        }
+      }
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  BenchOptions options;
+  for (int i = 1; i < argc; i++) {
+    std::string arg(argv[i]);
+    if (arg == "--frames" && i + 1 < argc) {
+      options.frames = std::atoi(argv[++i]);
+    } else if (arg == "--sim-only") {
+      options.sim_only = true;
+    } else if (arg == "--software") {
+      options.software = true;
+    } else if (arg == "--no-batching") {
+      options.batching = false;
+    } else if (arg == "--no-lod") {
+      options.lod = false;
+    } else if (arg == "--depth-prepass") {
+      options.depth_prepass = true;
+    } else if (arg == "--no-front-to-back") {
+      options.front_to_back = false;
+    } else if (arg == "--gpu-cull") {
+      options.gpu_culling = true;
+    } else if (arg == "--verify-culling") {
+      options.verify_culling = true;
+    } else if (arg == "--minimap-interval" && i + 1 < argc) {
+      options.minimap_interval = std::atoi(argv[++i]);
+    } else if (arg == "--gaussian-bloom") {
+      options.gaussian_bloom = true;
+    } else if (arg == "--bloom-quality" && i + 1 < argc) {
+      std::string quality(argv[++i]);
+      options.bloom_quality = quality == "low" ? BloomQuality::LOW
+                              : quality == "high" ? BloomQuality::HIGH
+                                                  : BloomQuality::MEDIUM;
+    } else if (arg == "--shadow-quality" && i + 1 < argc) {
+      std::string quality(argv[++i]);
+      options.shadow_quality = quality == "off" ? ShadowQuality::OFF
+                               : quality == "low" ? ShadowQuality::LOW
+                               : quality == "high" ? ShadowQuality::HIGH
+                                                   : ShadowQuality::MEDIUM;
+    } else if (arg == "--dynamic-resolution" && i + 1 < argc) {
+      options.dynamic_resolution_ms = std::atof(argv[++i]);
+    } else if (arg == "--sync-loading") {
+      options.sync_loading = true;
+    } else if (arg == "--no-mesh-cache") {
+      options.mesh_cache = false;
+    } else if (arg == "--no-texture-cache") {
+      options.texture_cache = false;
+    } else if (arg == "--no-program-binaries") {
+      options.program_binaries = false;
+    } else if (arg == "--music" && i + 1 < argc) {
+      options.music_path = argv[++i];
+    } else if (arg == "--video" && i + 1 < argc) {
+      options.video_path = argv[++i];
+    } else if (arg == "--out" && i + 1 < argc) {
+      options.output_path = argv[++i];
+    } else {
+      options.level_paths.push_back(arg);
+    }
+  }
+  if (options.level_paths.empty()) {
+    options.level_paths = FileSystemUtils::ListFiles(ASSET_DIR "/levels", "*");
+  }
+
+  if (options.software) {
+#ifndef _WIN32
+    setenv("LIBGL_ALWAYS_SOFTWARE", "1", 1);
+    setenv("GALLIUM_DRIVER", "llvmpipe", 0);
+#else
+    std::cerr << "--software is only supported with Mesa" << std::endl;
+#endif
+  }
+
+  std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+  AssetLoader::SetAsync(!options.sync_loading);
+  MeshCache::SetEnabled(options.mesh_cache);
+  TextureCache::SetEnabled(options.texture_cache);
+  ProgramCache::SetBinariesEnabled(options.program_binaries);
+  GLFWwindow* window = RendererSetup::InitOpenGL(false);
+  double window_ms = BenchTiming::MillisecondsSince(start);
+  InputBindings::Bind(window);
+  glfwSwapInterval(0);  // measure frames, not vsync
+  RenderQueue::SetBatching(options.batching);
+  RenderQueue::SetLod(options.lod);
+  RenderQueue::SetDepthPrepass(options.depth_prepass);
+  RenderQueue::SetFrontToBack(options.front_to_back);
+  RenderQueue::SetCountFragments(!options.sim_only);
+  GameRenderer::SetGpuCulling(options.gpu_culling);
+  GameRenderer::SetGaussianBloom(options.gaussian_bloom);
+  GameRenderer::SetBloomQuality(options.bloom_quality);
+  ShadowMaps::SetQuality(options.shadow_quality);
+  DynamicResolution::SetEnabled(options.dynamic_resolution_ms > 0);
+  if (options.dynamic_resolution_ms > 0) {
+    DynamicResolution::SetTargetMs(options.dynamic_resolution_ms);
+  }
+  if (options.minimap_interval > 0) {
+    MinimapRenderer::SetRefreshInterval(options.minimap_interval);
+  }
+
+  GameRenderer game_renderer;
+  nlohmann::json startup;
+  if (!options.sim_only) {
+    game_renderer.Init(ASSET_DIR, window);
+    startup = RunStartup(window, start);
+    startup["window_ms"] = window_ms;
+  }
+
+  nlohmann::json report;
+#ifdef DEBUG
+  report["build"] = "debug";
+#else
+  report["build"] = "release";
+#endif
+  report["mode"] = options.sim_only ? "simulation" : "render";
+  report["batching"] = options.batching;
+  report["lod"] = options.lod;
+  report["depth_prepass"] = options.depth_prepass;
+  report["front_to_back"] = options.front_to_back;
+  report["gpu_culling"] = options.gpu_culling;
+  report["minimap_interval"] = MinimapRenderer::GetRefreshInterval();
+  report["bloom"] = options.gaussian_bloom ? "gaussian" : "mip chain";
+  report["bloom_quality"] = (int)options.bloom_quality;
+  report["shadow_quality"] = (int)options.shadow_quality;
+  report["dynamic_resolution_ms"] = options.dynamic_resolution_ms;
+  report["async_loading"] = !options.sync_loading;
+  report["mesh_cache"] = options.mesh_cache;
+  report["texture_cache"] = options.texture_cache;
+  report["program_binaries"] = options.program_binaries;
+  report["program_binaries_supported"] = ProgramCache::BinariesSupported();
+  report["texture_compression"] =
+      GLEW_EXT_texture_compression_s3tc ? "bc1" : "rgb8";
+  report["compute_shaders"] = GpuCulling::ComputeSupported();
+  report["gl_renderer"] = std::string((const char*)glGetString(GL_RENDERER));
+  report["warmup_frames"] = WARMUP_FRAMES;
+  report["music"] = options.music_path;
+  if (!options.sim_only) {
+    report["startup"] = startup;
+    report["uniform_submission"] = ProgramBench::RunUniforms();
+    report["programs"] = ProgramBench::Run();
+  }
+  report["culling_kernel"] = CullingBench::RunKernels();
+  report["meshes"] = MeshBench::Run();
+  report["textures"] = TextureBench::Run();
+  if (!options.sim_only && !options.level_paths.empty()) {
+    report["resize_storm"] = TargetBench::RunResizeStorm(
+        window, game_renderer,
+        LoadGameState(options, options.level_paths[0], window));
+  }
+  report["levels"] = nlohmann::json::array();
+  for (const std::string& level_path : options.level_paths) {
+    report["levels"].push_back(
+        RunLevel(options, level_path, window, game_renderer));
+  }
+
+  std::ofstream output(options.output_path);
+  if (!output) {
+    std::cerr << "Couldn't open " << options.output_path << std::endl;
+    RendererSetup::Close(window);
+    return EXIT_FAILURE;
+  }
+  output << report.dump(2) << std::endl;
+  std::cout << "Wrote " << options.output_path << std::endl;
+
+  RendererSetup::Close(window);
+  return Passed(report) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
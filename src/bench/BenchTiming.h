@@ -0,0 +1,17 @@
+#ifndef BENCH_TIMING_H_
+#define BENCH_TIMING_H_
+
+#include <chrono>
+
+// Timing shared by RhythmRunnerBench and the checks in src/bench
+namespace BenchTiming {
+
+inline double MillisecondsSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+}  // namespace BenchTiming
+
+#endif
@@ -0,0 +1,138 @@
+#include "BloomBench.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <utility>
+#include <vector>
+
+#include "GpuProfiler.h"
+#include "Profiler.h"
+
+#define BLOOM_BENCH_REPEATS 50
+// most mean difference from the Gaussian bloom, as a fraction of the
+// Gaussian bloom's own, and out of 255 when there's nothing bright to bloom
+#define BLOOM_BENCH_MAX_DIFFERENCE 0.5
+#define BLOOM_BENCH_MIN_DIFFERENCE 0.5
+
+namespace BloomBench {
+
+namespace {
+
+// Milliseconds per Bloom() at the renderer's settings. GPU time when there
+// are timer queries, otherwise wall time up to a glFinish(). The GPU time is
+// between two timestamps rather than a GL_TIME_ELAPSED query, which can't
+// be open around Bloom()'s own GPU_PASS queries.
+double TimeBloom(GameRenderer& game_renderer, int width, int height) {
+  bool timer_queries = GpuProfiler::TimerQueriesAvailable();
+  GLuint queries[2] = {0, 0};
+  glFinish();
+  std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+  if (timer_queries) {
+    glGenQueries(2, queries);
+    glQueryCounter(queries[0], GL_TIMESTAMP);
+  }
+  for (int i = 0; i < BLOOM_BENCH_REPEATS; i++) {
+    game_renderer.Bloom(width, height);
+  }
+  if (timer_queries) {
+    glQueryCounter(queries[1], GL_TIMESTAMP);
+    GLuint64 start_ns = 0;
+    GLuint64 end_ns = 0;
+    glGetQueryObjectui64v(queries[0], GL_QUERY_RESULT, &start_ns);
+    glGetQueryObjectui64v(queries[1], GL_QUERY_RESULT, &end_ns);
+    glDeleteQueries(2, queries);
+    return (end_ns - start_ns) / 1e6 / BLOOM_BENCH_REPEATS;
+  }
+  glFinish();
+  return std::chrono::duration<double, std::milli>(
+             std::chrono::steady_clock::now() - start)
+             .count() /
+         BLOOM_BENCH_REPEATS;
+}
+
+// The composited frame Bloom() just drew
+std::vector<unsigned char> ReadFrame(int width, int height) {
+  std::vector<unsigned char> pixels(width * height * 3);
+  glReadBuffer(GL_BACK);
+  glPixelStorei(GL_PACK_ALIGNMENT, 1);
+  glReadPixels(0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, &pixels[0]);
+  return pixels;
+}
+
+// Mean and largest difference of two frames, per channel, out of 255
+nlohmann::json ImageDifference(const std::vector<unsigned char>& a,
+                               const std::vector<unsigned char>& b) {
+  uint64_t total = 0;
+  int largest = 0;
+  for (size_t i = 0; i < a.size(); i++) {
+    int difference = std::abs((int)a[i] - (int)b[i]);
+    total += difference;
+    largest = std::max(largest, difference);
+  }
+  nlohmann::json result;
+  result["mean"] = a.empty() ? 0.0 : total / (double)a.size();
+  result["max"] = largest;
+  return result;
+}
+
+}  // namespace
+
+nlohmann::json Run(GLFWwindow* window, GameRenderer& game_renderer) {
+  PROFILE_SCOPE("BloomBench");
+  int width, height;
+  glfwGetFramebufferSize(window, &width, &height);
+  bool gaussian_bloom = GameRenderer::GetGaussianBloom();
+  BloomQuality bloom_quality = GameRenderer::GetBloomQuality();
+  GpuProfiler::Init();
+
+  nlohmann::json result;
+  result["timer_queries"] = GpuProfiler::TimerQueriesAvailable();
+  game_renderer.SetBloom(false);
+  game_renderer.Bloom(width, height);
+  std::vector<unsigned char> no_bloom = ReadFrame(width, height);
+  game_renderer.SetBloom(true);
+
+  GameRenderer::SetGaussianBloom(true);
+  result["gaussian_ms"] = TimeBloom(game_renderer, width, height);
+  std::vector<unsigned char> gaussian = ReadFrame(width, height);
+  result["gaussian_vs_no_bloom"] = ImageDifference(gaussian, no_bloom);
+
+  GameRenderer::SetGaussianBloom(false);
+  const std::pair<const char*, BloomQuality> qualities[] = {
+      {"low", BloomQuality::LOW},
+      {"medium", BloomQuality::MEDIUM},
+      {"high", BloomQuality::HIGH}};
+  for (const auto& quality : qualities) {
+    GameRenderer::SetBloomQuality(quality.second);
+    nlohmann::json mip_chain;
+    mip_chain["ms"] = TimeBloom(game_renderer, width, height);
+    mip_chain["vs_gaussian"] =
+        ImageDifference(ReadFrame(width, height), gaussian);
+    double allowed = std::max(
+        BLOOM_BENCH_MIN_DIFFERENCE,
+        BLOOM_BENCH_MAX_DIFFERENCE *
+            result["gaussian_vs_no_bloom"]["mean"].get<double>());
+    mip_chain["matches"] =
+        mip_chain["vs_gaussian"]["mean"].get<double>() <= allowed;
+    if (!mip_chain["matches"].get<bool>()) {
+      std::cerr << "bloom: the " << quality.first
+                << " mip chain is a mean "
+                << mip_chain["vs_gaussian"]["mean"].get<double>()
+                << " from the Gaussian bloom, past " << allowed << std::endl;
+    }
+    result["mip_chain"][quality.first] = mip_chain;
+  }
+
+  GameRenderer::SetGaussianBloom(gaussian_bloom);
+  GameRenderer::SetBloomQuality(bloom_quality);
+  std::cout << "bloom: " << result["gaussian_ms"].get<double>()
+            << " ms Gaussian, "
+            << result["mip_chain"]["medium"]["ms"].get<double>()
+            << " ms mip chain" << std::endl;
+  return result;
+}
+
+}  // namespace BloomBench
@@ -0,0 +1,19 @@
+#ifndef BLOOM_BENCH_H_
+#define BLOOM_BENCH_H_
+
+#include "GameRenderer.h"
+#include "json.hpp"
+
+// RhythmRunnerBench's timing and check of GameRenderer::Bloom()
+namespace BloomBench {
+
+// Blooms the last frame drawn with each blur, timing them and diffing the
+// mip chain's images against the Gaussian one. The mip chain is a different
+// blur, so it only has to be well closer to the Gaussian bloom than the
+// Gaussian bloom is to none: its mean difference can be at most
+// BLOOM_BENCH_MAX_DIFFERENCE of the difference the bloom makes at all.
+nlohmann::json Run(GLFWwindow* window, GameRenderer& game_renderer);
+
+}  // namespace BloomBench
+
+#endif
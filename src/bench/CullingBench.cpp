@@ -0,0 +1,237 @@
+#include "CullingBench.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <unordered_set>
+#include <vector>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "GameRenderer.h"
+#include "GpuCulling.h"
+#include "MatrixStack.h"
+#include "ViewFrustumCulling.h"
+
+// not a multiple of four, so CullBoxes' scalar tail is checked too
+#define CULLING_BENCH_BOXES 4099
+#define CULLING_BENCH_VIEWS 64
+// disagreements closer than this to a plane are float rounding
+#define CULLING_BENCH_EPSILON 1e-3f
+
+namespace CullingBench {
+
+namespace {
+
+// Distance from the nearest plane to the box corner farthest in front of it,
+// from the eight corners. Near 0, the tests can round either way.
+float CornerMargin(AxisAlignedBox box,
+                   const ViewFrustumCulling::Frustum& frustum) {
+  float margin = std::numeric_limits<float>::max();
+  for (const glm::vec4& plane : frustum.planes) {
+    float farthest = -std::numeric_limits<float>::max();
+    for (int corner = 0; corner < 8; corner++) {
+      glm::vec3 point((corner & 1) ? box.GetMax().x : box.GetMin().x,
+                      (corner & 2) ? box.GetMax().y : box.GetMin().y,
+                      (corner & 4) ? box.GetMax().z : box.GetMin().z);
+      farthest =
+          std::max(farthest, glm::dot(glm::vec3(plane), point) + plane.w);
+    }
+    margin = std::min(margin, std::fabs(farthest));
+  }
+  return margin;
+}
+
+// The projection GameRenderer culls the scene with
+glm::mat4 SceneProjection(float aspect) {
+  MatrixStack P;
+  P.pushMatrix();
+  P.perspective(45.0f, aspect, 0.01f, 1000.0f);
+  return P.topMatrix();
+}
+
+}  // namespace
+
+nlohmann::json RunKernels() {
+  std::mt19937 random(1);
+  std::uniform_real_distribution<float> position(-200.0f, 200.0f);
+  std::uniform_real_distribution<float> size(0.0f, 20.0f);
+  std::vector<AxisAlignedBox> boxes;
+  ViewFrustumCulling::BoxArray box_array;
+  for (int i = 0; i < CULLING_BENCH_BOXES; i++) {
+    glm::vec3 min(position(random), position(random), position(random));
+    glm::vec3 max = min + glm::vec3(size(random), size(random), size(random));
+    boxes.push_back(AxisAlignedBox(min, max));
+    box_array.Add(boxes.back());
+  }
+  MatrixStack P;
+  P.pushMatrix();
+  P.perspective(45.0f, 16.0f / 9.0f, 0.01f, 1000.0f);
+  std::vector<ViewFrustumCulling::Frustum> frustums;
+  std::vector<std::shared_ptr<std::vector<glm::vec4>>> planes;
+  for (int i = 0; i < CULLING_BENCH_VIEWS; i++) {
+    glm::vec3 eye(position(random), position(random), position(random));
+    glm::vec3 target(position(random), position(random), position(random));
+    glm::mat4 V = glm::lookAt(eye, target, glm::vec3(0, 1, 0));
+    frustums.push_back(ViewFrustumCulling::GetFrustum(P.topMatrix(), V));
+    planes.push_back(
+        ViewFrustumCulling::GetViewFrustumPlanes(P.topMatrix(), V));
+  }
+
+  std::vector<unsigned char> legacy(CULLING_BENCH_BOXES * CULLING_BENCH_VIEWS);
+  std::vector<unsigned char> scalar(legacy.size());
+  std::vector<unsigned char> simd(legacy.size());
+  std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+  for (int view = 0; view < CULLING_BENCH_VIEWS; view++) {
+    for (int i = 0; i < CULLING_BENCH_BOXES; i++) {
+      legacy[view * CULLING_BENCH_BOXES + i] =
+          ViewFrustumCulling::IsCulled(boxes[i], planes[view]);
+    }
+  }
+  std::chrono::steady_clock::time_point legacy_end =
+      std::chrono::steady_clock::now();
+  for (int view = 0; view < CULLING_BENCH_VIEWS; view++) {
+    for (int i = 0; i < CULLING_BENCH_BOXES; i++) {
+      scalar[view * CULLING_BENCH_BOXES + i] =
+          ViewFrustumCulling::IsCulled(boxes[i], frustums[view]);
+    }
+  }
+  std::chrono::steady_clock::time_point scalar_end =
+      std::chrono::steady_clock::now();
+  for (int view = 0; view < CULLING_BENCH_VIEWS; view++) {
+    ViewFrustumCulling::CullBoxes(box_array, frustums[view],
+                                  &simd[view * CULLING_BENCH_BOXES]);
+  }
+  std::chrono::steady_clock::time_point simd_end =
+      std::chrono::steady_clock::now();
+
+  // every set of planes the Octree walk can leave a node to test against
+  uint64_t plane_mask_mismatches = 0;
+  std::vector<unsigned char> masked(CULLING_BENCH_BOXES);
+  for (int mask = 0; mask <= VFC_ALL_PLANES; mask++) {
+    for (int view = 0; view < CULLING_BENCH_VIEWS; view++) {
+      ViewFrustumCulling::CullBoxes(box_array, frustums[view], &masked[0],
+                                    mask);
+      for (int i = 0; i < CULLING_BENCH_BOXES; i++) {
+        unsigned char plane_mask = mask;
+        unsigned char first_plane = 0;
+        ViewFrustumCulling::Containment containment =
+            ViewFrustumCulling::Classify(boxes[i], frustums[view], plane_mask,
+                                         first_plane);
+        plane_mask_mismatches +=
+            masked[i] !=
+            (containment == ViewFrustumCulling::Containment::OUTSIDE);
+      }
+    }
+  }
+
+  uint64_t kernel_mismatches = 0;
+  uint64_t legacy_mismatches = 0;
+  uint64_t legacy_mismatches_beyond_rounding = 0;
+  uint64_t culled = 0;
+  for (size_t i = 0; i < legacy.size(); i++) {
+    culled += scalar[i];
+    kernel_mismatches += scalar[i] != simd[i];
+    if (scalar[i] != legacy[i]) {
+      legacy_mismatches++;
+      if (CornerMargin(boxes[i % CULLING_BENCH_BOXES],
+                       frustums[i / CULLING_BENCH_BOXES]) >
+          CULLING_BENCH_EPSILON) {
+        legacy_mismatches_beyond_rounding++;
+      }
+    }
+  }
+
+  double tests = legacy.size();
+  nlohmann::json result;
+  result["boxes"] = CULLING_BENCH_BOXES;
+  result["views"] = CULLING_BENCH_VIEWS;
+  result["culled_fraction"] = culled / tests;
+  result["legacy_ns_per_box"] =
+      std::chrono::duration<double, std::nano>(legacy_end - start).count() /
+      tests;
+  result["scalar_ns_per_box"] =
+      std::chrono::duration<double, std::nano>(scalar_end - legacy_end)
+          .count() /
+      tests;
+  result["simd_ns_per_box"] =
+      std::chrono::duration<double, std::nano>(simd_end - scalar_end).count() /
+      tests;
+  result["kernel_mismatches"] = kernel_mismatches;
+  result["plane_mask_mismatches"] = plane_mask_mismatches;
+  result["legacy_mismatches"] = legacy_mismatches;
+  result["legacy_mismatches_beyond_rounding"] =
+      legacy_mismatches_beyond_rounding;
+  std::cout << "frustum culling: " << result["legacy_ns_per_box"].get<double>()
+            << " ns per box original, "
+            << result["scalar_ns_per_box"].get<double>() << " ns scalar, "
+            << result["simd_ns_per_box"].get<double>() << " ns SIMD"
+            << std::endl;
+  if (kernel_mismatches || plane_mask_mismatches ||
+      legacy_mismatches_beyond_rounding) {
+    std::cerr << "frustum culling kernels disagree: " << kernel_mismatches
+              << " SIMD, " << plane_mask_mismatches
+              << " SIMD with a plane mask, "
+              << legacy_mismatches_beyond_rounding << " against the original"
+              << std::endl;
+  }
+  return result;
+}
+
+uint64_t KernelMismatches(std::shared_ptr<GameState> game_state,
+                          float aspect) {
+  glm::mat4 P = SceneProjection(aspect);
+  glm::mat4 V = game_state->GetCamera()->getView().topMatrix();
+  ViewFrustumCulling::Frustum frustum = ViewFrustumCulling::GetFrustum(P, V);
+  std::shared_ptr<std::vector<glm::vec4>> planes =
+      ViewFrustumCulling::GetViewFrustumPlanes(P, V);
+  const std::vector<std::shared_ptr<GameObject>>& objects =
+      *game_state->GetLevel()->getObjects();
+  ViewFrustumCulling::BoxArray box_array;
+  for (const std::shared_ptr<GameObject>& object : objects) {
+    box_array.Add(object->GetBoundingBox());
+  }
+  std::vector<unsigned char> simd(objects.size());
+  if (!objects.empty()) {
+    ViewFrustumCulling::CullBoxes(box_array, frustum, &simd[0]);
+  }
+  uint64_t mismatches = 0;
+  for (size_t i = 0; i < objects.size(); i++) {
+    AxisAlignedBox box = objects[i]->GetBoundingBox();
+    bool scalar = ViewFrustumCulling::IsCulled(box, frustum);
+    if (scalar != (bool)simd[i] ||
+        (scalar != ViewFrustumCulling::IsCulled(box, planes) &&
+         CornerMargin(box, frustum) > CULLING_BENCH_EPSILON)) {
+      mismatches++;
+    }
+  }
+  return mismatches;
+}
+
+uint64_t Mismatches(std::shared_ptr<GameState> game_state, float aspect) {
+  ViewFrustumCulling::Frustum frustum = ViewFrustumCulling::GetFrustum(
+      SceneProjection(aspect), game_state->GetCamera()->getView().topMatrix());
+
+  GameRenderer::UpdateGpuCulling(game_state);
+  GpuCulling::Cull(frustum);
+  std::unique_ptr<std::unordered_set<std::shared_ptr<GameObject>>> visible(
+      GpuCulling::ReadVisible());
+  std::unique_ptr<std::unordered_set<std::shared_ptr<GameObject>>> octree(
+      GameRenderer::GetObjectsInView(frustum, game_state->GetLevel()->getTree(),
+                                     SCENE_CULLING_VIEW));
+  uint64_t mismatches = 0;
+  for (std::shared_ptr<GameObject> object :
+       *game_state->GetLevel()->getObjects()) {
+    if (visible->count(object) != octree->count(object) &&
+        CornerMargin(object->GetBoundingBox(), frustum) >
+            CULLING_BENCH_EPSILON) {
+      mismatches++;
+    }
+  }
+  return mismatches;
+}
+
+}  // namespace CullingBench
@@ -0,0 +1,32 @@
+#ifndef CULLING_BENCH_H_
+#define CULLING_BENCH_H_
+
+#include <cstdint>
+#include <memory>
+
+#include "GameState.h"
+#include "json.hpp"
+
+// RhythmRunnerBench's checks of frustum culling
+namespace CullingBench {
+
+// Culls the same random boxes against random views with the original
+// ViewFrustumCulling::IsCulled, the center and extent IsCulled, and
+// CullBoxes. CullBoxes must agree with the scalar test exactly, and both
+// with the original except within rounding of a plane. CullBoxes is also
+// checked against Classify() with every plane mask.
+nlohmann::json RunKernels();
+// Boxes of every object in the level that CullBoxes, the scalar IsCulled and
+// the original disagree on, culled against the main camera's frustum, so the
+// kernels are checked on the game's own boxes from the views it plays
+uint64_t KernelMismatches(std::shared_ptr<GameState> game_state,
+                          float aspect);
+// Objects in exactly one of GpuCulling's and the Octree's visible sets,
+// culled against the main camera's frustum. The two compute the test in
+// different forms, so boxes that only touch a plane, within
+// CULLING_BENCH_EPSILON, can round either way and don't count.
+uint64_t Mismatches(std::shared_ptr<GameState> game_state, float aspect);
+
+}  // namespace CullingBench
+
+#endif
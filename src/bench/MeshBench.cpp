@@ -0,0 +1,134 @@
+#include "MeshBench.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "AxisAlignedBox.h"
+#include "BenchTiming.h"
+#include "FileSystemUtils.h"
+#include "MeshCache.h"
+#include "Shape.h"
+#include "VertexCache.h"
+#include "tiny_obj_loader.h"
+
+#define MESH_BENCH_REPEATS 5
+#define MESH_BENCH_TRANSFORMS 64
+
+namespace MeshBench {
+
+namespace {
+
+// Best of MESH_BENCH_REPEATS loads of path into a new shape
+double TimeLoadMesh(const std::string& path, std::shared_ptr<Shape>& shape) {
+  double best = std::numeric_limits<double>::max();
+  for (int i = 0; i < MESH_BENCH_REPEATS; i++) {
+    shape = std::make_shared<Shape>();
+    std::chrono::steady_clock::time_point start =
+        std::chrono::steady_clock::now();
+    shape->loadMesh(path);
+    best = std::min(best, BenchTiming::MillisecondsSince(start));
+  }
+  return best;
+}
+
+bool SameMesh(Shape& one, Shape& other) {
+  if (one.GetPositions() != other.GetPositions() ||
+      one.GetNormals() != other.GetNormals() ||
+      one.GetTexCoords() != other.GetTexCoords() ||
+      one.GetLodCount() != other.GetLodCount()) {
+    return false;
+  }
+  for (int lod = 0; lod < one.GetLodCount(); lod++) {
+    if (one.GetElements(lod) != other.GetElements(lod)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
+nlohmann::json Run() {
+  bool cache_enabled = MeshCache::GetEnabled();
+  std::mt19937 random(1);
+  std::uniform_real_distribution<float> scale(-4.0f, 4.0f);
+  std::uniform_real_distribution<float> offset(-100.0f, 100.0f);
+  uint64_t load_mismatches = 0;
+  uint64_t box_mismatches = 0;
+  nlohmann::json result;
+  for (const std::string& path :
+       FileSystemUtils::ListFiles(ASSET_DIR "/models", "*.obj")) {
+    std::shared_ptr<Shape> from_obj;
+    std::shared_ptr<Shape> from_cache;
+    MeshCache::SetEnabled(false);
+    double obj_ms = TimeLoadMesh(path, from_obj);
+    MeshCache::SetEnabled(true);
+    // writes the cache if there isn't one
+    std::make_shared<Shape>()->loadMesh(path);
+    double cache_ms = TimeLoadMesh(path, from_cache);
+    bool same = SameMesh(*from_obj, *from_cache);
+    load_mismatches += !same;
+
+    std::vector<tinyobj::shape_t> shapes;
+    std::vector<tinyobj::material_t> materials;
+    std::string error;
+    tinyobj::LoadObj(shapes, materials, error, path.c_str());
+    std::vector<float> positions = from_cache->GetPositions();
+    size_t vertex_count = positions.size() / 3;
+
+    for (int i = 0; i < MESH_BENCH_TRANSFORMS; i++) {
+      glm::mat4 transform =
+          glm::translate(glm::mat4(1.0f),
+                         glm::vec3(offset(random), offset(random),
+                                   offset(random))) *
+          glm::scale(glm::mat4(1.0f), glm::vec3(scale(random), scale(random),
+                                                scale(random)));
+      AxisAlignedBox box(from_cache, transform);
+      glm::vec3 min(std::numeric_limits<float>::max());
+      glm::vec3 max(-std::numeric_limits<float>::max());
+      for (size_t v = 0; v < vertex_count; v++) {
+        glm::vec3 position(transform * glm::vec4(positions[3 * v],
+                                                 positions[3 * v + 1],
+                                                 positions[3 * v + 2], 1.0f));
+        min = glm::min(min, position);
+        max = glm::max(max, position);
+      }
+      box_mismatches += vertex_count && (box.GetMin() != min ||
+                                         box.GetMax() != max);
+    }
+
+    nlohmann::json mesh;
+    mesh["vertices"] = vertex_count;
+    mesh["triangles"] = from_cache->GetElements().size() / 3;
+    mesh["lods"] = from_cache->GetLodCount();
+    mesh["obj_ms"] = obj_ms;
+    mesh["cache_ms"] = cache_ms;
+    mesh["cache_matches"] = same;
+    mesh["acmr_obj"] =
+        shapes.empty() ? 0.0f
+                       : VertexCache::Acmr(shapes[0].mesh.indices,
+                                           vertex_count);
+    mesh["acmr_optimized"] =
+        VertexCache::Acmr(from_cache->GetElements(), vertex_count);
+    result["models"][path.substr(path.find_last_of("/\\") + 1)] = mesh;
+  }
+  MeshCache::SetEnabled(cache_enabled);
+  result["vertex_cache_size"] = VERTEX_CACHE_SIZE;
+  result["load_mismatches"] = load_mismatches;
+  result["box_mismatches"] = box_mismatches;
+  if (load_mismatches || box_mismatches) {
+    std::cerr << "meshes: " << load_mismatches
+              << " loaded differently from their cache, " << box_mismatches
+              << " boxes differed from their vertices'" << std::endl;
+  }
+  return result;
+}
+
+}  // namespace MeshBench
@@ -0,0 +1,17 @@
+#ifndef MESH_BENCH_H_
+#define MESH_BENCH_H_
+
+#include "json.hpp"
+
+// RhythmRunnerBench's timing and checks of loading meshes
+namespace MeshBench {
+
+// Loads every model from its OBJ and from MeshCache and checks the two
+// agree. Compares the vertex cache misses of the OBJ's triangle order with
+// VertexCache's, and checks the boxes AxisAlignedBox makes of unrotated
+// models from their bounds against the boxes of their transformed vertices.
+nlohmann::json Run();
+
+}  // namespace MeshBench
+
+#endif
@@ -0,0 +1,105 @@
+#include "ProgramBench.h"
+
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+#include <glm/gtc/type_ptr.hpp>
+
+#include "BenchTiming.h"
+#include "FileSystemUtils.h"
+#include "GameRenderer.h"
+#include "Program.h"
+#include "ProgramCache.h"
+
+#define UNIFORM_BENCH_DRAWS 100000
+
+namespace ProgramBench {
+
+namespace {
+
+// Milliseconds to build every program in assets/shaders through a cleared
+// ProgramCache. glFinish() waits for drivers that compile in the background.
+double TimeBuildPrograms(const std::vector<std::string>& json_paths) {
+  ProgramCache::Clear();
+  std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+  for (const std::string& json_path : json_paths) {
+    ProgramCache::Get(json_path);
+  }
+  glFinish();
+  return BenchTiming::MillisecondsSince(start);
+}
+
+}  // namespace
+
+nlohmann::json Run() {
+  bool binaries_enabled = ProgramCache::GetBinariesEnabled();
+  std::vector<std::string> json_paths =
+      FileSystemUtils::ListFiles(ASSET_DIR "/shaders", "*.json");
+  nlohmann::json result;
+  ProgramCache::SetBinariesEnabled(false);
+  result["cold_ms"] = TimeBuildPrograms(json_paths);
+  ProgramCache::SetBinariesEnabled(true);
+  result["first_run_ms"] = TimeBuildPrograms(json_paths);
+  result["warm_ms"] = TimeBuildPrograms(json_paths);
+  ProgramCache::Stats warm = ProgramCache::GetStats();
+  result["programs"] = warm.programs;
+  result["warm_compiled"] = warm.compiled;
+  result["warm_binaries_loaded"] = warm.binaries_loaded;
+  ProgramCache::SetBinariesEnabled(binaries_enabled);
+  std::cout << "programs: " << result["cold_ms"].get<double>()
+            << " ms cold, " << result["warm_ms"].get<double>()
+            << " ms warm, " << warm.binaries_loaded << " of " << warm.programs
+            << " from binaries" << std::endl;
+  return result;
+}
+
+nlohmann::json RunUniforms() {
+  std::shared_ptr<Program> program =
+      GameRenderer::ProgramFromJSON(ASSET_DIR "/shaders/note.json");
+  glm::mat4 transform(1.0f);
+  glm::vec3 color(1.0f, 0.5f, 0.0f);
+  program->bind();
+
+  std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+  for (int i = 0; i < UNIFORM_BENCH_DRAWS; i++) {
+    glUniformMatrix4fv(program->getUniform("MV"), 1, GL_FALSE,
+                       glm::value_ptr(transform));
+    glUniform3f(program->getUniform("in_obj_color"), color.x, color.y,
+                color.z);
+    glUniform1i(program->getUniform("isCollected"), 0);
+    glUniform1i(program->getUniform("timeCollected"), i);
+  }
+  glFinish();
+  std::chrono::steady_clock::time_point by_name =
+      std::chrono::steady_clock::now();
+  for (int i = 0; i < UNIFORM_BENCH_DRAWS; i++) {
+    program->setUniform(Uniform::MV, transform);
+    program->setUniform(Uniform::in_obj_color, color);
+    program->setUniform(Uniform::isCollected, 0);
+    program->setUniform(Uniform::timeCollected, i);
+  }
+  glFinish();
+  std::chrono::steady_clock::time_point by_id =
+      std::chrono::steady_clock::now();
+
+  nlohmann::json result;
+  result["draws"] = UNIFORM_BENCH_DRAWS;
+  result["by_name_ns_per_draw"] =
+      std::chrono::duration<double, std::nano>(by_name - start).count() /
+      UNIFORM_BENCH_DRAWS;
+  result["by_id_ns_per_draw"] =
+      std::chrono::duration<double, std::nano>(by_id - by_name).count() /
+      UNIFORM_BENCH_DRAWS;
+  std::cout << "uniform updates: "
+            << result["by_name_ns_per_draw"].get<double>()
+            << " ns per draw by name, "
+            << result["by_id_ns_per_draw"].get<double>() << " ns by id"
+            << std::endl;
+  return result;
+}
+
+}  // namespace ProgramBench
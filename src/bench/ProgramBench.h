@@ -0,0 +1,20 @@
+#ifndef PROGRAM_BENCH_H_
+#define PROGRAM_BENCH_H_
+
+#include "json.hpp"
+
+// RhythmRunnerBench's timing of building programs and setting their uniforms
+namespace ProgramBench {
+
+// Builds every program cold, compiling without binaries, then compiling and
+// saving binaries as a first run does, then warm from them. The programs
+// made here are left behind, everything else already has its own.
+nlohmann::json Run();
+// Times the per collectible uniform updates RenderQueue::Execute makes, with
+// locations looked up by name and by Uniform id. The GL calls are the same
+// both ways, so the difference is the lookup.
+nlohmann::json RunUniforms();
+
+}  // namespace ProgramBench
+
+#endif
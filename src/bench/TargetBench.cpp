@@ -0,0 +1,89 @@
+#include "TargetBench.h"
+
+#include <iostream>
+#include <random>
+
+#include "GameUpdater.h"
+#include "RenderTargets.h"
+
+// frames of a new window size every frame, then of holding still
+#define RESIZE_STORM_FRAMES 60
+#define RESIZE_HOLD_FRAMES 10
+
+namespace TargetBench {
+
+namespace {
+
+nlohmann::json TargetStats(const RenderTargets::Stats& stats) {
+  nlohmann::json result;
+  result["targets"] = stats.targets;
+  result["framebuffers"] = stats.framebuffers;
+  result["textures"] = stats.textures;
+  result["renderbuffers"] = stats.renderbuffers;
+  result["megabytes"] = stats.bytes / (1024.0 * 1024.0);
+  return result;
+}
+
+}  // namespace
+
+nlohmann::json RunResizeStorm(GLFWwindow* window,
+                              GameRenderer& game_renderer,
+                              std::shared_ptr<GameState> game_state) {
+  GameUpdater game_updater;
+  game_updater.Init(game_state);
+  game_updater.UpdateCamera(game_state);
+  game_updater.Reset(game_state);
+
+  int width, height;
+  glfwGetWindowSize(window, &width, &height);
+  game_renderer.Render(window, game_state);
+  RenderTargets::Stats before = RenderTargets::GetStats();
+  RenderTargets::Stats peak = before;
+  std::mt19937 random(1);
+  std::uniform_int_distribution<int> grow(0, width / 2);
+  bool resized = false;
+  for (int frame = 0; frame < RESIZE_STORM_FRAMES + 2 * RESIZE_HOLD_FRAMES;
+       frame++) {
+    if (frame < RESIZE_STORM_FRAMES) {
+      glfwSetWindowSize(window, width / 2 + grow(random),
+                        height / 2 + grow(random) * height / width);
+    } else if (frame == RESIZE_STORM_FRAMES) {
+      glfwSetWindowSize(window, width * 3 / 4, height * 3 / 4);
+    } else if (frame == RESIZE_STORM_FRAMES + RESIZE_HOLD_FRAMES) {
+      glfwSetWindowSize(window, width, height);
+    }
+    game_updater.Update(game_state);
+    game_renderer.Render(window, game_state);
+    int framebuffer_width, framebuffer_height;
+    glfwGetFramebufferSize(window, &framebuffer_width, &framebuffer_height);
+    resized = resized || framebuffer_width != width;
+    RenderTargets::Stats stats = RenderTargets::GetStats();
+    if (stats.bytes > peak.bytes) {
+      peak = stats;
+    }
+  }
+  RenderTargets::Stats after = RenderTargets::GetStats();
+
+  nlohmann::json result;
+  // some platforms never resize a hidden window, then this proves nothing
+  result["resized"] = resized;
+  result["storm_frames"] = RESIZE_STORM_FRAMES;
+  result["targets_created"] = after.created - before.created;
+  result["before"] = TargetStats(before);
+  result["peak"] = TargetStats(peak);
+  result["after"] = TargetStats(after);
+  int growth = (after.framebuffers - before.framebuffers) +
+               (after.textures - before.textures) +
+               (after.renderbuffers - before.renderbuffers);
+  result["handle_growth"] = growth;
+  std::cout << "resize storm: " << after.created - before.created
+            << " targets created, " << growth << " GL objects more after"
+            << std::endl;
+  if (growth) {
+    std::cerr << "render targets leaked " << growth
+              << " GL objects over a resize storm" << std::endl;
+  }
+  return result;
+}
+
+}  // namespace TargetBench
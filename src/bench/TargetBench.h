@@ -0,0 +1,23 @@
+#ifndef TARGET_BENCH_H_
+#define TARGET_BENCH_H_
+
+#include <memory>
+
+#include "GameRenderer.h"
+#include "GameState.h"
+#include "json.hpp"
+
+// RhythmRunnerBench's check of RenderTargets
+namespace TargetBench {
+
+// Resizes the window every frame for a while, as a resize drag does, then
+// holds it at another size and puts it back. The render targets should be
+// reallocated once for each size that was held, and end up with exactly the
+// GL objects they started with. game_state plays all the while.
+nlohmann::json RunResizeStorm(GLFWwindow* window,
+                              GameRenderer& game_renderer,
+                              std::shared_ptr<GameState> game_state);
+
+}  // namespace TargetBench
+
+#endif
@@ -0,0 +1,102 @@
+#include "TextureBench.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "BenchTiming.h"
+#include "BlockCompression.h"
+#include "FileSystemUtils.h"
+#include "TextureCache.h"
+
+#define TEXTURE_BENCH_REPEATS 3
+
+namespace TextureBench {
+
+nlohmann::json Run() {
+  bool cache_enabled = TextureCache::GetEnabled();
+  TextureCache::SetEnabled(true);
+  std::vector<std::string> paths =
+      FileSystemUtils::ListFiles(ASSET_DIR "/textures", "*.jpg");
+  std::vector<std::string> pngs =
+      FileSystemUtils::ListFiles(ASSET_DIR "/textures", "*.png");
+  paths.insert(paths.end(), pngs.begin(), pngs.end());
+  uint64_t cache_mismatches = 0;
+  uint64_t total_rgba8_bytes = 0;
+  uint64_t total_bc1_bytes = 0;
+  nlohmann::json result;
+  for (const std::string& path : paths) {
+    TextureCache::Image bc1;
+    TextureCache::Image rgb8;
+    std::chrono::steady_clock::time_point start =
+        std::chrono::steady_clock::now();
+    if (!TextureCache::Cook(path, GL_COMPRESSED_RGB_S3TC_DXT1_EXT, bc1)) {
+      continue;
+    }
+    double bc1_cook_ms = BenchTiming::MillisecondsSince(start);
+    start = std::chrono::steady_clock::now();
+    TextureCache::Cook(path, GL_RGB8, rgb8);
+    double rgb8_cook_ms = BenchTiming::MillisecondsSince(start);
+
+    TextureCache::Write(path, bc1);
+    TextureCache::Image cached;
+    bool same = false;
+    double cache_ms = std::numeric_limits<double>::max();
+    for (int i = 0; i < TEXTURE_BENCH_REPEATS; i++) {
+      start = std::chrono::steady_clock::now();
+      same = TextureCache::Read(path, GL_COMPRESSED_RGB_S3TC_DXT1_EXT,
+                                cached);
+      cache_ms = std::min(cache_ms, BenchTiming::MillisecondsSince(start));
+    }
+    same = same && cached.data == bc1.data;
+    cache_mismatches += !same;
+
+    uint64_t rgba8_bytes = 0;
+    for (const TextureCache::Level& level : rgb8.levels) {
+      rgba8_bytes += (uint64_t)level.width * level.height * 4;
+    }
+    const TextureCache::Level& full = bc1.levels[0];
+    std::vector<unsigned char> decompressed = BlockCompression::DecompressBc1(
+        &bc1.data[0], full.width, full.height);
+    double squared_error = 0.0;
+    for (size_t i = 0; i < decompressed.size(); i++) {
+      double difference = (double)decompressed[i] - rgb8.data[i];
+      squared_error += difference * difference;
+    }
+    double mse = squared_error / decompressed.size();
+    total_rgba8_bytes += rgba8_bytes;
+    total_bc1_bytes += bc1.data.size();
+
+    nlohmann::json texture;
+    texture["width"] = full.width;
+    texture["height"] = full.height;
+    texture["levels"] = bc1.levels.size();
+    texture["rgba8_bytes"] = rgba8_bytes;
+    texture["bc1_bytes"] = bc1.data.size();
+    texture["bc1_cook_ms"] = bc1_cook_ms;
+    texture["rgb8_cook_ms"] = rgb8_cook_ms;
+    texture["cache_ms"] = cache_ms;
+    texture["cache_matches"] = same;
+    texture["bc1_psnr"] = mse > 0 ? 10.0 * std::log10(255.0 * 255.0 / mse)
+                                  : std::numeric_limits<double>::infinity();
+    result["textures"][path.substr(path.find_last_of("/\\") + 1)] = texture;
+  }
+  TextureCache::SetEnabled(cache_enabled);
+  result["rgba8_bytes"] = total_rgba8_bytes;
+  result["bc1_bytes"] = total_bc1_bytes;
+  result["cache_mismatches"] = cache_mismatches;
+  std::cout << "textures: " << total_rgba8_bytes / (1024.0 * 1024.0)
+            << " MB as RGBA8, " << total_bc1_bytes / (1024.0 * 1024.0)
+            << " MB as BC1" << std::endl;
+  if (cache_mismatches) {
+    std::cerr << "textures: " << cache_mismatches
+              << " read differently from their cache" << std::endl;
+  }
+  return result;
+}
+
+}  // namespace TextureBench
@@ -0,0 +1,16 @@
+#ifndef TEXTURE_BENCH_H_
+#define TEXTURE_BENCH_H_
+
+#include "json.hpp"
+
+// RhythmRunnerBench's timing and checks of cooking textures
+namespace TextureBench {
+
+// Cooks every texture to BC1 and to RGB8 and reads the BC1 back from
+// TextureCache. The memory RGB8 takes is counted at 4 bytes a pixel, as
+// drivers pad it to RGBA8.
+nlohmann::json Run();
+
+}  // namespace TextureBench
+
+#endif
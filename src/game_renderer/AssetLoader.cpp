@@ -0,0 +1,219 @@
+#include "AssetLoader.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "Profiler.h"
+
+#define DEFAULT_UPLOAD_BUDGET (4 * 1024 * 1024)
+// decoding is mostly waiting on the disk and stb_image, a few threads do
+#define MAX_WORKERS 4
+
+namespace AssetLoader {
+
+struct Job {
+  enum class State { QUEUED, DECODING, DECODED, DONE };
+
+  Decode decode;
+  Upload upload;
+  State state;
+};
+
+namespace {
+
+// Joins the workers at exit, they'd terminate the program otherwise
+struct Workers {
+  std::mutex mutex;
+  // workers wait on it for the queue, Wait() and Cancel() for decodes
+  std::condition_variable queued;
+  std::condition_variable decoded;
+  std::deque<std::shared_ptr<Job>> queue;
+  std::vector<std::thread> threads;
+  bool stopping = false;
+
+  ~Workers() {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stopping = true;
+      queue.clear();
+    }
+    queued.notify_all();
+    for (std::thread& thread : threads) {
+      thread.join();
+    }
+  }
+};
+
+Workers workers;
+// every job not done yet in the order it was loaded, only the main thread
+// touches it
+std::vector<std::shared_ptr<Job>> pending;
+bool async = true;
+size_t upload_budget = DEFAULT_UPLOAD_BUDGET;
+
+void Work() {
+  std::unique_lock<std::mutex> lock(workers.mutex);
+  while (true) {
+    workers.queued.wait(
+        lock, [] { return workers.stopping || !workers.queue.empty(); });
+    if (workers.stopping) {
+      return;
+    }
+    std::shared_ptr<Job> job = workers.queue.front();
+    workers.queue.pop_front();
+    job->state = Job::State::DECODING;
+    lock.unlock();
+    job->decode();
+    lock.lock();
+    job->state = Job::State::DECODED;
+    workers.decoded.notify_all();
+  }
+}
+
+void StartWorkers() {
+  // one core stays with the main thread
+  int count = std::min((int)std::thread::hardware_concurrency() - 1,
+                       MAX_WORKERS);
+  for (int i = 0; i < std::max(count, 1); i++) {
+    workers.threads.push_back(std::thread(Work));
+  }
+}
+
+// Takes job off the queue to decode here, or waits for the worker that has
+// it. Returns with the lock held and job decoded.
+void Decoded(const std::shared_ptr<Job>& job,
+             std::unique_lock<std::mutex>& lock) {
+  if (job->state == Job::State::QUEUED) {
+    workers.queue.erase(
+        std::find(workers.queue.begin(), workers.queue.end(), job));
+    job->state = Job::State::DECODING;
+    lock.unlock();
+    job->decode();
+    lock.lock();
+    job->state = Job::State::DECODED;
+  }
+  workers.decoded.wait(lock,
+                       [&job] { return job->state != Job::State::DECODING; });
+}
+
+void Forget(const std::shared_ptr<Job>& job) {
+  auto found = std::find(pending.begin(), pending.end(), job);
+  if (found != pending.end()) {
+    pending.erase(found);
+  }
+}
+
+size_t Finish(const std::shared_ptr<Job>& job) {
+  {
+    std::lock_guard<std::mutex> lock(workers.mutex);
+    job->state = Job::State::DONE;
+  }
+  Forget(job);
+  return job->upload();
+}
+
+}  // namespace
+
+std::shared_ptr<Job> Load(Decode decode, Upload upload) {
+  std::shared_ptr<Job> job(new Job{decode, upload, Job::State::QUEUED});
+  if (!async) {
+    job->decode();
+    job->state = Job::State::DONE;
+    job->upload();
+    return job;
+  }
+  if (workers.threads.empty()) {
+    StartWorkers();
+  }
+  {
+    std::lock_guard<std::mutex> lock(workers.mutex);
+    workers.queue.push_back(job);
+  }
+  workers.queued.notify_one();
+  pending.push_back(job);
+  return job;
+}
+
+void Wait(const std::shared_ptr<Job>& job) {
+  {
+    std::unique_lock<std::mutex> lock(workers.mutex);
+    if (job->state == Job::State::DONE) {
+      return;
+    }
+    Decoded(job, lock);
+  }
+  Finish(job);
+}
+
+void WaitAll() {
+  PROFILE_SCOPE("AssetLoader::WaitAll");
+  while (!pending.empty()) {
+    Wait(pending.front());
+  }
+}
+
+void Cancel(const std::shared_ptr<Job>& job) {
+  {
+    std::unique_lock<std::mutex> lock(workers.mutex);
+    if (job->state == Job::State::DONE) {
+      return;
+    }
+    if (job->state == Job::State::QUEUED) {
+      workers.queue.erase(
+          std::find(workers.queue.begin(), workers.queue.end(), job));
+    } else {
+      workers.decoded.wait(
+          lock, [&job] { return job->state != Job::State::DECODING; });
+    }
+    job->state = Job::State::DONE;
+  }
+  Forget(job);
+}
+
+void Update() {
+  PROFILE_SCOPE("AssetLoader::Update");
+  size_t spent = 0;
+  bool uploaded = false;
+  size_t i = 0;
+  while (i < pending.size() && (spent < upload_budget || !uploaded)) {
+    std::shared_ptr<Job> job = pending[i];
+    bool decoded;
+    {
+      std::lock_guard<std::mutex> lock(workers.mutex);
+      decoded = job->state == Job::State::DECODED;
+    }
+    if (!decoded) {
+      i++;
+      continue;
+    }
+    // Finish() takes it out of pending, so i is already the next one
+    spent += Finish(job);
+    uploaded = true;
+  }
+}
+
+int GetPending() {
+  return pending.size();
+}
+
+void SetAsync(bool new_async) {
+  async = new_async;
+}
+
+bool GetAsync() {
+  return async;
+}
+
+void SetUploadBudget(size_t bytes) {
+  upload_budget = bytes;
+}
+
+size_t GetUploadBudget() {
+  return upload_budget;
+}
+
+}  // namespace AssetLoader
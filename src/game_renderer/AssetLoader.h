@@ -0,0 +1,47 @@
+#ifndef ASSET_LOADER_H_
+#define ASSET_LOADER_H_
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+
+// Loads assets in two halves: a decode that reads and parses files on a pool
+// of worker threads, and an upload that hands the result to GL on the main
+// thread. Uploads run in Update(), a few megabytes a frame, so a burst of
+// loads spreads over frames instead of stalling one. Until its upload runs an
+// asset is whatever placeholder its owner draws in the meantime.
+//
+// With async off, Load() decodes and uploads on the spot, the way everything
+// used to load.
+namespace AssetLoader {
+
+// Runs on a worker, may not touch GL or anything another thread does
+typedef std::function<void()> Decode;
+// Runs on the main thread after the decode, returns the bytes it uploaded
+typedef std::function<size_t()> Upload;
+
+struct Job;
+
+std::shared_ptr<Job> Load(Decode decode, Upload upload);
+// Blocks until job has decoded, decoding it here if no worker has started,
+// and uploads it now if it hasn't been
+void Wait(const std::shared_ptr<Job>& job);
+void WaitAll();
+// Drops job without uploading it, first waiting out its decode if a worker
+// is on it. For owners that go away before their asset is ready.
+void Cancel(const std::shared_ptr<Job>& job);
+// Uploads decoded jobs, oldest first, until the budget is spent. Call once a
+// frame on the main thread.
+void Update();
+// Loads not uploaded yet
+int GetPending();
+
+void SetAsync(bool async);
+bool GetAsync();
+// At least one upload runs per Update(), however big
+void SetUploadBudget(size_t bytes);
+size_t GetUploadBudget();
+
+}  // namespace AssetLoader
+
+#endif
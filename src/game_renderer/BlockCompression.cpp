@@ -0,0 +1,268 @@
+#include "BlockCompression.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+// Power iterations finding a block's principal axis
+#define AXIS_ITERATIONS 8
+// Least squares passes over the ends once indices are picked
+#define REFINE_ITERATIONS 2
+
+namespace BlockCompression {
+
+namespace {
+
+typedef float Color[3];
+
+uint16_t Pack565(const Color color) {
+  int r = std::min(std::max((int)std::lround(color[0] * 31 / 255.0f), 0), 31);
+  int g = std::min(std::max((int)std::lround(color[1] * 63 / 255.0f), 0), 63);
+  int b = std::min(std::max((int)std::lround(color[2] * 31 / 255.0f), 0), 31);
+  return (r << 11) | (g << 5) | b;
+}
+
+void Unpack565(uint16_t packed, Color color) {
+  int r = (packed >> 11) & 31;
+  int g = (packed >> 5) & 63;
+  int b = packed & 31;
+  // the top bits repeat into the bottom, so 31 comes out 255
+  color[0] = (r << 3) | (r >> 2);
+  color[1] = (g << 2) | (g >> 4);
+  color[2] = (b << 3) | (b >> 2);
+}
+
+// The four colours a block's indices pick from, as a decoder makes them
+void Palette(uint16_t color0, uint16_t color1, Color palette[4]) {
+  Unpack565(color0, palette[0]);
+  Unpack565(color1, palette[1]);
+  for (int c = 0; c < 3; c++) {
+    if (color0 > color1) {
+      palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+      palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+    } else {
+      // three colours and black, which the encoder doesn't use
+      palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+      palette[3][c] = 0;
+    }
+  }
+}
+
+float Distance(const Color a, const Color b) {
+  float dr = a[0] - b[0], dg = a[1] - b[1], db = a[2] - b[2];
+  return dr * dr + dg * dg + db * db;
+}
+
+// Each pixel's nearest palette index, returning the squared error
+float Fit(const Color pixels[16],
+          uint16_t color0,
+          uint16_t color1,
+          uint32_t& indices) {
+  Color palette[4];
+  Palette(color0, color1, palette);
+  // the same colour twice is the three colour mode, where 3 is black
+  int choices = color0 == color1 ? 1 : 4;
+  indices = 0;
+  float error = 0.0f;
+  for (int i = 0; i < 16; i++) {
+    int best = 0;
+    float best_distance = Distance(pixels[i], palette[0]);
+    for (int p = 1; p < choices; p++) {
+      float distance = Distance(pixels[i], palette[p]);
+      if (distance < best_distance) {
+        best = p;
+        best_distance = distance;
+      }
+    }
+    indices |= (uint32_t)best << (2 * i);
+    error += best_distance;
+  }
+  return error;
+}
+
+// The four colour mode needs color0 above color1
+void Order(uint16_t& color0, uint16_t& color1) {
+  if (color0 < color1) {
+    std::swap(color0, color1);
+  }
+}
+
+// Ends that fit pixels best by least squares for the indices they picked,
+// false when the indices don't pin them down
+bool Refine(const Color pixels[16],
+            uint32_t indices,
+            uint16_t& color0,
+            uint16_t& color1) {
+  // how much of color0 each index takes
+  static const float weights[4] = {1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f};
+  float aa = 0, ab = 0, bb = 0;
+  Color ax = {0, 0, 0}, bx = {0, 0, 0};
+  for (int i = 0; i < 16; i++) {
+    float a = weights[(indices >> (2 * i)) & 3];
+    float b = 1.0f - a;
+    aa += a * a;
+    ab += a * b;
+    bb += b * b;
+    for (int c = 0; c < 3; c++) {
+      ax[c] += a * pixels[i][c];
+      bx[c] += b * pixels[i][c];
+    }
+  }
+  float determinant = aa * bb - ab * ab;
+  if (std::fabs(determinant) < 1e-6f) {
+    return false;  // every pixel picked the same end
+  }
+  Color end0, end1;
+  for (int c = 0; c < 3; c++) {
+    end0[c] = (bb * ax[c] - ab * bx[c]) / determinant;
+    end1[c] = (aa * bx[c] - ab * ax[c]) / determinant;
+  }
+  color0 = Pack565(end0);
+  color1 = Pack565(end1);
+  Order(color0, color1);
+  return true;
+}
+
+void CompressBlock(const Color pixels[16], unsigned char* out) {
+  Color mean = {0, 0, 0};
+  for (int i = 0; i < 16; i++) {
+    for (int c = 0; c < 3; c++) {
+      mean[c] += pixels[i][c] / 16;
+    }
+  }
+  float covariance[6] = {0, 0, 0, 0, 0, 0};  // rr rg rb gg gb bb
+  for (int i = 0; i < 16; i++) {
+    float r = pixels[i][0] - mean[0];
+    float g = pixels[i][1] - mean[1];
+    float b = pixels[i][2] - mean[2];
+    covariance[0] += r * r;
+    covariance[1] += r * g;
+    covariance[2] += r * b;
+    covariance[3] += g * g;
+    covariance[4] += g * b;
+    covariance[5] += b * b;
+  }
+  Color axis = {1, 1, 1};
+  for (int i = 0; i < AXIS_ITERATIONS; i++) {
+    Color next = {
+        covariance[0] * axis[0] + covariance[1] * axis[1] +
+            covariance[2] * axis[2],
+        covariance[1] * axis[0] + covariance[3] * axis[1] +
+            covariance[4] * axis[2],
+        covariance[2] * axis[0] + covariance[4] * axis[1] +
+            covariance[5] * axis[2]};
+    float length = std::max(std::fabs(next[0]),
+                            std::max(std::fabs(next[1]), std::fabs(next[2])));
+    if (length < 1e-6f) {
+      break;  // a flat block, any axis does
+    }
+    for (int c = 0; c < 3; c++) {
+      axis[c] = next[c] / length;
+    }
+  }
+
+  // the pixels furthest either way along the axis are the first ends
+  int lowest = 0, highest = 0;
+  float low = INFINITY, high = -INFINITY;
+  for (int i = 0; i < 16; i++) {
+    float along = pixels[i][0] * axis[0] + pixels[i][1] * axis[1] +
+                  pixels[i][2] * axis[2];
+    if (along < low) {
+      low = along;
+      lowest = i;
+    }
+    if (along > high) {
+      high = along;
+      highest = i;
+    }
+  }
+  uint16_t color0 = Pack565(pixels[highest]);
+  uint16_t color1 = Pack565(pixels[lowest]);
+  Order(color0, color1);
+  uint32_t indices;
+  float error = Fit(pixels, color0, color1, indices);
+  for (int i = 0; i < REFINE_ITERATIONS && error > 0; i++) {
+    uint16_t refined0, refined1;
+    if (!Refine(pixels, indices, refined0, refined1)) {
+      break;
+    }
+    uint32_t refined_indices;
+    float refined_error = Fit(pixels, refined0, refined1, refined_indices);
+    if (refined_error >= error) {
+      break;
+    }
+    color0 = refined0;
+    color1 = refined1;
+    indices = refined_indices;
+    error = refined_error;
+  }
+
+  out[0] = color0 & 0xff;
+  out[1] = color0 >> 8;
+  out[2] = color1 & 0xff;
+  out[3] = color1 >> 8;
+  for (int i = 0; i < 4; i++) {
+    out[4 + i] = (indices >> (8 * i)) & 0xff;
+  }
+}
+
+}  // namespace
+
+size_t Bc1Size(int width, int height) {
+  return (size_t)((width + 3) / 4) * ((height + 3) / 4) * 8;
+}
+
+std::vector<unsigned char> CompressBc1(const unsigned char* rgb,
+                                       int width,
+                                       int height) {
+  std::vector<unsigned char> blocks(Bc1Size(width, height));
+  unsigned char* out = blocks.data();
+  for (int block_y = 0; block_y < height; block_y += 4) {
+    for (int block_x = 0; block_x < width; block_x += 4) {
+      Color pixels[16];
+      for (int y = 0; y < 4; y++) {
+        for (int x = 0; x < 4; x++) {
+          int pixel_x = std::min(block_x + x, width - 1);
+          int pixel_y = std::min(block_y + y, height - 1);
+          const unsigned char* pixel =
+              rgb + ((size_t)pixel_y * width + pixel_x) * 3;
+          for (int c = 0; c < 3; c++) {
+            pixels[4 * y + x][c] = pixel[c];
+          }
+        }
+      }
+      CompressBlock(pixels, out);
+      out += 8;
+    }
+  }
+  return blocks;
+}
+
+std::vector<unsigned char> DecompressBc1(const unsigned char* blocks,
+                                         int width,
+                                         int height) {
+  std::vector<unsigned char> rgb((size_t)width * height * 3);
+  const unsigned char* in = blocks;
+  for (int block_y = 0; block_y < height; block_y += 4) {
+    for (int block_x = 0; block_x < width; block_x += 4) {
+      Color palette[4];
+      Palette(in[0] | (in[1] << 8), in[2] | (in[3] << 8), palette);
+      uint32_t indices =
+          in[4] | (in[5] << 8) | (in[6] << 16) | ((uint32_t)in[7] << 24);
+      for (int y = 0; y < 4 && block_y + y < height; y++) {
+        for (int x = 0; x < 4 && block_x + x < width; x++) {
+          const float* color = palette[(indices >> (2 * (4 * y + x))) & 3];
+          unsigned char* pixel =
+              &rgb[((size_t)(block_y + y) * width + block_x + x) * 3];
+          for (int c = 0; c < 3; c++) {
+            pixel[c] = (unsigned char)(color[c] + 0.5f);
+          }
+        }
+      }
+      in += 8;
+    }
+  }
+  return rgb;
+}
+
+}  // namespace BlockCompression
@@ -0,0 +1,30 @@
+#ifndef BLOCK_COMPRESSION_H_
+#define BLOCK_COMPRESSION_H_
+
+#include <cstddef>
+#include <vector>
+
+// BC1 (DXT1), which GPUs sample straight from memory at 4 bits a pixel.
+// Each 4x4 block keeps two RGB565 colours and a 2 bit index per pixel into
+// them and the two colours a third and two thirds of the way between.
+//
+// CompressBc1() fits each block's colours along their principal axis, then
+// refines the two ends by least squares over the indices that picked.
+namespace BlockCompression {
+
+// 8 bytes per 4x4 block, blocks hanging off the edge included
+size_t Bc1Size(int width, int height);
+
+// rgb is width * height RGB8 pixels, row after row. Blocks hanging off the
+// edge repeat its last row and column.
+std::vector<unsigned char> CompressBc1(const unsigned char* rgb,
+                                       int width,
+                                       int height);
+// Back to width * height RGB8 pixels
+std::vector<unsigned char> DecompressBc1(const unsigned char* blocks,
+                                         int width,
+                                         int height);
+
+}  // namespace BlockCompression
+
+#endif
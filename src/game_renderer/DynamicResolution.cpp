@@ -0,0 +1,142 @@
+#include "DynamicResolution.h"
+
+#include <algorithm>
+#include <cmath>
+
+#define GLEW_STATIC
+#include <GL/glew.h>
+
+// 60 fps, less what the minimap, UI and swap need
+#define DEFAULT_TARGET_MS 13.0
+// frames of queries in flight, results are read this many frames late
+#define QUERY_FRAMES 3
+// the controller works on the fraction of pixels drawn, scale squared
+#define MIN_PIXELS 0.25f
+#define PROPORTIONAL_GAIN 0.3f
+#define INTEGRAL_GAIN 0.05f
+#define SCALE_STEP 0.05f
+
+namespace DynamicResolution {
+
+namespace {
+
+bool enabled = true;
+double target_ms = DEFAULT_TARGET_MS;
+double scene_ms = -1;
+float scale = 1.0f;
+// the pixel fraction the controller has integrated to
+float integral = 1.0f;
+
+bool initialized = false;
+bool timer_queries = false;
+GLuint begin_queries[QUERY_FRAMES];
+GLuint end_queries[QUERY_FRAMES];
+bool issued[QUERY_FRAMES] = {};
+int current = 0;
+// whether this frame's queries are free to time the scene
+bool measuring = false;
+
+void Init() {
+  initialized = true;
+  timer_queries = GLEW_VERSION_3_3 || GLEW_ARB_timer_query;
+  if (timer_queries) {
+    GLint counter_bits = 0;
+    glGetQueryiv(GL_TIMESTAMP, GL_QUERY_COUNTER_BITS, &counter_bits);
+    timer_queries = counter_bits > 0;
+  }
+  if (timer_queries) {
+    glGenQueries(QUERY_FRAMES, begin_queries);
+    glGenQueries(QUERY_FRAMES, end_queries);
+  }
+}
+
+void Control(double measured_ms) {
+  // positive when there's time to spare
+  float error = (float)((target_ms - measured_ms) / target_ms);
+  integral = std::min(std::max(integral + INTEGRAL_GAIN * error, MIN_PIXELS),
+                      1.0f);
+  float pixels = std::min(
+      std::max(integral + PROPORTIONAL_GAIN * error, MIN_PIXELS), 1.0f);
+  // only move once the controller wants most of a step, so the scale
+  // doesn't flicker between two steps
+  float wanted = std::sqrt(pixels);
+  if (std::abs(wanted - scale) > SCALE_STEP * 0.75f) {
+    scale = std::min(std::round(wanted / SCALE_STEP) * SCALE_STEP, 1.0f);
+  }
+}
+
+}  // namespace
+
+void Update() {
+  if (!initialized) {
+    Init();
+  }
+  measuring = false;
+  if (!timer_queries) {
+    return;
+  }
+  // the oldest frame's queries are reused for this one, if they're done
+  if (issued[current]) {
+    GLint available = 0;
+    glGetQueryObjectiv(end_queries[current], GL_QUERY_RESULT_AVAILABLE,
+                       &available);
+    if (!available) {
+      return;  // this frame goes unmeasured
+    }
+    GLuint64 begin_ns, end_ns;
+    glGetQueryObjectui64v(begin_queries[current], GL_QUERY_RESULT, &begin_ns);
+    glGetQueryObjectui64v(end_queries[current], GL_QUERY_RESULT, &end_ns);
+    scene_ms = (end_ns - begin_ns) / 1e6;
+    issued[current] = false;
+    if (enabled) {
+      Control(scene_ms);
+    }
+  }
+  measuring = true;
+}
+
+void BeginScene() {
+  if (measuring) {
+    glQueryCounter(begin_queries[current], GL_TIMESTAMP);
+  }
+}
+
+void EndScene() {
+  if (!measuring) {
+    return;
+  }
+  glQueryCounter(end_queries[current], GL_TIMESTAMP);
+  issued[current] = true;
+  current = (current + 1) % QUERY_FRAMES;
+  measuring = false;
+}
+
+float GetScale() {
+  return enabled ? scale : 1.0f;
+}
+
+double GetSceneMs() {
+  return scene_ms;
+}
+
+void SetEnabled(bool new_enabled) {
+  enabled = new_enabled;
+  if (!enabled) {
+    scale = 1.0f;
+    integral = 1.0f;
+  }
+}
+
+bool GetEnabled() {
+  return enabled;
+}
+
+void SetTargetMs(double new_target_ms) {
+  target_ms = new_target_ms;
+}
+
+double GetTargetMs() {
+  return target_ms;
+}
+
+}  // namespace DynamicResolution
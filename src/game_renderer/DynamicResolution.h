@@ -0,0 +1,34 @@
+#ifndef DYNAMIC_RESOLUTION_H_
+#define DYNAMIC_RESOLUTION_H_
+
+// Picks the scale the scene is drawn at, so it takes a target time on the
+// GPU. The scene's time is measured with GL timestamp queries and read back a
+// few frames late so nothing waits on the GPU, and a PI controller on the
+// fraction of pixels drawn steers it towards the target. Only the drawing is
+// timed, since the GPU sits idle through the culling and sorting before it
+// and those don't get faster at a lower scale. The scale moves in
+// steps, so the targets it sizes change now and then rather than every frame.
+//
+// Without timer queries the scale stays at 1.
+namespace DynamicResolution {
+
+// Reads the oldest measured frame back and steers the scale, once a frame
+// before anything is sized by it
+void Update();
+// Around the GPU work the scale applies to, once a frame after Update()
+void BeginScene();
+void EndScene();
+
+// Width and height are multiplied by this, at most 1
+float GetScale();
+// The last measured scene time, negative before the first
+double GetSceneMs();
+
+void SetEnabled(bool enabled);
+bool GetEnabled();
+void SetTargetMs(double target_ms);
+double GetTargetMs();
+
+}  // namespace DynamicResolution
+
+#endif
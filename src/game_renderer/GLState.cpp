@@ -0,0 +1,264 @@
+#include "GLState.h"
+
+#include <cstdint>
+#include <unordered_map>
+
+#include "RenderStats.h"
+
+// texture units and vertex attributes past these aren't cached
+#define CACHED_TEXTURE_UNITS 16
+#define CACHED_VERTEX_ATTRIBS 16
+// never a valid name or enum, so nothing matches it
+#define UNKNOWN 0xFFFFFFFFu
+
+namespace GLState {
+
+namespace {
+
+struct AttribPointer {
+  GLuint buffer;
+  GLint size;
+  GLenum type;
+  GLboolean normalized;
+  GLsizei stride;
+  const void* offset;
+};
+
+struct VertexArrayState {
+  GLuint element_buffer;
+  uint32_t enabled;       // bit per attribute
+  uint32_t enabled_known;
+  uint32_t pointer_known;
+  AttribPointer pointers[CACHED_VERTEX_ATTRIBS];
+};
+
+GLuint program;
+GLenum active_unit;
+GLuint textures[CACHED_TEXTURE_UNITS];
+GLuint framebuffer;
+GLuint array_buffer;
+GLuint vertex_array;
+GLboolean depth_mask;
+bool depth_mask_known;
+GLint viewport[4];
+bool viewport_known;
+
+// What's known about each vertex array since the last Invalidate(). The
+// entries outlive it, only forgetting what they knew, so the map doesn't
+// churn when it's invalidated every frame.
+std::unordered_map<GLuint, VertexArrayState> vertex_arrays;
+VertexArrayState* current_vertex_array;
+
+bool initialized = false;
+
+// Returns whether the call has to be issued, and counts it
+bool Changes(bool changed) {
+  if (changed) {
+    RenderStats::StateChanges(1);
+  } else {
+    RenderStats::StateChangesElided(1);
+  }
+  return changed;
+}
+
+void Forget(VertexArrayState& state) {
+  state.element_buffer = UNKNOWN;
+  state.enabled = 0;
+  state.enabled_known = 0;
+  state.pointer_known = 0;
+}
+
+VertexArrayState* VertexArray(GLuint name) {
+  auto found = vertex_arrays.find(name);
+  if (found == vertex_arrays.end()) {
+    VertexArrayState state;
+    Forget(state);
+    found = vertex_arrays.insert(std::make_pair(name, state)).first;
+  }
+  return &found->second;
+}
+
+void EnsureInitialized() {
+  if (!initialized) {
+    Invalidate();
+  }
+}
+
+}  // namespace
+
+void Invalidate() {
+  initialized = true;
+  program = UNKNOWN;
+  active_unit = UNKNOWN;
+  for (GLuint& texture : textures) {
+    texture = UNKNOWN;
+  }
+  framebuffer = UNKNOWN;
+  array_buffer = UNKNOWN;
+  vertex_array = UNKNOWN;
+  depth_mask_known = false;
+  viewport_known = false;
+  for (auto& vertex_array_state : vertex_arrays) {
+    Forget(vertex_array_state.second);
+  }
+  current_vertex_array = nullptr;
+}
+
+void UseProgram(GLuint new_program) {
+  EnsureInitialized();
+  if (Changes(program != new_program)) {
+    glUseProgram(new_program);
+    program = new_program;
+  }
+}
+
+void ActiveTexture(GLenum unit) {
+  EnsureInitialized();
+  if (Changes(active_unit != unit)) {
+    glActiveTexture(unit);
+    active_unit = unit;
+  }
+}
+
+void BindTexture(GLenum target, GLuint texture) {
+  EnsureInitialized();
+  GLuint unit = active_unit - GL_TEXTURE0;
+  if (target != GL_TEXTURE_2D || active_unit == UNKNOWN ||
+      unit >= CACHED_TEXTURE_UNITS) {
+    Changes(true);
+    glBindTexture(target, texture);
+    return;
+  }
+  if (Changes(textures[unit] != texture)) {
+    glBindTexture(target, texture);
+    textures[unit] = texture;
+  }
+}
+
+void BindFramebuffer(GLenum target, GLuint new_framebuffer) {
+  EnsureInitialized();
+  if (target != GL_FRAMEBUFFER) {
+    // draw and read are tracked together, so a split bind forgets both
+    Changes(true);
+    glBindFramebuffer(target, new_framebuffer);
+    framebuffer = UNKNOWN;
+    return;
+  }
+  if (Changes(framebuffer != new_framebuffer)) {
+    glBindFramebuffer(target, new_framebuffer);
+    framebuffer = new_framebuffer;
+  }
+}
+
+void BindBuffer(GLenum target, GLuint buffer) {
+  EnsureInitialized();
+  if (target == GL_ARRAY_BUFFER) {
+    if (Changes(array_buffer != buffer)) {
+      glBindBuffer(target, buffer);
+      array_buffer = buffer;
+    }
+  } else if (target == GL_ELEMENT_ARRAY_BUFFER && current_vertex_array) {
+    if (Changes(current_vertex_array->element_buffer != buffer)) {
+      glBindBuffer(target, buffer);
+      current_vertex_array->element_buffer = buffer;
+    }
+  } else {
+    Changes(true);
+    glBindBuffer(target, buffer);
+  }
+}
+
+void DepthMask(GLboolean flag) {
+  EnsureInitialized();
+  if (Changes(!depth_mask_known || depth_mask != flag)) {
+    glDepthMask(flag);
+    depth_mask = flag;
+    depth_mask_known = true;
+  }
+}
+
+void Viewport(GLint x, GLint y, GLsizei width, GLsizei height) {
+  EnsureInitialized();
+  if (Changes(!viewport_known || viewport[0] != x || viewport[1] != y ||
+              viewport[2] != width || viewport[3] != height)) {
+    glViewport(x, y, width, height);
+    viewport[0] = x;
+    viewport[1] = y;
+    viewport[2] = width;
+    viewport[3] = height;
+    viewport_known = true;
+  }
+}
+
+void BindVertexArray(GLuint new_vertex_array) {
+  EnsureInitialized();
+  if (Changes(vertex_array != new_vertex_array)) {
+    glBindVertexArray(new_vertex_array);
+    vertex_array = new_vertex_array;
+    current_vertex_array = VertexArray(new_vertex_array);
+  }
+}
+
+void EnableVertexAttribArray(GLuint index) {
+  EnsureInitialized();
+  if (!current_vertex_array || index >= CACHED_VERTEX_ATTRIBS) {
+    Changes(true);
+    glEnableVertexAttribArray(index);
+    return;
+  }
+  uint32_t bit = 1u << index;
+  if (Changes(!(current_vertex_array->enabled_known & bit) ||
+              !(current_vertex_array->enabled & bit))) {
+    glEnableVertexAttribArray(index);
+    current_vertex_array->enabled |= bit;
+    current_vertex_array->enabled_known |= bit;
+  }
+}
+
+void DisableVertexAttribArray(GLuint index) {
+  EnsureInitialized();
+  if (!current_vertex_array || index >= CACHED_VERTEX_ATTRIBS) {
+    Changes(true);
+    glDisableVertexAttribArray(index);
+    return;
+  }
+  uint32_t bit = 1u << index;
+  if (Changes(!(current_vertex_array->enabled_known & bit) ||
+              (current_vertex_array->enabled & bit))) {
+    glDisableVertexAttribArray(index);
+    current_vertex_array->enabled &= ~bit;
+    current_vertex_array->enabled_known |= bit;
+  }
+}
+
+void VertexAttribPointer(GLuint index,
+                         GLint size,
+                         GLenum type,
+                         GLboolean normalized,
+                         GLsizei stride,
+                         const void* offset) {
+  EnsureInitialized();
+  if (!current_vertex_array || index >= CACHED_VERTEX_ATTRIBS ||
+      array_buffer == UNKNOWN) {
+    Changes(true);
+    glVertexAttribPointer(index, size, type, normalized, stride, offset);
+    return;
+  }
+  uint32_t bit = 1u << index;
+  AttribPointer& pointer = current_vertex_array->pointers[index];
+  if (Changes(!(current_vertex_array->pointer_known & bit) ||
+              pointer.buffer != array_buffer || pointer.size != size ||
+              pointer.type != type || pointer.normalized != normalized ||
+              pointer.stride != stride || pointer.offset != offset)) {
+    glVertexAttribPointer(index, size, type, normalized, stride, offset);
+    pointer.buffer = array_buffer;
+    pointer.size = size;
+    pointer.type = type;
+    pointer.normalized = normalized;
+    pointer.stride = stride;
+    pointer.offset = offset;
+    current_vertex_array->pointer_known |= bit;
+  }
+}
+
+}  // namespace GLState
@@ -0,0 +1,41 @@
+#ifndef GL_STATE_H_
+#define GL_STATE_H_
+
+#define GLEW_STATIC
+#include <GL/glew.h>
+
+// Thin layer over the GL binds the renderer makes, remembering what is bound
+// so that binding the same thing again is skipped. Every call counts as either
+// issued or elided in RenderStats.
+//
+// The cache only knows about changes made through here. RendererSetup
+// invalidates it every frame, and anything else that binds GL objects directly
+// (ImGui does) has to call Invalidate() afterwards.
+namespace GLState {
+
+void Invalidate();
+
+void UseProgram(GLuint program);
+void ActiveTexture(GLenum unit);
+// Only GL_TEXTURE_2D binds are cached
+void BindTexture(GLenum target, GLuint texture);
+void BindFramebuffer(GLenum target, GLuint framebuffer);
+void BindBuffer(GLenum target, GLuint buffer);
+void DepthMask(GLboolean flag);
+void Viewport(GLint x, GLint y, GLsizei width, GLsizei height);
+
+// These, and GL_ELEMENT_ARRAY_BUFFER binds, are cached per vertex array
+void BindVertexArray(GLuint vertex_array);
+void EnableVertexAttribArray(GLuint index);
+void DisableVertexAttribArray(GLuint index);
+// Uses the GL_ARRAY_BUFFER bound through BindBuffer()
+void VertexAttribPointer(GLuint index,
+                         GLint size,
+                         GLenum type,
+                         GLboolean normalized,
+                         GLsizei stride,
+                         const void* offset);
+
+}  // namespace GLState
+
+#endif
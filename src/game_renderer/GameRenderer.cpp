@@ -6,6 +6,7 @@
 #include <iostream>
 #include <glm/gtc/type_ptr.hpp>
 #include <cstdlib>
+#include <memory>
 #include <queue>
 #include <algorithm>  // std::copy_if, std::distance
 
@@ -13,11 +14,13 @@
 #include "InputBindings.h"
 #include "LevelGenerator.h"
 #include "MatrixStack.h"
+#include "MinimapRenderer.h"
 #include "MovingPlatform.h"
 #include "Octree.h"
 #include "Platform.h"
 #include "Note.h"
 #include "DroppingPlatform.h"
+#include "DynamicResolution.h"
 #include "ViewFrustumCulling.h"
 #include "json.hpp"
 #include "RendererSetup.h"
@@ -29,27 +32,94 @@
 #include "Acid.h"
 #include "Cocainum.h"
 #include "LevelJson.h"
+#include "Profiler.h"
+#include "GpuProfiler.h"
+#include "GLState.h"
+#include "GpuCulling.h"
+#include "RenderQueue.h"
+#include "RenderStats.h"
+#include "RenderTargets.h"
+#include "ShadowMaps.h"
+#include "ShapeManager.h"
 #include "GameUpdater.h"
 #include "CollisionCalculator.h"
 #include "ParticleGenerator.h"
+#include "ProgramCache.h"
+#include "TimingConstants.h"
+#include "VideoTexture.h"
 
 #define TEXT_FIELD_LENGTH 256
 #define SHOW_ME_THE_MENU_ITEMS 4
 #define ENDGAME_MENU_WAIT_SECONDS 0.5
+#define BLOOM_BLUR_PASSES 8
+// how much of the blurred bright parts are added back to the scene
+#define BLOOM_EXPOSURE 1.3f
+#define SCENE_FAR 10000.0f
+#define SCENE_QUEUE_DUMP "scene_queue.csv"
 
 std::unordered_map<std::string, std::shared_ptr<Program>>
     GameRenderer::programs;
-GLuint GameRenderer::hdrFBO;
-GLuint GameRenderer::hdrColorBuffers[2];
-GLuint GameRenderer::pingpongFBO[2];
-GLuint GameRenderer::pingpongColorbuffers[2];
+bool GameRenderer::gpu_culling = false;
+BloomQuality GameRenderer::bloom_quality = BloomQuality::MEDIUM;
+bool GameRenderer::gaussian_bloom = false;
 
 namespace {
 
-void DrawPhysicalObjectTree(std::shared_ptr<Program> program,
-                            MatrixStack P,
-                            MatrixStack V,
-                            std::shared_ptr<PhysicalObject> physical_object) {
+// one timer query per blur pass
+const char* const BLUR_PASS_NAMES[BLOOM_BLUR_PASSES] = {
+    "blur 0", "blur 1", "blur 2", "blur 3",
+    "blur 4", "blur 5", "blur 6", "blur 7"};
+const char* const BLOOM_DOWN_PASS_NAMES[BLOOM_MAX_MIPS] = {
+    "bloom down 0", "bloom down 1", "bloom down 2",
+    "bloom down 3", "bloom down 4", "bloom down 5"};
+const char* const BLOOM_UP_PASS_NAMES[BLOOM_MAX_MIPS - 1] = {
+    "bloom up 0", "bloom up 1", "bloom up 2", "bloom up 3", "bloom up 4"};
+
+// notes cycle through the rainbow
+const glm::vec3 NOTE_COLORS[] = {
+    glm::vec3(236.0 / 255.0, 0, 83.0 / 255.0),
+    glm::vec3(236.0 / 255.0, 122.0 / 255, 0),
+    glm::vec3(236.0 / 255.0, 205.0 / 255, 0),
+    glm::vec3(89.0 / 255.0, 236.0 / 255, 0),
+    glm::vec3(0 / 255.0, 172.0 / 255, 236.0 / 255.0)};
+#define NOTE_COLOR_COUNT (sizeof(NOTE_COLORS) / sizeof(NOTE_COLORS[0]))
+
+// note is how many notes came before this one, for its place in the rainbow
+glm::vec3 CollectibleColor(const std::shared_ptr<GameObject>& collectible,
+                           size_t note) {
+  switch (collectible->GetSecondaryType()) {
+    case SecondaryType::NOTE:
+      return NOTE_COLORS[note % NOTE_COLOR_COUNT];
+    case SecondaryType::DMT:
+      return gameobject::DMT::color;
+    case SecondaryType::ACID:
+      return gameobject::Acid::color;
+    default:
+      return gameobject::Cocainum::color;
+  }
+}
+
+// The object data GpuCulling's draws read, as SubmitLevel() submits it
+void WriteObjectData(const std::shared_ptr<GameObject>& object,
+                     size_t index,
+                     glm::vec4* texels) {
+  if (object->GetType() != ObjectType::COLLECTIBLE) {
+    RenderQueue::WriteObject(object->GetTransform(), glm::vec3(0.0f), false, 0,
+                             texels);
+    return;
+  }
+  std::shared_ptr<Collectible> collectible =
+      std::static_pointer_cast<Collectible>(object);
+  RenderQueue::WriteObject(
+      collectible->GetTransform(), CollectibleColor(object, index),
+      collectible->GetCollected(), collectible->GetTicksCollected(), texels);
+}
+
+void SubmitPhysicalObjectTree(RenderQueue& render_queue,
+                              RenderQueue::Pass pass,
+                              std::shared_ptr<Program> program,
+                              std::shared_ptr<Texture> texture,
+                              std::shared_ptr<PhysicalObject> physical_object) {
   std::queue<std::shared_ptr<PhysicalObject>> queue;
   queue.push(physical_object);
 
@@ -57,27 +127,71 @@ void DrawPhysicalObjectTree(std::shared_ptr<Program> program,
     std::shared_ptr<PhysicalObject> object = queue.front();
     queue.pop();
 
-    glUniformMatrix4fv(program->getUniform("P"), 1, GL_FALSE,
-                       glm::value_ptr(P.topMatrix()));
-    glUniformMatrix4fv(program->getUniform("V"), 1, GL_FALSE,
-                       glm::value_ptr(V.topMatrix()));
-    glUniformMatrix4fv(program->getUniform("MV"), 1, GL_FALSE,
-                       glm::value_ptr(object->GetTransform()));
-    object->GetModel()->draw(program);
+    render_queue.Submit(pass, program, texture, nullptr, object->GetModel(),
+                        object->GetTransform());
 
     for (std::shared_ptr<PhysicalObject> sub_object : object->GetSubObjects()) {
       queue.push(sub_object);
     }
   }
 }
+
+// Nodes hold the whole path of an object that moves, so unlike a static
+// object it can be outside its node now. Static objects overlap their node's
+// box, so they're inside every plane it's inside.
+bool LeavesNode(std::shared_ptr<GameObject> object) {
+  SecondaryType type = object->GetSecondaryType();
+  return GameObject::Moves(type) ||
+         type == SecondaryType::DROPPING_PLATFORM_UP ||
+         type == SecondaryType::DROPPING_PLATFORM_DOWN;
+}
+
+// Adds everything under a node that's entirely inside frustum
+void AddSubtree(Node* root,
+                const ViewFrustumCulling::Frustum& frustum,
+                std::unordered_set<std::shared_ptr<GameObject>>* inView) {
+  static std::vector<Node*> toAdd;
+  toAdd.clear();
+  toAdd.push_back(root);
+  while (!toAdd.empty()) {
+    Node* node = toAdd.back();
+    toAdd.pop_back();
+    if (node->children != nullptr) {
+      toAdd.insert(toAdd.end(), node->children->begin(),
+                   node->children->end());
+    }
+    if (node->objects == nullptr) {
+      continue;
+    }
+    for (std::shared_ptr<GameObject> objectInBox : *(node->objects)) {
+      if (!LeavesNode(objectInBox) ||
+          !ViewFrustumCulling::IsCulled(objectInBox->GetBoundingBox(),
+                                        frustum)) {
+        inView->insert(objectInBox);
+      }
+    }
+  }
+}
 }
 
 GameRenderer::GameRenderer() {}
 
-GameRenderer::~GameRenderer() {}
+GameRenderer::~GameRenderer() {
+  ReleaseTargets();
+}
 
 void GameRenderer::Init(const std::string& resource_dir, GLFWwindow* window) {
   glClearColor(.2f, .2f, .2f, 1.0f);
+  // Meshes and textures decode on AssetLoader's workers while the shaders
+  // compile, and upload over the first frames
+  ShapeManager::Preload();
+  std::shared_ptr<Texture> temp_texture;
+  std::vector<std::string> texture_files =
+      FileSystemUtils::ListFiles(ASSET_DIR "/textures", "*.json");
+  for (int i = 0; i < texture_files.size(); i++) {
+    temp_texture = GameRenderer::TextureFromJSON(texture_files[i]);
+    textures[temp_texture->getName()] = temp_texture;
+  }
   // Initialize all programs from JSON files in assets folder
   std::shared_ptr<Program> temp_program;
   std::vector<std::string> json_files =
@@ -86,27 +200,14 @@ void GameRenderer::Init(const std::string& resource_dir, GLFWwindow* window) {
     temp_program = GameRenderer::ProgramFromJSON(json_files[i]);
     programs[temp_program->getName()] = temp_program;
   }
-  std::shared_ptr<Texture> temp_texture;
-  std::vector<std::string> texture_files =
-      FileSystemUtils::ListFiles(ASSET_DIR "/textures", "*.json");
-  for (int i = 0; i < texture_files.size(); i++) {
-    temp_texture = GameRenderer::TextureFromJSON(texture_files[i]);
-    textures[temp_texture->getName()] = temp_texture;
-  }
 
+  scene_queue.SetPrepassProgram(programs["shadowmap_prog"]);
+  scene_queue.SetOverdrawProgram(programs["overdraw_prog"]);
+
+  UpdateTargets(window);
   int width, height;
   glfwGetFramebufferSize(window, &width, &height);
-  InitBloom(width, height);
   Bloom(width, height);
-
-  // Set up rainbow of colors in color_vector
-  // TODO move somewhere else
-  color_vec.push_back(glm::vec3(236.0 / 255.0, 0, 83.0 / 255.0));
-  color_vec.push_back(glm::vec3(236.0 / 255.0, 122.0 / 255, 0));
-  color_vec.push_back(glm::vec3(236.0 / 255.0, 205.0 / 255, 0));
-  color_vec.push_back(glm::vec3(89.0 / 255.0, 236.0 / 255, 0));
-  color_vec.push_back(glm::vec3(0 / 255.0, 172.0 / 255, 236.0 / 255.0));
-  color_vec.push_back(glm::vec3(150.0 / 255.0, 0 / 255, 236.0 / 255.0));
 }
 
 std::shared_ptr<Texture> GameRenderer::TextureFromJSON(std::string filepath) {
@@ -133,85 +234,97 @@ std::shared_ptr<Texture> GameRenderer::TextureFromJSON(std::string filepath) {
 }
 
 std::shared_ptr<Program> GameRenderer::ProgramFromJSON(std::string filepath) {
-  // Read in the file
-  std::ifstream json_input_stream(filepath, std::ifstream::in);
-  // Read the file into the JSON library
-  nlohmann::json json_handler;
-  json_input_stream >> json_handler;
-
-  // Get name attributes from JSON
-  std::string vert_name = json_handler["vert"];
-  std::string frag_name = json_handler["frag"];
-  std::string prog_name = json_handler["name"];
-  std::string geom_name;
-  bool isGeomShader = false;
-  if (json_handler.find("geom") != json_handler.end()) {
-    geom_name = json_handler["geom"];
-    isGeomShader = true;
-  }
-
-  // Create new shader program
-  std::shared_ptr<Program> new_program;
-  new_program = std::make_shared<Program>();
-  new_program->setVerbose(true);
-  new_program->setName(prog_name);
-
-  if (isGeomShader) {
-    new_program->setShaderNames(ASSET_DIR "/shaders/" + vert_name,
-                                ASSET_DIR "/shaders/" + frag_name,
-                                ASSET_DIR "/shaders/" + geom_name);
-  } else {
-    new_program->setShaderNames(ASSET_DIR "/shaders/" + vert_name,
-                                ASSET_DIR "/shaders/" + frag_name);
-  }
-
-  new_program->init();
-
-  // Create the uniforms
-  std::vector<std::string> uniforms = json_handler["uniforms"];
-  for (int i = 0; i < uniforms.size(); i++) {
-    new_program->addUniform(uniforms[i]);
-  }
-  // Create the attributes
-  std::vector<std::string> attributes = json_handler["attributes"];
-  for (int i = 0; i < attributes.size(); i++) {
-    new_program->addAttribute(attributes[i]);
-  }
-
-  return new_program;
+  return ProgramCache::Get(filepath);
 }
 
 std::unordered_set<std::shared_ptr<GameObject>>* GameRenderer::GetObjectsInView(
-    std::shared_ptr<std::vector<glm::vec4>> vfplane,
-    std::shared_ptr<Octree> tree) {
+    const ViewFrustumCulling::Frustum& frustum,
+    std::shared_ptr<Octree> tree,
+    int view) {
+  PROFILE_SCOPE("GetObjectsInView");
+  // kept between calls so culling doesn't allocate
+  static ViewFrustumCulling::BoxArray boxes;
+  static std::vector<unsigned char> culled;
+  static std::vector<std::pair<Node*, unsigned char>> toVisit;
   std::unordered_set<std::shared_ptr<GameObject>>* inView =
       new std::unordered_set<std::shared_ptr<GameObject>>();
-  std::queue<Node*> toVisit;
-  toVisit.push(tree->GetRoot());
+  toVisit.clear();
+  toVisit.push_back(std::make_pair(tree->GetRoot(), VFC_ALL_PLANES));
   while (!toVisit.empty()) {
-    Node* node = toVisit.front();
-    toVisit.pop();
+    Node* node = toVisit.back().first;
+    unsigned char plane_mask = toVisit.back().second;
+    toVisit.pop_back();
+    ViewFrustumCulling::Containment containment =
+        ViewFrustumCulling::Classify(node->boundingBox, frustum, plane_mask,
+                                     node->culling_planes[view]);
+    if (containment == ViewFrustumCulling::Containment::OUTSIDE) {
+      continue;
+    }
+    if (containment == ViewFrustumCulling::Containment::INSIDE) {
+      AddSubtree(node, frustum, inView);
+      continue;
+    }
     if (node->children != nullptr) {
       for (Node* child : *(node->children)) {
-        if (!ViewFrustumCulling::IsCulled(child->boundingBox, vfplane)) {
-          toVisit.push(child);
-        }
+        toVisit.push_back(std::make_pair(child, plane_mask));
       }
     }
     if (node->objects != nullptr) {
+      boxes.Clear();
       for (std::shared_ptr<GameObject> objectInBox : *(node->objects)) {
-        if (!ViewFrustumCulling::IsCulled(objectInBox->GetBoundingBox(),
-                                          vfplane)) {
-          inView->insert(objectInBox);
+        boxes.Add(objectInBox->GetBoundingBox());
+      }
+      culled.resize(boxes.Size());
+      ViewFrustumCulling::CullBoxes(boxes, frustum, culled.data(), plane_mask);
+      for (size_t i = 0; i < node->objects->size(); i++) {
+        std::shared_ptr<GameObject> objectInBox = node->objects->at(i);
+        if (culled[i] || (plane_mask != VFC_ALL_PLANES &&
+                          LeavesNode(objectInBox) &&
+                          ViewFrustumCulling::IsCulled(
+                              objectInBox->GetBoundingBox(), frustum))) {
+          continue;
         }
+        inView->insert(objectInBox);
       }
     }
   }
   return inView;
 }
 
+std::unordered_set<std::shared_ptr<GameObject>>* GameRenderer::CullLevel(
+    const ViewFrustumCulling::Frustum& frustum,
+    std::shared_ptr<GameState> game_state,
+    int view) {
+  if (!gpu_culling) {
+    return GetObjectsInView(frustum, game_state->GetLevel()->getTree(), view);
+  }
+  UpdateGpuCulling(game_state);
+  GpuCulling::Cull(frustum);
+  return GpuCulling::GetVisible();
+}
+
+// Starting over resets every object, in view or not
+void GameRenderer::UpdateGpuCulling(std::shared_ptr<GameState> game_state) {
+  static uint64_t start_generation = 0;
+  if (game_state->GetStartGeneration() != start_generation) {
+    start_generation = game_state->GetStartGeneration();
+    GpuCulling::Invalidate();
+  }
+  GpuCulling::Update(game_state->GetLevel(), *game_state->GetObjectsInView(),
+                     WriteObjectData);
+}
+
+void GameRenderer::SetGpuCulling(bool enabled) {
+  gpu_culling = enabled;
+}
+
+bool GameRenderer::GetGpuCulling() {
+  return gpu_culling;
+}
+
 MainProgramMode GameRenderer::Render(GLFWwindow* window,
                                      std::shared_ptr<GameState> game_state) {
+  PROFILE_SCOPE("GameRenderer::Render");
   RenderObjects(window, game_state);
   glClear(GL_DEPTH_BUFFER_BIT);
   RenderMinimap(window, game_state);
@@ -253,257 +366,170 @@ LevelProgramMode GameRenderer::RenderLevelEditor(
   return next_mode;
 }
 
-void GameRenderer::RenderMinimap(GLFWwindow* window,
-                                 std::shared_ptr<GameState> game_state) {
-  std::shared_ptr<Level> level = game_state->GetLevel();
+void GameRenderer::UpdateMinimapView(std::shared_ptr<GameState> game_state,
+                                     float aspect) {
   std::shared_ptr<GameCamera> camera = game_state->GetCamera();
-  std::shared_ptr<Player> player = game_state->GetPlayer();
-  std::shared_ptr<Sky> sky = game_state->GetSky();
-
-  int width, height;
-  glfwGetFramebufferSize(window, &width, &height);
-  glViewport(0, 0, width / 6, height / 6);
-  float aspect = width / (float)height;
-
-  auto P = std::make_shared<MatrixStack>();
   GameCamera mini_cam = GameCamera(glm::vec3(camera->getPosition().x, 5, 100),
                                    camera->getLookAt(), camera->getUp());
   mini_cam.Refresh();
-  auto V = std::make_shared<MatrixStack>(mini_cam.getView());
-  auto MV = std::make_shared<MatrixStack>();
 
-  P->pushMatrix();
+  MatrixStack P;
+  P.pushMatrix();
   // small far for aggressive culling
-  P->perspective(45.0f, aspect, 0.01f, 200.0f);
-  V->pushMatrix();
+  P.perspective(45.0f, aspect, 0.01f, 200.0f);
 
-  std::shared_ptr<std::vector<glm::vec4>> vfplane =
-      ViewFrustumCulling::GetViewFrustumPlanes(P->topMatrix(), V->topMatrix());
+  ViewFrustumCulling::Frustum frustum = ViewFrustumCulling::GetFrustum(
+      P.topMatrix(), mini_cam.getView().topMatrix());
 
   game_state->SetItemsInView(
-      GameRenderer::GetObjectsInView(vfplane, level->getTree()));
-
-  // large far for sexy looks
-  P->popMatrix();
-  P->pushMatrix();
-  P->perspective(20.0f, aspect, 0.01f, 1000.0f);
-
-  player->SetScale(glm::vec3(10, 10, 10));
-  RenderSingleObject(player, P, V);
-  player->SetScale(glm::vec3(1, 1, 1));
-
-  if (player->GetGround()) {
-    RenderSingleObject(player->GetGround(), programs["player_prog"],
-                       textures["rainbowass"], P, V);
-  }
-  RenderLevelObjects(game_state->GetObjectsInView(), SecondaryType::PLATFORM,
-                     textures["nightsky"], P, V);
-  RenderLevelObjects(game_state->GetObjectsInView(),
-                     SecondaryType::MOVING_PLATFORM, textures["nightsky"], P,
-                     V);
-  RenderLevelObjects(game_state->GetObjectsInView(),
-                     SecondaryType::DROPPING_PLATFORM_UP, textures["nightsky"],
-                     P, V);
-  RenderLevelObjects(game_state->GetObjectsInView(),
-                     SecondaryType::DROPPING_PLATFORM_DOWN,
-                     textures["nightsky"], P, V);
-  RenderLevelCollectibles(game_state->GetObjectsInView(), SecondaryType::NOTE,
-                          P, V);
-  RenderLevelCollectibles(game_state->GetObjectsInView(), SecondaryType::DMT,
-                          gameobject::DMT::color, P, V);
-  RenderLevelCollectibles(game_state->GetObjectsInView(), SecondaryType::ACID,
-                          gameobject::Acid::color, P, V);
-  RenderLevelCollectibles(game_state->GetObjectsInView(),
-                          SecondaryType::COCAINUM, gameobject::Cocainum::color,
-                          P, V);
-  RenderLevelObjects(game_state->GetObjectsInView(), SecondaryType::MONSTER, P,
-                     V);
-  RenderLevelObjects(game_state->GetObjectsInView(), SecondaryType::MOONROCK, P,
-                     V);
-  RenderLevelObjects(game_state->GetObjectsInView(), SecondaryType::PLAINROCK,
-                     P, V);
-  P->popMatrix();
-  V->popMatrix();
-}
-
-void GameRenderer::RenderSingleObject(std::shared_ptr<GameObject> object,
-                                      std::shared_ptr<Program> program,
-                                      std::shared_ptr<Texture> texture,
-                                      std::shared_ptr<MatrixStack> P,
-                                      std::shared_ptr<MatrixStack> V) {
-  program->bind();
-  texture->bind(program->getUniform("Texture0"));
-  DrawPhysicalObjectTree(program, *P, *V,
-                         std::static_pointer_cast<PhysicalObject>(object));
-  program->unbind();
-}
-
-void GameRenderer::RenderSingleObject(std::shared_ptr<GameObject> object,
-                                      std::shared_ptr<MatrixStack> P,
-                                      std::shared_ptr<MatrixStack> V) {
-  object->GetProgram()->bind();
-  object->GetTexture()->bind(object->GetProgram()->getUniform("Texture0"));
-  DrawPhysicalObjectTree(object->GetProgram(), *P, *V,
-                         std::static_pointer_cast<PhysicalObject>(object));
-  object->GetProgram()->unbind();
+      GameRenderer::CullLevel(frustum, game_state, MINIMAP_CULLING_VIEW));
 }
 
-std::shared_ptr<std::vector<std::shared_ptr<GameObject>>>
-GameRenderer::GetObjectsOfType(
-    std::unordered_set<std::shared_ptr<GameObject>>* objects,
-    SecondaryType type_to_get) {
-  std::shared_ptr<std::vector<std::shared_ptr<GameObject>>> objects_to_render =
-      std::make_shared<std::vector<std::shared_ptr<GameObject>>>(
-          objects->size());
-  auto it =
-      std::copy_if(objects->begin(), objects->end(), objects_to_render->begin(),
-                   [&](std::shared_ptr<GameObject> obj) {
-                     return obj->GetSecondaryType() == type_to_get;
-                   });
-  objects_to_render->resize(std::distance(objects_to_render->begin(), it));
-  return objects_to_render;
-}
-
-void GameRenderer::RenderLevelObjects(
-    std::unordered_set<std::shared_ptr<GameObject>>* objects,
-    SecondaryType type_to_render,
-    std::shared_ptr<MatrixStack> P,
-    std::shared_ptr<MatrixStack> V) {
-  std::shared_ptr<std::vector<std::shared_ptr<GameObject>>> objects_to_render =
-      GetObjectsOfType(objects, type_to_render);
-  if (!objects_to_render->empty()) {
-    std::shared_ptr<Program> program = objects_to_render->front()->GetProgram();
-    std::shared_ptr<Texture> texture = objects_to_render->front()->GetTexture();
-    program->bind();
-    texture->bind(program->getUniform("Texture0"));
-
-    glUniformMatrix4fv(program->getUniform("P"), 1, GL_FALSE,
-                       glm::value_ptr(P->topMatrix()));
-    glUniformMatrix4fv(program->getUniform("V"), 1, GL_FALSE,
-                       glm::value_ptr(V->topMatrix()));
-    for (std::shared_ptr<GameObject> obj : *objects_to_render) {
-      glUniformMatrix4fv(program->getUniform("MV"), 1, GL_FALSE,
-                         glm::value_ptr(obj->GetTransform()));
-      obj->GetModel()->draw(program);
-    }
-    program->unbind();
-  }
+void GameRenderer::RenderMinimap(GLFWwindow* window,
+                                 std::shared_ptr<GameState> game_state) {
+  int width, height;
+  glfwGetFramebufferSize(window, &width, &height);
+  UpdateMinimapView(game_state, width / (float)height);
+  MinimapRenderer::Render(game_state, programs["minimap_prog"], width, height);
 }
 
-void GameRenderer::RenderLevelObjects(
-    std::unordered_set<std::shared_ptr<GameObject>>* objects,
-    SecondaryType type_to_render,
-    std::shared_ptr<Texture> video_texture,
-    std::shared_ptr<MatrixStack> P,
-    std::shared_ptr<MatrixStack> V) {
-  std::shared_ptr<std::vector<std::shared_ptr<GameObject>>> objects_to_render =
-      GetObjectsOfType(objects, type_to_render);
-  if (!objects_to_render->empty()) {
-    std::shared_ptr<Program> program = objects_to_render->front()->GetProgram();
-    std::shared_ptr<Texture> texture = objects_to_render->front()->GetTexture();
-    program->bind();
-    texture->bind(program->getUniform("Texture0"));
-    video_texture->bind(program->getUniform("SkyTexture0"));
-
-    glUniformMatrix4fv(program->getUniform("P"), 1, GL_FALSE,
-                       glm::value_ptr(P->topMatrix()));
-    glUniformMatrix4fv(program->getUniform("V"), 1, GL_FALSE,
-                       glm::value_ptr(V->topMatrix()));
-    for (std::shared_ptr<GameObject> obj : *objects_to_render) {
-      glUniformMatrix4fv(program->getUniform("MV"), 1, GL_FALSE,
-                         glm::value_ptr(obj->GetTransform()));
-      obj->GetModel()->draw(program);
+void GameRenderer::SubmitLevel(
+    RenderQueue& render_queue,
+    std::unordered_set<std::shared_ptr<GameObject>>* objects) {
+  PROFILE_SCOPE("SubmitLevel");
+  std::shared_ptr<Texture> nightsky = textures["nightsky"];
+  size_t note_count = 0;
+  for (const std::shared_ptr<GameObject>& obj : *objects) {
+    switch (obj->GetSecondaryType()) {
+      case SecondaryType::PLATFORM:
+      case SecondaryType::MOVING_PLATFORM:
+      case SecondaryType::DROPPING_PLATFORM_UP:
+      case SecondaryType::DROPPING_PLATFORM_DOWN:
+        render_queue.Submit(RenderQueue::Pass::OPAQUE, obj->GetProgram(),
+                            obj->GetTexture(), nightsky, obj->GetModel(),
+                            obj->GetTransform(), obj.get());
+        break;
+      case SecondaryType::MONSTER:
+      case SecondaryType::MOONROCK:
+      case SecondaryType::PLAINROCK:
+        render_queue.Submit(RenderQueue::Pass::OPAQUE, obj->GetProgram(),
+                            obj->GetTexture(), nullptr, obj->GetModel(),
+                            obj->GetTransform(), obj.get());
+        break;
+      case SecondaryType::NOTE:
+      case SecondaryType::DMT:
+      case SecondaryType::ACID:
+      case SecondaryType::COCAINUM: {
+        std::shared_ptr<Collectible> collectible =
+            std::static_pointer_cast<Collectible>(obj);
+        render_queue.SubmitCollectible(
+            collectible->GetProgram(), collectible->GetModel(),
+            collectible->GetTransform(), CollectibleColor(obj, note_count),
+            collectible->GetCollected(), collectible->GetTicksCollected(),
+            obj.get());
+        note_count += obj->GetSecondaryType() == SecondaryType::NOTE;
+        break;
+      }
+      default:
+        break;
     }
-    program->unbind();
   }
 }
 
-void GameRenderer::RenderLevelCollectibles(
-    std::unordered_set<std::shared_ptr<GameObject>>* objects,
-    SecondaryType type_to_render,
-    std::shared_ptr<MatrixStack> P,
-    std::shared_ptr<MatrixStack> V) {
-  std::shared_ptr<std::vector<std::shared_ptr<GameObject>>> objects_to_render =
-      GetObjectsOfType(objects, type_to_render);
-  if (!objects_to_render->empty()) {
-    std::shared_ptr<Program> program = objects_to_render->front()->GetProgram();
-    program->bind();
-    glUniformMatrix4fv(program->getUniform("P"), 1, GL_FALSE,
-                       glm::value_ptr(P->topMatrix()));
-    glUniformMatrix4fv(program->getUniform("V"), 1, GL_FALSE,
-                       glm::value_ptr(V->topMatrix()));
-    int color_count = 0;
-    for (std::shared_ptr<GameObject> obj : *objects_to_render) {
-      if (std::shared_ptr<Collectible> collectible =
-              std::static_pointer_cast<Collectible>(obj)) {
-        glUniformMatrix4fv(program->getUniform("MV"), 1, GL_FALSE,
-                           glm::value_ptr(collectible->GetTransform()));
-        glm::vec3 cur_color = color_vec.at(color_count);
-        color_count++;
-        if (color_count == 5) {
-          color_count = 0;
-        }
-        glUniform3f(program->getUniform("in_obj_color"), cur_color.x,
-                    cur_color.y, cur_color.z);
-        glUniform1i(program->getUniform("isCollected"),
-                    collectible->GetCollected());
-        glUniform1i(program->getUniform("timeCollected"),
-                    collectible->GetTicksCollected());
-        collectible->GetModel()->draw(program);
+// Draws that share a program and texture are next to each other, and go
+// together as one submission
+void GameRenderer::SubmitCulledLevel(RenderQueue& render_queue) {
+  PROFILE_SCOPE("SubmitCulledLevel");
+  std::shared_ptr<Texture> nightsky = textures["nightsky"];
+  size_t draw_count = GpuCulling::GetDrawCount();
+  size_t first = 0;
+  for (size_t i = 1; i <= draw_count; i++) {
+    std::shared_ptr<GameObject> obj = GpuCulling::GetDrawObject(first);
+    if (i < draw_count) {
+      std::shared_ptr<GameObject> next = GpuCulling::GetDrawObject(i);
+      if (next->GetProgram() == obj->GetProgram() &&
+          next->GetTexture() == obj->GetTexture()) {
+        continue;
       }
     }
-    program->unbind();
-  }
-}
-
-void GameRenderer::RenderLevelCollectibles(
-    std::unordered_set<std::shared_ptr<GameObject>>* objects,
-    SecondaryType type_to_render,
-    glm::vec3 color,
-    std::shared_ptr<MatrixStack> P,
-    std::shared_ptr<MatrixStack> V) {
-  std::shared_ptr<std::vector<std::shared_ptr<GameObject>>> objects_to_render =
-      GetObjectsOfType(objects, type_to_render);
-  if (!objects_to_render->empty()) {
-    std::shared_ptr<Program> program = objects_to_render->front()->GetProgram();
-    program->bind();
-    glUniformMatrix4fv(program->getUniform("P"), 1, GL_FALSE,
-                       glm::value_ptr(P->topMatrix()));
-    glUniformMatrix4fv(program->getUniform("V"), 1, GL_FALSE,
-                       glm::value_ptr(V->topMatrix()));
-    for (std::shared_ptr<GameObject> obj : *objects_to_render) {
-      std::shared_ptr<Collectible> collectible =
-          std::static_pointer_cast<Collectible>(obj);
-      glUniformMatrix4fv(program->getUniform("MV"), 1, GL_FALSE,
-                         glm::value_ptr(collectible->GetTransform()));
-      glUniform3f(program->getUniform("in_obj_color"), color.x, color.y,
-                  color.z);
-      glUniform1i(program->getUniform("isCollected"),
-                  collectible->GetCollected());
-      glUniform1i(program->getUniform("timeCollected"),
-                  collectible->GetTicksCollected());
-      collectible->GetModel()->draw(program);
+    RenderQueue::Culled culled;
+    culled.indirect_buffer = GpuCulling::GetIndirectBuffer();
+    culled.object_indices = GpuCulling::GetVisibleIndexBuffer();
+    culled.objects = GpuCulling::GetObjectTexture();
+    culled.first_draw = first;
+    culled.draw_count = i - first;
+    culled.collectible = obj->GetType() == ObjectType::COLLECTIBLE;
+    first = i;
+    switch (obj->GetSecondaryType()) {
+      case SecondaryType::PLATFORM:
+      case SecondaryType::MOVING_PLATFORM:
+      case SecondaryType::DROPPING_PLATFORM_UP:
+      case SecondaryType::DROPPING_PLATFORM_DOWN:
+        render_queue.SubmitCulled(RenderQueue::Pass::OPAQUE, obj->GetProgram(),
+                                  obj->GetTexture(), nightsky, culled);
+        break;
+      case SecondaryType::MONSTER:
+      case SecondaryType::MOONROCK:
+      case SecondaryType::PLAINROCK:
+        render_queue.SubmitCulled(RenderQueue::Pass::OPAQUE, obj->GetProgram(),
+                                  obj->GetTexture(), nullptr, culled);
+        break;
+      case SecondaryType::NOTE:
+      case SecondaryType::DMT:
+      case SecondaryType::ACID:
+      case SecondaryType::COCAINUM:
+        render_queue.SubmitCulled(RenderQueue::Pass::OPAQUE, obj->GetProgram(),
+                                  nullptr, nullptr, culled);
+        break;
+      default:
+        break;
     }
-    program->unbind();
   }
 }
 
 void GameRenderer::RenderObjects(GLFWwindow* window,
                                  std::shared_ptr<GameState> game_state) {
+  PROFILE_SCOPE("RenderObjects");
   std::shared_ptr<Level> level = game_state->GetLevel();
   std::shared_ptr<GameCamera> camera = game_state->GetCamera();
   std::shared_ptr<Player> player = game_state->GetPlayer();
   std::shared_ptr<Sky> sky = game_state->GetSky();
+  if (queued_level.lock() != level) {
+    scene_queue.Forget();
+    queued_level = level;
+  }
 
-  glBindFramebuffer(GL_FRAMEBUFFER, hdrFBO);
+  // videos keep to the music, holding their first frame before it starts
+  std::unordered_map<std::string, std::shared_ptr<VideoTexture>>
+      video_textures = game_state->GetVideoTextures();
+  double music_seconds = ((double)game_state->GetElapsedTicks() -
+                          (double)game_state->GetMusicStartTick()) *
+                         SECONDS_PER_TICK;
+  for (auto& video_texture : video_textures) {
+    video_texture.second->Update(music_seconds);
+  }
+  std::shared_ptr<Texture> sky_texture = sky->GetTexture();
+  if (video_textures.count("sky") && video_textures["sky"]->GetCurFrame()) {
+    sky_texture = video_textures["sky"]->GetCurFrame();
+  }
+
+  // before the targets are sized, as it may change the scale
+  DynamicResolution::Update();
+  UpdateTargets(window);
+  GLState::BindFramebuffer(GL_FRAMEBUFFER, hdr_target->framebuffer);
   if (game_state->GetPlayer()->Tripping() == Player::Trip::DMT) {
-    float r = ((double)rand() / (RAND_MAX));
-    float g = ((double)rand() / (RAND_MAX));
-    float b = ((double)rand() / (RAND_MAX));
+    std::shared_ptr<RandomGenerator> random =
+        game_state->GetRandom(GameState::RENDERER_RANDOM);
+    float r = random->NextFloat();
+    float g = random->NextFloat();
+    float b = random->NextFloat();
     glClearColor(r, g, b, 1.0);
     if (game_state->GetElapsedTicks() % 10 == 0) {
       glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
     }
+  } else if (RenderQueue::GetOverdrawView()) {
+    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);  // so the count starts at nothing
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
   } else {
     glClearColor(.2f, .2f, .2f, 1.0f);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
@@ -511,7 +537,8 @@ void GameRenderer::RenderObjects(GLFWwindow* window,
 
   int width, height;
   glfwGetFramebufferSize(window, &width, &height);
-  glViewport(0, 0, width, height);
+  GLState::Viewport(0, 0, hdr_target->format.width,
+                    hdr_target->format.height);
   float aspect = width / (float)height;
   auto P = std::make_shared<MatrixStack>();
   auto V = std::make_shared<MatrixStack>(camera->getView());
@@ -522,63 +549,75 @@ void GameRenderer::RenderObjects(GLFWwindow* window,
   P->perspective(45.0f, aspect, 0.01f, 1000.0f);
   V->pushMatrix();
 
-  std::shared_ptr<std::vector<glm::vec4>> vfplane =
-      ViewFrustumCulling::GetViewFrustumPlanes(P->topMatrix(), V->topMatrix());
+  ViewFrustumCulling::Frustum frustum =
+      ViewFrustumCulling::GetFrustum(P->topMatrix(), V->topMatrix());
+
+  // With GPU culling the scene is drawn from the cull's own draws, and the
+  // objects in view stay the ones gameplay has, from the last minimap cull.
+  // Without indirect draws they're read back, waiting on the cull.
+  bool culled_draws =
+      gpu_culling && RenderQueue::MultiDrawIndirectSupported();
+  std::unique_ptr<std::unordered_set<std::shared_ptr<GameObject>>>
+      scene_objects;
+  if (gpu_culling) {
+    UpdateGpuCulling(game_state);
+    GpuCulling::Cull(frustum);
+    if (!culled_draws) {
+      scene_objects.reset(GpuCulling::ReadVisible());
+    }
+  } else {
+    game_state->SetItemsInView(
+        GetObjectsInView(frustum, level->getTree(), SCENE_CULLING_VIEW));
+  }
 
-  game_state->SetItemsInView(
-      GameRenderer::GetObjectsInView(vfplane, level->getTree()));
+  // the dynamic map draws what moves from the objects in view
+  ShadowMaps::Render(game_state, programs["shadowmap_prog"]);
+  GLState::BindFramebuffer(GL_FRAMEBUFFER, hdr_target->framebuffer);
+  GLState::Viewport(0, 0, hdr_target->format.width,
+                    hdr_target->format.height);
 
   // large far for sexy looks
   P->popMatrix();
   P->pushMatrix();
-  P->perspective(45.0f, aspect, 0.01f, 10000.0f);
-
-  RenderSingleObject(player, P, V);
-  if (player->GetGround()) {
-    switch (player->GetGround()->GetSecondaryType()) {
-      case SecondaryType::PLATFORM:
-        RenderSingleObject(player->GetGround(), P, V);
-        break;
-      case SecondaryType::PLAINROCK:
-        RenderSingleObject(player->GetGround(),
-                           programs["current_platform_prog"],
-                           textures["rainbowass"], P, V);
-        break;
-      case SecondaryType::MOONROCK:
-        RenderSingleObject(player->GetGround(),
-                           programs["current_platform_prog"],
-                           textures["rainbowass"], P, V);
-        break;
+  P->perspective(45.0f, aspect, 0.01f, SCENE_FAR);
+
+  {
+    GPU_PASS("scene");
+    scene_queue.Begin(P->topMatrix(), V->topMatrix(), SCENE_FAR);
+    SubmitPhysicalObjectTree(scene_queue, RenderQueue::Pass::OPAQUE,
+                             player->GetProgram(), player->GetTexture(),
+                             player);
+    std::shared_ptr<GameObject> ground = player->GetGround();
+    if (ground) {
+      switch (ground->GetSecondaryType()) {
+        case SecondaryType::PLATFORM:
+          SubmitPhysicalObjectTree(scene_queue, RenderQueue::Pass::HIGHLIGHT,
+                                   ground->GetProgram(), ground->GetTexture(),
+                                   ground);
+          break;
+        case SecondaryType::PLAINROCK:
+        case SecondaryType::MOONROCK:
+          SubmitPhysicalObjectTree(scene_queue, RenderQueue::Pass::HIGHLIGHT,
+                                   programs["current_platform_prog"],
+                                   textures["rainbowass"], ground);
+          break;
+        default:
+          break;
+      }
     }
-  }
+    if (culled_draws) {
+      SubmitCulledLevel(scene_queue);
+    } else {
+      SubmitLevel(scene_queue, scene_objects ? scene_objects.get()
+                                             : game_state->GetObjectsInView());
+    }
+    SubmitPhysicalObjectTree(scene_queue, RenderQueue::Pass::SKY,
+                             sky->GetProgram(), sky_texture, sky);
 
-  RenderLevelObjects(game_state->GetObjectsInView(), SecondaryType::PLATFORM,
-                     textures["nightsky"], P, V);
-  RenderLevelObjects(game_state->GetObjectsInView(),
-                     SecondaryType::MOVING_PLATFORM, textures["nightsky"], P,
-                     V);
-  RenderLevelObjects(game_state->GetObjectsInView(),
-                     SecondaryType::DROPPING_PLATFORM_UP, textures["nightsky"],
-                     P, V);
-  RenderLevelObjects(game_state->GetObjectsInView(),
-                     SecondaryType::DROPPING_PLATFORM_DOWN,
-                     textures["nightsky"], P, V);
-  RenderLevelCollectibles(game_state->GetObjectsInView(), SecondaryType::NOTE,
-                          P, V);
-  RenderLevelCollectibles(game_state->GetObjectsInView(), SecondaryType::DMT,
-                          gameobject::DMT::color, P, V);
-  RenderLevelCollectibles(game_state->GetObjectsInView(), SecondaryType::ACID,
-                          gameobject::Acid::color, P, V);
-  RenderLevelCollectibles(game_state->GetObjectsInView(),
-                          SecondaryType::COCAINUM, gameobject::Cocainum::color,
-                          P, V);
-  RenderLevelObjects(game_state->GetObjectsInView(), SecondaryType::MONSTER, P,
-                     V);
-  RenderLevelObjects(game_state->GetObjectsInView(), SecondaryType::MOONROCK, P,
-                     V);
-  RenderLevelObjects(game_state->GetObjectsInView(), SecondaryType::PLAINROCK,
-                     P, V);
-  RenderSingleObject(sky, P, V);
+    scene_queue.Sort();
+    DynamicResolution::BeginScene();
+    scene_queue.Execute();
+  }
   if (game_state->GetParticles()) {
     RenderParticles(game_state->GetParticles(), P, V);
   }
@@ -589,138 +628,220 @@ void GameRenderer::RenderObjects(GLFWwindow* window,
   P->popMatrix();
   V->popMatrix();
 
-  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  GLState::BindFramebuffer(GL_FRAMEBUFFER, 0);
 
+  // the composite upsamples the scene to the window
   Bloom(width, height);
+  DynamicResolution::EndScene();
 }
 
 void GameRenderer::RenderParticles(std::shared_ptr<ParticleGenerator> particles,
                                    std::shared_ptr<MatrixStack> P,
                                    std::shared_ptr<MatrixStack> V) {
+  PROFILE_SCOPE("RenderParticles");
+  GPU_PASS("particles");
   std::shared_ptr<Program> current_program;
   std::shared_ptr<Texture> current_texture;
   current_program = programs["particle_prog"];
   current_program->bind();
   current_texture = textures["particletex"];
-  current_texture->bind(current_program->getUniform("Texture0"));
-  glUniformMatrix4fv(current_program->getUniform("P"), 1, GL_FALSE,
-                     glm::value_ptr(P->topMatrix()));
-  glUniformMatrix4fv(current_program->getUniform("V"), 1, GL_FALSE,
-                     glm::value_ptr(V->topMatrix()));
-  glUniform3f(current_program->getUniform("CamRight"), V->topMatrix()[0][0],
-              V->topMatrix()[1][0], V->topMatrix()[2][0]);
-  glUniform3f(current_program->getUniform("CamUp"), V->topMatrix()[0][1],
-              V->topMatrix()[1][1], V->topMatrix()[2][1]);
+  current_texture->bind(current_program->getUniform(Uniform::Texture0));
+  current_program->setUniform(Uniform::P, P->topMatrix());
+  current_program->setUniform(Uniform::V, V->topMatrix());
+  current_program->setUniform(
+      Uniform::CamRight,
+      glm::vec3(V->topMatrix()[0][0], V->topMatrix()[1][0],
+                V->topMatrix()[2][0]));
+  current_program->setUniform(
+      Uniform::CamUp, glm::vec3(V->topMatrix()[0][1], V->topMatrix()[1][1],
+                                V->topMatrix()[2][1]));
   particles->DrawParticles(current_program);
-  current_program->unbind();
 }
 
-void GameRenderer::InitBloom(int width, int height) {
-  programs["bloom_final_prog"]->bind();
-  glUniform1i(programs["bloom_final_prog"]->getUniform("scene"), 0);
-  glUniform1i(programs["bloom_final_prog"]->getUniform("bloomBlur"), 1);
-  programs["bloom_final_prog"]->unbind();
-
-  // hdrFBO stores normal scene and to-be-blurred scene
-  glGenFramebuffers(1, &hdrFBO);
-  glBindFramebuffer(GL_FRAMEBUFFER, hdrFBO);
-  glGenTextures(2, hdrColorBuffers);
-  for (GLuint i = 0; i < 2; i++) {
-    glBindTexture(GL_TEXTURE_2D, hdrColorBuffers[i]);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB16F, width, height, 0, GL_RGB,
-                 GL_FLOAT, NULL);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + i,
-                           GL_TEXTURE_2D, hdrColorBuffers[i], 0);
+void GameRenderer::AcquireTargets(int width, int height, bool trim) {
+  PROFILE_SCOPE("AcquireTargets");
+  ReleaseTargets();
+  // the scene, and its bright parts to be blurred
+  hdr_target = RenderTargets::Acquire({width, height, GL_RGB16F, 2, true});
+  // the Gaussian blur's, at half size and at most a million pixels
+  int blurWidth = width / 2;
+  int blurHeight = height / 2;
+  while (blurWidth * blurHeight > 1000000) {
+    blurWidth = blurWidth / 2;
+    blurHeight = blurHeight / 2;
+  }
+  for (RenderTargets::Target*& target : pingpong_targets) {
+    target = RenderTargets::Acquire(
+        {std::max(blurWidth, 1), std::max(blurHeight, 1), GL_RGB16F, 1, false});
+  }
+  // the mip chain, from half size down. R11F_G11F_B10F is half the bandwidth
+  // of RGB16F and bloom is all bandwidth.
+  int mipWidth = width / 2;
+  int mipHeight = height / 2;
+  bloom_mip_count = 0;
+  while (bloom_mip_count < BLOOM_MAX_MIPS && mipWidth > 0 && mipHeight > 0) {
+    bloom_mips[bloom_mip_count++] = RenderTargets::Acquire(
+        {mipWidth, mipHeight, GL_R11F_G11F_B10F, 1, false});
+    mipWidth /= 2;
+    mipHeight /= 2;
   }
-  // depth framebuffer
-  GLuint rboDepth;
-  glGenRenderbuffers(1, &rboDepth);
-  glBindRenderbuffer(GL_RENDERBUFFER, rboDepth);
-  glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT, width, height);
-  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT,
-                            GL_RENDERBUFFER, rboDepth);
-  GLuint attachments[2] = {GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1};
-  glDrawBuffers(2, attachments);
-  if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
-    std::cout << "Framebuffer not complete!" << std::endl;
-  glBindFramebuffer(GL_FRAMEBUFFER, 0);
-  // pingpongFBO and pingpongColorbuffers used for blurring
-  glGenFramebuffers(2, pingpongFBO);
-  glGenTextures(2, pingpongColorbuffers);
-  int tempTexWidth = width / 2;
-  int tempTexHeight = height / 2;
-  while (tempTexWidth * tempTexHeight > 1000000) {
-    tempTexWidth = tempTexWidth / 2;
-    tempTexHeight = tempTexHeight / 2;
+  if (trim) {
+    // the old targets aren't coming back
+    RenderTargets::Trim();
   }
-  for (GLuint i = 0; i < 2; i++) {
-    glBindFramebuffer(GL_FRAMEBUFFER, pingpongFBO[i]);
-    glBindTexture(GL_TEXTURE_2D, pingpongColorbuffers[i]);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB16F, tempTexWidth, tempTexHeight, 0,
-                 GL_RGB, GL_FLOAT, NULL);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
-                           pingpongColorbuffers[i], 0);
+}
+
+void GameRenderer::ReleaseTargets() {
+  RenderTargets::Release(hdr_target);
+  hdr_target = nullptr;
+  for (RenderTargets::Target*& target : pingpong_targets) {
+    RenderTargets::Release(target);
+    target = nullptr;
   }
-  if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
-    std::cout << "Framebuffer not complete!" << std::endl;
-    exit(EXIT_FAILURE);
+  for (int i = 0; i < bloom_mip_count; i++) {
+    RenderTargets::Release(bloom_mips[i]);
+    bloom_mips[i] = nullptr;
+  }
+  bloom_mip_count = 0;
+}
+
+void GameRenderer::UpdateTargets(GLFWwindow* window) {
+  int width, height;
+  glfwGetFramebufferSize(window, &width, &height);
+  bool resized = target_size.Update(width, height);
+  float scale = DynamicResolution::GetScale();
+  int scene_width = std::max(1, (int)(target_size.GetWidth() * scale + 0.5f));
+  int scene_height =
+      std::max(1, (int)(target_size.GetHeight() * scale + 0.5f));
+  // scales the controller steps between stay in the pool for a while, so
+  // stepping back to one reuses its targets
+  if (resized || !hdr_target || scene_width != hdr_target->format.width ||
+      scene_height != hdr_target->format.height) {
+    AcquireTargets(scene_width, scene_height, resized);
   }
 }
 
 void GameRenderer::Bloom(int width, int height) {
+  PROFILE_SCOPE("Bloom");
+  GLuint blurred;
+  GLfloat exposure = BLOOM_EXPOSURE;
+  if (gaussian_bloom) {
+    blurred = GaussianBlur();
+  } else {
+    blurred = MipChainBlur();
+    // every level of the chain is added into the first, so average them
+    exposure /= std::max(1, std::min((int)bloom_quality, bloom_mip_count));
+  }
+
+  // combine bloom and normal scenes
+  GPU_PASS("composite");
+  GLState::BindFramebuffer(GL_FRAMEBUFFER, 0);
+  GLState::Viewport(0, 0, width, height);
+  std::shared_ptr<Program> bloom_final_prog = programs["bloom_final_prog"];
+  bloom_final_prog->bind();
+  GLState::ActiveTexture(GL_TEXTURE0);
+  GLState::BindTexture(GL_TEXTURE_2D, hdr_target->colors[0]);
+  GLState::ActiveTexture(GL_TEXTURE1);
+  GLState::BindTexture(GL_TEXTURE_2D, blurred);
+  // set every time, as a hot reload links the program over with them at 0
+  bloom_final_prog->setUniform(Uniform::scene, 0);
+  bloom_final_prog->setUniform(Uniform::bloomBlur, 1);
+  bloom_final_prog->setUniform(Uniform::bloom, bloom);
+  bloom_final_prog->setUniform(Uniform::exposure, exposure);
+  RenderQuad();
+}
+
+GLuint GameRenderer::GaussianBlur() {
   // blur the brightColor scene using blur fragment shader
-  programs["blur_prog"]->bind();
+  std::shared_ptr<Program> blur_prog = programs["blur_prog"];
+  blur_prog->bind();
 
   GLboolean horizontal = true, first_iteration = true;
-  GLuint amount = 8;
-  int tempTexWidth = width / 2;
-  int tempTexHeight = height / 2;
-  while (tempTexWidth * tempTexHeight > 1000000) {
-    tempTexWidth = tempTexWidth / 2;
-    tempTexHeight = tempTexHeight / 2;
-  }
-  glViewport(0, 0, tempTexWidth, tempTexHeight);
+  GLuint amount = BLOOM_BLUR_PASSES;
+  GLState::Viewport(0, 0, pingpong_targets[0]->format.width,
+                    pingpong_targets[0]->format.height);
+  GLState::ActiveTexture(GL_TEXTURE0);
   for (GLuint i = 0; i < amount; i++) {
-    glBindFramebuffer(GL_FRAMEBUFFER, pingpongFBO[horizontal]);
-    glUniform1i(programs["blur_prog"]->getUniform("horizontal"), horizontal);
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, first_iteration
-                                     ? hdrColorBuffers[1]
-                                     : pingpongColorbuffers[!horizontal]);
+    GPU_PASS(BLUR_PASS_NAMES[i]);
+    GLState::BindFramebuffer(GL_FRAMEBUFFER,
+                             pingpong_targets[horizontal]->framebuffer);
+    blur_prog->setUniform(Uniform::horizontal, horizontal);
+    GLState::BindTexture(GL_TEXTURE_2D,
+                         first_iteration
+                             ? hdr_target->colors[1]
+                             : pingpong_targets[!horizontal]->colors[0]);
     RenderQuad();
     horizontal = !horizontal;
     if (first_iteration)
       first_iteration = false;
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
   }
-  programs["blur_prog"]->unbind();
+  return pingpong_targets[!horizontal]->colors[0];
+}
 
-  // combine bloom and normal scenes
-  glViewport(0, 0, width, height);
-  GLfloat exposure = 1.3f;
-  programs["bloom_final_prog"]->bind();
-  glActiveTexture(GL_TEXTURE0);
-  glBindTexture(GL_TEXTURE_2D, hdrColorBuffers[0]);
-  glActiveTexture(GL_TEXTURE1);
-  glBindTexture(GL_TEXTURE_2D, pingpongColorbuffers[horizontal]);
-  glUniform1i(programs["bloom_final_prog"]->getUniform("bloom"), bloom);
-  glUniform1f(programs["bloom_final_prog"]->getUniform("exposure"), exposure);
-  RenderQuad();
-  programs["bloom_final_prog"]->unbind();
+// Downsamples the bright parts of the scene level by level with a 13 tap
+// filter, then tent filters each level back up, adding it into the next
+// larger one. The blur ends up wide without any pass touching more than
+// half the screen's pixels.
+GLuint GameRenderer::MipChainBlur() {
+  int levels = std::min((int)bloom_quality, bloom_mip_count);
+  GLState::ActiveTexture(GL_TEXTURE0);
+
+  std::shared_ptr<Program> down_prog = programs["bloom_down_prog"];
+  down_prog->bind();
+  for (int i = 0; i < levels; i++) {
+    GPU_PASS(BLOOM_DOWN_PASS_NAMES[i]);
+    GLState::BindFramebuffer(GL_FRAMEBUFFER, bloom_mips[i]->framebuffer);
+    GLState::Viewport(0, 0, bloom_mips[i]->format.width,
+                      bloom_mips[i]->format.height);
+    GLState::BindTexture(GL_TEXTURE_2D, i == 0 ? hdr_target->colors[1]
+                                               : bloom_mips[i - 1]->colors[0]);
+    down_prog->setUniform(Uniform::karis, i == 0);
+    RenderQuad();
+  }
+
+  std::shared_ptr<Program> up_prog = programs["bloom_up_prog"];
+  up_prog->bind();
+  glBlendFunc(GL_ONE, GL_ONE);
+  for (int i = levels - 1; i > 0; i--) {
+    GPU_PASS(BLOOM_UP_PASS_NAMES[i - 1]);
+    GLState::BindFramebuffer(GL_FRAMEBUFFER, bloom_mips[i - 1]->framebuffer);
+    GLState::Viewport(0, 0, bloom_mips[i - 1]->format.width,
+                      bloom_mips[i - 1]->format.height);
+    GLState::BindTexture(GL_TEXTURE_2D, bloom_mips[i]->colors[0]);
+    RenderQuad();
+  }
+  glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+  return bloom_mips[0]->colors[0];
 }
 
 void GameRenderer::SetBloom(bool doBloom) {
   bloom = doBloom;
 }
 
+void GameRenderer::SetBloomQuality(BloomQuality quality) {
+  bloom_quality = quality;
+}
+
+BloomQuality GameRenderer::GetBloomQuality() {
+  return bloom_quality;
+}
+
+void GameRenderer::SetGaussianBloom(bool enabled) {
+  gaussian_bloom = enabled;
+}
+
+bool GameRenderer::GetGaussianBloom() {
+  return gaussian_bloom;
+}
+
+double GameRenderer::GetFragmentsPerPixel() const {
+  if (!hdr_target) {
+    return 0;
+  }
+  return scene_queue.GetFragments() /
+         ((double)hdr_target->format.width * hdr_target->format.height);
+}
+
 void GameRenderer::RenderQuad() {
   if (quadVAO == 0) {
     GLfloat quadVertices[] = {
@@ -730,20 +851,22 @@ void GameRenderer::RenderQuad() {
     };
     glGenVertexArrays(1, &quadVAO);
     glGenBuffers(1, &quadVBO);
-    glBindVertexArray(quadVAO);
-    glBindBuffer(GL_ARRAY_BUFFER, quadVBO);
+    GLState::BindVertexArray(quadVAO);
+    GLState::BindBuffer(GL_ARRAY_BUFFER, quadVBO);
     glBufferData(GL_ARRAY_BUFFER, sizeof(quadVertices), &quadVertices,
                  GL_STATIC_DRAW);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(GLfloat),
-                          (GLvoid*)0);
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(GLfloat),
-                          (GLvoid*)(3 * sizeof(GLfloat)));
+    GLState::EnableVertexAttribArray(AttributeLocation(Attribute::vertPos));
+    GLState::VertexAttribPointer(AttributeLocation(Attribute::vertPos), 3,
+                                 GL_FLOAT, GL_FALSE, 5 * sizeof(GLfloat),
+                                 (GLvoid*)0);
+    GLState::EnableVertexAttribArray(AttributeLocation(Attribute::vertTex));
+    GLState::VertexAttribPointer(AttributeLocation(Attribute::vertTex), 2,
+                                 GL_FLOAT, GL_FALSE, 5 * sizeof(GLfloat),
+                                 (GLvoid*)(3 * sizeof(GLfloat)));
   }
-  glBindVertexArray(quadVAO);
+  GLState::BindVertexArray(quadVAO);
   glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
-  glBindVertexArray(0);
+  RenderStats::DrawCalls(1);
 }
 
 void GameRenderer::ImGuiRenderBegin(std::shared_ptr<GameState> game_state) {
@@ -773,17 +896,102 @@ void GameRenderer::ImGuiRenderBegin(std::shared_ptr<GameState> game_state) {
       (std::string("anim: ") +
        Player::AnimationToString(game_state->GetPlayer()->GetAnimation()))
           .c_str());
+  const RenderStats::Counters& render_stats = RenderStats::GetLastFrame();
+  ImGui::Text("draws: %llu", (unsigned long long)render_stats.draw_calls);
+  ImGui::Text("triangles: %llu", (unsigned long long)render_stats.triangles);
+  ImGui::Text("state changes: %llu (%llu elided)",
+              (unsigned long long)render_stats.state_changes,
+              (unsigned long long)render_stats.state_changes_elided);
+  RenderTargets::Stats target_stats = RenderTargets::GetStats();
+  ImGui::Text("render targets: %d (%.1f MB)", target_stats.targets,
+              target_stats.bytes / (1024.0 * 1024.0));
+  ImGui::Text("scene: %dx%d, %.2f ms", hdr_target->format.width,
+              hdr_target->format.height, DynamicResolution::GetSceneMs());
+  for (auto& video_texture : game_state->GetVideoTextures()) {
+    if (video_texture.second->GetFrameCount()) {
+      ImGui::Text("%s: %llu frames shown, %llu dropped",
+                  video_texture.first.c_str(),
+                  (unsigned long long)video_texture.second->GetShownFrames(),
+                  (unsigned long long)video_texture.second->GetDroppedFrames());
+    }
+  }
+  bool dynamic_resolution = DynamicResolution::GetEnabled();
+  if (ImGui::Checkbox("Dynamic resolution", &dynamic_resolution)) {
+    DynamicResolution::SetEnabled(dynamic_resolution);
+  }
+  if (ImGui::Button("Dump render queue")) {
+    std::ofstream scene_dump(SCENE_QUEUE_DUMP);
+    scene_queue.Dump(scene_dump);
+    std::cout << "Wrote " SCENE_QUEUE_DUMP << std::endl;
+  }
+  ImGui::Checkbox("GPU culling", &gpu_culling);
+  bool lod = RenderQueue::GetLod();
+  if (ImGui::Checkbox("Levels of detail", &lod)) {
+    RenderQueue::SetLod(lod);
+  }
+  bool depth_prepass = RenderQueue::GetDepthPrepass();
+  if (ImGui::Checkbox("Depth pre-pass", &depth_prepass)) {
+    RenderQueue::SetDepthPrepass(depth_prepass);
+  }
+  bool front_to_back = RenderQueue::GetFrontToBack();
+  if (ImGui::Checkbox("Front to back", &front_to_back)) {
+    RenderQueue::SetFrontToBack(front_to_back);
+  }
+  bool overdraw_view = RenderQueue::GetOverdrawView();
+  if (ImGui::Checkbox("Overdraw view", &overdraw_view)) {
+    RenderQueue::SetOverdrawView(overdraw_view);
+  }
+  bool count_fragments = RenderQueue::GetCountFragments();
+  if (ImGui::Checkbox("Count fragments", &count_fragments)) {
+    RenderQueue::SetCountFragments(count_fragments);
+  }
+  if (count_fragments) {
+    ImGui::Text("fragments/pixel: %.2f", GetFragmentsPerPixel());
+  }
+  ImGui::Checkbox("Gaussian bloom", &gaussian_bloom);
+  int quality = (int)bloom_quality - (int)BloomQuality::LOW;
+  if (ImGui::Combo("Bloom quality", &quality, "Low\0Medium\0High\0")) {
+    bloom_quality = (BloomQuality)(quality + (int)BloomQuality::LOW);
+  }
+  int shadow_quality = (int)ShadowMaps::GetQuality();
+  if (ImGui::Combo("Shadow quality", &shadow_quality,
+                   "Off\0Low\0Medium\0High\0")) {
+    ShadowMaps::SetQuality((ShadowQuality)shadow_quality);
+  }
+  const ShadowMaps::Stats& shadow_stats = ShadowMaps::GetStats();
+  ImGui::Text("shadows: %llu strips, %llu draws",
+              (unsigned long long)shadow_stats.strips,
+              (unsigned long long)shadow_stats.draw_calls);
+  int minimap_interval = MinimapRenderer::GetRefreshInterval();
+  if (ImGui::SliderInt("Minimap interval", &minimap_interval, 1, 30)) {
+    MinimapRenderer::SetRefreshInterval(minimap_interval);
+  }
 
   ImGui::End();
 #endif
+
+  PROFILE_IMGUI_RENDER();
+#ifdef PROFILING
+  GpuProfiler::ImGuiRender();
+#endif
 }
 
 void GameRenderer::ImGuiRenderEnd() {
+  GPU_PASS("ui");
   ImGui::Render();
+  // one draw call and a scissor change per ImGui command
+  ImDrawData* draw_data = ImGui::GetDrawData();
+  for (int i = 0; draw_data && i < draw_data->CmdListsCount; i++) {
+    RenderStats::DrawCalls(draw_data->CmdLists[i]->CmdBuffer.Size);
+    RenderStats::StateChanges(draw_data->CmdLists[i]->CmdBuffer.Size);
+  }
+  // the ImGui backend binds its own program, buffers and textures
+  GLState::Invalidate();
 }
 
 MainProgramMode GameRenderer::ImGuiRenderGame(
     std::shared_ptr<GameState> game_state) {
+  PROFILE_SCOPE("ImGuiRenderGame");
   MainProgramMode next_mode = MainProgramMode::GAME_SCREEN;
 
   ImGuiRenderBegin(game_state);
@@ -1085,6 +1293,7 @@ LevelProgramMode GameRenderer::ImGuiRenderEditor(
       default:
         break;
     }
+    ShadowMaps::Invalidate();
   }
   if (ImGui::Button("Remove")) {
     std::shared_ptr<std::unordered_set<std::shared_ptr<GameObject>>>
@@ -1094,6 +1303,7 @@ LevelProgramMode GameRenderer::ImGuiRenderEditor(
 
     if (!colliding_objs->empty()) {
       game_state->GetLevel()->RemoveItem(*colliding_objs->begin());
+      ShadowMaps::Invalidate();
     }
   }
 
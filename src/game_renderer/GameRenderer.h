@@ -14,8 +14,20 @@
 #include "Program.h"
 #include "ProgramMode.h"
 #include "ParticleGenerator.h"
+#include "RenderQueue.h"
+#include "RenderTargets.h"
+#include "ViewFrustumCulling.h"
 
 #define PLATFORM_PROG "platform_prog"
+// which of a Node's culling_planes each view keeps
+#define SCENE_CULLING_VIEW 0
+#define MINIMAP_CULLING_VIEW 1
+#define SHADOW_CULLING_VIEW 2
+#define BLOOM_MAX_MIPS 6
+
+// How many levels of the mip chain bloom goes down, each half the size of the
+// last. More spreads the glow further.
+enum class BloomQuality { LOW = 4, MEDIUM = 5, HIGH = 6 };
 
 struct Light {
   glm::vec4 position;
@@ -35,71 +47,89 @@ class GameRenderer {
   LevelProgramMode RenderLevelEditor(GLFWwindow* window,
                                      std::shared_ptr<GameState> game_state);
 
+  // Through ProgramCache, so every call for one JSON shares a program
   static std::shared_ptr<Program> ProgramFromJSON(std::string filepath);
   static std::shared_ptr<Texture> TextureFromJSON(std::string filepath);
+  // Walks tree, testing nodes only against the planes their parents cross
+  // and taking nodes entirely inside the frustum whole
   static std::unordered_set<std::shared_ptr<GameObject>>* GetObjectsInView(
-      std::shared_ptr<std::vector<glm::vec4>> vfplane,
-      std::shared_ptr<Octree> tree);
+      const ViewFrustumCulling::Frustum& frustum,
+      std::shared_ptr<Octree> tree,
+      int view);
+  // The level objects inside frustum, culled by walking the level's Octree,
+  // or by GpuCulling if GPU culling is on, in which case they're the last
+  // call's. The caller owns the set.
+  static std::unordered_set<std::shared_ptr<GameObject>>* CullLevel(
+      const ViewFrustumCulling::Frustum& frustum,
+      std::shared_ptr<GameState> game_state,
+      int view);
+  static void SetGpuCulling(bool enabled);
+  static bool GetGpuCulling();
+  // Uploads what gameplay changed to GpuCulling, ahead of a cull
+  static void UpdateGpuCulling(std::shared_ptr<GameState> game_state);
+  // Culls the level against the minimap camera and stores the result as the
+  // objects in view. This is the last cull of a rendered frame, so it decides
+  // which objects the next GameUpdater::Update() moves and animates.
+  static void UpdateMinimapView(std::shared_ptr<GameState> game_state,
+                                float aspect);
 
-  static void InitBloom(int height, int width);
-  void Bloom(int height, int width);
+  // Blurs the bright parts of the scene and composites them over it into a
+  // width by height framebuffer 0
+  void Bloom(int width, int height);
   void SetBloom(bool doBloom);
+  static void SetBloomQuality(BloomQuality quality);
+  static BloomQuality GetBloomQuality();
+  // Blur with the original eight Gaussian passes instead of the mip chain,
+  // to compare the two
+  static void SetGaussianBloom(bool enabled);
+  static bool GetGaussianBloom();
+  // Fragments the scene drew per pixel of the scene target, while
+  // RenderQueue counts fragments. Above 1 is overdraw.
+  double GetFragmentsPerPixel() const;
 
  private:
-  static std::shared_ptr<std::vector<std::shared_ptr<GameObject>>>
-  GetObjectsOfType(std::unordered_set<std::shared_ptr<GameObject>>* objects,
-                   SecondaryType type_to_get);
-
   void RenderObjects(GLFWwindow* window, std::shared_ptr<GameState> game_state);
-  void RenderSingleObject(std::shared_ptr<GameObject> object,
-                          std::shared_ptr<Program> program,
-                          std::shared_ptr<Texture> texture,
-                          std::shared_ptr<MatrixStack> P,
-                          std::shared_ptr<MatrixStack> V);
-  void RenderSingleObject(std::shared_ptr<GameObject> object,
-                          std::shared_ptr<MatrixStack> P,
-                          std::shared_ptr<MatrixStack> V);
-  void RenderLevelCollectibles(
-      std::unordered_set<std::shared_ptr<GameObject>>* objects,
-      SecondaryType type_to_render,
-      std::shared_ptr<MatrixStack> P,
-      std::shared_ptr<MatrixStack> V);
-  void RenderLevelCollectibles(
-      std::unordered_set<std::shared_ptr<GameObject>>* objects,
-      SecondaryType type_to_render,
-      glm::vec3 color,
-      std::shared_ptr<MatrixStack> P,
-      std::shared_ptr<MatrixStack> V);
-  void RenderLevelObjects(
-      std::unordered_set<std::shared_ptr<GameObject>>* objects,
-      SecondaryType type_to_render,
-      std::shared_ptr<Texture> video_texture,
-      std::shared_ptr<MatrixStack> P,
-      std::shared_ptr<MatrixStack> V);
+  // Submits the level objects in view
+  void SubmitLevel(RenderQueue& render_queue,
+                   std::unordered_set<std::shared_ptr<GameObject>>* objects);
+  // Submits the draws the last GpuCulling::Cull() filled in
+  void SubmitCulledLevel(RenderQueue& render_queue);
   void RenderParticles(std::shared_ptr<ParticleGenerator> particles,
                        std::shared_ptr<MatrixStack> P,
                        std::shared_ptr<MatrixStack> V);
-  void RenderLevelObjects(
-      std::unordered_set<std::shared_ptr<GameObject>>* objects,
-      SecondaryType type_to_render,
-      std::shared_ptr<MatrixStack> P,
-      std::shared_ptr<MatrixStack> V);
 
   void RenderMinimap(GLFWwindow* window, std::shared_ptr<GameState> game_state);
   void ImGuiRenderBegin(std::shared_ptr<GameState> game_state);
   void ImGuiRenderEnd();
   void RenderQuad();
+  // Takes the targets for a width by height scene from the pool. Trimming
+  // deletes the free targets, which only a new window size warrants.
+  void AcquireTargets(int width, int height, bool trim);
+  void ReleaseTargets();
+  // Follows the framebuffer's size once it has stopped changing, scaled by
+  // DynamicResolution. Until then the scene is drawn at the old size and
+  // stretched.
+  void UpdateTargets(GLFWwindow* window);
+  // Blur the bright parts of the scene, returning the blurred texture
+  GLuint GaussianBlur();
+  GLuint MipChainBlur();
   MainProgramMode ImGuiRenderGame(std::shared_ptr<GameState> game_state);
   LevelProgramMode ImGuiRenderEditor(std::shared_ptr<GameState> game_state);
 
   static std::unordered_map<std::string, std::shared_ptr<Program>> programs;
   std::unordered_map<std::string, std::shared_ptr<Texture>> textures;
-  std::vector<glm::vec3> color_vec;
+  RenderQueue scene_queue;
+  // the level scene_queue has ids and levels of detail for
+  std::weak_ptr<Level> queued_level;
 
-  static GLuint hdrFBO;
-  static GLuint hdrColorBuffers[2];
-  static GLuint pingpongFBO[2];
-  static GLuint pingpongColorbuffers[2];
+  static bool gpu_culling;
+  RenderTargets::Target* hdr_target = nullptr;
+  RenderTargets::Target* pingpong_targets[2] = {};
+  RenderTargets::Target* bloom_mips[BLOOM_MAX_MIPS] = {};
+  int bloom_mip_count = 0;
+  RenderTargets::SettledSize target_size;
+  static BloomQuality bloom_quality;
+  static bool gaussian_bloom;
   GLuint quadVAO = 0;
   GLuint quadVBO;
   GLboolean bloom = true;
@@ -0,0 +1,451 @@
+#include "GpuCulling.h"
+
+#include <algorithm>
+#include <iostream>
+#include <map>
+#include <tuple>
+#include <unordered_map>
+
+#include "GLSL.h"
+#include "GLState.h"
+#include "MeshBuffer.h"
+#include "Profiler.h"
+#include "RenderQueue.h"
+
+#define CULL_SHADER ASSET_DIR "/shaders/cull_comp.glsl"
+// matches local_size_x in the shader
+#define CULL_GROUP_SIZE 64
+// copies of the visible list on their way back, one per GetVisible() call
+#define READBACK_SLOTS 2
+
+// storage buffer bindings in the shader
+#define BOXES_BINDING 0
+#define OBJECT_DRAWS_BINDING 1
+#define DRAWS_BINDING 2
+#define VISIBLE_INDICES_BINDING 3
+#define VISIBLE_BINDING 4
+
+namespace GpuCulling {
+
+namespace {
+
+// std430 layout of an AABB, w unused
+struct Box {
+  glm::vec4 min;
+  glm::vec4 max;
+};
+
+// the tree the objects were laid out from
+std::shared_ptr<Octree> current_tree;
+// the level's objects, in order of where their boxes start along x
+std::vector<std::shared_ptr<GameObject>> objects;
+std::unordered_map<const GameObject*, size_t> object_indices;
+bool stale = false;
+std::vector<Box> boxes;
+// OBJECT_TEXELS per object
+std::vector<glm::vec4> object_data;
+// the draw each object is an instance of, and an object of each draw
+std::vector<GLuint> object_draws;
+std::vector<std::shared_ptr<GameObject>> draw_objects;
+// the draws with no instances yet, copied over the last frame's before a cull
+std::vector<IndirectDraw> empty_draws;
+
+// results on the CPU when there are no compute shaders
+std::vector<IndirectDraw> draws;
+std::vector<GLuint> visible_indices;
+std::vector<GLuint> visible;
+// where lists read back from the GPU go
+std::vector<GLuint> read_indices;
+
+GLuint program = 0;
+bool program_failed = false;
+GLint planes_location;
+GLint object_count_location;
+
+GLuint box_buffer = 0;
+GLuint object_buffer;
+GLuint object_texture;
+GLuint object_draw_buffer;
+GLuint draw_buffer;
+GLuint visible_index_buffer;
+// how many objects are visible and then which
+GLuint visible_buffer;
+GLuint readback_buffers[READBACK_SLOTS];
+GLsync readback_fences[READBACK_SLOTS] = {};
+int readback_slot = 0;
+
+Box BoxOf(std::shared_ptr<GameObject> object) {
+  AxisAlignedBox box = object->GetBoundingBox();
+  Box gpu_box;
+  gpu_box.min = glm::vec4(box.GetMin(), 0.0f);
+  gpu_box.max = glm::vec4(box.GetMax(), 0.0f);
+  return gpu_box;
+}
+
+// Culled if the corner farthest along some plane's normal is behind it,
+// which is when all eight corners are
+bool IsVisible(const Box& box, const ViewFrustumCulling::Frustum& frustum) {
+  for (const glm::vec4& plane : frustum.planes) {
+    glm::vec3 corner(plane.x > 0 ? box.max.x : box.min.x,
+                     plane.y > 0 ? box.max.y : box.min.y,
+                     plane.z > 0 ? box.max.z : box.min.z);
+    if (glm::dot(glm::vec3(plane), corner) + plane.w <= 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool LoadProgram() {
+  if (program || program_failed) {
+    return program != 0;
+  }
+  program_failed = true;
+  char* source = GLSL::textFileRead(CULL_SHADER);
+  if (!source) {
+    return false;
+  }
+  GLuint shader = glCreateShader(GL_COMPUTE_SHADER);
+  glShaderSource(shader, 1, &source, NULL);
+  glCompileShader(shader);
+  free(source);
+  GLint rc;
+  glGetShaderiv(shader, GL_COMPILE_STATUS, &rc);
+  if (!rc) {
+    GLSL::printShaderInfoLog(shader);
+    std::cerr << "Error compiling " CULL_SHADER << std::endl;
+    glDeleteShader(shader);
+    return false;
+  }
+  GLuint new_program = glCreateProgram();
+  glAttachShader(new_program, shader);
+  glLinkProgram(new_program);
+  glDeleteShader(shader);
+  glGetProgramiv(new_program, GL_LINK_STATUS, &rc);
+  if (!rc) {
+    GLSL::printProgramInfoLog(new_program);
+    std::cerr << "Error linking " CULL_SHADER << std::endl;
+    glDeleteProgram(new_program);
+    return false;
+  }
+  program = new_program;
+  program_failed = false;
+  planes_location = glGetUniformLocation(program, "planes");
+  object_count_location = glGetUniformLocation(program, "objectCount");
+  return true;
+}
+
+bool UseCompute() {
+  return ComputeSupported() && LoadProgram();
+}
+
+template <typename T>
+void Upload(GLenum target, GLuint buffer, const std::vector<T>& data) {
+  GLState::BindBuffer(target, buffer);
+  glBufferData(target, std::max<size_t>(data.size(), 1) * sizeof(T),
+               data.empty() ? NULL : &data[0], GL_DYNAMIC_DRAW);
+}
+
+// Uploads elements [first, first + count) of data, where each object has
+// per_object elements
+template <typename T>
+void UploadRange(GLenum target,
+                 GLuint buffer,
+                 const std::vector<T>& data,
+                 size_t per_object,
+                 size_t first,
+                 size_t count) {
+  GLState::BindBuffer(target, buffer);
+  glBufferSubData(target, first * per_object * sizeof(T),
+                  count * per_object * sizeof(T), &data[first * per_object]);
+}
+
+void Refresh(size_t index, ObjectWriter writer) {
+  boxes[index] = BoxOf(objects[index]);
+  writer(objects[index], index, &object_data[index * OBJECT_TEXELS]);
+}
+
+void ForgetReadbacks() {
+  for (GLsync& fence : readback_fences) {
+    if (fence) {
+      glDeleteSync(fence);
+      fence = 0;
+    }
+  }
+}
+
+// Lays out the objects and draws for a level and uploads everything
+void Load(std::shared_ptr<Level> level, ObjectWriter writer) {
+  PROFILE_SCOPE("GpuCulling::Load");
+  current_tree = level->getTree();
+  objects = *level->getObjects();
+  boxes.resize(objects.size());
+  object_data.resize(objects.size() * OBJECT_TEXELS);
+  for (size_t i = 0; i < objects.size(); i++) {
+    boxes[i] = BoxOf(objects[i]);
+  }
+  std::vector<size_t> order(objects.size());
+  for (size_t i = 0; i < order.size(); i++) {
+    order[i] = i;
+  }
+  std::stable_sort(order.begin(), order.end(), [](size_t a, size_t b) {
+    return boxes[a].min.x < boxes[b].min.x;
+  });
+  std::vector<std::shared_ptr<GameObject>> level_objects;
+  level_objects.swap(objects);
+  object_indices.clear();
+  for (size_t index : order) {
+    object_indices[level_objects[index].get()] = objects.size();
+    objects.push_back(level_objects[index]);
+  }
+  for (size_t i = 0; i < objects.size(); i++) {
+    Refresh(i, writer);
+  }
+  stale = false;
+
+  // ordered so draws of one program and texture are next to each other
+  typedef std::tuple<const Program*, const Texture*, const Shape*> DrawKey;
+  std::map<DrawKey, std::vector<GLuint>> draw_instances;
+  for (size_t i = 0; i < objects.size(); i++) {
+    DrawKey key(objects[i]->GetProgram().get(),
+                objects[i]->GetTexture().get(),
+                objects[i]->GetModel().get());
+    draw_instances[key].push_back(i);
+  }
+  object_draws.assign(objects.size(), 0);
+  draw_objects.clear();
+  empty_draws.clear();
+  // each draw's instances follow the last draw's
+  GLuint base_instance = 0;
+  for (const auto& instances : draw_instances) {
+    const MeshBuffer::Mesh* mesh =
+        MeshBuffer::Find(std::get<2>(instances.first));
+    IndirectDraw draw = {mesh ? mesh->index_count : 0, 0,
+                         mesh ? mesh->first_index : 0,
+                         mesh ? mesh->base_vertex : 0, base_instance};
+    for (GLuint object : instances.second) {
+      object_draws[object] = empty_draws.size();
+    }
+    draw_objects.push_back(objects[instances.second[0]]);
+    empty_draws.push_back(draw);
+    base_instance += instances.second.size();
+  }
+
+  if (!box_buffer) {
+    glGenBuffers(1, &box_buffer);
+    glGenBuffers(1, &object_buffer);
+    glGenTextures(1, &object_texture);
+    glGenBuffers(1, &object_draw_buffer);
+    glGenBuffers(1, &draw_buffer);
+    glGenBuffers(1, &visible_index_buffer);
+    glGenBuffers(1, &visible_buffer);
+    glGenBuffers(READBACK_SLOTS, readback_buffers);
+  }
+  visible.clear();
+  visible_indices.assign(objects.size(), 0);
+  read_indices.resize(objects.size());
+  Upload(GL_ARRAY_BUFFER, box_buffer, boxes);
+  Upload(GL_ARRAY_BUFFER, object_draw_buffer, object_draws);
+  Upload(GL_ARRAY_BUFFER, draw_buffer, empty_draws);
+  Upload(GL_ARRAY_BUFFER, visible_index_buffer, visible_indices);
+  std::vector<GLuint> no_visible(objects.size() + 1, 0);
+  Upload(GL_ARRAY_BUFFER, visible_buffer, no_visible);
+  for (GLuint readback_buffer : readback_buffers) {
+    GLState::BindBuffer(GL_COPY_WRITE_BUFFER, readback_buffer);
+    glBufferData(GL_COPY_WRITE_BUFFER, no_visible.size() * sizeof(GLuint),
+                 NULL, GL_STREAM_READ);
+  }
+  ForgetReadbacks();
+  Upload(GL_TEXTURE_BUFFER, object_buffer, object_data);
+  GLState::ActiveTexture(GL_TEXTURE0);
+  GLState::BindTexture(GL_TEXTURE_BUFFER, object_texture);
+  glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, object_buffer);
+}
+
+void CullOnCpu(const ViewFrustumCulling::Frustum& frustum) {
+  draws = empty_draws;
+  visible.clear();
+  for (size_t i = 0; i < objects.size(); i++) {
+    if (IsVisible(boxes[i], frustum)) {
+      visible.push_back(i);
+      IndirectDraw& draw = draws[object_draws[i]];
+      visible_indices[draw.base_instance + draw.instance_count++] = i;
+    }
+  }
+  Upload(GL_ARRAY_BUFFER, draw_buffer, draws);
+  Upload(GL_ARRAY_BUFFER, visible_index_buffer, visible_indices);
+}
+
+void CullOnGpu(const ViewFrustumCulling::Frustum& frustum) {
+  GLState::BindBuffer(GL_ARRAY_BUFFER, draw_buffer);
+  glBufferSubData(GL_ARRAY_BUFFER, 0, empty_draws.size() * sizeof(IndirectDraw),
+                  empty_draws.empty() ? NULL : &empty_draws[0]);
+  GLuint visible_count = 0;
+  GLState::BindBuffer(GL_ARRAY_BUFFER, visible_buffer);
+  glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(GLuint), &visible_count);
+
+  GLState::UseProgram(program);
+  glUniform4fv(planes_location, 6, &frustum.planes[0][0]);
+  glUniform1ui(object_count_location, objects.size());
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BOXES_BINDING, box_buffer);
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, OBJECT_DRAWS_BINDING,
+                   object_draw_buffer);
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, DRAWS_BINDING, draw_buffer);
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, VISIBLE_INDICES_BINDING,
+                   visible_index_buffer);
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, VISIBLE_BINDING, visible_buffer);
+  glDispatchCompute((objects.size() + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE,
+                    1, 1);
+  // for the indirect draws, their objectIndex and copies of the list
+  glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT |
+                  GL_BUFFER_UPDATE_BARRIER_BIT);
+}
+
+std::unordered_set<std::shared_ptr<GameObject>>* VisibleSet(
+    const std::vector<GLuint>& indices,
+    size_t count) {
+  std::unordered_set<std::shared_ptr<GameObject>>* visible_objects =
+      new std::unordered_set<std::shared_ptr<GameObject>>();
+  for (size_t i = 0; i < count; i++) {
+    visible_objects->insert(objects[indices[i]]);
+  }
+  return visible_objects;
+}
+
+// Reads a count and then that many indices out of buffer, which the GPU is
+// done writing
+std::unordered_set<std::shared_ptr<GameObject>>* ReadList(GLuint buffer) {
+  GLuint count = 0;
+  GLState::BindBuffer(GL_COPY_READ_BUFFER, buffer);
+  glGetBufferSubData(GL_COPY_READ_BUFFER, 0, sizeof(GLuint), &count);
+  count = std::min<size_t>(count, objects.size());
+  if (count) {
+    glGetBufferSubData(GL_COPY_READ_BUFFER, sizeof(GLuint),
+                       count * sizeof(GLuint), &read_indices[0]);
+  }
+  return VisibleSet(read_indices, count);
+}
+
+std::unordered_set<std::shared_ptr<GameObject>>* ReadSlot(int slot) {
+  PROFILE_SCOPE("GpuCulling::ReadSlot");
+  GLenum status;
+  do {
+    status = glClientWaitSync(readback_fences[slot],
+                              GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+  } while (status == GL_TIMEOUT_EXPIRED);
+  glDeleteSync(readback_fences[slot]);
+  readback_fences[slot] = 0;
+  return ReadList(readback_buffers[slot]);
+}
+
+}  // namespace
+
+bool ComputeSupported() {
+  return GLEW_VERSION_4_3 || (GLEW_ARB_compute_shader &&
+                              GLEW_ARB_shader_storage_buffer_object);
+}
+
+void Update(std::shared_ptr<Level> level,
+            const std::unordered_set<std::shared_ptr<GameObject>>& changed,
+            ObjectWriter writer) {
+  PROFILE_SCOPE("GpuCulling::Update");
+  if (level->getTree() != current_tree ||
+      level->getObjects()->size() != objects.size()) {
+    Load(level, writer);
+    return;
+  }
+  size_t first = objects.size();
+  size_t last = 0;
+  if (stale) {
+    for (size_t i = 0; i < objects.size(); i++) {
+      Refresh(i, writer);
+    }
+    first = 0;
+    last = objects.size();
+    stale = false;
+  } else {
+    for (const std::shared_ptr<GameObject>& object : changed) {
+      auto found = object_indices.find(object.get());
+      if (found != object_indices.end()) {
+        Refresh(found->second, writer);
+        first = std::min(first, found->second);
+        last = std::max(last, found->second + 1);
+      }
+    }
+  }
+  if (first >= last) {
+    return;
+  }
+  UploadRange(GL_ARRAY_BUFFER, box_buffer, boxes, 1, first, last - first);
+  UploadRange(GL_TEXTURE_BUFFER, object_buffer, object_data, OBJECT_TEXELS,
+              first, last - first);
+}
+
+void Invalidate() {
+  stale = true;
+}
+
+void Cull(const ViewFrustumCulling::Frustum& frustum) {
+  PROFILE_SCOPE("GpuCulling::Cull");
+  if (objects.empty()) {
+    visible.clear();
+    return;
+  }
+  if (UseCompute()) {
+    CullOnGpu(frustum);
+  } else {
+    CullOnCpu(frustum);
+  }
+}
+
+std::unordered_set<std::shared_ptr<GameObject>>* GetVisible() {
+  PROFILE_SCOPE("GpuCulling::GetVisible");
+  if (!UseCompute() || objects.empty()) {
+    return VisibleSet(visible, visible.size());
+  }
+  GLState::BindBuffer(GL_COPY_READ_BUFFER, visible_buffer);
+  GLState::BindBuffer(GL_COPY_WRITE_BUFFER, readback_buffers[readback_slot]);
+  glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0,
+                      (objects.size() + 1) * sizeof(GLuint));
+  if (readback_fences[readback_slot]) {
+    glDeleteSync(readback_fences[readback_slot]);
+  }
+  readback_fences[readback_slot] =
+      glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  int last_slot = 1 - readback_slot;
+  if (!readback_fences[last_slot]) {
+    last_slot = readback_slot;
+  }
+  readback_slot = 1 - readback_slot;
+  return ReadSlot(last_slot);
+}
+
+std::unordered_set<std::shared_ptr<GameObject>>* ReadVisible() {
+  PROFILE_SCOPE("GpuCulling::ReadVisible");
+  if (!UseCompute() || objects.empty()) {
+    return VisibleSet(visible, visible.size());
+  }
+  return ReadList(visible_buffer);
+}
+
+GLuint GetIndirectBuffer() {
+  return draw_buffer;
+}
+
+GLuint GetVisibleIndexBuffer() {
+  return visible_index_buffer;
+}
+
+GLuint GetObjectTexture() {
+  return object_texture;
+}
+
+size_t GetDrawCount() {
+  return empty_draws.size();
+}
+
+std::shared_ptr<GameObject> GetDrawObject(size_t draw) {
+  return draw_objects[draw];
+}
+
+}  // namespace GpuCulling
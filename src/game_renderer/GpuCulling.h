@@ -0,0 +1,82 @@
+#ifndef GPU_CULLING_H_
+#define GPU_CULLING_H_
+
+#define GLEW_STATIC
+#include <GL/glew.h>
+
+#include <memory>
+#include <unordered_set>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "GameObject.h"
+#include "Level.h"
+#include "ViewFrustumCulling.h"
+
+// Frustum culling of every object in the level on the GPU, in place of
+// walking the Octree. Object AABBs and the object data batched shaders read
+// stay on the GPU, in order along the level so that the objects in view,
+// the only ones that move or animate, are one range to upload again. The
+// compute shader in assets/shaders/cull_comp.glsl tests each AABB against
+// the six planes, lists it if it's visible, and adds it to an indirect draw
+// per program, texture and mesh, whose instances are the visible object
+// indices. RenderQueue draws straight from those, with nothing read back.
+//
+// Gameplay still needs a set of the objects in view, so GetVisible() copies
+// the list aside behind a fence and returns the one from the call before,
+// which the GPU has long finished. The set is a frame late, so replays
+// recorded with GPU culling on only replay the same with it on.
+//
+// Without compute shaders (GL 4.3, or ARB_compute_shader and
+// ARB_shader_storage_buffer_object) the same buffers are filled in on the
+// CPU, and GetVisible() returns the current cull.
+namespace GpuCulling {
+
+// Layout of the indirect draws, as glMultiDrawElementsIndirect reads them
+struct IndirectDraw {
+  GLuint count;
+  GLuint instance_count;
+  GLuint first_index;
+  GLint base_vertex;
+  GLuint base_instance;
+};
+
+// Writes an object's OBJECT_TEXELS texels of object data. index is its
+// place in the level's order, the same from frame to frame.
+typedef void (*ObjectWriter)(const std::shared_ptr<GameObject>& object,
+                             size_t index,
+                             glm::vec4* texels);
+
+bool ComputeSupported();
+// Brings the boxes and object data up to date with level, loading it if it's
+// new. Only the objects in changed are written again, unless Invalidate()
+// was called since the last update.
+void Update(std::shared_ptr<Level> level,
+            const std::unordered_set<std::shared_ptr<GameObject>>& changed,
+            ObjectWriter writer);
+// For when objects out of view change too, like when the level starts over
+void Invalidate();
+// Culls the objects against frustum, into the draws
+void Cull(const ViewFrustumCulling::Frustum& frustum);
+// The objects the last Cull() before the call before this found visible,
+// for one view culled once a frame. Without a call before, it waits for
+// the last Cull() instead. The caller owns the set.
+std::unordered_set<std::shared_ptr<GameObject>>* GetVisible();
+// The objects the last Cull() found visible. Waits for it to finish, so
+// it's for checking the culling rather than every frame.
+std::unordered_set<std::shared_ptr<GameObject>>* ReadVisible();
+
+// Filled in by the last Cull(). Draw i's visible object indices are
+// GetVisibleIndexBuffer()[base_instance, base_instance + instance_count).
+// Draws are ordered by program and then texture.
+GLuint GetIndirectBuffer();
+GLuint GetVisibleIndexBuffer();
+// A buffer texture of each object's data
+GLuint GetObjectTexture();
+size_t GetDrawCount();
+// One of the objects draw is of, for its program and textures
+std::shared_ptr<GameObject> GetDrawObject(size_t draw);
+
+}  // namespace GpuCulling
+
+#endif
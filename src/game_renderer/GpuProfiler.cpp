@@ -0,0 +1,214 @@
+#include "GpuProfiler.h"
+
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+#include <imgui.h>
+
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <map>
+
+#include "InputBindings.h"
+#include "Logging.h"
+
+// weight of the newest frame in the overlay's running averages
+#define AVERAGE_WEIGHT 0.05
+
+namespace GpuProfiler {
+
+namespace {
+
+struct FrameQueries {
+  int count;
+  const char* names[GPU_PROFILER_MAX_PASSES];
+  GLuint queries[GPU_PROFILER_MAX_PASSES];
+  uint64_t cpu_ns[GPU_PROFILER_MAX_PASSES];
+};
+
+bool initialized = false;
+bool timer_queries = false;
+FrameQueries frames[2];
+int current = 0;
+int open_pass = -1;
+int pass_depth = 0;  // passes begun inside the open one are only counted
+std::chrono::steady_clock::time_point open_pass_start;
+uint64_t frame_number = 0;
+
+std::vector<PassTiming> last_timings;
+// keyed on the name literal itself, so no strings are built every frame
+std::map<const char*, PassTiming> averages;
+std::ofstream csv_log;
+bool show_overlay = false;
+
+void CollectFrame(FrameQueries& frame) {
+  if (frame.count == 0) {
+    return;
+  }
+
+  if (timer_queries) {
+    // never wait on the GPU, drop the frame if it's still busy
+    for (int i = 0; i < frame.count; i++) {
+      GLint available = 0;
+      glGetQueryObjectiv(frame.queries[i], GL_QUERY_RESULT_AVAILABLE,
+                         &available);
+      if (!available) {
+        return;
+      }
+    }
+  }
+
+  last_timings.clear();
+  for (int i = 0; i < frame.count; i++) {
+    PassTiming timing;
+    timing.name = frame.names[i];
+    timing.cpu_ms = frame.cpu_ns[i] / 1000000.0;
+    timing.gpu_ms = -1;
+    if (timer_queries) {
+      GLuint64 elapsed_ns = 0;
+      glGetQueryObjectui64v(frame.queries[i], GL_QUERY_RESULT, &elapsed_ns);
+      timing.gpu_ms = elapsed_ns / 1000000.0;
+    }
+    last_timings.push_back(timing);
+
+    auto average = averages.find(timing.name);
+    if (average == averages.end()) {
+      averages[timing.name] = timing;
+    } else {
+      average->second.cpu_ms +=
+          (timing.cpu_ms - average->second.cpu_ms) * AVERAGE_WEIGHT;
+      average->second.gpu_ms +=
+          (timing.gpu_ms - average->second.gpu_ms) * AVERAGE_WEIGHT;
+    }
+
+    if (csv_log.is_open()) {
+      csv_log << frame_number << "," << timing.name << "," << timing.gpu_ms
+              << "," << timing.cpu_ms << "\n";
+    }
+  }
+}
+
+}  // namespace
+
+void Init() {
+  if (initialized) {
+    return;
+  }
+  initialized = true;
+
+  timer_queries = GLEW_VERSION_3_3 || GLEW_ARB_timer_query;
+  if (timer_queries) {
+    GLint counter_bits = 0;
+    glGetQueryiv(GL_TIME_ELAPSED, GL_QUERY_COUNTER_BITS, &counter_bits);
+    timer_queries = counter_bits > 0;
+  }
+  if (timer_queries) {
+    for (FrameQueries& frame : frames) {
+      glGenQueries(GPU_PROFILER_MAX_PASSES, frame.queries);
+    }
+  } else {
+    LOG("GL timer queries unavailable, using CPU pass timing");
+  }
+}
+
+bool TimerQueriesAvailable() {
+  return timer_queries;
+}
+
+void Pass::Begin(const char* name) {
+  FrameQueries& frame = frames[current];
+  if (!initialized || pass_depth++ > 0 ||
+      frame.count == GPU_PROFILER_MAX_PASSES) {
+    return;
+  }
+
+  open_pass = frame.count++;
+  frame.names[open_pass] = name;
+  open_pass_start = std::chrono::steady_clock::now();
+  if (timer_queries) {
+    glBeginQuery(GL_TIME_ELAPSED, frame.queries[open_pass]);
+  }
+}
+
+void Pass::End() {
+  if (!initialized || --pass_depth > 0 || open_pass < 0) {
+    return;
+  }
+  FrameQueries& frame = frames[current];
+  if (timer_queries) {
+    glEndQuery(GL_TIME_ELAPSED);
+  }
+  frame.cpu_ns[open_pass] =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::steady_clock::now() - open_pass_start)
+          .count();
+  open_pass = -1;
+}
+
+void EndFrame() {
+  if (!initialized) {
+    return;
+  }
+  if (pass_depth > 0) {
+    LOG_ERROR("frame ended with " << pass_depth << " passes open");
+    return;
+  }
+
+  // last frame's queries have had a whole frame to finish
+  current = 1 - current;
+  CollectFrame(frames[current]);
+  frames[current].count = 0;
+  frame_number++;
+}
+
+const std::vector<PassTiming>& GetLastTimings() {
+  return last_timings;
+}
+
+bool OpenCsvLog(const std::string& path) {
+  csv_log.open(path);
+  if (!csv_log) {
+    LOG_ERROR("Couldn't open " << path);
+    return false;
+  }
+  csv_log << "frame,pass,gpu_ms,cpu_ms\n";
+  return true;
+}
+
+void ImGuiRender() {
+  if (InputBindings::KeyPressed(GLFW_KEY_F4)) {
+    show_overlay = !show_overlay;
+  }
+  if (!show_overlay) {
+    return;
+  }
+
+  ImGui::SetNextWindowSize(ImVec2(420, 400), ImGuiSetCond_FirstUseEver);
+  ImGui::Begin("Render passes [F4]", &show_overlay);
+  if (!timer_queries) {
+    ImGui::Text("No timer queries, CPU submit time only");
+  }
+  ImGui::Text("%-16s %9s %9s", "pass", "gpu ms", "cpu ms");
+
+  double gpu_total = 0, cpu_total = 0;
+  for (const PassTiming& timing : last_timings) {
+    const PassTiming& average = averages[timing.name];
+    if (timer_queries) {
+      ImGui::Text("%-16s %9.3f %9.3f", timing.name, average.gpu_ms,
+                  average.cpu_ms);
+    } else {
+      ImGui::Text("%-16s %9s %9.3f", timing.name, "-", average.cpu_ms);
+    }
+    gpu_total += average.gpu_ms;
+    cpu_total += average.cpu_ms;
+  }
+  ImGui::Separator();
+  if (timer_queries) {
+    ImGui::Text("%-16s %9.3f %9.3f", "total", gpu_total, cpu_total);
+  } else {
+    ImGui::Text("%-16s %9s %9.3f", "total", "-", cpu_total);
+  }
+  ImGui::End();
+}
+
+}  // namespace GpuProfiler
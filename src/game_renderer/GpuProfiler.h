@@ -0,0 +1,65 @@
+#ifndef GPU_PROFILER_H_
+#define GPU_PROFILER_H_
+
+#include <string>
+#include <vector>
+
+// GL_TIME_ELAPSED queries around render passes. Queries are double buffered:
+// a frame's results are read at the end of the next frame and dropped if the
+// GPU still hasn't finished them, so nothing ever waits on the GPU. Without
+// timer queries (GL < 3.3 without ARB_timer_query, or 0 counter bits as on
+// some software rasterizers) only CPU submission time is reported.
+//
+// Passes can't nest: GL only allows one GL_TIME_ELAPSED query at a time, so
+// a pass started inside another one is ignored. Like PROFILE_SCOPE, GPU_PASS
+// only exists when built with -DPROFILING and names must be string literals.
+#ifdef PROFILING
+#define GPU_PASS_CONCAT_INNER(a, b) a##b
+#define GPU_PASS_CONCAT(a, b) GPU_PASS_CONCAT_INNER(a, b)
+#define GPU_PASS(name) \
+  GpuProfiler::Pass GPU_PASS_CONCAT(gpu_pass_, __LINE__)(name)
+#else
+#define GPU_PASS(name) \
+  do {                 \
+  } while (0)
+#endif
+
+#define GPU_PROFILER_MAX_PASSES 32
+
+namespace GpuProfiler {
+
+struct PassTiming {
+  const char* name;
+  double gpu_ms;  // negative when timer queries are unavailable
+  double cpu_ms;
+};
+
+class Pass {
+ public:
+  explicit Pass(const char* name) { Begin(name); }
+  ~Pass() { End(); }
+
+ private:
+  static void Begin(const char* name);
+  static void End();
+};
+
+// Call once there is a GL context
+void Init();
+bool TimerQueriesAvailable();
+
+// Call once per frame after the last pass, collects last frame's queries
+void EndFrame();
+
+// Latest pass timings that made it back from the GPU
+const std::vector<PassTiming>& GetLastTimings();
+
+// Appends frame,pass,gpu_ms,cpu_ms rows to path for every collected frame
+bool OpenCsvLog(const std::string& path);
+
+// Draws the pass overlay, toggled with F4
+void ImGuiRender();
+
+}  // namespace GpuProfiler
+
+#endif
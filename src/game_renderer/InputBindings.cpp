@@ -4,11 +4,34 @@
 
 #include "Logging.h"
 #include "GameRenderer.h"
+#include "GLState.h"
 
 static GLFWwindow* static_window;
 static bool key_pressed_buffer[512];
 static InputBindings::CursorMode cursor_mode = InputBindings::CursorMode::FREE;
 static std::pair<double, double> last_cursor_pos;
+static InputBindings::InputMode input_mode = InputBindings::InputMode::LIVE;
+static InputBindings::InputTick input_tick;
+
+// The keys read by GameUpdater and PlayerUpdater, in InputTick bit order.
+// Append new keys to the end so old replays keep their meaning.
+static const int RECORDED_KEYS[] = {
+    GLFW_KEY_SPACE,      GLFW_KEY_A,           GLFW_KEY_D,
+    GLFW_KEY_LEFT_SHIFT, GLFW_KEY_RIGHT_SHIFT, GLFW_KEY_ESCAPE,
+    GLFW_KEY_L,          GLFW_KEY_RIGHT,       GLFW_KEY_H,
+    GLFW_KEY_LEFT,       GLFW_KEY_K,           GLFW_KEY_UP,
+    GLFW_KEY_J,          GLFW_KEY_DOWN,        GLFW_KEY_C,
+    GLFW_KEY_E,          GLFW_KEY_1,           GLFW_KEY_2};
+
+uint32_t InputBindings::RecordedKeyBit(int key) {
+  for (size_t i = 0; i < sizeof(RECORDED_KEYS) / sizeof(RECORDED_KEYS[0]);
+       i++) {
+    if (RECORDED_KEYS[i] == key) {
+      return 1u << i;
+    }
+  }
+  return 0;
+}
 
 InputBindings::InputBindings() {}
 
@@ -30,18 +53,33 @@ void InputBindings::Bind(GLFWwindow* window) {
 }
 
 bool InputBindings::KeyPressed(int key) {
+  if (input_mode == InputMode::REPLAYING) {
+    return input_tick.keys_pressed & RecordedKeyBit(key);
+  }
+
   if (key_pressed_buffer[key]) {
     // "handle" the keypress at this moment
     key_pressed_buffer[key] = false;
+    if (input_mode == InputMode::RECORDING) {
+      input_tick.keys_pressed |= RecordedKeyBit(key);
+    }
     return true;
   }
   return false;
 }
 
 bool InputBindings::KeyDown(int key) {
+  if (input_mode == InputMode::REPLAYING) {
+    return input_tick.keys_down & RecordedKeyBit(key);
+  }
+
   // handle the keypress if there was one
   key_pressed_buffer[key] = false;
-  return ImGui::GetIO().KeysDown[key];
+  bool down = ImGui::GetIO().KeysDown[key];
+  if (down && input_mode == InputMode::RECORDING) {
+    input_tick.keys_down |= RecordedKeyBit(key);
+  }
+  return down;
 }
 
 void InputBindings::ClearKeyPresses() {
@@ -70,6 +108,9 @@ InputBindings::CursorMode InputBindings::GetCursorMode() {
 }
 
 std::pair<float, float> InputBindings::GetCursorDiff() {
+  if (input_mode == InputMode::REPLAYING) {
+    return std::pair<float, float>(input_tick.cursor_dx, input_tick.cursor_dy);
+  }
   if (cursor_mode != CursorMode::LOCKED) {
     return std::pair<float, float>(0, 0);
   }
@@ -79,9 +120,34 @@ std::pair<float, float> InputBindings::GetCursorDiff() {
   std::pair<float, float> diff = std::pair<double, double>(
       xpos - last_cursor_pos.first, ypos - last_cursor_pos.second);
   last_cursor_pos = std::pair<double, double>(xpos, ypos);
+  if (input_mode == InputMode::RECORDING) {
+    input_tick.cursor_dx += diff.first;
+    input_tick.cursor_dy += diff.second;
+  }
   return diff;
 }
 
+void InputBindings::SetInputMode(InputMode new_input_mode) {
+  input_mode = new_input_mode;
+  ResetInputTick();
+}
+
+InputBindings::InputMode InputBindings::GetInputMode() {
+  return input_mode;
+}
+
+void InputBindings::ResetInputTick() {
+  input_tick = InputTick();
+}
+
+InputBindings::InputTick InputBindings::GetInputTick() {
+  return input_tick;
+}
+
+void InputBindings::SetInputTick(const InputTick& new_input_tick) {
+  input_tick = new_input_tick;
+}
+
 void InputBindings::KeyCallback(GLFWwindow* window,
                                 int key,
                                 int scancode,
@@ -110,8 +176,8 @@ void InputBindings::ErrorCallback(int error, const char* description) {
 }
 
 void InputBindings::ResizeCallback(GLFWwindow* window, int width, int height) {
-  glViewport(0, 0, width, height);
-  GameRenderer::InitBloom(width, height);
+  // GameRenderer resizes its targets once the size settles
+  GLState::Viewport(0, 0, width, height);
 }
 
 void InputBindings::CursorCallback(GLFWwindow* window,
@@ -3,6 +3,7 @@
 #ifndef INPUT_BINDINGS_H_
 #define INPUT_BINDINGS_H_
 
+#include <cstdint>
 #include <memory>
 
 #include "RendererSetup.h"
@@ -20,6 +21,28 @@ class InputBindings {
   static CursorMode GetCursorMode();
   static std::pair<float, float> GetCursorDiff();
 
+  // Everything the simulation asked about the input during one call to
+  // GameUpdater::Update(). Each bit of the masks is one of the keys in
+  // RECORDED_KEYS; keys outside of that table always read as up in a replay.
+  struct InputTick {
+    uint32_t keys_down;
+    uint32_t keys_pressed;
+    float cursor_dx;
+    float cursor_dy;
+  };
+
+  // LIVE reads the window, RECORDING reads the window and remembers what was
+  // returned in the current InputTick, REPLAYING only returns the current
+  // InputTick and never touches the window.
+  enum InputMode { LIVE = 1, RECORDING = 2, REPLAYING = 3 };
+  static void SetInputMode(InputMode input_mode);
+  static InputMode GetInputMode();
+  static void ResetInputTick();
+  static InputTick GetInputTick();
+  static void SetInputTick(const InputTick& input_tick);
+  // The InputTick mask bit for key, 0 if key isn't recorded
+  static uint32_t RecordedKeyBit(int key);
+
  private:
   InputBindings();
   ~InputBindings();
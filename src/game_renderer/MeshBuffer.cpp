@@ -0,0 +1,155 @@
+#include "MeshBuffer.h"
+
+#include <numeric>
+#include <unordered_map>
+#include <vector>
+
+#include "GLState.h"
+#include "Program.h"
+#include "RenderStats.h"
+
+// position, normal, texcoord
+#define FLOATS_PER_VERTEX 8
+
+namespace MeshBuffer {
+
+namespace {
+
+// each shape's levels of detail
+std::unordered_map<const Shape*, std::vector<Mesh>> meshes;
+std::vector<float> vertices;
+std::vector<unsigned int> elements;
+bool dirty = false;
+
+GLuint vao = 0;
+GLuint vertex_buffer;
+GLuint element_buffer;
+GLuint instance_buffer;  // 0, 1, 2, ... for objectIndex
+GLuint indexed_vao = 0;
+// what indexed_vao's objectIndex reads
+GLuint indexed_buffer = 0;
+
+// Sets up a VAO's vertex attributes and element buffer, leaving it bound
+GLuint MakeVertexArray() {
+  GLuint array;
+  glGenVertexArrays(1, &array);
+  GLState::BindVertexArray(array);
+
+  GLsizei stride = FLOATS_PER_VERTEX * sizeof(float);
+  GLState::BindBuffer(GL_ARRAY_BUFFER, vertex_buffer);
+  GLState::EnableVertexAttribArray(AttributeLocation(Attribute::vertPos));
+  GLState::VertexAttribPointer(AttributeLocation(Attribute::vertPos), 3,
+                               GL_FLOAT, GL_FALSE, stride, (const void*)0);
+  GLState::EnableVertexAttribArray(AttributeLocation(Attribute::vertNor));
+  GLState::VertexAttribPointer(AttributeLocation(Attribute::vertNor), 3,
+                               GL_FLOAT, GL_FALSE, stride,
+                               (const void*)(3 * sizeof(float)));
+  GLState::EnableVertexAttribArray(AttributeLocation(Attribute::vertTex));
+  GLState::VertexAttribPointer(AttributeLocation(Attribute::vertTex), 2,
+                               GL_FLOAT, GL_FALSE, stride,
+                               (const void*)(6 * sizeof(float)));
+  GLState::EnableVertexAttribArray(AttributeLocation(Attribute::objectIndex));
+  glVertexAttribDivisor(AttributeLocation(Attribute::objectIndex), 1);
+  GLState::BindBuffer(GL_ELEMENT_ARRAY_BUFFER, element_buffer);
+  return array;
+}
+
+void InitGL() {
+  glGenBuffers(1, &vertex_buffer);
+  glGenBuffers(1, &element_buffer);
+  glGenBuffers(1, &instance_buffer);
+  vao = MakeVertexArray();
+
+  std::vector<GLuint> instances(MESH_BUFFER_MAX_INSTANCES);
+  std::iota(instances.begin(), instances.end(), 0);
+  GLState::BindBuffer(GL_ARRAY_BUFFER, instance_buffer);
+  glBufferData(GL_ARRAY_BUFFER, instances.size() * sizeof(GLuint),
+               &instances[0], GL_STATIC_DRAW);
+  glVertexAttribIPointer(AttributeLocation(Attribute::objectIndex), 1,
+                         GL_UNSIGNED_INT, 0, (const void*)0);
+}
+
+void Upload() {
+  GLState::BindBuffer(GL_ARRAY_BUFFER, vertex_buffer);
+  glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), &vertices[0],
+               GL_STATIC_DRAW);
+  GLState::BindBuffer(GL_ELEMENT_ARRAY_BUFFER, element_buffer);
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER, elements.size() * sizeof(unsigned int),
+               &elements[0], GL_STATIC_DRAW);
+  dirty = false;
+}
+
+}  // namespace
+
+void Add(const std::shared_ptr<Shape>& shape) {
+  if (meshes.count(shape.get())) {
+    return;
+  }
+  std::vector<float> positions = shape->GetPositions();
+  const std::vector<float>& normals = shape->GetNormals();
+  const std::vector<float>& texcoords = shape->GetTexCoords();
+  size_t vertex_count = positions.size() / 3;
+
+  GLint base_vertex = vertices.size() / FLOATS_PER_VERTEX;
+  for (size_t v = 0; v < vertex_count; v++) {
+    vertices.insert(vertices.end(), &positions[3 * v], &positions[3 * v] + 3);
+    for (int i = 0; i < 3; i++) {
+      vertices.push_back(normals.empty() ? 0.0f : normals[3 * v + i]);
+    }
+    for (int i = 0; i < 2; i++) {
+      vertices.push_back(texcoords.empty() ? 0.0f : texcoords[2 * v + i]);
+    }
+  }
+  std::vector<Mesh>& lods = meshes[shape.get()];
+  for (int lod = 0; lod < shape->GetLodCount(); lod++) {
+    const std::vector<unsigned int>& shape_elements = shape->GetElements(lod);
+    Mesh mesh;
+    mesh.base_vertex = base_vertex;
+    mesh.first_index = elements.size();
+    mesh.index_count = shape_elements.size();
+    elements.insert(elements.end(), shape_elements.begin(),
+                    shape_elements.end());
+    lods.push_back(mesh);
+  }
+  dirty = true;
+}
+
+const Mesh* Find(const Shape* shape, int lod) {
+  auto found = meshes.find(shape);
+  return found == meshes.end() ? nullptr : &found->second[lod];
+}
+
+void Bind() {
+  if (!vao) {
+    InitGL();
+  }
+  GLState::BindVertexArray(vao);
+  if (dirty) {
+    Upload();
+  }
+}
+
+void BindIndexed(GLuint object_indices) {
+  Bind();
+  if (!indexed_vao) {
+    indexed_vao = MakeVertexArray();
+  }
+  GLState::BindVertexArray(indexed_vao);
+  if (object_indices != indexed_buffer) {
+    indexed_buffer = object_indices;
+    GLState::BindBuffer(GL_ARRAY_BUFFER, object_indices);
+    glVertexAttribIPointer(AttributeLocation(Attribute::objectIndex), 1,
+                           GL_UNSIGNED_INT, 0, (const void*)0);
+    RenderStats::StateChanges(1);
+  }
+}
+
+void SetFirstInstance(GLuint first_instance) {
+  GLState::BindBuffer(GL_ARRAY_BUFFER, instance_buffer);
+  glVertexAttribIPointer(AttributeLocation(Attribute::objectIndex), 1,
+                         GL_UNSIGNED_INT, 0,
+                         (const void*)(first_instance * sizeof(GLuint)));
+  RenderStats::StateChanges(1);
+}
+
+}  // namespace MeshBuffer
@@ -0,0 +1,44 @@
+#ifndef MESH_BUFFER_H_
+#define MESH_BUFFER_H_
+
+#define GLEW_STATIC
+#include <GL/glew.h>
+
+#include <memory>
+
+#include "Shape.h"
+
+// Every mesh ShapeManager loads, packed into one vertex buffer and one index
+// buffer behind a single VAO, so that draws of different meshes can go out
+// as one batch. Vertices are position, normal and texcoord whether or not the
+// mesh has the last two, at the locations every program shares.
+//
+// Attribute objectIndex advances once per instance, counting up from the
+// instance's base instance, and is how batched shaders find their object.
+// A second VAO reads it from a buffer of object indices instead, for draws
+// whose instances another pass picked out, like GpuCulling's.
+namespace MeshBuffer {
+
+struct Mesh {
+  GLint base_vertex;
+  GLuint first_index;
+  GLuint index_count;
+};
+
+// Most instances one batched draw can have
+#define MESH_BUFFER_MAX_INSTANCES 65536
+
+void Add(const std::shared_ptr<Shape>& shape);
+// null if the shape was never added
+const Mesh* Find(const Shape* shape, int lod = 0);
+// Binds the VAO, uploading any meshes added since the last time
+void Bind();
+// Binds the VAO whose objectIndex is object_indices[base instance + i]
+void BindIndexed(GLuint object_indices);
+// For drawing without a base instance: objectIndex starts at
+// first_instance for the following draws
+void SetFirstInstance(GLuint first_instance);
+
+}  // namespace MeshBuffer
+
+#endif
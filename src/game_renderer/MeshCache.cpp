@@ -0,0 +1,127 @@
+#include "MeshCache.h"
+
+#include <cstdint>
+#include <cstring>
+
+#include "CacheFile.h"
+#include "Shape.h"
+
+#define MESH_CACHE_EXTENSION ".mesh"
+#define MESH_CACHE_MAGIC 0x48534d52  // "RMSH"
+
+namespace MeshCache {
+
+namespace {
+
+bool enabled = true;
+
+struct Header {
+  CacheFile::Stamp stamp;
+  uint32_t position_count;
+  uint32_t normal_count;
+  uint32_t texcoord_count;
+  uint32_t lod_count;
+  uint32_t element_counts[SHAPE_LOD_LEVELS];
+  float min[3];
+  float max[3];
+};
+
+template <typename T>
+void Take(const char*& data, std::vector<T>& out, size_t count) {
+  out.resize(count);
+  if (count) {
+    memcpy(&out[0], data, count * sizeof(T));
+  }
+  data += count * sizeof(T);
+}
+
+template <typename T>
+void Put(CacheFile::Parts& parts, const std::vector<T>& in) {
+  parts.push_back(std::make_pair(in.data(), in.size() * sizeof(T)));
+}
+
+}  // namespace
+
+bool Read(const std::string& source_path, Mesh& mesh) {
+  if (!enabled) {
+    return false;
+  }
+  std::string path = CacheFile::GetPath(source_path, MESH_CACHE_EXTENSION);
+  std::unique_ptr<MappedFile> cache = CacheFile::Map(
+      path, MESH_CACHE_MAGIC, MESH_CACHE_VERSION, sizeof(Header));
+  if (!cache) {
+    return false;
+  }
+  Header header;
+  memcpy(&header, cache->GetData(), sizeof(Header));
+  if (header.lod_count < 1 || header.lod_count > SHAPE_LOD_LEVELS) {
+    return false;
+  }
+  size_t expected_size =
+      sizeof(Header) + (size_t)(header.position_count + header.normal_count +
+                                header.texcoord_count) *
+                           sizeof(float);
+  for (uint32_t lod = 0; lod < header.lod_count; lod++) {
+    expected_size += (size_t)header.element_counts[lod] * sizeof(unsigned int);
+  }
+  if (cache->GetSize() != expected_size) {
+    return false;  // cut short
+  }
+  if (!CacheFile::IsCurrent(*cache, path, source_path)) {
+    return false;
+  }
+
+  const char* data = cache->GetData() + sizeof(Header);
+  Take(data, mesh.positions, header.position_count);
+  Take(data, mesh.normals, header.normal_count);
+  Take(data, mesh.texcoords, header.texcoord_count);
+  mesh.elements.resize(header.lod_count);
+  for (uint32_t lod = 0; lod < header.lod_count; lod++) {
+    Take(data, mesh.elements[lod], header.element_counts[lod]);
+  }
+  memcpy(mesh.min, header.min, sizeof(mesh.min));
+  memcpy(mesh.max, header.max, sizeof(mesh.max));
+  return true;
+}
+
+bool Write(const std::string& source_path, const Mesh& mesh) {
+  if (!enabled || mesh.elements.empty() ||
+      mesh.elements.size() > SHAPE_LOD_LEVELS) {
+    return false;
+  }
+  Header header = {};
+  if (!CacheFile::MakeStamp(source_path, MESH_CACHE_MAGIC, MESH_CACHE_VERSION,
+                            header.stamp)) {
+    return false;
+  }
+  header.position_count = mesh.positions.size();
+  header.normal_count = mesh.normals.size();
+  header.texcoord_count = mesh.texcoords.size();
+  header.lod_count = mesh.elements.size();
+  for (size_t lod = 0; lod < mesh.elements.size(); lod++) {
+    header.element_counts[lod] = mesh.elements[lod].size();
+  }
+  memcpy(header.min, mesh.min, sizeof(header.min));
+  memcpy(header.max, mesh.max, sizeof(header.max));
+
+  CacheFile::Parts parts;
+  parts.push_back(std::make_pair(&header, sizeof(Header)));
+  Put(parts, mesh.positions);
+  Put(parts, mesh.normals);
+  Put(parts, mesh.texcoords);
+  for (const std::vector<unsigned int>& elements : mesh.elements) {
+    Put(parts, elements);
+  }
+  return CacheFile::Write(
+      CacheFile::GetPath(source_path, MESH_CACHE_EXTENSION), parts);
+}
+
+void SetEnabled(bool new_enabled) {
+  enabled = new_enabled;
+}
+
+bool GetEnabled() {
+  return enabled;
+}
+
+}  // namespace MeshCache
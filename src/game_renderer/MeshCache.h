@@ -0,0 +1,41 @@
+#ifndef MESH_CACHE_H_
+#define MESH_CACHE_H_
+
+#include <string>
+#include <vector>
+
+// Meshes as Shape keeps them once loaded: normalized, simplified into levels
+// of detail and ordered for the vertex cache, saved as <name>.obj.mesh in the
+// cache directory (see CacheFile.h) so later runs map them in instead of
+// doing all that again.
+//
+// A cache holds the OBJ's modification time, size and hash. It's used when
+// the time and size match, or failing that when the hash does, as it will
+// after a checkout touches the file, and it's rebuilt otherwise. Bump
+// MESH_CACHE_VERSION whenever the way meshes are processed changes.
+namespace MeshCache {
+
+#define MESH_CACHE_VERSION 1
+
+struct Mesh {
+  std::vector<float> positions;
+  std::vector<float> normals;
+  std::vector<float> texcoords;
+  // one per level of detail, full detail first
+  std::vector<std::vector<unsigned int>> elements;
+  // of the positions
+  float min[3];
+  float max[3];
+};
+
+// False when there's no cache for source_path or it's out of date
+bool Read(const std::string& source_path, Mesh& mesh);
+bool Write(const std::string& source_path, const Mesh& mesh);
+
+// Off, Read() finds nothing and Write() writes nothing
+void SetEnabled(bool enabled);
+bool GetEnabled();
+
+}  // namespace MeshCache
+
+#endif
@@ -0,0 +1,325 @@
+#include "MeshSimplifier.h"
+
+#include <algorithm>
+#include <iterator>
+#include <map>
+#include <queue>
+#include <tuple>
+#include <glm/glm.hpp>
+
+// how much an open edge resists moving, against a triangle's plane
+#define BOUNDARY_WEIGHT 1000.0
+// a collapse may turn a triangle this far (cosine) and no further
+#define MAX_NORMAL_CHANGE 0.2f
+
+namespace MeshSimplifier {
+
+namespace {
+
+// Symmetric 4x4 matrix, upper triangle by rows
+struct Quadric {
+  double q[10];
+};
+
+Quadric PlaneQuadric(glm::vec3 normal, float d, double weight) {
+  double a = normal.x, b = normal.y, c = normal.z;
+  Quadric quadric = {{a * a, a * b, a * c, a * d, b * b, b * c, b * d, c * c,
+                      c * d, (double)d * d}};
+  for (double& q : quadric.q) {
+    q *= weight;
+  }
+  return quadric;
+}
+
+void Add(Quadric& to, const Quadric& from) {
+  for (int i = 0; i < 10; i++) {
+    to.q[i] += from.q[i];
+  }
+}
+
+// v^T Q v for v = (p, 1)
+double Error(const Quadric& quadric, glm::vec3 p) {
+  const double* q = quadric.q;
+  double x = p.x, y = p.y, z = p.z;
+  return q[0] * x * x + 2 * q[1] * x * y + 2 * q[2] * x * z + 2 * q[3] * x +
+         q[4] * y * y + 2 * q[5] * y * z + 2 * q[6] * y + q[7] * z * z +
+         2 * q[8] * z + q[9];
+}
+
+struct Collapse {
+  double cost;
+  unsigned int from;
+  unsigned int to;
+  // the versions of from and to when this was queued, stale once either moves
+  unsigned int from_version;
+  unsigned int to_version;
+
+  bool operator>(const Collapse& other) const { return cost > other.cost; }
+};
+
+class Simplifier {
+ public:
+  Simplifier(const std::vector<float>& positions,
+             const std::vector<unsigned int>& elements);
+  void Run(size_t target_triangles);
+  std::vector<unsigned int> GetElements() const;
+
+ private:
+  glm::vec3 TriangleNormal(size_t triangle) const;
+  void QueueEdge(unsigned int a, unsigned int b);
+  std::vector<unsigned int> Neighbors(unsigned int vertex) const;
+  bool CanCollapse(unsigned int from, unsigned int to) const;
+  void DoCollapse(unsigned int from, unsigned int to);
+
+  // welded vertices
+  std::vector<glm::vec3> positions;
+  std::vector<Quadric> quadrics;
+  std::vector<unsigned int> versions;
+  std::vector<bool> removed;
+  // an original vertex at each welded vertex's position
+  std::vector<unsigned int> originals;
+  std::vector<std::vector<unsigned int>> vertex_triangles;
+
+  // corners as welded vertices, and the original vertices they're drawn with
+  std::vector<unsigned int> corners;
+  std::vector<unsigned int> original_corners;
+  std::vector<bool> dead;
+  size_t live_triangles;
+
+  std::priority_queue<Collapse, std::vector<Collapse>, std::greater<Collapse>>
+      collapses;
+};
+
+Simplifier::Simplifier(const std::vector<float>& vertex_positions,
+                       const std::vector<unsigned int>& elements)
+    : corners(elements.size()),
+      original_corners(elements),
+      dead(elements.size() / 3, false),
+      live_triangles(elements.size() / 3) {
+  std::map<std::tuple<float, float, float>, unsigned int> welded;
+  std::vector<unsigned int> weld(vertex_positions.size() / 3);
+  for (size_t v = 0; v < weld.size(); v++) {
+    glm::vec3 p(vertex_positions[3 * v], vertex_positions[3 * v + 1],
+                vertex_positions[3 * v + 2]);
+    auto found =
+        welded.insert(std::make_pair(std::make_tuple(p.x, p.y, p.z),
+                                     (unsigned int)positions.size()));
+    if (found.second) {
+      positions.push_back(p);
+      originals.push_back(v);
+    }
+    weld[v] = found.first->second;
+  }
+  for (size_t i = 0; i < elements.size(); i++) {
+    corners[i] = weld[elements[i]];
+  }
+
+  Quadric zero = {{0}};
+  quadrics.assign(positions.size(), zero);
+  versions.assign(positions.size(), 0);
+  removed.assign(positions.size(), false);
+  vertex_triangles.resize(positions.size());
+
+  std::map<std::pair<unsigned int, unsigned int>, int> edge_uses;
+  for (size_t t = 0; t < dead.size(); t++) {
+    glm::vec3 p0 = positions[corners[3 * t]];
+    glm::vec3 normal = glm::cross(positions[corners[3 * t + 1]] - p0,
+                                  positions[corners[3 * t + 2]] - p0);
+    // larger triangles count for more
+    double area = glm::length(normal) * 0.5;
+    if (area > 0) {
+      normal = glm::normalize(normal);
+      Quadric quadric = PlaneQuadric(normal, -glm::dot(normal, p0), area);
+      for (int c = 0; c < 3; c++) {
+        Add(quadrics[corners[3 * t + c]], quadric);
+      }
+    }
+    for (int c = 0; c < 3; c++) {
+      unsigned int a = corners[3 * t + c];
+      unsigned int b = corners[3 * t + (c + 1) % 3];
+      vertex_triangles[a].push_back(t);
+      edge_uses[std::make_pair(std::min(a, b), std::max(a, b))]++;
+    }
+  }
+
+  // a plane through each open edge, perpendicular to its triangle, keeps
+  // the edge from moving off its line
+  for (size_t t = 0; t < dead.size(); t++) {
+    glm::vec3 normal = TriangleNormal(t);
+    for (int c = 0; c < 3; c++) {
+      unsigned int a = corners[3 * t + c];
+      unsigned int b = corners[3 * t + (c + 1) % 3];
+      if (edge_uses[std::make_pair(std::min(a, b), std::max(a, b))] != 1) {
+        continue;
+      }
+      glm::vec3 edge = positions[b] - positions[a];
+      glm::vec3 side = glm::cross(edge, normal);
+      if (glm::length(side) == 0) {
+        continue;
+      }
+      side = glm::normalize(side);
+      Quadric quadric =
+          PlaneQuadric(side, -glm::dot(side, positions[a]),
+                       BOUNDARY_WEIGHT * glm::dot(edge, edge));
+      Add(quadrics[a], quadric);
+      Add(quadrics[b], quadric);
+    }
+  }
+
+  for (const auto& edge : edge_uses) {
+    QueueEdge(edge.first.first, edge.first.second);
+  }
+}
+
+glm::vec3 Simplifier::TriangleNormal(size_t triangle) const {
+  glm::vec3 p0 = positions[corners[3 * triangle]];
+  glm::vec3 normal = glm::cross(positions[corners[3 * triangle + 1]] - p0,
+                                positions[corners[3 * triangle + 2]] - p0);
+  float length = glm::length(normal);
+  return length > 0 ? normal / length : normal;
+}
+
+// Queues the cheaper direction to collapse the edge in
+void Simplifier::QueueEdge(unsigned int a, unsigned int b) {
+  Quadric quadric = quadrics[a];
+  Add(quadric, quadrics[b]);
+  double a_to_b = Error(quadric, positions[b]);
+  double b_to_a = Error(quadric, positions[a]);
+  Collapse collapse;
+  collapse.cost = std::min(a_to_b, b_to_a);
+  collapse.from = a_to_b <= b_to_a ? a : b;
+  collapse.to = a_to_b <= b_to_a ? b : a;
+  collapse.from_version = versions[collapse.from];
+  collapse.to_version = versions[collapse.to];
+  collapses.push(collapse);
+}
+
+std::vector<unsigned int> Simplifier::Neighbors(unsigned int vertex) const {
+  std::vector<unsigned int> neighbors;
+  for (unsigned int t : vertex_triangles[vertex]) {
+    if (dead[t]) {
+      continue;
+    }
+    for (int c = 0; c < 3; c++) {
+      if (corners[3 * t + c] != vertex) {
+        neighbors.push_back(corners[3 * t + c]);
+      }
+    }
+  }
+  std::sort(neighbors.begin(), neighbors.end());
+  neighbors.erase(std::unique(neighbors.begin(), neighbors.end()),
+                  neighbors.end());
+  return neighbors;
+}
+
+bool Simplifier::CanCollapse(unsigned int from, unsigned int to) const {
+  // an edge has two triangles, so its ends have two neighbors in common.
+  // More and the collapse would pinch the surface.
+  std::vector<unsigned int> from_neighbors = Neighbors(from);
+  std::vector<unsigned int> to_neighbors = Neighbors(to);
+  std::vector<unsigned int> shared;
+  std::set_intersection(from_neighbors.begin(), from_neighbors.end(),
+                        to_neighbors.begin(), to_neighbors.end(),
+                        std::back_inserter(shared));
+  if (shared.size() > 2) {
+    return false;
+  }
+
+  for (unsigned int t : vertex_triangles[from]) {
+    if (dead[t]) {
+      continue;
+    }
+    glm::vec3 p[3];
+    bool has_to = false;
+    for (int c = 0; c < 3; c++) {
+      unsigned int corner = corners[3 * t + c];
+      has_to = has_to || corner == to;
+      p[c] = positions[corner == from ? to : corner];
+    }
+    if (has_to) {
+      continue;  // collapses away
+    }
+    glm::vec3 normal = glm::cross(p[1] - p[0], p[2] - p[0]);
+    float length = glm::length(normal);
+    if (length == 0 ||
+        glm::dot(normal / length, TriangleNormal(t)) < MAX_NORMAL_CHANGE) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void Simplifier::DoCollapse(unsigned int from, unsigned int to) {
+  for (unsigned int t : vertex_triangles[from]) {
+    if (dead[t]) {
+      continue;
+    }
+    bool has_to = false;
+    for (int c = 0; c < 3; c++) {
+      has_to = has_to || corners[3 * t + c] == to;
+    }
+    if (has_to) {
+      dead[t] = true;
+      live_triangles--;
+      continue;
+    }
+    for (int c = 0; c < 3; c++) {
+      if (corners[3 * t + c] == from) {
+        corners[3 * t + c] = to;
+        original_corners[3 * t + c] = originals[to];
+      }
+    }
+    vertex_triangles[to].push_back(t);
+  }
+  vertex_triangles[from].clear();
+  removed[from] = true;
+  Add(quadrics[to], quadrics[from]);
+  versions[to]++;
+
+  std::vector<unsigned int>& triangles = vertex_triangles[to];
+  triangles.erase(std::remove_if(triangles.begin(), triangles.end(),
+                                 [this](unsigned int t) { return dead[t]; }),
+                  triangles.end());
+  for (unsigned int neighbor : Neighbors(to)) {
+    QueueEdge(to, neighbor);
+  }
+}
+
+void Simplifier::Run(size_t target_triangles) {
+  while (live_triangles > target_triangles && !collapses.empty()) {
+    Collapse collapse = collapses.top();
+    collapses.pop();
+    if (removed[collapse.from] || removed[collapse.to] ||
+        versions[collapse.from] != collapse.from_version ||
+        versions[collapse.to] != collapse.to_version) {
+      continue;
+    }
+    if (CanCollapse(collapse.from, collapse.to)) {
+      DoCollapse(collapse.from, collapse.to);
+    }
+  }
+}
+
+std::vector<unsigned int> Simplifier::GetElements() const {
+  std::vector<unsigned int> elements;
+  elements.reserve(live_triangles * 3);
+  for (size_t t = 0; t < dead.size(); t++) {
+    if (!dead[t]) {
+      elements.insert(elements.end(), &original_corners[3 * t],
+                      &original_corners[3 * t] + 3);
+    }
+  }
+  return elements;
+}
+
+}  // namespace
+
+std::vector<unsigned int> Simplify(const std::vector<float>& positions,
+                                   const std::vector<unsigned int>& elements,
+                                   size_t target_triangles) {
+  Simplifier simplifier(positions, elements);
+  simplifier.Run(target_triangles);
+  return simplifier.GetElements();
+}
+
+}  // namespace MeshSimplifier
@@ -0,0 +1,27 @@
+#ifndef MESH_SIMPLIFIER_H_
+#define MESH_SIMPLIFIER_H_
+
+#include <cstddef>
+#include <vector>
+
+// Quadric error edge collapse (Garland and Heckbert). Each vertex keeps the
+// sum of the squared distances to the planes of the triangles around it, and
+// the edge whose collapse adds the least error goes next. Collapses move one
+// end of an edge onto the other, so the result indexes the same vertices and
+// a simplified mesh can share its vertex buffer with the original.
+//
+// Vertices at the same position are welded first, so seams in normals or
+// texcoords don't keep the mesh from simplifying. Collapses that would flip a
+// triangle or make the mesh non-manifold are skipped, and open edges are
+// held in place.
+namespace MeshSimplifier {
+
+// Elements of a mesh of at most target_triangles triangles, or as close as
+// it gets. positions are three floats per vertex.
+std::vector<unsigned int> Simplify(const std::vector<float>& positions,
+                                   const std::vector<unsigned int>& elements,
+                                   size_t target_triangles);
+
+}  // namespace MeshSimplifier
+
+#endif
@@ -0,0 +1,297 @@
+#include "MinimapRenderer.h"
+
+#include <algorithm>
+#include <vector>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "Acid.h"
+#include "Cocainum.h"
+#include "Collectible.h"
+#include "DMT.h"
+#include "GLState.h"
+#include "GpuProfiler.h"
+#include "Profiler.h"
+#include "RenderStats.h"
+#include "RenderTargets.h"
+
+#define MINIMAP_REFRESH_INTERVAL 4
+// the corner takes this fraction of the framebuffer each way
+#define MINIMAP_SCREEN_DIVISOR 6
+// target pixels per pixel of the corner, the blit scales it up
+#define MINIMAP_RESOLUTION_SCALE 0.5f
+// world units either side of the camera
+#define MINIMAP_HALF_WIDTH 60.0f
+#define MINIMAP_CAMERA_Z 100.0f
+#define MINIMAP_FAR 200.0f
+// sprite sizes in target pixels
+#define COLLECTIBLE_SPRITE_SIZE 3.0f
+#define PLAYER_SPRITE_SIZE 6.0f
+#define CUBE_INDEX_COUNT 36
+
+namespace MinimapRenderer {
+
+namespace {
+
+// A box, or a sprite with its size in extent.x. Boxes are instances of the
+// unit cube and sprites are vertices, both read as the same attributes.
+struct Instance {
+  glm::vec3 center;
+  glm::vec3 extent;
+  glm::vec3 color;
+};
+
+const GLfloat BACKGROUND_COLOR[] = {0.1f, 0.1f, 0.15f, 1.0f};
+const glm::vec3 PLATFORM_COLOR(0.55f, 0.6f, 0.75f);
+const glm::vec3 MOVING_PLATFORM_COLOR(0.35f, 0.75f, 0.9f);
+const glm::vec3 DROPPING_PLATFORM_COLOR(0.85f, 0.55f, 0.3f);
+const glm::vec3 GROUND_COLOR(1.0f, 0.9f, 0.3f);
+const glm::vec3 ROCK_COLOR(0.5f, 0.42f, 0.35f);
+const glm::vec3 MONSTER_COLOR(0.9f, 0.2f, 0.2f);
+const glm::vec3 NOTE_COLOR(1.0f, 1.0f, 1.0f);
+const glm::vec3 PLAYER_COLOR(0.2f, 1.0f, 0.4f);
+
+const GLfloat CUBE_VERTICES[] = {-1, -1, -1, 1, -1, -1, 1, 1, -1, -1, 1, -1,
+                                 -1, -1, 1,  1, -1, 1,  1, 1, 1,  -1, 1, 1};
+const GLubyte CUBE_INDICES[CUBE_INDEX_COUNT] = {
+    0, 2, 1, 0, 3, 2, 4, 5, 6, 4, 6, 7, 0, 1, 5, 0, 5, 4,
+    3, 6, 2, 3, 7, 6, 0, 4, 7, 0, 7, 3, 1, 2, 6, 1, 6, 5};
+
+int refresh_interval = MINIMAP_REFRESH_INTERVAL;
+int frames_since_refresh = 0;
+bool stale = true;
+
+RenderTargets::Target* target = nullptr;
+RenderTargets::SettledSize corner_size;
+int target_width = 0;
+int target_height = 0;
+
+GLuint box_vertex_array = 0;
+GLuint sprite_vertex_array;
+GLuint cube_vertex_buffer;
+GLuint cube_element_buffer;
+GLuint box_buffer;
+GLuint sprite_buffer;
+
+std::vector<Instance> boxes;
+std::vector<Instance> sprites;
+
+void InstanceAttributes(GLuint divisor) {
+  const Attribute attributes[] = {Attribute::boxCenter, Attribute::boxExtent,
+                                  Attribute::flatColor};
+  for (int i = 0; i < 3; i++) {
+    GLuint location = AttributeLocation(attributes[i]);
+    GLState::EnableVertexAttribArray(location);
+    GLState::VertexAttribPointer(location, 3, GL_FLOAT, GL_FALSE,
+                                 sizeof(Instance),
+                                 (const void*)(i * sizeof(glm::vec3)));
+    glVertexAttribDivisor(location, divisor);
+  }
+}
+
+void InitBuffers() {
+  glGenVertexArrays(1, &box_vertex_array);
+  glGenVertexArrays(1, &sprite_vertex_array);
+  glGenBuffers(1, &cube_vertex_buffer);
+  glGenBuffers(1, &cube_element_buffer);
+  glGenBuffers(1, &box_buffer);
+  glGenBuffers(1, &sprite_buffer);
+
+  GLState::BindVertexArray(box_vertex_array);
+  GLState::BindBuffer(GL_ARRAY_BUFFER, cube_vertex_buffer);
+  glBufferData(GL_ARRAY_BUFFER, sizeof(CUBE_VERTICES), CUBE_VERTICES,
+               GL_STATIC_DRAW);
+  GLState::EnableVertexAttribArray(AttributeLocation(Attribute::vertPos));
+  GLState::VertexAttribPointer(AttributeLocation(Attribute::vertPos), 3,
+                               GL_FLOAT, GL_FALSE, 0, (const void*)0);
+  GLState::BindBuffer(GL_ELEMENT_ARRAY_BUFFER, cube_element_buffer);
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(CUBE_INDICES),
+               CUBE_INDICES, GL_STATIC_DRAW);
+  GLState::BindBuffer(GL_ARRAY_BUFFER, box_buffer);
+  InstanceAttributes(1);
+
+  GLState::BindVertexArray(sprite_vertex_array);
+  GLState::BindBuffer(GL_ARRAY_BUFFER, sprite_buffer);
+  InstanceAttributes(0);
+  GLState::BindVertexArray(0);
+}
+
+// Takes a target of the given size from the pool in place of the last one
+void AcquireTarget(int width, int height) {
+  if (!box_vertex_array) {
+    InitBuffers();
+  }
+  RenderTargets::Release(target);
+  target = RenderTargets::Acquire({width, height, GL_RGB8, 1, true});
+  target_width = width;
+  target_height = height;
+}
+
+Instance BoxOf(std::shared_ptr<GameObject> object, glm::vec3 color) {
+  AxisAlignedBox box = object->GetBoundingBox();
+  Instance instance = {box.GetCenter(), (box.GetMax() - box.GetMin()) * 0.5f,
+                       color};
+  return instance;
+}
+
+Instance SpriteOf(std::shared_ptr<GameObject> object,
+                  float size,
+                  glm::vec3 color) {
+  Instance instance = {object->GetBoundingBox().GetCenter(),
+                       glm::vec3(size, 0, 0), color};
+  return instance;
+}
+
+void Gather(std::shared_ptr<GameState> game_state) {
+  std::shared_ptr<Player> player = game_state->GetPlayer();
+  std::shared_ptr<GameObject> ground = player->GetGround();
+  boxes.clear();
+  sprites.clear();
+  for (const std::shared_ptr<GameObject>& obj :
+       *game_state->GetObjectsInView()) {
+    switch (obj->GetSecondaryType()) {
+      case SecondaryType::PLATFORM:
+        boxes.push_back(
+            BoxOf(obj, obj == ground ? GROUND_COLOR : PLATFORM_COLOR));
+        break;
+      case SecondaryType::MOVING_PLATFORM:
+        boxes.push_back(
+            BoxOf(obj, obj == ground ? GROUND_COLOR : MOVING_PLATFORM_COLOR));
+        break;
+      case SecondaryType::DROPPING_PLATFORM_UP:
+      case SecondaryType::DROPPING_PLATFORM_DOWN:
+        boxes.push_back(BoxOf(
+            obj, obj == ground ? GROUND_COLOR : DROPPING_PLATFORM_COLOR));
+        break;
+      case SecondaryType::MOONROCK:
+      case SecondaryType::PLAINROCK:
+        boxes.push_back(BoxOf(obj, ROCK_COLOR));
+        break;
+      case SecondaryType::MONSTER:
+        boxes.push_back(BoxOf(obj, MONSTER_COLOR));
+        break;
+      case SecondaryType::NOTE:
+      case SecondaryType::DMT:
+      case SecondaryType::ACID:
+      case SecondaryType::COCAINUM: {
+        if (std::static_pointer_cast<Collectible>(obj)->GetCollected()) {
+          break;
+        }
+        glm::vec3 color =
+            obj->GetSecondaryType() == SecondaryType::NOTE
+                ? NOTE_COLOR
+                : obj->GetSecondaryType() == SecondaryType::DMT
+                      ? gameobject::DMT::color
+                      : obj->GetSecondaryType() == SecondaryType::ACID
+                            ? gameobject::Acid::color
+                            : gameobject::Cocainum::color;
+        sprites.push_back(SpriteOf(obj, COLLECTIBLE_SPRITE_SIZE, color));
+        break;
+      }
+      default:
+        break;
+    }
+  }
+  // last, so it's drawn over the collectibles
+  sprites.push_back(SpriteOf(player, PLAYER_SPRITE_SIZE, PLAYER_COLOR));
+}
+
+void Upload(GLuint buffer, const std::vector<Instance>& instances) {
+  GLState::BindBuffer(GL_ARRAY_BUFFER, buffer);
+  // orphaned every refresh, so the last one's draw doesn't stall this
+  glBufferData(GL_ARRAY_BUFFER, instances.size() * sizeof(Instance),
+               instances.empty() ? NULL : &instances[0], GL_STREAM_DRAW);
+}
+
+// Draws the objects in view into the target
+void Refresh(std::shared_ptr<GameState> game_state,
+             std::shared_ptr<Program> program) {
+  PROFILE_SCOPE("MinimapRenderer::Refresh");
+  Gather(game_state);
+
+  // from the side, centered on the camera like the scene
+  glm::vec3 center(game_state->GetCamera()->getPosition().x,
+                   game_state->GetPlayer()->GetPosition().y, 0);
+  float half_height = MINIMAP_HALF_WIDTH * target_height / target_width;
+  glm::mat4 P = glm::ortho(-MINIMAP_HALF_WIDTH, MINIMAP_HALF_WIDTH,
+                           -half_height, half_height, 0.0f, MINIMAP_FAR);
+  glm::mat4 V = glm::lookAt(center + glm::vec3(0, 0, MINIMAP_CAMERA_Z), center,
+                            glm::vec3(0, 1, 0));
+
+  GLState::BindFramebuffer(GL_FRAMEBUFFER, target->framebuffer);
+  GLState::Viewport(0, 0, target_width, target_height);
+  GLState::DepthMask(GL_TRUE);
+  const GLfloat far_depth = 1.0f;
+  glClearBufferfv(GL_COLOR, 0, BACKGROUND_COLOR);
+  glClearBufferfv(GL_DEPTH, 0, &far_depth);
+
+  program->bind();
+  program->setUniform(Uniform::P, P);
+  program->setUniform(Uniform::V, V);
+
+  program->setUniform(Uniform::sprites, 0);
+  Upload(box_buffer, boxes);
+  GLState::BindVertexArray(box_vertex_array);
+  glDrawElementsInstanced(GL_TRIANGLES, CUBE_INDEX_COUNT, GL_UNSIGNED_BYTE, 0,
+                          boxes.size());
+  RenderStats::DrawCalls(1);
+  RenderStats::Triangles(boxes.size() * CUBE_INDEX_COUNT / 3);
+
+  // collectibles and the player show through whatever is in front of them
+  program->setUniform(Uniform::sprites, 1);
+  Upload(sprite_buffer, sprites);
+  GLState::BindVertexArray(sprite_vertex_array);
+  glDisable(GL_DEPTH_TEST);
+  glEnable(GL_PROGRAM_POINT_SIZE);
+  glDrawArrays(GL_POINTS, 0, sprites.size());
+  glDisable(GL_PROGRAM_POINT_SIZE);
+  glEnable(GL_DEPTH_TEST);
+  RenderStats::DrawCalls(1);
+
+  GLState::BindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+}  // namespace
+
+void Render(std::shared_ptr<GameState> game_state,
+            std::shared_ptr<Program> program,
+            int width,
+            int height) {
+  PROFILE_SCOPE("RenderMinimap");
+  GPU_PASS("minimap");
+  int screen_width = width / MINIMAP_SCREEN_DIVISOR;
+  int screen_height = height / MINIMAP_SCREEN_DIVISOR;
+  if (corner_size.Update(screen_width, screen_height)) {
+    AcquireTarget(
+        std::max(1, (int)(corner_size.GetWidth() * MINIMAP_RESOLUTION_SCALE)),
+        std::max(1, (int)(corner_size.GetHeight() * MINIMAP_RESOLUTION_SCALE)));
+    stale = true;
+  }
+  if (!target) {
+    // the corner has never had a size, like when the window starts minimized
+    return;
+  }
+
+  frames_since_refresh++;
+  if (stale || frames_since_refresh >= refresh_interval) {
+    Refresh(game_state, program);
+    frames_since_refresh = 0;
+    stale = false;
+  }
+
+  GLState::BindFramebuffer(GL_READ_FRAMEBUFFER, target->framebuffer);
+  GLState::BindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+  glBlitFramebuffer(0, 0, target_width, target_height, 0, 0, screen_width,
+                    screen_height, GL_COLOR_BUFFER_BIT, GL_LINEAR);
+  RenderStats::DrawCalls(1);
+  GLState::BindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void SetRefreshInterval(int frames) {
+  refresh_interval = std::max(1, frames);
+}
+
+int GetRefreshInterval() {
+  return refresh_interval;
+}
+
+}  // namespace MinimapRenderer
@@ -0,0 +1,32 @@
+#ifndef MINIMAP_RENDERER_H_
+#define MINIMAP_RENDERER_H_
+
+#include <memory>
+
+#include "GameState.h"
+#include "Program.h"
+
+// The minimap, drawn apart from the scene. Every few frames the objects in
+// view are drawn from the side, orthographically, into a small offscreen
+// target: platforms, rocks and monsters as one instanced draw of flat colored
+// boxes, and collectibles and the player as one draw of point sprites. Every
+// frame the target is blitted into the bottom left corner.
+//
+// Nothing is culled here. It draws the objects GameRenderer::UpdateMinimapView
+// last found in view, which are the ones the game updates.
+namespace MinimapRenderer {
+
+// Draws the minimap over the framebuffer bound to GL_FRAMEBUFFER, which is
+// width by height, redrawing the target first if it is due. program is
+// minimap_prog.
+void Render(std::shared_ptr<GameState> game_state,
+            std::shared_ptr<Program> program,
+            int width,
+            int height);
+// Redraw the target every frames frames, 1 for every frame
+void SetRefreshInterval(int frames);
+int GetRefreshInterval();
+
+}  // namespace MinimapRenderer
+
+#endif
@@ -1,19 +1,43 @@
 #include "Program.h"
 
+#include <algorithm>
 #include <iostream>
 #include <cassert>
+#include <cstdlib>
 
 #include "GLSL.h"
+#include "GLState.h"
+#include "ProgramCache.h"
+#include "RenderQueue.h"
+#include "ShadowMaps.h"
 
 using namespace std;
 
+#define PROGRAM_NAME_ENTRY(name) #name,
+static const char *UNIFORM_NAMES[] = {PROGRAM_UNIFORMS(PROGRAM_NAME_ENTRY)};
+static const char *ATTRIBUTE_NAMES[] = {PROGRAM_ATTRIBUTES(PROGRAM_NAME_ENTRY)};
+#undef PROGRAM_NAME_ENTRY
+
+// Defined in every shader after its #version line, so the layouts C++ and the
+// shaders share are only written down once
+#define SHADER_DEFINES(X) \
+   X(OBJECT_TEXELS) X(OBJECT_COLOR_TEXEL) X(OBJECT_COLLECTED_TEXEL) \
+   X(SHADOW_MAX_CASCADES)
+#define SHADER_STRINGIFY(value) #value
+#define SHADER_DEFINE_ENTRY(name) \
+   "#define " #name " " SHADER_STRINGIFY(name) "\n"
+static const char *SHADER_DEFINES_SOURCE =
+   SHADER_DEFINES(SHADER_DEFINE_ENTRY);
+#undef SHADER_DEFINE_ENTRY
+
 Program::Program() :
    vShaderName(""),
    fShaderName(""),
    gShaderName(""),
    pid(0),
    verbose(true) {
-
+   fill(begin(attributeLocations), end(attributeLocations), -1);
+   fill(begin(uniformLocations), end(uniformLocations), -1);
 }
 
 Program::~Program() {
@@ -31,95 +55,185 @@ void Program::setShaderNames(const string &v, const string &f, const string &g)
    gShaderName = g;
 }
 
+// Reads fn and frees what textFileRead allocated
+static bool readFile(const string &fn, string &text) {
+   char *content = GLSL::textFileRead(fn.c_str());
+   if (!content) {
+      return false;
+   }
+   text = content;
+   free(content);
+   return true;
+}
+
+// Reads the shader fn with each #include "name" line replaced by the file
+// name in fn's folder, and SHADER_DEFINES after the #version line. #line
+// directives keep compile errors pointing at fn's own lines. Included files
+// can't include others. Adds the files included to includes.
+static bool readSource(const string &fn, string &source,
+                       vector<string> &includes) {
+   string text;
+   if (!readFile(fn, text)) {
+      return false;
+   }
+   string folder = fn.substr(0, fn.find_last_of("/\\") + 1);
+   source.clear();
+   size_t start = 0;
+   int line = 1;
+   while (start < text.size()) {
+      size_t end = text.find('\n', start);
+      end = end == string::npos ? text.size() : end + 1;
+      string code = text.substr(start, end - start);
+      start = end;
+      line++;
+      if (code.compare(0, 9, "#include ") == 0) {
+         size_t open = code.find('"');
+         size_t close =
+            open == string::npos ? open : code.find('"', open + 1);
+         string include, included;
+         if (close != string::npos) {
+            include = folder + code.substr(open + 1, close - open - 1);
+         }
+         if (include.empty() || !readFile(include, included)) {
+            cout << fn << " can't " << code;
+            return false;
+         }
+         includes.push_back(include);
+         source += included + "\n#line " + to_string(line) + "\n";
+         continue;
+      }
+      source += code;
+      if (code.compare(0, 9, "#version ") == 0) {
+         if (code.back() != '\n') {
+            source += "\n";
+         }
+         source += string(SHADER_DEFINES_SOURCE) + "#line " + to_string(line) +
+                   "\n";
+      }
+   }
+   return true;
+}
+
 bool Program::init() {
-   GLint rc;
    bool isGeomShader = false;
    if (this->gShaderName != "") {
       isGeomShader = true;
    }
 
-   // Create shader handles
-   GLuint VS = glCreateShader(GL_VERTEX_SHADER);
-   GLuint FS = glCreateShader(GL_FRAGMENT_SHADER);
-   GLuint GS;
-   if (isGeomShader) {
-      GS = glCreateShader(GL_GEOMETRY_SHADER);
-   }
-
    // Read shader sources
-   const char *vshader = GLSL::textFileRead(vShaderName.c_str());
-   const char *fshader = GLSL::textFileRead(fShaderName.c_str());
-   const char *gshader;
-   glShaderSource(VS, 1, &vshader, NULL);
-   glShaderSource(FS, 1, &fshader, NULL);
-
-   if (isGeomShader) {
-      gshader = GLSL::textFileRead(gShaderName.c_str());
-      glShaderSource(GS, 1, &gshader, NULL); 
+   string vshader, fshader, gshader;
+   includedFiles.clear();
+   if (!readSource(vShaderName, vshader, includedFiles) ||
+       !readSource(fShaderName, fshader, includedFiles) ||
+       (isGeomShader && !readSource(gShaderName, gshader, includedFiles))) {
+      return false;
    }
 
-   // Compile vertex shader
-   glCompileShader(VS);
-   glGetShaderiv(VS, GL_COMPILE_STATUS, &rc);
-   if(!rc) {
-      if(isVerbose()) {
-         GLSL::printShaderInfoLog(VS);
-         cout << "Error compiling vertex shader " << vShaderName << endl;
+   // Load the binary a run before linked, or compile and link
+   uint64_t sourceHash = ProgramCache::HashSources({vshader, fshader, gshader});
+   GLuint newPid = glCreateProgram();
+   bool cached = !binaryPath.empty() &&
+                 ProgramCache::ReadBinary(binaryPath, sourceHash, newPid);
+   if (!cached) {
+      if (!compile(newPid, vshader, fshader, gshader)) {
+         glDeleteProgram(newPid);
+         return false;
+      }
+      if (!binaryPath.empty()) {
+         ProgramCache::WriteBinary(binaryPath, sourceHash, newPid);
       }
-      return false;
    }
+   if (pid) {
+      // reloaded
+      glDeleteProgram(pid);
+      // GLState may still think it's bound, and the name may come back
+      GLState::Invalidate();
+   }
+   pid = newPid;
 
-   // Compile fragment shader
-   glCompileShader(FS);
-   glGetShaderiv(FS, GL_COMPILE_STATUS, &rc);
-   if(!rc) {
-      if(isVerbose()) {
-         GLSL::printShaderInfoLog(FS);
-         cout << "Error compiling fragment shader " << fShaderName << endl;
+   for (int i = 0; i < (int)Attribute::COUNT; i++) {
+      attributeLocations[i] = glGetAttribLocation(pid, ATTRIBUTE_NAMES[i]);
+      if (attributeLocations[i] != -1 && attributeLocations[i] != i &&
+          isVerbose()) {
+         cout << vShaderName << " puts " << ATTRIBUTE_NAMES[i]
+              << " at location " << attributeLocations[i] << " instead of "
+              << i << ", shapes won't draw with it" << endl;
       }
-      return false;
+   }
+   for (int i = 0; i < (int)Uniform::COUNT; i++) {
+      uniformLocations[i] = glGetUniformLocation(pid, UNIFORM_NAMES[i]);
    }
 
-   if (isGeomShader) {
-      // Compile geom shader
-      glCompileShader(GS);
-      glGetShaderiv(GS, GL_COMPILE_STATUS, &rc);
+   GLSL::checkError(GET_FILE_LINE);
+   return true;
+}
+
+bool Program::compile(GLuint program, const string &vshader,
+                      const string &fshader, const string &gshader) {
+   GLint rc;
+   bool isGeomShader = !gshader.empty();
+   const GLenum types[] = {GL_VERTEX_SHADER, GL_FRAGMENT_SHADER,
+                           GL_GEOMETRY_SHADER};
+   const string *sources[] = {&vshader, &fshader, &gshader};
+   const string *names[] = {&vShaderName, &fShaderName, &gShaderName};
+   const char *kinds[] = {"vertex", "fragment", "geom"};
+   GLuint shaders[3] = {0, 0, 0};
+   int count = isGeomShader ? 3 : 2;
+   bool compiled = true;
+
+   // Create, source and compile each shader
+   for (int i = 0; i < count && compiled; i++) {
+      shaders[i] = glCreateShader(types[i]);
+      const char *source = sources[i]->c_str();
+      glShaderSource(shaders[i], 1, &source, NULL);
+      glCompileShader(shaders[i]);
+      glGetShaderiv(shaders[i], GL_COMPILE_STATUS, &rc);
       if(!rc) {
          if(isVerbose()) {
-            GLSL::printShaderInfoLog(GS);
-            cout << "Error compiling geom shader " << gShaderName << endl;
+            GLSL::printShaderInfoLog(shaders[i]);
+            cout << "Error compiling " << kinds[i] << " shader " << *names[i]
+                 << endl;
          }
-         return false;
+         compiled = false;
       }
    }
 
-   // Create the program and link
-   pid = glCreateProgram();
-   glAttachShader(pid, VS);
-   glAttachShader(pid, FS);
-   if (isGeomShader) {
-      glAttachShader(pid, GS);
+   // Link
+   if (compiled) {
+      for (int i = 0; i < count; i++) {
+         glAttachShader(program, shaders[i]);
+      }
+      for (int i = 0; i < (int)Attribute::COUNT; i++) {
+         glBindAttribLocation(program, i, ATTRIBUTE_NAMES[i]);
+      }
+      if (!binaryPath.empty() && ProgramCache::BinariesSupported()) {
+         glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT,
+                             GL_TRUE);
+      }
+      glLinkProgram(program);
+      glGetProgramiv(program, GL_LINK_STATUS, &rc);
+      if(!rc) {
+         if(isVerbose()) {
+            GLSL::printProgramInfoLog(program);
+            cout << "Error linking shaders " << vShaderName << " and " << fShaderName << endl;
+         }
+         compiled = false;
+      }
+      for (int i = 0; i < count; i++) {
+         glDetachShader(program, shaders[i]);
+      }
    }
-   glLinkProgram(pid);
-   glGetProgramiv(pid, GL_LINK_STATUS, &rc);
-   if(!rc) {
-      if(isVerbose()) {
-         GLSL::printProgramInfoLog(pid);
-         cout << "Error linking shaders " << vShaderName << " and " << fShaderName << endl;
+   // the program keeps what it needs once linked
+   for (int i = 0; i < count; i++) {
+      if (shaders[i]) {
+         glDeleteShader(shaders[i]);
       }
-      return false;
    }
-
-   GLSL::checkError(GET_FILE_LINE);
-   return true;
+   return compiled;
 }
 
 void Program::bind() {
-   glUseProgram(pid);
-}
-
-void Program::unbind() {
-   glUseProgram(0);
+   GLState::UseProgram(pid);
 }
 
 void Program::addAttribute(const string &name) {
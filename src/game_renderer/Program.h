@@ -4,9 +4,39 @@
 
 #include <map>
 #include <string>
+#include <vector>
 
 #define GLEW_STATIC
 #include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+// Every uniform and attribute declared by the programs in assets/shaders.
+// init() looks all of them up once, so draws index a flat array instead of
+// searching a map by string. Names a program doesn't use resolve to -1, which
+// GL ignores. Anything not listed here still works through the string API.
+#define PROGRAM_UNIFORMS(X)                                               \
+   X(P) X(V) X(MV) X(Texture0) X(SkyTexture0) X(in_obj_color)             \
+   X(isCollected) X(timeCollected) X(Offset) X(Color) X(CamRight) X(CamUp) \
+   X(scene) X(bloomBlur) X(bloom) X(exposure) X(horizontal) X(image)       \
+   X(batched) X(objects) X(sprites) X(karis) X(shadowCascadeCount)       \
+   X(shadowCascades) X(shadowDynamic) X(shadowView) X(shadowWindows)      \
+   X(shadowDynamicWindow) X(shadowDepth)
+#define PROGRAM_ATTRIBUTES(X)                                             \
+   X(vertPos) X(vertNor) X(vertTex) X(objectIndex) X(boxCenter)           \
+   X(boxExtent) X(flatColor)
+
+#define PROGRAM_ENUM_ENTRY(name) name,
+enum class Uniform { PROGRAM_UNIFORMS(PROGRAM_ENUM_ENTRY) COUNT };
+enum class Attribute { PROGRAM_ATTRIBUTES(PROGRAM_ENUM_ENTRY) COUNT };
+#undef PROGRAM_ENUM_ENTRY
+
+// Every program puts an attribute at the same location, its Attribute value,
+// so a vertex layout set up once works with any program. The shaders declare
+// these with layout qualifiers and init() binds them for any that don't.
+inline GLuint AttributeLocation(Attribute attribute) {
+   return (GLuint)attribute;
+}
 
 class Program {
 public:
@@ -22,14 +52,54 @@ public:
 
    void setShaderNames(const std::string &v, const std::string &f);
    void setShaderNames(const std::string &v, const std::string &f, const std::string &g);
+   // Where init() keeps the linked program with ProgramCache, none if empty
+   void setBinaryPath(const std::string &path) {
+      binaryPath = path;
+   }
+   // Calling it again rebuilds the program from the shaders, keeping the
+   // one before if they don't compile
    virtual bool init();
+   // The files the shaders #include, as of the last init()
+   const std::vector<std::string> &getIncludedFiles() const {
+      return includedFiles;
+   }
+   // Programs stay bound until the next bind() of another, so binding the
+   // same one again right after is free
    virtual void bind();
-   virtual void unbind();
 
    void addAttribute(const std::string &name);
    void addUniform(const std::string &name);
    GLint getAttribute(const std::string &name) const;
    GLint getUniform(const std::string &name) const;
+
+   GLint getAttribute(Attribute attribute) const {
+      return attributeLocations[(int)attribute];
+   }
+   GLint getUniform(Uniform uniform) const {
+      return uniformLocations[(int)uniform];
+   }
+
+   // The program must be bound
+   void setUniform(Uniform uniform, GLint value) const {
+      glUniform1i(getUniform(uniform), value);
+   }
+   void setUniform(Uniform uniform, GLfloat value) const {
+      glUniform1f(getUniform(uniform), value);
+   }
+   void setUniform(Uniform uniform, const glm::vec2 &value) const {
+      glUniform2fv(getUniform(uniform), 1, glm::value_ptr(value));
+   }
+   void setUniform(Uniform uniform, const glm::vec3 &value) const {
+      glUniform3fv(getUniform(uniform), 1, glm::value_ptr(value));
+   }
+   void setUniform(Uniform uniform, const glm::vec4 &value) const {
+      glUniform4fv(getUniform(uniform), 1, glm::value_ptr(value));
+   }
+   void setUniform(Uniform uniform, const glm::mat4 &value) const {
+      glUniformMatrix4fv(getUniform(uniform), 1, GL_FALSE,
+                         glm::value_ptr(value));
+   }
+
    std::string getName() const;
    void setName(const std::string &name);
 
@@ -38,11 +108,18 @@ protected:
    std::string fShaderName;
    std::string gShaderName;
    std::string progName;
+   std::string binaryPath;
+   std::vector<std::string> includedFiles;
 
 private:
+   bool compile(GLuint program, const std::string &vshader,
+                const std::string &fshader, const std::string &gshader);
+
    GLuint pid;
    std::map<std::string,GLint> attributes;
    std::map<std::string,GLint> uniforms;
+   GLint attributeLocations[(int)Attribute::COUNT];
+   GLint uniformLocations[(int)Uniform::COUNT];
    bool verbose;
 };
 
@@ -0,0 +1,265 @@
+#include "ProgramCache.h"
+
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <unordered_map>
+#include <vector>
+
+#include "CacheFile.h"
+#include "FileSystemUtils.h"
+#include "GLState.h"
+#include "Program.h"
+#include "json.hpp"
+
+#define PROGRAM_CACHE_EXTENSION ".program"
+#define PROGRAM_CACHE_MAGIC 0x47525052  // "RPRG"
+// seconds between looks at the shader files
+#define RELOAD_INTERVAL 0.5
+
+namespace ProgramCache {
+
+namespace {
+
+// The stamp's source_hash is HashSources(), which covers every file, so
+// there's no time or size to go by
+struct Header {
+  CacheFile::Stamp stamp;
+  uint64_t driver_hash;
+  uint32_t format;
+  uint32_t length;
+};
+
+struct Entry {
+  std::shared_ptr<Program> program;
+  // the JSON and its shaders, with their modification times when loaded
+  std::vector<std::string> files;
+  std::vector<uint64_t> mtimes;
+};
+
+std::unordered_map<std::string, Entry> entries;
+bool binaries_enabled = true;
+Stats stats = {};
+std::chrono::steady_clock::time_point last_check =
+    std::chrono::steady_clock::now();
+
+// FNV-1a
+uint64_t Hash(const char* data, size_t size, uint64_t hash) {
+  for (size_t i = 0; i < size; i++) {
+    hash = (hash ^ (unsigned char)data[i]) * 1099511628211ull;
+  }
+  return hash;
+}
+
+uint64_t Hash(const std::string& text, uint64_t hash) {
+  // the terminator too, so "ab" "c" and "a" "bc" differ
+  return Hash(text.c_str(), text.size() + 1, hash);
+}
+
+// Binaries only load on the driver that made them
+uint64_t DriverHash() {
+  static uint64_t driver_hash = 0;
+  if (!driver_hash) {
+    driver_hash = 14695981039346656037ull;
+    for (GLenum name : {GL_VENDOR, GL_RENDERER, GL_VERSION}) {
+      const char* value = (const char*)glGetString(name);
+      driver_hash = Hash(value ? value : "", driver_hash);
+    }
+  }
+  return driver_hash;
+}
+
+std::vector<uint64_t> Stamps(const std::vector<std::string>& files) {
+  std::vector<uint64_t> mtimes;
+  for (const std::string& file : files) {
+    uint64_t mtime = 0, size;
+    FileSystemUtils::GetStamp(file, mtime, size);
+    mtimes.push_back(mtime);
+  }
+  return mtimes;
+}
+
+// Sets program up from the JSON at json_path, compiling it or loading its
+// binary. Returns the JSON and the shaders it names.
+std::vector<std::string> Load(const std::string& json_path,
+                              Program& program) {
+  // Read in the file
+  std::ifstream json_input_stream(json_path, std::ifstream::in);
+  // Read the file into the JSON library
+  nlohmann::json json_handler;
+  json_input_stream >> json_handler;
+
+  // Get name attributes from JSON
+  std::string vert_name = json_handler["vert"];
+  std::string frag_name = json_handler["frag"];
+  std::string prog_name = json_handler["name"];
+  std::vector<std::string> files = {json_path,
+                                    ASSET_DIR "/shaders/" + vert_name,
+                                    ASSET_DIR "/shaders/" + frag_name};
+  if (json_handler.find("geom") != json_handler.end()) {
+    std::string geom_name = json_handler["geom"];
+    files.push_back(ASSET_DIR "/shaders/" + geom_name);
+    program.setShaderNames(files[1], files[2], files[3]);
+  } else {
+    program.setShaderNames(files[1], files[2]);
+  }
+  program.setVerbose(true);
+  program.setName(prog_name);
+  program.setBinaryPath(CacheFile::GetPath(json_path, PROGRAM_CACHE_EXTENSION));
+
+  int binaries_before = stats.binaries_loaded;
+  program.init();
+  if (stats.binaries_loaded == binaries_before) {
+    stats.compiled++;
+  }
+  // a change to a shared include reloads every program using it
+  const std::vector<std::string>& includes = program.getIncludedFiles();
+  files.insert(files.end(), includes.begin(), includes.end());
+
+  // Create the uniforms
+  std::vector<std::string> uniforms = json_handler["uniforms"];
+  for (int i = 0; i < uniforms.size(); i++) {
+    program.addUniform(uniforms[i]);
+  }
+  // Create the attributes
+  std::vector<std::string> attributes = json_handler["attributes"];
+  for (int i = 0; i < attributes.size(); i++) {
+    program.addAttribute(attributes[i]);
+  }
+  return files;
+}
+
+}  // namespace
+
+std::shared_ptr<Program> Get(const std::string& json_path) {
+  auto entry = entries.find(json_path);
+  if (entry != entries.end()) {
+    return entry->second.program;
+  }
+  Entry new_entry;
+  new_entry.program = std::make_shared<Program>();
+  new_entry.files = Load(json_path, *new_entry.program);
+  new_entry.mtimes = Stamps(new_entry.files);
+  entries[json_path] = new_entry;
+  stats.programs++;
+  return new_entry.program;
+}
+
+void Clear() {
+  entries.clear();
+  stats = Stats();
+}
+
+void Update() {
+  std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+  if (std::chrono::duration<double>(now - last_check).count() <
+      RELOAD_INTERVAL) {
+    return;
+  }
+  last_check = now;
+  for (auto& entry : entries) {
+    std::vector<uint64_t> mtimes = Stamps(entry.second.files);
+    if (mtimes == entry.second.mtimes) {
+      continue;
+    }
+    // not tried again until it's saved again, whether it compiles or not
+    entry.second.mtimes = mtimes;
+    std::cout << "Reloading " << entry.first << std::endl;
+    entry.second.files = Load(entry.first, *entry.second.program);
+    stats.reloaded++;
+  }
+}
+
+uint64_t HashSources(const std::vector<std::string>& sources) {
+  uint64_t hash = 14695981039346656037ull;
+  hash = Hash(std::to_string(PROGRAM_CACHE_VERSION), hash);
+  for (const std::string& source : sources) {
+    hash = Hash(source, hash);
+  }
+  // init() binds the attributes before linking
+#define PROGRAM_HASH_ENTRY(name) hash = Hash(#name, hash);
+  PROGRAM_ATTRIBUTES(PROGRAM_HASH_ENTRY)
+#undef PROGRAM_HASH_ENTRY
+  return hash;
+}
+
+bool BinariesSupported() {
+  if (!binaries_enabled || !GLEW_ARB_get_program_binary) {
+    return false;
+  }
+  GLint formats = 0;
+  glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+  return formats > 0;
+}
+
+bool ReadBinary(const std::string& path,
+                uint64_t source_hash,
+                GLuint program) {
+  if (!BinariesSupported()) {
+    return false;
+  }
+  std::unique_ptr<MappedFile> cache = CacheFile::Map(
+      path, PROGRAM_CACHE_MAGIC, PROGRAM_CACHE_VERSION, sizeof(Header));
+  if (!cache) {
+    return false;
+  }
+  Header header;
+  memcpy(&header, cache->GetData(), sizeof(Header));
+  if (header.driver_hash != DriverHash() ||
+      header.stamp.source_hash != source_hash ||
+      cache->GetSize() != sizeof(Header) + header.length) {
+    return false;
+  }
+  glProgramBinary(program, header.format, cache->GetData() + sizeof(Header),
+                  header.length);
+  GLint linked;
+  glGetProgramiv(program, GL_LINK_STATUS, &linked);
+  if (!linked) {
+    return false;  // the driver changed under the same version string
+  }
+  stats.binaries_loaded++;
+  return true;
+}
+
+void WriteBinary(const std::string& path,
+                 uint64_t source_hash,
+                 GLuint program) {
+  if (!BinariesSupported()) {
+    return;
+  }
+  GLint length = 0;
+  glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+  if (length <= 0) {
+    return;
+  }
+  Header header = {};
+  header.stamp.magic = PROGRAM_CACHE_MAGIC;
+  header.stamp.version = PROGRAM_CACHE_VERSION;
+  header.stamp.source_hash = source_hash;
+  header.driver_hash = DriverHash();
+  std::vector<char> binary(length);
+  GLenum format;
+  glGetProgramBinary(program, length, &length, &format, &binary[0]);
+  header.format = format;
+  header.length = length;
+
+  CacheFile::Parts parts;
+  parts.push_back(std::make_pair(&header, sizeof(Header)));
+  parts.push_back(std::make_pair(&binary[0], (size_t)length));
+  CacheFile::Write(path, parts);
+}
+
+void SetBinariesEnabled(bool enabled) {
+  binaries_enabled = enabled;
+}
+
+bool GetBinariesEnabled() {
+  return binaries_enabled;
+}
+
+Stats GetStats() {
+  return stats;
+}
+
+}  // namespace ProgramCache
@@ -0,0 +1,61 @@
+#ifndef PROGRAM_CACHE_H_
+#define PROGRAM_CACHE_H_
+
+#define GLEW_STATIC
+#include <GL/glew.h>
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+class Program;
+
+// Every program made from a shader JSON, made once and shared by everything
+// that asks for the same JSON.
+//
+// Linked programs are also saved with glGetProgramBinary as <name>.json.program
+// in the cache directory (see CacheFile.h), keyed by the driver and a hash of
+// the sources, so later runs hand the binary back to the driver instead of
+// compiling. A binary the driver turns down is compiled over.
+//
+// In DEBUG builds Update() recompiles the programs whose JSON or shaders
+// changed, in place, so everything holding them draws with the new ones. A
+// program that doesn't compile keeps the old one.
+namespace ProgramCache {
+
+#define PROGRAM_CACHE_VERSION 2
+
+struct Stats {
+  int programs;
+  int compiled;
+  int binaries_loaded;
+  int reloaded;
+};
+
+// The program json_path describes
+std::shared_ptr<Program> Get(const std::string& json_path);
+// Forgets every program, the next Get() of each makes it again. The ones
+// already handed out keep working.
+void Clear();
+// Checks for changed shaders every so often
+void Update();
+
+// For Program::init(). The hash covers what else goes into linking too.
+uint64_t HashSources(const std::vector<std::string>& sources);
+bool BinariesSupported();
+// False if there's no binary at path for these sources and this driver, or
+// the driver won't take it
+bool ReadBinary(const std::string& path, uint64_t source_hash, GLuint program);
+// program must have linked with GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+void WriteBinary(const std::string& path, uint64_t source_hash, GLuint program);
+
+// Off, no binaries are read or written
+void SetBinariesEnabled(bool enabled);
+bool GetBinariesEnabled();
+
+Stats GetStats();
+
+}  // namespace ProgramCache
+
+#endif
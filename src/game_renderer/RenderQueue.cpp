@@ -0,0 +1,685 @@
+#include "RenderQueue.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <iterator>
+
+#include "GLState.h"
+#include "MeshBuffer.h"
+#include "Profiler.h"
+#include "RenderStats.h"
+#include "ShadowMaps.h"
+
+#define PASS_BITS 4
+#define DEPTH_BAND_BITS 2
+#define PROGRAM_BITS 8
+#define TEXTURE_BITS 8
+#define SKY_TEXTURE_BITS 6
+#define SHAPE_BITS 14
+#define DEPTH_BITS 22
+
+#define DEPTH_SHIFT 0
+#define SHAPE_SHIFT (DEPTH_SHIFT + DEPTH_BITS)
+#define SKY_TEXTURE_SHIFT (SHAPE_SHIFT + SHAPE_BITS)
+#define TEXTURE_SHIFT (SKY_TEXTURE_SHIFT + SKY_TEXTURE_BITS)
+#define PROGRAM_SHIFT (TEXTURE_SHIFT + TEXTURE_BITS)
+#define DEPTH_BAND_SHIFT (PROGRAM_SHIFT + PROGRAM_BITS)
+#define PASS_SHIFT (DEPTH_BAND_SHIFT + DEPTH_BAND_BITS)
+
+#define RADIX_BITS 8
+#define RADIX_BUCKETS (1 << RADIX_BITS)
+
+// shorter runs aren't worth batching
+#define BATCH_MIN_DRAWS 4
+// past the units assets/textures use
+#define OBJECT_BUFFER_UNIT 15
+// how far past a level's threshold an object's size has to be to switch
+#define LOD_HYSTERESIS 0.2f
+
+namespace {
+
+bool batching = true;
+bool levels_of_detail = true;
+bool depth_prepass = false;
+bool front_to_back = true;
+bool overdraw_view = false;
+bool count_fragments = false;
+
+// Below each of these, the next level of detail is used. Sizes are the radius
+// of the bounding sphere on screen, as a fraction of half the view's height.
+const float LOD_SIZES[SHAPE_LOD_LEVELS - 1] = {0.08f, 0.02f};
+
+// Where each opaque depth band ends, in view units. The camera sits a few
+// units behind the player, so the first band is the player and the platforms
+// around them, which cover the most of the screen.
+const float DEPTH_BANDS[(1 << DEPTH_BAND_BITS) - 1] = {20.0f, 60.0f, 180.0f};
+
+// The order passes are drawn in after the depth pre-pass
+const RenderQueue::Pass PREPASS_ORDER[] = {RenderQueue::Pass::OPAQUE,
+                                           RenderQueue::Pass::HIGHLIGHT,
+                                           RenderQueue::Pass::SKY};
+
+uint64_t Field(uint64_t key, int shift, int bits) {
+  return (key >> shift) & ((1ull << bits) - 1);
+}
+
+}  // namespace
+
+RenderQueue::RenderQueue()
+    : P(1.0f),
+      V(1.0f),
+      far(1.0f),
+      object_buffer(0),
+      object_texture(0),
+      indirect_buffer(0),
+      prepass_program(nullptr),
+      overdraw_program(nullptr),
+      fragment_queries{0, 0},
+      fragment_query_pending{false, false},
+      fragment_query(0),
+      fragments(0) {}
+
+void RenderQueue::SetBatching(bool enabled) {
+  batching = enabled;
+}
+
+bool RenderQueue::GetBatching() {
+  return batching;
+}
+
+void RenderQueue::SetLod(bool enabled) {
+  levels_of_detail = enabled;
+}
+
+bool RenderQueue::GetLod() {
+  return levels_of_detail;
+}
+
+void RenderQueue::SetDepthPrepass(bool enabled) {
+  depth_prepass = enabled;
+}
+
+bool RenderQueue::GetDepthPrepass() {
+  return depth_prepass;
+}
+
+void RenderQueue::SetFrontToBack(bool enabled) {
+  front_to_back = enabled;
+}
+
+bool RenderQueue::GetFrontToBack() {
+  return front_to_back;
+}
+
+void RenderQueue::SetOverdrawView(bool enabled) {
+  overdraw_view = enabled;
+}
+
+bool RenderQueue::GetOverdrawView() {
+  return overdraw_view;
+}
+
+void RenderQueue::SetCountFragments(bool enabled) {
+  count_fragments = enabled;
+}
+
+bool RenderQueue::GetCountFragments() {
+  return count_fragments;
+}
+
+// Each draw's objects start at its base instance, which GL 4.3 has but
+// ARB_multi_draw_indirect alone doesn't
+bool RenderQueue::MultiDrawIndirectSupported() {
+  return GLEW_VERSION_4_3 ||
+         (GLEW_ARB_multi_draw_indirect && GLEW_ARB_base_instance);
+}
+
+void RenderQueue::WriteObject(const glm::mat4& transform,
+                              glm::vec3 color,
+                              bool collected,
+                              int ticks_collected,
+                              glm::vec4* texels) {
+  for (int column = 0; column < 4; column++) {
+    texels[column] = transform[column];
+  }
+  texels[OBJECT_COLOR_TEXEL] = glm::vec4(color, 0.0f);
+  texels[OBJECT_COLLECTED_TEXEL] =
+      glm::vec4((float)collected, (float)ticks_collected, 0.0f, 0.0f);
+}
+
+void RenderQueue::SetPrepassProgram(const std::shared_ptr<Program>& program) {
+  prepass_program = program.get();
+}
+
+void RenderQueue::SetOverdrawProgram(const std::shared_ptr<Program>& program) {
+  overdraw_program = program.get();
+}
+
+void RenderQueue::Begin(const glm::mat4& P, const glm::mat4& V, float far) {
+  commands.clear();
+  culled.clear();
+  order.clear();
+  this->P = P;
+  this->V = V;
+  this->far = far;
+}
+
+void RenderQueue::Forget() {
+  program_ids.clear();
+  texture_ids.clear();
+  sky_texture_ids.clear();
+  shape_ids.clear();
+  owner_lods.clear();
+}
+
+// 0 is left for null, and everything past the last id shares it
+uint32_t RenderQueue::Id(std::unordered_map<const void*, uint32_t>& ids,
+                         const void* object,
+                         int bits) {
+  if (!object) {
+    return 0;
+  }
+  auto found = ids.find(object);
+  if (found == ids.end()) {
+    uint32_t max_id = (1u << bits) - 1;
+    uint32_t id = std::min<uint32_t>(ids.size() + 1, max_id);
+    found = ids.insert(std::make_pair(object, id)).first;
+  }
+  return found->second;
+}
+
+// Shapes are normalized to [-1, 1], so the bounding sphere's radius is
+// sqrt(3) times the largest scale
+int RenderQueue::SelectLod(const Shape* shape,
+                           const glm::mat4& transform,
+                           const void* lod_owner) {
+  int lod_count = shape->GetLodCount();
+  if (!levels_of_detail || !lod_owner || lod_count == 1) {
+    return 0;
+  }
+  float scale = std::max(glm::length(glm::vec3(transform[0])),
+                         std::max(glm::length(glm::vec3(transform[1])),
+                                  glm::length(glm::vec3(transform[2]))));
+  float radius = std::sqrt(3.0f) * scale;
+  float depth = -(V * transform[3]).z;
+  auto owner_lod = owner_lods.insert(std::make_pair(lod_owner, 0)).first;
+  if (depth <= radius) {
+    owner_lod->second = 0;  // the camera's inside it
+    return 0;
+  }
+  float size = radius * P[1][1] / depth;
+  int level = std::min(owner_lod->second, lod_count - 1);
+  while (level > 0 && size > LOD_SIZES[level - 1] * (1.0f + LOD_HYSTERESIS)) {
+    level--;
+  }
+  while (level + 1 < lod_count &&
+         size < LOD_SIZES[level] * (1.0f - LOD_HYSTERESIS)) {
+    level++;
+  }
+  owner_lod->second = level;
+  return level;
+}
+
+uint64_t RenderQueue::MakeKey(Pass pass,
+                              Program* program,
+                              Texture* texture,
+                              Texture* sky_texture,
+                              Shape* shape,
+                              int lod,
+                              float depth) {
+  uint64_t band = 0;
+  if (front_to_back && pass == Pass::OPAQUE) {
+    band = std::upper_bound(std::begin(DEPTH_BANDS), std::end(DEPTH_BANDS),
+                            depth) -
+           std::begin(DEPTH_BANDS);
+  }
+  depth = std::max(0.0f, std::min(depth / far, 1.0f));
+  uint64_t max_depth = (1ull << DEPTH_BITS) - 1;
+
+  return ((uint64_t)pass << PASS_SHIFT) | (band << DEPTH_BAND_SHIFT) |
+         ((uint64_t)Id(program_ids, program, PROGRAM_BITS) << PROGRAM_SHIFT) |
+         ((uint64_t)Id(texture_ids, texture, TEXTURE_BITS) << TEXTURE_SHIFT) |
+         ((uint64_t)Id(sky_texture_ids, sky_texture, SKY_TEXTURE_BITS)
+          << SKY_TEXTURE_SHIFT) |
+         // levels of detail are numbered as meshes of their own. A Shape is
+         // bigger than SHAPE_LOD_LEVELS bytes, so these never collide.
+         ((uint64_t)Id(shape_ids, shape ? (const char*)shape + lod : nullptr,
+                       SHAPE_BITS)
+          << SHAPE_SHIFT) |
+         ((uint64_t)(depth * max_depth) << DEPTH_SHIFT);
+}
+
+void RenderQueue::Submit(Pass pass,
+                         const std::shared_ptr<Program>& program,
+                         const std::shared_ptr<Texture>& texture,
+                         const std::shared_ptr<Texture>& sky_texture,
+                         const std::shared_ptr<Shape>& shape,
+                         const glm::mat4& transform,
+                         const void* lod_owner) {
+  Command command;
+  command.program = program.get();
+  command.texture = texture.get();
+  command.sky_texture = sky_texture.get();
+  command.shape = shape.get();
+  command.lod = SelectLod(command.shape, transform, lod_owner);
+  command.transform = transform;
+  command.collectible = false;
+  command.color = glm::vec3(0.0f);
+  command.collected = 0;
+  command.ticks_collected = 0;
+  command.culled = -1;
+  command.key =
+      MakeKey(pass, command.program, command.texture, command.sky_texture,
+              command.shape, command.lod, -(V * transform[3]).z);
+  commands.push_back(command);
+}
+
+void RenderQueue::SubmitCollectible(const std::shared_ptr<Program>& program,
+                                    const std::shared_ptr<Shape>& shape,
+                                    const glm::mat4& transform,
+                                    glm::vec3 color,
+                                    bool collected,
+                                    int ticks_collected,
+                                    const void* lod_owner) {
+  Command command;
+  command.program = program.get();
+  command.texture = nullptr;
+  command.sky_texture = nullptr;
+  command.shape = shape.get();
+  command.lod = SelectLod(command.shape, transform, lod_owner);
+  command.transform = transform;
+  command.collectible = true;
+  command.color = color;
+  command.collected = collected;
+  command.ticks_collected = ticks_collected;
+  command.culled = -1;
+  command.key = MakeKey(Pass::OPAQUE, command.program, nullptr, nullptr,
+                        command.shape, command.lod, -(V * transform[3]).z);
+  commands.push_back(command);
+}
+
+// The objects could be anywhere, so the draws go in the nearest band, which
+// is where most of the level on screen is
+void RenderQueue::SubmitCulled(Pass pass,
+                               const std::shared_ptr<Program>& program,
+                               const std::shared_ptr<Texture>& texture,
+                               const std::shared_ptr<Texture>& sky_texture,
+                               const Culled& culled) {
+  Command command;
+  command.program = program.get();
+  command.texture = texture.get();
+  command.sky_texture = sky_texture.get();
+  command.shape = nullptr;
+  command.lod = 0;
+  command.transform = glm::mat4(1.0f);
+  command.collectible = culled.collectible;
+  command.color = glm::vec3(0.0f);
+  command.collected = 0;
+  command.ticks_collected = 0;
+  command.culled = this->culled.size();
+  command.key = MakeKey(pass, command.program, command.texture,
+                        command.sky_texture, nullptr, 0, 0.0f);
+  commands.push_back(command);
+  this->culled.push_back(culled);
+}
+
+// Least significant digit radix sort of the command indices by key, a byte at
+// a time. Bytes that are the same in every key are skipped, which is most of
+// them with this few programs and textures.
+void RenderQueue::Sort() {
+  PROFILE_SCOPE("RenderQueue::Sort");
+  order.resize(commands.size());
+  order_scratch.resize(commands.size());
+  for (uint32_t i = 0; i < order.size(); i++) {
+    order[i] = i;
+  }
+
+  for (int shift = 0; shift < 64; shift += RADIX_BITS) {
+    size_t counts[RADIX_BUCKETS] = {0};
+    for (uint32_t index : order) {
+      counts[Field(commands[index].key, shift, RADIX_BITS)]++;
+    }
+    if (std::find(counts, counts + RADIX_BUCKETS, order.size()) !=
+        counts + RADIX_BUCKETS) {
+      continue;
+    }
+
+    size_t offset = 0;
+    for (size_t& count : counts) {
+      size_t bucket_size = count;
+      count = offset;
+      offset += bucket_size;
+    }
+    for (uint32_t index : order) {
+      order_scratch[counts[Field(commands[index].key, shift, RADIX_BITS)]++] =
+          index;
+    }
+    order.swap(order_scratch);
+  }
+}
+
+void RenderQueue::BuildRuns() {
+  runs.clear();
+  object_data.clear();
+  indirect_draws.clear();
+  size_t first = 0;
+  for (size_t i = 1; i <= order.size(); i++) {
+    if (i < order.size()) {
+      const Command& run_command = commands[order[first]];
+      const Command& command = commands[order[i]];
+      if (Field(command.key, PASS_SHIFT, PASS_BITS) ==
+              Field(run_command.key, PASS_SHIFT, PASS_BITS) &&
+          command.program == run_command.program &&
+          command.texture == run_command.texture &&
+          command.sky_texture == run_command.sky_texture &&
+          command.culled == -1 && run_command.culled == -1) {
+        continue;
+      }
+    }
+    Run run;
+    run.first = first;
+    run.count = i - first;
+    run.first_draw = 0;
+    run.draw_count = 0;
+    run.batched = BuildBatch(run);
+    runs.push_back(run);
+    first = i;
+  }
+}
+
+// Fills in the run's object data and indirect draws, one draw per mesh since
+// draws in a run are sorted by mesh. Returns false if the run can't batch.
+bool RenderQueue::BuildBatch(Run& run) {
+  Program* program = commands[order[run.first]].program;
+  size_t first_object = object_data.size() / OBJECT_TEXELS;
+  if (commands[order[run.first]].culled != -1 || !batching ||
+      run.count < BATCH_MIN_DRAWS ||
+      program->getUniform(Uniform::batched) == -1 ||
+      first_object + run.count > MESH_BUFFER_MAX_INSTANCES) {
+    return false;
+  }
+  for (size_t i = run.first; i < run.first + run.count; i++) {
+    const Command& command = commands[order[i]];
+    if (!MeshBuffer::Find(command.shape, command.lod)) {
+      return false;
+    }
+  }
+
+  run.first_draw = indirect_draws.size();
+  const Shape* shape = nullptr;
+  int lod = 0;
+  for (size_t i = run.first; i < run.first + run.count; i++) {
+    const Command& command = commands[order[i]];
+    if (command.shape != shape || command.lod != lod) {
+      shape = command.shape;
+      lod = command.lod;
+      const MeshBuffer::Mesh* mesh = MeshBuffer::Find(shape, lod);
+      IndirectDraw draw;
+      draw.count = mesh->index_count;
+      draw.instance_count = 0;
+      draw.first_index = mesh->first_index;
+      draw.base_vertex = mesh->base_vertex;
+      draw.base_instance = object_data.size() / OBJECT_TEXELS;
+      indirect_draws.push_back(draw);
+    }
+    indirect_draws.back().instance_count++;
+    object_data.resize(object_data.size() + OBJECT_TEXELS);
+    WriteObject(command.transform, command.color, command.collected,
+                command.ticks_collected,
+                &object_data[object_data.size() - OBJECT_TEXELS]);
+  }
+  run.draw_count = indirect_draws.size() - run.first_draw;
+  return true;
+}
+
+void RenderQueue::UploadBatches() {
+  if (object_data.empty()) {
+    return;
+  }
+  if (!object_buffer) {
+    glGenBuffers(1, &object_buffer);
+    glGenBuffers(1, &indirect_buffer);
+    glGenTextures(1, &object_texture);
+    GLState::BindBuffer(GL_TEXTURE_BUFFER, object_buffer);
+    GLState::ActiveTexture(GL_TEXTURE0 + OBJECT_BUFFER_UNIT);
+    GLState::BindTexture(GL_TEXTURE_BUFFER, object_texture);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, object_buffer);
+  }
+
+  // orphaning first means not waiting on draws still reading the last data
+  GLsizeiptr object_bytes = object_data.size() * sizeof(glm::vec4);
+  GLState::BindBuffer(GL_TEXTURE_BUFFER, object_buffer);
+  glBufferData(GL_TEXTURE_BUFFER, object_bytes, NULL, GL_STREAM_DRAW);
+  glBufferSubData(GL_TEXTURE_BUFFER, 0, object_bytes, &object_data[0]);
+  if (MultiDrawIndirectSupported()) {
+    GLsizeiptr indirect_bytes = indirect_draws.size() * sizeof(IndirectDraw);
+    GLState::BindBuffer(GL_DRAW_INDIRECT_BUFFER, indirect_buffer);
+    glBufferData(GL_DRAW_INDIRECT_BUFFER, indirect_bytes, NULL,
+                 GL_STREAM_DRAW);
+    glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, indirect_bytes,
+                    &indirect_draws[0]);
+  }
+}
+
+void RenderQueue::ExecuteBatch(const Run& run) {
+  GLState::ActiveTexture(GL_TEXTURE0 + OBJECT_BUFFER_UNIT);
+  GLState::BindTexture(GL_TEXTURE_BUFFER, object_texture);
+  MeshBuffer::Bind();
+  for (size_t i = run.first_draw; i < run.first_draw + run.draw_count; i++) {
+    RenderStats::Triangles(indirect_draws[i].count / 3 *
+                           indirect_draws[i].instance_count);
+  }
+
+  if (MultiDrawIndirectSupported()) {
+    GLState::BindBuffer(GL_DRAW_INDIRECT_BUFFER, indirect_buffer);
+    glMultiDrawElementsIndirect(
+        GL_TRIANGLES, GL_UNSIGNED_INT,
+        (const void*)(run.first_draw * sizeof(IndirectDraw)), run.draw_count,
+        0);
+    RenderStats::DrawCalls(1);
+    return;
+  }
+  // without a base instance, objectIndex is offset to each draw's objects
+  for (size_t i = run.first_draw; i < run.first_draw + run.draw_count; i++) {
+    const IndirectDraw& draw = indirect_draws[i];
+    MeshBuffer::SetFirstInstance(draw.base_instance);
+    glDrawElementsInstancedBaseVertex(
+        GL_TRIANGLES, draw.count, GL_UNSIGNED_INT,
+        (const void*)(draw.first_index * sizeof(GLuint)), draw.instance_count,
+        draw.base_vertex);
+    RenderStats::DrawCalls(1);
+  }
+}
+
+// Triangles aren't counted, since how many instances each draw has is only
+// on the GPU
+void RenderQueue::ExecuteCulled(const Culled& culled) {
+  GLState::ActiveTexture(GL_TEXTURE0 + OBJECT_BUFFER_UNIT);
+  GLState::BindTexture(GL_TEXTURE_BUFFER, culled.objects);
+  MeshBuffer::BindIndexed(culled.object_indices);
+  GLState::BindBuffer(GL_DRAW_INDIRECT_BUFFER, culled.indirect_buffer);
+  glMultiDrawElementsIndirect(
+      GL_TRIANGLES, GL_UNSIGNED_INT,
+      (const void*)(culled.first_draw * sizeof(IndirectDraw)),
+      culled.draw_count, 0);
+  RenderStats::DrawCalls(1);
+}
+
+void RenderQueue::DrawRun(const Run& run, Program* program) {
+  int culled_index = commands[order[run.first]].culled;
+  program->setUniform(Uniform::batched,
+                      (GLint)(run.batched || culled_index != -1));
+  if (culled_index != -1) {
+    ExecuteCulled(culled[culled_index]);
+  } else if (run.batched) {
+    ExecuteBatch(run);
+  } else {
+    ExecuteCommands(run, program);
+  }
+}
+
+void RenderQueue::ExecuteCommands(const Run& run, Program* program) {
+  for (size_t i = run.first; i < run.first + run.count; i++) {
+    const Command& command = commands[order[i]];
+    program->setUniform(Uniform::MV, command.transform);
+    if (command.collectible) {
+      program->setUniform(Uniform::in_obj_color, command.color);
+      program->setUniform(Uniform::isCollected, command.collected);
+      program->setUniform(Uniform::timeCollected, command.ticks_collected);
+    }
+    command.shape->draw(command.lod);
+  }
+}
+
+// Runs never mix collectibles with anything else, since only collectibles
+// use their program
+bool RenderQueue::InPrepass(const Run& run) const {
+  const Command& run_command = commands[order[run.first]];
+  return Field(run_command.key, PASS_SHIFT, PASS_BITS) ==
+             (uint64_t)Pass::OPAQUE &&
+         !run_command.collectible;
+}
+
+void RenderQueue::ExecuteDepthPrepass() {
+  PROFILE_SCOPE("RenderQueue::DepthPrepass");
+  glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+  GLState::DepthMask(GL_TRUE);
+  prepass_program->bind();
+  prepass_program->setUniform(Uniform::P, P);
+  prepass_program->setUniform(Uniform::V, V);
+  prepass_program->setUniform(Uniform::objects, OBJECT_BUFFER_UNIT);
+  for (const Run& run : runs) {
+    if (InPrepass(run)) {
+      DrawRun(run, prepass_program);
+    }
+  }
+  glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+}
+
+// prepassed runs are tested against the depth the pre-pass left and don't
+// write it again
+void RenderQueue::ExecuteRun(const Run& run, bool prepassed, Bound& bound) {
+  const Command& run_command = commands[order[run.first]];
+  Program* program = run_command.program;
+  if (overdraw_view && overdraw_program) {
+    program = overdraw_program;
+  }
+  if (program != bound.program) {
+    bound.program = program;
+    program->bind();
+    program->setUniform(Uniform::P, P);
+    program->setUniform(Uniform::V, V);
+    // set even when not batching, since samplers of different types can't
+    // share a unit
+    program->setUniform(Uniform::objects, OBJECT_BUFFER_UNIT);
+    ShadowMaps::Apply(*program);
+    // sampler uniforms are per program, so textures are set again
+    bound.texture = nullptr;
+    bound.sky_texture = nullptr;
+  }
+  if (program == run_command.program) {
+    if (run_command.texture && run_command.texture != bound.texture) {
+      bound.texture = run_command.texture;
+      bound.texture->bind(program->getUniform(Uniform::Texture0));
+    }
+    if (run_command.sky_texture &&
+        run_command.sky_texture != bound.sky_texture) {
+      bound.sky_texture = run_command.sky_texture;
+      bound.sky_texture->bind(program->getUniform(Uniform::SkyTexture0));
+    }
+  }
+  GLState::DepthMask(prepassed ? GL_FALSE : GL_TRUE);
+  DrawRun(run, program);
+}
+
+void RenderQueue::BeginFragmentCount() {
+  if (!fragment_queries[0]) {
+    glGenQueries(2, fragment_queries);
+  }
+  glBeginQuery(GL_SAMPLES_PASSED, fragment_queries[fragment_query]);
+}
+
+// Reads the other query, from the last counted Execute(), if it's done. If
+// it isn't, that count is skipped rather than waited on.
+void RenderQueue::EndFragmentCount() {
+  glEndQuery(GL_SAMPLES_PASSED);
+  fragment_query_pending[fragment_query] = true;
+  fragment_query = 1 - fragment_query;
+  if (!fragment_query_pending[fragment_query]) {
+    return;
+  }
+  GLint available = 0;
+  glGetQueryObjectiv(fragment_queries[fragment_query],
+                     GL_QUERY_RESULT_AVAILABLE, &available);
+  if (!available) {
+    return;
+  }
+  GLuint64 samples = 0;
+  glGetQueryObjectui64v(fragment_queries[fragment_query], GL_QUERY_RESULT,
+                        &samples);
+  fragments = samples;
+  fragment_query_pending[fragment_query] = false;
+}
+
+void RenderQueue::Execute() {
+  PROFILE_SCOPE("RenderQueue::Execute");
+  BuildRuns();
+  UploadBatches();
+
+  bool prepass = depth_prepass && prepass_program;
+  if (prepass) {
+    ExecuteDepthPrepass();
+    glDepthFunc(GL_LEQUAL);
+  }
+  if (count_fragments) {
+    BeginFragmentCount();
+  }
+  if (overdraw_view && overdraw_program) {
+    glBlendFunc(GL_ONE, GL_ONE);
+  }
+
+  Bound bound = {nullptr, nullptr, nullptr};
+  if (prepass) {
+    // runs are sorted by pass, but the highlight has to go over the object
+    // it highlights now that both are at the same depth
+    for (Pass pass : PREPASS_ORDER) {
+      for (const Run& run : runs) {
+        if (Field(commands[order[run.first]].key, PASS_SHIFT, PASS_BITS) ==
+            (uint64_t)pass) {
+          ExecuteRun(run, InPrepass(run), bound);
+        }
+      }
+    }
+  } else {
+    for (const Run& run : runs) {
+      ExecuteRun(run, false, bound);
+    }
+  }
+  if (overdraw_view && overdraw_program) {
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+  }
+  if (count_fragments) {
+    EndFragmentCount();
+  }
+  if (prepass) {
+    GLState::DepthMask(GL_TRUE);
+    glDepthFunc(GL_LESS);
+  }
+}
+
+void RenderQueue::Dump(std::ostream& out) const {
+  out << "key,pass,band,program,texture,sky_texture,mesh,lod,depth"
+      << std::endl;
+  for (uint32_t index : order) {
+    const Command& command = commands[index];
+    out << std::hex << std::setw(16) << std::setfill('0') << command.key
+        << std::dec << "," << Field(command.key, PASS_SHIFT, PASS_BITS) << ","
+        << Field(command.key, DEPTH_BAND_SHIFT, DEPTH_BAND_BITS) << ","
+        << command.program->getName() << ","
+        << (command.texture ? command.texture->getName() : "") << ","
+        << (command.sky_texture ? command.sky_texture->getName() : "") << ","
+        << Field(command.key, SHAPE_SHIFT, SHAPE_BITS) << "," << command.lod
+        << "," << Field(command.key, DEPTH_SHIFT, DEPTH_BITS) << std::endl;
+  }
+}
@@ -0,0 +1,269 @@
+#ifndef RENDER_QUEUE_H_
+#define RENDER_QUEUE_H_
+
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <unordered_map>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "Program.h"
+#include "Shape.h"
+#include "Texture.h"
+
+// Texels of object data per batched object: the transform's four columns,
+// the collectible color and then collected and ticks collected. Program
+// defines these in every shader for objects.glsl.
+#define OBJECT_TEXELS 6
+#define OBJECT_COLOR_TEXEL 4
+#define OBJECT_COLLECTED_TEXEL 5
+
+// The draws of one view, collected during a frame and then run in an order
+// that keeps programs, textures and meshes bound for as long as possible.
+// Each draw gets a 64 bit sort key, from the top bit down:
+//
+//   pass (4) | depth band (2) | program (8) | texture (8) | sky texture (6) |
+//   mesh (14) | depth (22)
+//
+// Programs, textures and meshes are numbered the first time they're
+// submitted, each level of detail of a mesh as its own mesh, and depth is the
+// distance in front of the camera, so draws of the same mesh go front to
+// back. Opaque draws are also split into a few bands of depth ahead of the
+// program, so near objects go first and hide what's behind them before it's
+// shaded, for the cost of binding each program once per band.
+//
+// With the depth pre-pass on, the opaque runs are drawn first with only
+// depth, by the prepass program, and then shaded against that depth without
+// writing it, so each pixel is shaded once. Collectibles are left out, since
+// their geometry shader moves them.
+//
+// Draws submitted with an owner get the Shape level of detail that fits how
+// big they are on screen. The owner's last level is kept so it only changes
+// once the size is well past a threshold, not back and forth across it.
+//
+// Runs of draws that share a pass, program and textures go out as one batch if
+// the program supports it (declares the batched uniform) and every mesh is
+// in the MeshBuffer. Each object's transform and collectible state go in a
+// buffer texture, and the run is one glMultiDrawElementsIndirect, or one
+// instanced draw per mesh without GL 4.3.
+//
+// Draws culled on the GPU come in already laid out, as a range of indirect
+// draws and the object data and indices they read. Each range is a run of its
+// own, drawn full detail with one glMultiDrawElementsIndirect.
+//
+// The queue holds raw pointers to what's submitted, which the game objects
+// own and keep alive for the frame.
+class RenderQueue {
+ public:
+  enum class Pass {
+    // before the level, so it wins the depth test against the object it
+    // highlights when that object is drawn again. After the pre-pass it's
+    // drawn after the level instead, at the depth already there.
+    HIGHLIGHT = 0,
+    OPAQUE = 1,
+    // after everything it would otherwise overdraw
+    SKY = 2,
+  };
+
+  struct Command {
+    uint64_t key;
+    Program* program;
+    Texture* texture;      // bound to Texture0 if set
+    Texture* sky_texture;  // bound to SkyTexture0 if set
+    Shape* shape;
+    int lod;
+    glm::mat4 transform;
+    // collectibles also set in_obj_color, isCollected and timeCollected
+    bool collectible;
+    glm::vec3 color;
+    GLint collected;
+    GLint ticks_collected;
+    // index of the culled draws this stands for, or -1
+    int culled;
+  };
+
+  // Indirect draws [first_draw, first_draw + draw_count) in indirect_buffer,
+  // whose instances' objectIndex is read from object_indices and whose
+  // object data is in objects, a buffer texture laid out like the queue's
+  struct Culled {
+    GLuint indirect_buffer;
+    GLuint object_indices;
+    GLuint objects;
+    size_t first_draw;
+    size_t draw_count;
+    // left out of the pre-pass, like other collectibles
+    bool collectible;
+  };
+
+  RenderQueue();
+
+  // Empties the queue for a view. far is the farthest depth that still sorts.
+  void Begin(const glm::mat4& P, const glm::mat4& V, float far);
+  // Forgets the ids and levels of detail handed out so far, which are kept by
+  // address. For when the level changes, so a new object at a freed one's
+  // address doesn't take its level of detail, and the numbering starts over.
+  void Forget();
+  // lod_owner is what the draw is of, to pick a level of detail for. Without
+  // one the draw is full detail.
+  void Submit(Pass pass,
+              const std::shared_ptr<Program>& program,
+              const std::shared_ptr<Texture>& texture,
+              const std::shared_ptr<Texture>& sky_texture,
+              const std::shared_ptr<Shape>& shape,
+              const glm::mat4& transform,
+              const void* lod_owner = nullptr);
+  void SubmitCollectible(const std::shared_ptr<Program>& program,
+                         const std::shared_ptr<Shape>& shape,
+                         const glm::mat4& transform,
+                         glm::vec3 color,
+                         bool collected,
+                         int ticks_collected,
+                         const void* lod_owner = nullptr);
+  // The program has to support batching, and GL has to have
+  // MultiDrawIndirectSupported()
+  void SubmitCulled(Pass pass,
+                    const std::shared_ptr<Program>& program,
+                    const std::shared_ptr<Texture>& texture,
+                    const std::shared_ptr<Texture>& sky_texture,
+                    const Culled& culled);
+  void Sort();
+  // Draws everything submitted in sorted order, setting P, V and the
+  // shadow maps on each program it binds
+  void Execute();
+  // Both position only, like shadowmap_prog. Without a prepass program the
+  // queue never does the pre-pass, and without an overdraw program it never
+  // shows overdraw.
+  void SetPrepassProgram(const std::shared_ptr<Program>& program);
+  void SetOverdrawProgram(const std::shared_ptr<Program>& program);
+  // Fragments the last counted Execute() shaded, not counting the pre-pass.
+  // Counts are read a frame late, so they never wait on the GPU.
+  uint64_t GetFragments() const { return fragments; }
+  // One line per command in sorted order: key, pass, depth band, program,
+  // textures, mesh, level of detail and depth
+  void Dump(std::ostream& out) const;
+
+  size_t Size() const { return commands.size(); }
+
+  // Writes one object's OBJECT_TEXELS texels of object data
+  static void WriteObject(const glm::mat4& transform,
+                          glm::vec3 color,
+                          bool collected,
+                          int ticks_collected,
+                          glm::vec4* texels);
+  // glMultiDrawElementsIndirect with a base instance per draw
+  static bool MultiDrawIndirectSupported();
+
+  // Turns batching off for every queue, to compare against drawing each
+  // object on its own
+  static void SetBatching(bool enabled);
+  static bool GetBatching();
+  // Turns levels of detail off for every queue, to compare triangle counts
+  static void SetLod(bool enabled);
+  static bool GetLod();
+  // Off by default, as the pre-pass costs a second pass over the opaque
+  // vertices, which only pays where fragments are the bottleneck
+  static void SetDepthPrepass(bool enabled);
+  static bool GetDepthPrepass();
+  // Turns the depth bands off for every queue, to compare overdraw
+  static void SetFrontToBack(bool enabled);
+  static bool GetFrontToBack();
+  // Draws every run with the overdraw program, blended additively, so the
+  // scene shows how many times each pixel is shaded
+  static void SetOverdrawView(bool enabled);
+  static bool GetOverdrawView();
+  // Counts the fragments every queue shades with GL_SAMPLES_PASSED
+  static void SetCountFragments(bool enabled);
+  static bool GetCountFragments();
+
+ private:
+  // Commands order[first, first + count) share a pass, program and textures
+  struct Run {
+    size_t first;
+    size_t count;
+    bool batched;
+    // where the run's indirect draws start in indirect_draws
+    size_t first_draw;
+    size_t draw_count;
+  };
+  // Layout GL reads indirect draws in
+  struct IndirectDraw {
+    GLuint count;
+    GLuint instance_count;
+    GLuint first_index;
+    GLint base_vertex;
+    GLuint base_instance;
+  };
+
+  // What Execute() last bound
+  struct Bound {
+    Program* program;
+    Texture* texture;
+    Texture* sky_texture;
+  };
+
+  void BuildRuns();
+  bool BuildBatch(Run& run);
+  void UploadBatches();
+  bool InPrepass(const Run& run) const;
+  void ExecuteDepthPrepass();
+  void ExecuteRun(const Run& run, bool prepassed, Bound& bound);
+  void ExecuteBatch(const Run& run);
+  void ExecuteCulled(const Culled& culled);
+  // Draws the run with program, which is already bound
+  void DrawRun(const Run& run, Program* program);
+  // Draws the run's commands one at a time with program
+  void ExecuteCommands(const Run& run, Program* program);
+  void BeginFragmentCount();
+  void EndFragmentCount();
+
+  int SelectLod(const Shape* shape,
+                const glm::mat4& transform,
+                const void* lod_owner);
+  uint64_t MakeKey(Pass pass,
+                   Program* program,
+                   Texture* texture,
+                   Texture* sky_texture,
+                   Shape* shape,
+                   int lod,
+                   float depth);
+  static uint32_t Id(std::unordered_map<const void*, uint32_t>& ids,
+                     const void* object,
+                     int bits);
+
+  std::vector<Command> commands;
+  std::vector<Culled> culled;
+  // command indices, sorted by key
+  std::vector<uint32_t> order;
+  std::vector<uint32_t> order_scratch;
+  glm::mat4 P;
+  glm::mat4 V;
+  float far;
+
+  std::vector<Run> runs;
+  // OBJECT_TEXELS per batched object
+  std::vector<glm::vec4> object_data;
+  std::vector<IndirectDraw> indirect_draws;
+  // made the first time there's a batch
+  GLuint object_buffer;
+  GLuint object_texture;
+  GLuint indirect_buffer;
+
+  Program* prepass_program;
+  Program* overdraw_program;
+  // Execute() counts into one query while the other, from the frame before,
+  // is read. Made the first time fragments are counted.
+  GLuint fragment_queries[2];
+  bool fragment_query_pending[2];
+  int fragment_query;
+  uint64_t fragments;
+
+  std::unordered_map<const void*, uint32_t> program_ids;
+  std::unordered_map<const void*, uint32_t> texture_ids;
+  std::unordered_map<const void*, uint32_t> sky_texture_ids;
+  std::unordered_map<const void*, uint32_t> shape_ids;
+  // each owner's level of detail last time it was submitted
+  std::unordered_map<const void*, int> owner_lods;
+};
+
+#endif
@@ -0,0 +1,22 @@
+#include "RenderStats.h"
+
+namespace RenderStats {
+
+Counters current = {0, 0, 0, 0};
+
+namespace {
+
+Counters last_frame = {0, 0, 0, 0};
+
+}  // namespace
+
+void EndFrame() {
+  last_frame = current;
+  current = Counters{0, 0, 0, 0};
+}
+
+const Counters& GetLastFrame() {
+  return last_frame;
+}
+
+}  // namespace RenderStats
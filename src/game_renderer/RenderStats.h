@@ -0,0 +1,45 @@
+#ifndef RENDER_STATS_H_
+#define RENDER_STATS_H_
+
+#include <cstdint>
+
+// Counts of the GL work submitted each frame: draw calls, the triangles mesh
+// draws ask for, and calls that change GL state (program, texture, VAO,
+// buffer, framebuffer and vertex attribute binds), split into those issued
+// and those GLState skipped as redundant. Counting is always on since it's a
+// couple of adds per call.
+namespace RenderStats {
+
+struct Counters {
+  uint64_t draw_calls;
+  uint64_t state_changes;
+  uint64_t state_changes_elided;
+  uint64_t triangles;
+};
+
+extern Counters current;
+
+inline void DrawCalls(uint64_t count) {
+  current.draw_calls += count;
+}
+
+inline void Triangles(uint64_t count) {
+  current.triangles += count;
+}
+
+inline void StateChanges(uint64_t count) {
+  current.state_changes += count;
+}
+
+inline void StateChangesElided(uint64_t count) {
+  current.state_changes_elided += count;
+}
+
+// The counts so far become the last frame's and counting starts over.
+// RendererSetup::PostRender() calls this after every frame it presents.
+void EndFrame();
+const Counters& GetLastFrame();
+
+}  // namespace RenderStats
+
+#endif
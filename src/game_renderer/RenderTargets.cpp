@@ -0,0 +1,186 @@
+#include "RenderTargets.h"
+
+#include <algorithm>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include "GLState.h"
+
+// frames a released target waits for a taker before it's deleted
+#define RENDER_TARGET_IDLE_FRAMES 120
+#define DEPTH_BYTES_PER_PIXEL 4
+// frames a new size has to hold before SettledSize takes it
+#define RESIZE_SETTLE_FRAMES 5
+
+namespace RenderTargets {
+
+namespace {
+
+std::vector<std::unique_ptr<Target>> targets;
+int frame = 0;
+int created_count = 0;
+int framebuffer_count = 0;
+int texture_count = 0;
+int renderbuffer_count = 0;
+
+int BytesPerPixel(GLenum color_format) {
+  switch (color_format) {
+    case GL_RGB16F:
+      return 6;
+    case GL_RGBA16F:
+      return 8;
+    case GL_RGB32F:
+      return 12;
+    case GL_RGBA32F:
+      return 16;
+    case GL_RGB8:
+      return 3;
+    default:
+      // GL_R11F_G11F_B10F, GL_RGBA8 and the like
+      return 4;
+  }
+}
+
+std::unique_ptr<Target> Create(const Format& format) {
+  std::unique_ptr<Target> target(new Target());
+  created_count++;
+  target->format = format;
+  target->depth = 0;
+  target->acquired = false;
+  target->released_frame = frame;
+  size_t pixels = (size_t)format.width * format.height;
+  target->bytes = pixels * BytesPerPixel(format.color_format) *
+                  format.color_count;
+
+  glGenFramebuffers(1, &target->framebuffer);
+  framebuffer_count++;
+  GLState::BindFramebuffer(GL_FRAMEBUFFER, target->framebuffer);
+  glGenTextures(format.color_count, target->colors);
+  texture_count += format.color_count;
+  GLenum attachments[RENDER_TARGET_MAX_COLORS];
+  for (int i = 0; i < format.color_count; i++) {
+    GLState::BindTexture(GL_TEXTURE_2D, target->colors[i]);
+    // the type doesn't matter without data, only that it goes with RGB
+    glTexImage2D(GL_TEXTURE_2D, 0, format.color_format, format.width,
+                 format.height, 0, GL_RGB, GL_FLOAT, NULL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + i,
+                           GL_TEXTURE_2D, target->colors[i], 0);
+    attachments[i] = GL_COLOR_ATTACHMENT0 + i;
+  }
+  glDrawBuffers(format.color_count, attachments);
+  if (format.depth) {
+    glGenRenderbuffers(1, &target->depth);
+    renderbuffer_count++;
+    glBindRenderbuffer(GL_RENDERBUFFER, target->depth);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, format.width,
+                          format.height);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT,
+                              GL_RENDERBUFFER, target->depth);
+    target->bytes += pixels * DEPTH_BYTES_PER_PIXEL;
+  }
+  if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+    std::cout << "Framebuffer not complete!" << std::endl;
+  }
+  GLState::BindFramebuffer(GL_FRAMEBUFFER, 0);
+  return target;
+}
+
+void Delete(Target* target) {
+  glDeleteFramebuffers(1, &target->framebuffer);
+  framebuffer_count--;
+  glDeleteTextures(target->format.color_count, target->colors);
+  texture_count -= target->format.color_count;
+  if (target->depth) {
+    glDeleteRenderbuffers(1, &target->depth);
+    renderbuffer_count--;
+  }
+  // GLState may still think it's bound
+  GLState::Invalidate();
+}
+
+// Deletes the free targets released before frame
+void DeleteReleasedBefore(int before) {
+  auto deleted = std::remove_if(
+      targets.begin(), targets.end(), [before](std::unique_ptr<Target>& t) {
+        if (t->acquired || t->released_frame >= before) {
+          return false;
+        }
+        Delete(t.get());
+        return true;
+      });
+  targets.erase(deleted, targets.end());
+}
+
+}  // namespace
+
+bool Format::operator==(const Format& other) const {
+  return width == other.width && height == other.height &&
+         color_format == other.color_format &&
+         color_count == other.color_count && depth == other.depth;
+}
+
+Target* Acquire(const Format& format) {
+  for (std::unique_ptr<Target>& target : targets) {
+    if (!target->acquired && target->format == format) {
+      target->acquired = true;
+      return target.get();
+    }
+  }
+  targets.push_back(Create(format));
+  targets.back()->acquired = true;
+  return targets.back().get();
+}
+
+void Release(Target* target) {
+  if (target) {
+    target->acquired = false;
+    target->released_frame = frame;
+  }
+}
+
+void EndFrame() {
+  frame++;
+  DeleteReleasedBefore(frame - RENDER_TARGET_IDLE_FRAMES);
+}
+
+void Trim() {
+  DeleteReleasedBefore(frame + 1);
+}
+
+Stats GetStats() {
+  Stats stats = {(int)targets.size(), 0, created_count, framebuffer_count,
+                 texture_count, renderbuffer_count, 0};
+  for (const std::unique_ptr<Target>& target : targets) {
+    stats.acquired += target->acquired;
+    stats.bytes += target->bytes;
+  }
+  return stats;
+}
+
+bool SettledSize::Update(int new_width, int new_height) {
+  if (new_width <= 0 || new_height <= 0 ||
+      (new_width == width && new_height == height)) {
+    // minimized, or back where it was
+    pending_frames = 0;
+    return false;
+  }
+  if (new_width != pending_width || new_height != pending_height) {
+    pending_width = new_width;
+    pending_height = new_height;
+    pending_frames = 0;
+  }
+  if (width && ++pending_frames < RESIZE_SETTLE_FRAMES) {
+    return false;
+  }
+  width = new_width;
+  height = new_height;
+  pending_frames = 0;
+  return true;
+}
+
+}  // namespace RenderTargets
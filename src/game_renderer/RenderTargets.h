@@ -0,0 +1,90 @@
+#ifndef RENDER_TARGETS_H_
+#define RENDER_TARGETS_H_
+
+#define GLEW_STATIC
+#include <GL/glew.h>
+
+#include <cstddef>
+
+#define RENDER_TARGET_MAX_COLORS 2
+
+// A pool of framebuffers and their attachments, keyed by size and format.
+// Targets are acquired for as long as they're drawn to and released after,
+// and a released target is handed to the next Acquire() of the same size and
+// format. Targets nobody has acquired for a while are deleted, so sizes that
+// come back soon are reused and the rest don't hold on to memory.
+//
+// Everything the pool creates is counted, so leaks show up in GetStats().
+namespace RenderTargets {
+
+struct Format {
+  int width;
+  int height;
+  // internal format of every color texture
+  GLenum color_format;
+  int color_count;
+  // with a depth renderbuffer
+  bool depth;
+
+  bool operator==(const Format& other) const;
+};
+
+struct Target {
+  Format format;
+  GLuint framebuffer;
+  // linear filtered and clamped to the edge
+  GLuint colors[RENDER_TARGET_MAX_COLORS];
+  GLuint depth;
+  size_t bytes;
+  bool acquired;
+  // the frame it was released on
+  int released_frame;
+};
+
+struct Stats {
+  int targets;
+  int acquired;
+  // every target ever created, to count reallocations
+  int created;
+  // GL objects the pool has created and not deleted
+  int framebuffers;
+  int textures;
+  int renderbuffers;
+  // estimated from the formats
+  size_t bytes;
+};
+
+// A target of format, drawing to every color attachment. It stays the
+// caller's until it's released.
+Target* Acquire(const Format& format);
+// Gives target back to the pool, nullptr is ignored
+void Release(Target* target);
+// Deletes targets that haven't been acquired for a while. Call once a frame.
+void EndFrame();
+// Deletes every target that isn't acquired right now
+void Trim();
+
+Stats GetStats();
+
+// A size that follows one that may change every frame, as a window's does
+// during a resize drag, but only once it has held still for a few frames.
+// Targets sized by it are reallocated once per resize instead of once per
+// frame, and stretched in between.
+class SettledSize {
+ public:
+  // True when the settled size changed, which the first call always does
+  bool Update(int new_width, int new_height);
+  int GetWidth() const { return width; }
+  int GetHeight() const { return height; }
+
+ private:
+  int width = 0;
+  int height = 0;
+  int pending_width = 0;
+  int pending_height = 0;
+  int pending_frames = 0;
+};
+
+}  // namespace RenderTargets
+
+#endif
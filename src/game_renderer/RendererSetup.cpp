@@ -4,14 +4,21 @@
 
 #include <iostream>
 
+#include "AssetLoader.h"
 #include "GLSL.h"
+#include "GLState.h"
+#include "GpuProfiler.h"
+#include "Profiler.h"
+#include "ProgramCache.h"
+#include "RenderStats.h"
+#include "RenderTargets.h"
 #include "ShapeManager.h"
 
 #define WINDOW_WIDTH 1600
 #define WINDOW_HEIGHT 900
 #define IMGUI_WINDOW_PADDING 10
 
-GLFWwindow* RendererSetup::InitOpenGL() {
+GLFWwindow* RendererSetup::InitOpenGL(bool visible) {
   if (!glfwInit()) {
     std::cerr << "!glfwInit()" << std::endl;
     exit(1);
@@ -24,14 +31,23 @@ GLFWwindow* RendererSetup::InitOpenGL() {
   glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 2);
 
   GLFWwindow* window;
+  if (!visible) {
+    glfwWindowHint(GLFW_VISIBLE, GL_FALSE);
+    window = glfwCreateWindow(WINDOW_WIDTH, WINDOW_HEIGHT, TITLE, NULL, NULL);
+  } else {
 #ifdef DEBUG
-  window = glfwCreateWindow(WINDOW_WIDTH, WINDOW_HEIGHT, "Rhythm Runner", NULL,
-                            NULL);
+    window = glfwCreateWindow(WINDOW_WIDTH, WINDOW_HEIGHT, "Rhythm Runner",
+                              NULL, NULL);
 #else
-  GLFWmonitor* monitor = glfwGetPrimaryMonitor();
-  const GLFWvidmode* mode = glfwGetVideoMode(monitor);
-  window = glfwCreateWindow(mode->width, mode->height, TITLE, monitor, NULL);
+    GLFWmonitor* monitor = glfwGetPrimaryMonitor();
+    const GLFWvidmode* mode = glfwGetVideoMode(monitor);
+    window = glfwCreateWindow(mode->width, mode->height, TITLE, monitor, NULL);
 #endif
+  }
+  if (!window) {
+    std::cerr << "Failed to create a window" << std::endl;
+    exit(1);
+  }
   glfwMakeContextCurrent(window);
   glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_NORMAL);
   glewExperimental = true;
@@ -59,6 +75,9 @@ GLFWwindow* RendererSetup::InitOpenGL() {
                                      24.0f);
 
   ShapeManager::InitGL();
+#ifdef PROFILING
+  GpuProfiler::Init();
+#endif
 
   return window;
 }
@@ -68,8 +87,20 @@ void RendererSetup::PreRender(GLFWwindow* window) {
 }
 
 void RendererSetup::PostRender(GLFWwindow* window) {
+  PROFILE_SCOPE("PostRender");
   glfwSwapBuffers(window);
+#ifdef PROFILING
+  GpuProfiler::EndFrame();
+#endif
+  RenderStats::EndFrame();
+  RenderTargets::EndFrame();
+  AssetLoader::Update();
+#ifdef DEBUG
+  ProgramCache::Update();
+#endif
   glfwPollEvents();
+  // event callbacks and the next frame's ImGui may change GL state directly
+  GLState::Invalidate();
 }
 
 void RendererSetup::Close(GLFWwindow* window) {
@@ -12,7 +12,9 @@
 
 class RendererSetup {
  public:
-  static GLFWwindow* InitOpenGL();
+  // A hidden window still gets a full context, which is enough to build the
+  // game state for replays and benchmarks that never present a frame.
+  static GLFWwindow* InitOpenGL(bool visible = true);
   static void Close(GLFWwindow* window);
   static void PreRender(GLFWwindow* window);
   static void PostRender(GLFWwindow* window);
@@ -0,0 +1,514 @@
+#include "ShadowMaps.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <queue>
+#include <unordered_set>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "GLState.h"
+#include "GameRenderer.h"
+#include "GpuProfiler.h"
+#include "Octree.h"
+#include "Profiler.h"
+#include "RenderQueue.h"
+#include "RenderStats.h"
+#include "ViewFrustumCulling.h"
+
+// below the object buffer's unit, and clear of the textures objects use
+#define SHADOW_CASCADE_UNIT 13
+#define SHADOW_DYNAMIC_UNIT 14
+// world units the first cascade covers in s, each one after is this many
+// times wider
+#define SHADOW_CASCADE_WIDTH 32.0f
+#define SHADOW_CASCADE_SCALE 4.0f
+// a cascade's window moves in this many steps of its width
+#define SHADOW_CASCADE_STEPS 16
+// how much of a window is behind the player, where the camera is
+#define SHADOW_WINDOW_BEHIND 0.25f
+// how far across a window the player may get before it's centered again,
+// when the level is too wide in t for it
+#define SHADOW_RECENTER 0.25f
+#define SHADOW_DYNAMIC_WIDTH 48.0f
+// light space units past the level's box
+#define SHADOW_LEVEL_MARGIN 10.0f
+#define SHADOW_SLOPE_BIAS 2.0f
+#define SHADOW_CONSTANT_BIAS 4.0f
+
+namespace ShadowMaps {
+
+namespace {
+
+// A map's window in light space, which it covers corner to corner
+struct Window {
+  float s;
+  float t;
+  float width;
+  float height;
+};
+
+struct Cascade {
+  bool valid;
+  // the window starts at first_step steps along s
+  long first_step;
+  float step;
+  Window window;
+};
+
+// the direction to the light in platform_frag.glsl and the rest
+const glm::vec3 LIGHT_DIRECTION(100, 1000, -4);
+// never inside, for cascades that haven't been drawn yet
+const glm::vec4 NO_WINDOW(std::numeric_limits<float>::max(), 0, 1, 1);
+
+const Budget BUDGETS[] = {
+    {0, 0, 0, 0, 1},         // OFF
+    {1024, 2, 512, 1, 2},    // LOW
+    {2048, 3, 1024, 1, 1},   // MEDIUM
+    {3072, 3, 2048, 2, 1}};  // HIGH
+
+ShadowQuality quality = ShadowQuality::MEDIUM;
+Stats stats = {};
+
+// world to light space: s, t and minus the depth along the light
+glm::mat4 light_view;
+glm::vec3 s_axis;
+glm::vec3 t_axis;
+glm::vec3 depth_axis;
+
+// the level the cascades were drawn for, and its box in light space
+Node* level_root = nullptr;
+float t_min, t_max;
+float depth_near, depth_far;
+
+Cascade cascades[SHADOW_MAX_CASCADES];
+Window dynamic_window;
+bool dynamic_valid = false;
+int frames_since_dynamic = 0;
+// the cascades the last Render() left for Apply(), 0 for none
+int active_cascades = 0;
+
+GLuint cascade_texture = 0;
+GLuint dynamic_texture;
+GLuint cascade_framebuffers[SHADOW_MAX_CASCADES];
+GLuint dynamic_framebuffer;
+// what the textures were made for
+int allocated_resolution = 0;
+int allocated_cascades = 0;
+int allocated_dynamic_resolution = 0;
+
+RenderQueue shadow_queue;
+
+void InitLightSpace() {
+  // s is world X with the light's direction taken out, so it grows as the
+  // player runs
+  glm::vec3 toward_light = glm::normalize(LIGHT_DIRECTION);
+  depth_axis = -toward_light;
+  s_axis = glm::normalize(glm::vec3(1, 0, 0) -
+                          toward_light * glm::dot(glm::vec3(1, 0, 0),
+                                                  toward_light));
+  t_axis = glm::cross(toward_light, s_axis);
+  light_view = glm::mat4(1.0f);
+  for (int i = 0; i < 3; i++) {
+    light_view[i][0] = s_axis[i];
+    light_view[i][1] = t_axis[i];
+    light_view[i][2] = toward_light[i];
+  }
+}
+
+void ConfigureDepthTexture(GLenum target) {
+  glTexParameteri(target, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  glTexParameteri(target, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  // the cascades wrap around in s, and linear filtering wraps with them
+  glTexParameteri(target, GL_TEXTURE_WRAP_S,
+                  target == GL_TEXTURE_2D_ARRAY ? GL_REPEAT : GL_CLAMP_TO_EDGE);
+  glTexParameteri(target, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  glTexParameteri(target, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+  glTexParameteri(target, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+}
+
+void CheckFramebuffer() {
+  glDrawBuffer(GL_NONE);
+  glReadBuffer(GL_NONE);
+  if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+    std::cout << "Shadow map framebuffer not complete!" << std::endl;
+  }
+}
+
+void DeleteMaps() {
+  if (!cascade_texture) {
+    return;
+  }
+  glDeleteFramebuffers(allocated_cascades, cascade_framebuffers);
+  glDeleteFramebuffers(1, &dynamic_framebuffer);
+  glDeleteTextures(1, &cascade_texture);
+  glDeleteTextures(1, &dynamic_texture);
+  cascade_texture = 0;
+  GLState::Invalidate();
+}
+
+// 16 bit depth is plenty across one level, and half the memory of 32
+void AllocateMaps(const Budget& budget) {
+  PROFILE_SCOPE("ShadowMaps::AllocateMaps");
+  DeleteMaps();
+  InitLightSpace();
+  glGenTextures(1, &cascade_texture);
+  GLState::BindTexture(GL_TEXTURE_2D_ARRAY, cascade_texture);
+  glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT16, budget.resolution,
+               budget.resolution, budget.cascades, 0, GL_DEPTH_COMPONENT,
+               GL_UNSIGNED_SHORT, NULL);
+  ConfigureDepthTexture(GL_TEXTURE_2D_ARRAY);
+  glGenFramebuffers(budget.cascades, cascade_framebuffers);
+  for (int i = 0; i < budget.cascades; i++) {
+    GLState::BindFramebuffer(GL_FRAMEBUFFER, cascade_framebuffers[i]);
+    glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT,
+                              cascade_texture, 0, i);
+    CheckFramebuffer();
+  }
+
+  glGenTextures(1, &dynamic_texture);
+  GLState::BindTexture(GL_TEXTURE_2D, dynamic_texture);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT16,
+               budget.dynamic_resolution, budget.dynamic_resolution, 0,
+               GL_DEPTH_COMPONENT, GL_UNSIGNED_SHORT, NULL);
+  ConfigureDepthTexture(GL_TEXTURE_2D);
+  glGenFramebuffers(1, &dynamic_framebuffer);
+  GLState::BindFramebuffer(GL_FRAMEBUFFER, dynamic_framebuffer);
+  glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D,
+                         dynamic_texture, 0);
+  CheckFramebuffer();
+  GLState::BindFramebuffer(GL_FRAMEBUFFER, 0);
+
+  allocated_resolution = budget.resolution;
+  allocated_cascades = budget.cascades;
+  allocated_dynamic_resolution = budget.dynamic_resolution;
+  Invalidate();
+}
+
+// Light space bounds of the level's box. Windows no wider in t than the
+// level never have to move in t.
+void FitLevel(Node* root) {
+  glm::vec3 corners[2] = {root->boundingBox.GetMin(),
+                          root->boundingBox.GetMax()};
+  t_min = depth_near = std::numeric_limits<float>::max();
+  t_max = depth_far = -std::numeric_limits<float>::max();
+  for (int i = 0; i < 8; i++) {
+    glm::vec3 corner(corners[i & 1].x, corners[(i >> 1) & 1].y,
+                     corners[(i >> 2) & 1].z);
+    float t = glm::dot(corner, t_axis);
+    float depth = glm::dot(corner, depth_axis);
+    t_min = std::min(t_min, t);
+    t_max = std::max(t_max, t);
+    depth_near = std::min(depth_near, depth);
+    depth_far = std::max(depth_far, depth);
+  }
+  depth_near -= SHADOW_LEVEL_MARGIN;
+  depth_far += SHADOW_LEVEL_MARGIN;
+  t_min -= SHADOW_LEVEL_MARGIN;
+  t_max += SHADOW_LEVEL_MARGIN;
+
+  float width = SHADOW_CASCADE_WIDTH;
+  for (Cascade& cascade : cascades) {
+    cascade.valid = false;
+    cascade.step = width / SHADOW_CASCADE_STEPS;
+    cascade.window.width = width;
+    cascade.window.height = std::min(width, t_max - t_min);
+    width *= SHADOW_CASCADE_SCALE;
+  }
+  dynamic_window.width = SHADOW_DYNAMIC_WIDTH;
+  dynamic_window.height = std::min(SHADOW_DYNAMIC_WIDTH, t_max - t_min);
+  dynamic_valid = false;
+  level_root = root;
+}
+
+// Where a window of height wants to start in t, centered on the player
+// unless that would leave the level
+float WindowT(float t, float height) {
+  return std::max(t_min, std::min(t - height * 0.5f, t_max - height));
+}
+
+bool CastsStaticShadow(SecondaryType type) {
+  return type == SecondaryType::PLATFORM ||
+         type == SecondaryType::MOONROCK || type == SecondaryType::PLAINROCK;
+}
+
+bool CastsDynamicShadow(SecondaryType type) {
+  return GameObject::Moves(type) ||
+         type == SecondaryType::DROPPING_PLATFORM_UP ||
+         type == SecondaryType::DROPPING_PLATFORM_DOWN;
+}
+
+void Submit(std::shared_ptr<Program> program,
+            std::shared_ptr<PhysicalObject> object) {
+  shadow_queue.Submit(RenderQueue::Pass::OPAQUE, program, nullptr, nullptr,
+                      object->GetModel(), object->GetTransform());
+}
+
+// Light space box from s_min to s_max across window, as a projection
+glm::mat4 WindowProjection(float s_min, float s_max, const Window& window) {
+  return glm::ortho(s_min, s_max, window.t, window.t + window.height,
+                    depth_near, depth_far);
+}
+
+// Clears the viewport, then draws what was submitted into it
+void DrawQueue(GLuint framebuffer, int x, int width, int height) {
+  GLState::BindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+  GLState::Viewport(x, 0, width, height);
+  glScissor(x, 0, width, height);
+  glClear(GL_DEPTH_BUFFER_BIT);
+  shadow_queue.Sort();
+  shadow_queue.Execute();
+}
+
+// Draws the static objects in steps [first_step, first_step + count) of
+// cascade, which lie in consecutive columns of its map
+void DrawStrip(std::shared_ptr<Level> level,
+               std::shared_ptr<Program> program,
+               int index,
+               long first_step,
+               long count) {
+  PROFILE_SCOPE("ShadowMaps::DrawStrip");
+  const Cascade& cascade = cascades[index];
+  glm::mat4 P = WindowProjection(first_step * cascade.step,
+                                 (first_step + count) * cascade.step,
+                                 cascade.window);
+  // The Octree, even with GPU culling on, since a GpuCulling::Cull() now
+  // would replace the scene's
+  std::unordered_set<std::shared_ptr<GameObject>>* objects =
+      GameRenderer::GetObjectsInView(
+          ViewFrustumCulling::GetFrustum(P, light_view), level->getTree(),
+          SHADOW_CULLING_VIEW);
+  shadow_queue.Begin(P, light_view, depth_far);
+  for (const std::shared_ptr<GameObject>& object : *objects) {
+    if (CastsStaticShadow(object->GetSecondaryType())) {
+      Submit(program, object);
+      stats.static_casters++;
+    }
+  }
+  delete objects;
+
+  int strip_texels = allocated_resolution / SHADOW_CASCADE_STEPS;
+  long column = (first_step % SHADOW_CASCADE_STEPS + SHADOW_CASCADE_STEPS) %
+                SHADOW_CASCADE_STEPS;
+  DrawQueue(cascade_framebuffers[index], column * strip_texels,
+            count * strip_texels, allocated_resolution);
+  stats.strips++;
+}
+
+// Draws steps [first_step, last_step) of cascade, splitting them where the
+// map wraps around
+void DrawSteps(std::shared_ptr<Level> level,
+               std::shared_ptr<Program> program,
+               int index,
+               long first_step,
+               long last_step) {
+  while (first_step < last_step) {
+    long column = (first_step % SHADOW_CASCADE_STEPS + SHADOW_CASCADE_STEPS) %
+                  SHADOW_CASCADE_STEPS;
+    long count =
+        std::min(last_step - first_step, SHADOW_CASCADE_STEPS - column);
+    DrawStrip(level, program, index, first_step, count);
+    first_step += count;
+  }
+}
+
+// Moves cascade's window to the player at s, t, drawing what it uncovers.
+// False if it was already there.
+bool UpdateCascade(std::shared_ptr<Level> level,
+                   std::shared_ptr<Program> program,
+                   int index,
+                   float s,
+                   float t) {
+  Cascade& cascade = cascades[index];
+  long target = (long)std::floor(
+      (s - cascade.window.width * SHADOW_WINDOW_BEHIND) / cascade.step);
+  float window_t = WindowT(t, cascade.window.height);
+  bool recenter = std::abs(window_t - cascade.window.t) >
+                  cascade.window.height * SHADOW_RECENTER;
+  if (!cascade.valid || recenter ||
+      std::abs(target - cascade.first_step) >= SHADOW_CASCADE_STEPS) {
+    cascade.valid = true;
+    cascade.first_step = target;
+    cascade.window.s = target * cascade.step;
+    cascade.window.t = window_t;
+    DrawSteps(level, program, index, target, target + SHADOW_CASCADE_STEPS);
+    return true;
+  }
+  if (target == cascade.first_step) {
+    return false;
+  }
+  // the columns the window left behind take the steps it moved into
+  long first_step = std::min(target, cascade.first_step);
+  long last_step = std::max(target, cascade.first_step);
+  if (target > cascade.first_step) {
+    first_step += SHADOW_CASCADE_STEPS;
+    last_step += SHADOW_CASCADE_STEPS;
+  }
+  cascade.first_step = target;
+  cascade.window.s = target * cascade.step;
+  DrawSteps(level, program, index, first_step, last_step);
+  return true;
+}
+
+// Draws what moves near the player into the dynamic map, snapped to its
+// texels so the edges of shadows don't crawl
+void DrawDynamic(std::shared_ptr<GameState> game_state,
+                 std::shared_ptr<Program> program,
+                 float s,
+                 float t) {
+  PROFILE_SCOPE("ShadowMaps::DrawDynamic");
+  float texel_s = dynamic_window.width / allocated_dynamic_resolution;
+  float texel_t = dynamic_window.height / allocated_dynamic_resolution;
+  dynamic_window.s = std::floor((s - dynamic_window.width *
+                                         SHADOW_WINDOW_BEHIND) /
+                                texel_s) *
+                     texel_s;
+  dynamic_window.t =
+      std::floor(WindowT(t, dynamic_window.height) / texel_t) * texel_t;
+  glm::mat4 P = WindowProjection(
+      dynamic_window.s, dynamic_window.s + dynamic_window.width,
+      dynamic_window);
+  ViewFrustumCulling::Frustum frustum =
+      ViewFrustumCulling::GetFrustum(P, light_view);
+
+  shadow_queue.Begin(P, light_view, depth_far);
+  std::queue<std::shared_ptr<PhysicalObject>> player_tree;
+  player_tree.push(game_state->GetPlayer());
+  while (!player_tree.empty()) {
+    std::shared_ptr<PhysicalObject> object = player_tree.front();
+    player_tree.pop();
+    Submit(program, object);
+    for (std::shared_ptr<PhysicalObject> sub_object :
+         object->GetSubObjects()) {
+      player_tree.push(sub_object);
+    }
+  }
+  for (const std::shared_ptr<GameObject>& object :
+       *game_state->GetObjectsInView()) {
+    if (CastsDynamicShadow(object->GetSecondaryType()) &&
+        !ViewFrustumCulling::IsCulled(object->GetBoundingBox(), frustum)) {
+      Submit(program, object);
+      stats.dynamic_casters++;
+    }
+  }
+  DrawQueue(dynamic_framebuffer, 0, allocated_dynamic_resolution,
+            allocated_dynamic_resolution);
+  dynamic_valid = true;
+  stats.dynamic_maps++;
+}
+
+glm::vec4 WindowUniform(const Window& window) {
+  return glm::vec4(window.s, window.t, window.width, window.height);
+}
+
+}  // namespace
+
+void Render(std::shared_ptr<GameState> game_state,
+            std::shared_ptr<Program> program) {
+  PROFILE_SCOPE("ShadowMaps::Render");
+  const Budget& budget = GetBudget();
+  active_cascades = 0;
+  if (!budget.cascades) {
+    return;
+  }
+  GPU_PASS("shadows");
+  uint64_t draw_calls = RenderStats::current.draw_calls;
+  if (budget.resolution != allocated_resolution ||
+      budget.cascades != allocated_cascades ||
+      budget.dynamic_resolution != allocated_dynamic_resolution) {
+    AllocateMaps(budget);
+  }
+  std::shared_ptr<Level> level = game_state->GetLevel();
+  if (level->getTree()->GetRoot() != level_root) {
+    FitLevel(level->getTree()->GetRoot());
+    shadow_queue.Forget();
+  }
+  glm::vec3 position = game_state->GetPlayer()->GetPosition();
+  float s = glm::dot(position, s_axis);
+  float t = glm::dot(position, t_axis);
+
+  GLState::DepthMask(GL_TRUE);
+  glEnable(GL_SCISSOR_TEST);
+  // casters between the light and the level's box still cast
+  glEnable(GL_DEPTH_CLAMP);
+  glEnable(GL_POLYGON_OFFSET_FILL);
+  glPolygonOffset(SHADOW_SLOPE_BIAS, SHADOW_CONSTANT_BIAS);
+
+  // finest first, so when the budget runs out it's the coarse cascades that
+  // wait a frame
+  int updates = 0;
+  for (int i = 0; i < budget.cascades && updates < budget.strips_per_frame;
+       i++) {
+    updates += UpdateCascade(level, program, i, s, t);
+  }
+  frames_since_dynamic++;
+  if (!dynamic_valid || frames_since_dynamic >= budget.dynamic_interval) {
+    DrawDynamic(game_state, program, s, t);
+    frames_since_dynamic = 0;
+  }
+
+  glDisable(GL_POLYGON_OFFSET_FILL);
+  glDisable(GL_DEPTH_CLAMP);
+  glDisable(GL_SCISSOR_TEST);
+  GLState::BindFramebuffer(GL_FRAMEBUFFER, 0);
+  stats.draw_calls += RenderStats::current.draw_calls - draw_calls;
+  active_cascades = budget.cascades;
+}
+
+void Apply(const Program& program) {
+  if (program.getUniform(Uniform::shadowCascades) < 0) {
+    return;
+  }
+  // set even when off, since samplers of different types can't share a unit
+  program.setUniform(Uniform::shadowCascades, SHADOW_CASCADE_UNIT);
+  program.setUniform(Uniform::shadowDynamic, SHADOW_DYNAMIC_UNIT);
+  program.setUniform(Uniform::shadowCascadeCount, active_cascades);
+  if (!active_cascades) {
+    return;
+  }
+  GLState::ActiveTexture(GL_TEXTURE0 + SHADOW_CASCADE_UNIT);
+  GLState::BindTexture(GL_TEXTURE_2D_ARRAY, cascade_texture);
+  GLState::ActiveTexture(GL_TEXTURE0 + SHADOW_DYNAMIC_UNIT);
+  GLState::BindTexture(GL_TEXTURE_2D, dynamic_texture);
+
+  glm::vec4 windows[SHADOW_MAX_CASCADES];
+  for (int i = 0; i < active_cascades; i++) {
+    windows[i] = cascades[i].valid ? WindowUniform(cascades[i].window)
+                                   : NO_WINDOW;
+  }
+  glUniform4fv(program.getUniform(Uniform::shadowWindows), active_cascades,
+               &windows[0][0]);
+  program.setUniform(Uniform::shadowDynamicWindow,
+                     dynamic_valid ? WindowUniform(dynamic_window)
+                                   : NO_WINDOW);
+  program.setUniform(Uniform::shadowView, light_view);
+  program.setUniform(Uniform::shadowDepth,
+                     glm::vec2(depth_near, depth_far));
+}
+
+void Invalidate() {
+  level_root = nullptr;
+}
+
+void SetQuality(ShadowQuality new_quality) {
+  quality = new_quality;
+}
+
+ShadowQuality GetQuality() {
+  return quality;
+}
+
+const Budget& GetBudget() {
+  return BUDGETS[(int)quality];
+}
+
+const Stats& GetStats() {
+  return stats;
+}
+
+void ResetStats() {
+  stats = Stats();
+}
+
+}  // namespace ShadowMaps
@@ -0,0 +1,71 @@
+#ifndef SHADOW_MAPS_H_
+#define SHADOW_MAPS_H_
+
+#include <cstdint>
+#include <memory>
+
+#include "GameState.h"
+#include "Program.h"
+
+#define SHADOW_MAX_CASCADES 3
+
+// What shadows may cost. Every tier draws the cascades at resolution by
+// resolution, and the cascades only ever draw the strip the player just
+// uncovered, up to strips_per_frame of them a frame.
+enum class ShadowQuality { OFF, LOW, MEDIUM, HIGH };
+
+// Shadows of the directional light the lit shaders hardcode. Light space
+// runs s along the level, which is world X seen from the light, and t across
+// it.
+//
+// Static geometry goes into SHADOW_MAX_CASCADES depth maps, each wider than
+// the last and all following the player along s. A cascade's window moves in
+// steps of a sixteenth of its width, and the map wraps around in s, so the
+// columns the window just left are the ones it needs for the strip it just
+// uncovered. Only that strip is drawn, which is a handful of objects, so the
+// cascades cost a few draws every few frames instead of the whole scene again
+// every frame.
+//
+// Whatever moves (the player, monsters, moving and dropping platforms) goes
+// into one more map around the player, drawn from the objects in view.
+namespace ShadowMaps {
+
+struct Budget {
+  // texels each way of a cascade
+  int resolution;
+  int cascades;
+  int dynamic_resolution;
+  int strips_per_frame;
+  // redraw the dynamic map every frames frames
+  int dynamic_interval;
+};
+
+// Totals since the last ResetStats()
+struct Stats {
+  uint64_t strips;
+  uint64_t static_casters;
+  uint64_t dynamic_maps;
+  uint64_t dynamic_casters;
+  uint64_t draw_calls;
+};
+
+// Brings the maps up to date for the player's position, before the scene
+// culled for the objects in view is drawn. program is shadowmap_prog.
+void Render(std::shared_ptr<GameState> game_state,
+            std::shared_ptr<Program> program);
+// Sets the shadow uniforms and binds the maps for program, which must be
+// bound. Programs that don't receive shadows are left alone.
+void Apply(const Program& program);
+// Draws the cascades again from scratch, for when the level changes in place
+void Invalidate();
+
+void SetQuality(ShadowQuality quality);
+ShadowQuality GetQuality();
+const Budget& GetBudget();
+
+const Stats& GetStats();
+void ResetStats();
+
+}  // namespace ShadowMaps
+
+#endif
@@ -3,19 +3,61 @@
 #include <iostream>
 
 #include "GLSL.h"
+#include "GLState.h"
+#include "MeshCache.h"
+#include "MeshSimplifier.h"
 #include "Program.h"
+#include "RenderStats.h"
+#include "VertexCache.h"
 #include "math.h"
 
 #define TINYOBJLOADER_IMPLEMENTATION
 #include "tiny_obj_loader.h"
 #define EPSILON_SHAPE 0.001;
+#include <algorithm>
 #include <cmath>
 
-Shape::Shape() : eleBufID(0), posBufID(0), norBufID(0), texBufID(0), vaoID(0) {}
+namespace {
+
+// Moves each vertex's components of buffer to the vertex's place in order
+void Reorder(std::vector<float>& buffer,
+             int components,
+             const std::vector<unsigned int>& order) {
+  if (buffer.size() != order.size() * components) {
+    return;  // the mesh doesn't have them
+  }
+  std::vector<float> reordered(buffer.size());
+  for (size_t v = 0; v < order.size(); v++) {
+    std::copy(&buffer[v * components], &buffer[v * components] + components,
+              &reordered[order[v] * components]);
+  }
+  buffer.swap(reordered);
+}
+
+}  // namespace
+
+Shape::Shape()
+    : eleBufs(1),
+      boundsMin{0, 0, 0},
+      boundsMax{0, 0, 0},
+      eleBufID(0),
+      vboID(0),
+      vaoID(0) {}
 
 Shape::~Shape() {}
 
 void Shape::loadMesh(const std::string& meshName) {
+  MeshCache::Mesh mesh;
+  if (MeshCache::Read(meshName, mesh)) {
+    posBuf.swap(mesh.positions);
+    norBuf.swap(mesh.normals);
+    texBuf.swap(mesh.texcoords);
+    eleBufs.swap(mesh.elements);
+    std::copy(mesh.min, mesh.min + 3, boundsMin);
+    std::copy(mesh.max, mesh.max + 3, boundsMax);
+    return;
+  }
+
   // Load geometry
   // Some obj files contain material information.
   // We'll ignore them for this assignment.
@@ -29,8 +71,68 @@ void Shape::loadMesh(const std::string& meshName) {
     posBuf = shapes[0].mesh.positions;
     norBuf = shapes[0].mesh.normals;
     texBuf = shapes[0].mesh.texcoords;
-    eleBuf = shapes[0].mesh.indices;
+    eleBufs.assign(1, shapes[0].mesh.indices);
     Normalize();
+    BuildLods();
+    OptimizeVertexCache();
+    ComputeBounds();
+    if (MeshCache::GetEnabled()) {
+      mesh.positions = posBuf;
+      mesh.normals = norBuf;
+      mesh.texcoords = texBuf;
+      mesh.elements = eleBufs;
+      std::copy(boundsMin, boundsMin + 3, mesh.min);
+      std::copy(boundsMax, boundsMax + 3, mesh.max);
+      MeshCache::Write(meshName, mesh);
+    }
+  }
+}
+
+void Shape::BuildLods() {
+  size_t triangles = eleBufs[0].size() / 3;
+  if (triangles < SHAPE_LOD_MIN_TRIANGLES) {
+    return;
+  }
+  for (int lod = 1; lod < SHAPE_LOD_LEVELS; lod++) {
+    size_t target = triangles * std::pow(SHAPE_LOD_RATIO, lod);
+    // from the full mesh each time, so errors don't compound
+    std::vector<unsigned int> elements =
+        MeshSimplifier::Simplify(posBuf, eleBufs[0], target);
+    // a level that barely simplifies isn't worth switching to
+    size_t last_size = eleBufs.back().size();
+    if (elements.size() > last_size * (1.0f + SHAPE_LOD_RATIO) / 2) {
+      break;
+    }
+    eleBufs.push_back(elements);
+  }
+}
+
+// Every level's triangles go in the order the cache likes, then the vertices
+// in the order the full mesh first uses them
+void Shape::OptimizeVertexCache() {
+  size_t vertex_count = posBuf.size() / 3;
+  for (std::vector<unsigned int>& elements : eleBufs) {
+    elements = VertexCache::Optimize(elements, vertex_count);
+  }
+  std::vector<unsigned int> order =
+      VertexCache::FetchOrder(eleBufs[0], vertex_count);
+  Reorder(posBuf, 3, order);
+  Reorder(norBuf, 3, order);
+  Reorder(texBuf, 2, order);
+  for (std::vector<unsigned int>& elements : eleBufs) {
+    for (unsigned int& element : elements) {
+      element = order[element];
+    }
+  }
+}
+
+void Shape::ComputeBounds() {
+  for (size_t v = 0; v < posBuf.size() / 3; v++) {
+    for (int i = 0; i < 3; i++) {
+      float position = posBuf[3 * v + i];
+      boundsMin[i] = v == 0 ? position : std::min(boundsMin[i], position);
+      boundsMax[i] = v == 0 ? position : std::max(boundsMax[i], position);
+    }
   }
 }
 
@@ -109,95 +211,101 @@ void Shape::Normalize() {
 }
 
 void Shape::init() {
+  // Interleave each vertex's position, normal and texcoord into one buffer,
+  // leaving out whichever of the last two the mesh doesn't have
+  bool has_normals = !norBuf.empty();
+  bool has_texcoords = !texBuf.empty();
+  size_t vertex_count = posBuf.size() / 3;
+  int floats_per_vertex = 3 + (has_normals ? 3 : 0) + (has_texcoords ? 2 : 0);
+  std::vector<float> vertices;
+  vertices.reserve(vertex_count * floats_per_vertex);
+  for (size_t v = 0; v < vertex_count; v++) {
+    vertices.insert(vertices.end(), &posBuf[3 * v], &posBuf[3 * v] + 3);
+    if (has_normals) {
+      vertices.insert(vertices.end(), &norBuf[3 * v], &norBuf[3 * v] + 3);
+    }
+    if (has_texcoords) {
+      vertices.insert(vertices.end(), &texBuf[2 * v], &texBuf[2 * v] + 2);
+    }
+  }
+
   // Initialize the vertex array object
   glGenVertexArrays(1, &vaoID);
-  glBindVertexArray(vaoID);
+  GLState::BindVertexArray(vaoID);
 
-  // Send the position array to the GPU
-  glGenBuffers(1, &posBufID);
-  glBindBuffer(GL_ARRAY_BUFFER, posBufID);
-  glBufferData(GL_ARRAY_BUFFER, posBuf.size() * sizeof(float), &posBuf[0],
+  // Send the vertices to the GPU
+  glGenBuffers(1, &vboID);
+  GLState::BindBuffer(GL_ARRAY_BUFFER, vboID);
+  glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), &vertices[0],
                GL_STATIC_DRAW);
 
-  // Send the normal array to the GPU
-  if (norBuf.empty()) {
-    norBufID = 0;
-  } else {
-    glGenBuffers(1, &norBufID);
-    glBindBuffer(GL_ARRAY_BUFFER, norBufID);
-    glBufferData(GL_ARRAY_BUFFER, norBuf.size() * sizeof(float), &norBuf[0],
-                 GL_STATIC_DRAW);
+  // Bake the layout into the vao at the locations every program shares
+  GLsizei stride = floats_per_vertex * sizeof(float);
+  size_t offset = 0;
+  GLState::EnableVertexAttribArray(AttributeLocation(Attribute::vertPos));
+  GLState::VertexAttribPointer(AttributeLocation(Attribute::vertPos), 3,
+                               GL_FLOAT, GL_FALSE, stride, (const void*)offset);
+  offset += 3 * sizeof(float);
+  if (has_normals) {
+    GLState::EnableVertexAttribArray(AttributeLocation(Attribute::vertNor));
+    GLState::VertexAttribPointer(AttributeLocation(Attribute::vertNor), 3,
+                                 GL_FLOAT, GL_FALSE, stride,
+                                 (const void*)offset);
+    offset += 3 * sizeof(float);
   }
-
-  // Send the texture array to the GPU
-  if (texBuf.empty()) {
-    texBufID = 0;
-  } else {
-    glGenBuffers(1, &texBufID);
-    glBindBuffer(GL_ARRAY_BUFFER, texBufID);
-    glBufferData(GL_ARRAY_BUFFER, texBuf.size() * sizeof(float), &texBuf[0],
-                 GL_STATIC_DRAW);
+  if (has_texcoords) {
+    GLState::EnableVertexAttribArray(AttributeLocation(Attribute::vertTex));
+    GLState::VertexAttribPointer(AttributeLocation(Attribute::vertTex), 2,
+                                 GL_FLOAT, GL_FALSE, stride,
+                                 (const void*)offset);
   }
 
-  // Send the element array to the GPU
+  // Send every level's elements to the GPU one after the other, they stay
+  // bound to the vao
+  std::vector<unsigned int> elements;
+  eleOffsets.clear();
+  for (const std::vector<unsigned int>& lod_elements : eleBufs) {
+    eleOffsets.push_back(elements.size());
+    elements.insert(elements.end(), lod_elements.begin(), lod_elements.end());
+  }
   glGenBuffers(1, &eleBufID);
-  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, eleBufID);
-  glBufferData(GL_ELEMENT_ARRAY_BUFFER, eleBuf.size() * sizeof(unsigned int),
-               &eleBuf[0], GL_STATIC_DRAW);
+  GLState::BindBuffer(GL_ELEMENT_ARRAY_BUFFER, eleBufID);
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER, elements.size() * sizeof(unsigned int),
+               &elements[0], GL_STATIC_DRAW);
 
-  // Unbind the arrays
-  glBindBuffer(GL_ARRAY_BUFFER, 0);
-  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+  // Unbind the vao before the array buffer so the vao keeps its bindings
+  GLState::BindVertexArray(0);
+  GLState::BindBuffer(GL_ARRAY_BUFFER, 0);
 
   assert(glGetError() == GL_NO_ERROR);
 }
 
-void Shape::draw(const std::shared_ptr<Program> prog) const {
-  int h_pos, h_nor, h_tex;
-  h_pos = h_nor = h_tex = -1;
-
-  glBindVertexArray(vaoID);
-  // Bind position buffer
-  h_pos = prog->getAttribute("vertPos");
-  GLSL::enableVertexAttribArray(h_pos);
-  glBindBuffer(GL_ARRAY_BUFFER, posBufID);
-  glVertexAttribPointer(h_pos, 3, GL_FLOAT, GL_FALSE, 0, (const void*)0);
-
-  // Bind normal buffer
-  h_nor = prog->getAttribute("vertNor");
-  if (h_nor != -1 && norBufID != 0) {
-    GLSL::enableVertexAttribArray(h_nor);
-    glBindBuffer(GL_ARRAY_BUFFER, norBufID);
-    glVertexAttribPointer(h_nor, 3, GL_FLOAT, GL_FALSE, 0, (const void*)0);
-  }
-
-  if (texBufID != 0) {
-    // Bind texcoords buffer
-    h_tex = prog->getAttribute("vertTex");
-    if (h_tex != -1 && texBufID != 0) {
-      GLSL::enableVertexAttribArray(h_tex);
-      glBindBuffer(GL_ARRAY_BUFFER, texBufID);
-      glVertexAttribPointer(h_tex, 2, GL_FLOAT, GL_FALSE, 0, (const void*)0);
-    }
-  }
-
-  // Bind element buffer
-  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, eleBufID);
-
-  // Draw
-  glDrawElements(GL_TRIANGLES, (int)eleBuf.size(), GL_UNSIGNED_INT,
-                 (const void*)0);
+// The vao has everything the draw needs, for any program since they all use
+// the same attribute locations
+void Shape::draw(int lod) const {
+  GLState::BindVertexArray(vaoID);
+  glDrawElements(GL_TRIANGLES, (int)eleBufs[lod].size(), GL_UNSIGNED_INT,
+                 (const void*)(eleOffsets[lod] * sizeof(unsigned int)));
+  RenderStats::DrawCalls(1);
+  RenderStats::Triangles(eleBufs[lod].size() / 3);
+}
 
-  // Disable and unbind
-  if (h_tex != -1) {
-    GLSL::disableVertexAttribArray(h_tex);
+size_t Shape::GetBytes() const {
+  size_t bytes =
+      (posBuf.size() + norBuf.size() + texBuf.size()) * sizeof(float);
+  for (const std::vector<unsigned int>& elements : eleBufs) {
+    bytes += elements.size() * sizeof(unsigned int);
   }
-  if (h_nor != -1) {
-    GLSL::disableVertexAttribArray(h_nor);
+  return bytes;
+}
+
+bool Shape::GetBounds(float min[3], float max[3]) const {
+  if (posBuf.empty()) {
+    return false;
   }
-  GLSL::disableVertexAttribArray(h_pos);
-  glBindBuffer(GL_ARRAY_BUFFER, 0);
-  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+  std::copy(boundsMin, boundsMin + 3, min);
+  std::copy(boundsMax, boundsMax + 3, max);
+  return true;
 }
 
 std::vector<float> Shape::GetPositions() {
@@ -6,30 +6,57 @@
 #include <vector>
 #include <memory>
 
+// Meshes with fewer triangles draw at full detail everywhere
+#define SHAPE_LOD_MIN_TRIANGLES 128
+#define SHAPE_LOD_LEVELS 3
+// each level aims for this fraction of the full mesh's triangles, to the
+// power of the level
+#define SHAPE_LOD_RATIO 0.4f
+
 class Program;
 
+// A mesh, and up to SHAPE_LOD_LEVELS - 1 simplified versions of it that index
+// the same vertices, made by MeshSimplifier when it's loaded. Every level is
+// ordered for the vertex cache, and the result is kept in MeshCache so it's
+// only worked out the first time.
 class Shape {
  public:
   Shape();
   virtual ~Shape();
   void loadMesh(const std::string& meshName);
   void init();
-  void draw(const std::shared_ptr<Program> prog) const;
+  void draw(int lod = 0) const;
 
   std::vector<float> GetPositions();
+  const std::vector<float>& GetNormals() const { return norBuf; }
+  const std::vector<float>& GetTexCoords() const { return texBuf; }
+  const std::vector<unsigned int>& GetElements(int lod = 0) const {
+    return eleBufs[lod];
+  }
+  int GetLodCount() const { return eleBufs.size(); }
+  // of the vertices and every level's elements
+  size_t GetBytes() const;
+  // The box around the positions, false if there are none
+  bool GetBounds(float min[3], float max[3]) const;
 
  private:
   void Normalize();
   void ComputeTex();
+  void BuildLods();
+  void OptimizeVertexCache();
+  void ComputeBounds();
 
-  std::vector<unsigned int> eleBuf;
+  // one per level of detail, full detail first
+  std::vector<std::vector<unsigned int>> eleBufs;
+  // where each level starts in the element buffer
+  std::vector<size_t> eleOffsets;
   std::vector<float> posBuf;
   std::vector<float> norBuf;
   std::vector<float> texBuf;
+  float boundsMin[3];
+  float boundsMax[3];
   unsigned eleBufID;
-  unsigned posBufID;
-  unsigned norBufID;
-  unsigned texBufID;
+  unsigned vboID;  // interleaved positions, normals and texcoords
   unsigned vaoID;
 };
 
@@ -2,30 +2,68 @@
 
 #include <map>
 
+#include "AssetLoader.h"
+#include "FileSystemUtils.h"
+#include "MeshBuffer.h"
 #include "ShapeManager.h"
 
+namespace {
+struct LoadingShape {
+  std::shared_ptr<Shape> shape;
+  std::shared_ptr<AssetLoader::Job> job;
+  // added to MeshBuffer, and given to GL if it's up
+  bool uploaded;
+};
+}
+
 static bool opengl_initialized = false;
-static std::map<std::string, std::shared_ptr<Shape>> path_to_shape;
+static std::map<std::string, LoadingShape> path_to_shape;
 
-std::shared_ptr<Shape> ShapeManager::GetShape(const std::string& path) {
+static LoadingShape& Load(const std::string& path) {
   auto iterator = path_to_shape.find(path);
   if (iterator != path_to_shape.end()) {
     return iterator->second;
   }
 
+  LoadingShape& loading = path_to_shape[path];
   std::shared_ptr<Shape> shape = std::make_shared<Shape>();
-  shape->loadMesh(std::string(ASSET_DIR "/") + path);
-  if (opengl_initialized) {
-    shape->init();
-  }
+  std::string full_path = std::string(ASSET_DIR "/") + path;
+  // map entries stay put, so the upload can flag this one
+  bool* uploaded = &loading.uploaded;
+  loading.shape = shape;
+  loading.uploaded = false;
+  loading.job = AssetLoader::Load(
+      [shape, full_path]() { shape->loadMesh(full_path); },
+      [shape, uploaded]() {
+        MeshBuffer::Add(shape);
+        if (opengl_initialized) {
+          shape->init();
+        }
+        *uploaded = true;
+        return shape->GetBytes();
+      });
+  return loading;
+}
 
-  path_to_shape[path] = shape;
-  return shape;
+std::shared_ptr<Shape> ShapeManager::GetShape(const std::string& path) {
+  LoadingShape& loading = Load(path);
+  AssetLoader::Wait(loading.job);
+  return loading.shape;
+}
+
+void ShapeManager::Preload() {
+  std::string asset_dir(ASSET_DIR "/");
+  for (const std::string& file :
+       FileSystemUtils::ListFiles(ASSET_DIR "/models", "*.obj")) {
+    Load(file.substr(asset_dir.size()));
+  }
 }
 
 void ShapeManager::InitGL() {
   opengl_initialized = true;
   for (auto& iterator : path_to_shape) {
-    iterator.second->init();
+    if (iterator.second.uploaded) {
+      iterator.second.shape->init();
+    }
   }
 }
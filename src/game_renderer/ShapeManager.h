@@ -6,7 +6,11 @@
 #include "Shape.h"
 
 namespace ShapeManager {
+// Blocks until the mesh has loaded, since collisions need its vertices
 std::shared_ptr<Shape> GetShape(const std::string& model_path);
+// Starts loading every model in assets/models through AssetLoader, so
+// GetShape() rarely has to wait
+void Preload();
 void InitGL();
 }
 
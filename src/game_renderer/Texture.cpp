@@ -1,83 +1,173 @@
 #include "Texture.h"
+#include "AssetLoader.h"
 #include "GLSL.h"
+#include "GLState.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <iostream>
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
+#include "TextureCache.h"
 
 using namespace std;
 
+namespace {
+
+// uploads go through it so glTexImage2D can return before the copy is done
+GLuint staging_buffer = 0;
+GLuint placeholder = 0;
+
+// Mid grey, what a texture draws as until it's loaded
+GLuint Placeholder()
+{
+  if(!placeholder) {
+    const unsigned char grey[] = {128, 128, 128};
+    glGenTextures(1, &placeholder);
+    GLState::BindTexture(GL_TEXTURE_2D, placeholder);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, 1, 1, 0, GL_RGB, GL_UNSIGNED_BYTE,
+                 grey);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  }
+  return placeholder;
+}
+
+// BC1 keeps a quarter of what RGB8 takes once the driver pads it to RGBA8
+GLenum CookFormat()
+{
+  return GLEW_EXT_texture_compression_s3tc ? GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+                                           : GL_RGB8;
+}
+
+}
+
 Texture::Texture() :
   filename(""),
-  tid(0)
+  tid(0),
+  format(GL_RGB8),
+  wrapS(GL_CLAMP_TO_EDGE),
+  wrapT(GL_CLAMP_TO_EDGE)
 {
 
 }
 
 Texture::~Texture()
 {
-
+  // the decode writes into this texture
+  if(job) {
+    AssetLoader::Cancel(job);
+  }
 }
 
 void Texture::init()
 {
-  // Load texture
-  int w, h, ncomps;
-  stbi_set_flip_vertically_on_load(true);
-  unsigned char *data = stbi_load(filename.c_str(), &w, &h, &ncomps, 0);
-  if(!data) {
-    cerr << filename << " not found" << endl;
+  // the extensions can only be asked about here, with the context current
+  format = CookFormat();
+  job = AssetLoader::Load([this]() { decode(); },
+                          [this]() { return upload(); });
+}
+
+void Texture::initStreamed(int width, int height)
+{
+  glGenTextures(1, &tid);
+  GLState::BindTexture(GL_TEXTURE_2D, tid);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, width, height, 0, GL_RGB,
+               GL_UNSIGNED_BYTE, NULL);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, wrapS);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, wrapT);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  GLState::BindTexture(GL_TEXTURE_2D, 0);
+}
+
+// On a worker
+void Texture::decode()
+{
+  if(!TextureCache::Load(filename, format, image)) {
+    image.levels.clear();
   }
-  if(ncomps != 3) {
-    cerr << filename << " must have 3 components (RGB)" << endl;
+}
+
+size_t Texture::upload()
+{
+  if(image.levels.empty()) {
+    return 0;  // stays the placeholder
   }
-  if((w & (w - 1)) != 0 || (h & (h - 1)) != 0) {
-    cerr << filename << " must be a power of 2" << endl;
+  size_t bytes = image.data.size();
+  // Copy into a freshly orphaned staging buffer, the driver moves it into the
+  // texture on its own time rather than glTexImage2D copying it right away
+  if(!staging_buffer) {
+    glGenBuffers(1, &staging_buffer);
   }
-  width = w;
-  height = h;
+  GLState::BindBuffer(GL_PIXEL_UNPACK_BUFFER, staging_buffer);
+  glBufferData(GL_PIXEL_UNPACK_BUFFER, bytes, NULL, GL_STREAM_DRAW);
+  void *staging = glMapBufferRange(
+      GL_PIXEL_UNPACK_BUFFER, 0, bytes,
+      GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+  memcpy(staging, &image.data[0], bytes);
+  glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
 
   // Generate a texture buffer object
   glGenTextures(1, &tid);
   // Bind the current texture to be the newly generated texture object
-  glBindTexture(GL_TEXTURE_2D, tid);
-  // Load the actual texture data
-  // Base level is 0, number of channels is 3, and border is 0.
-  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
-  // Generate image pyramid
-  glGenerateMipmap(GL_TEXTURE_2D);
+  GLState::BindTexture(GL_TEXTURE_2D, tid);
+  // Load every level from its place in the staging buffer, they were all
+  // made when the texture was cooked. RGB8 rows aren't padded.
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  for(size_t i = 0; i < image.levels.size(); i++) {
+    const TextureCache::Level &level = image.levels[i];
+    const void *offset = (const void *)level.offset;
+    if(image.format == GL_RGB8) {
+      glTexImage2D(GL_TEXTURE_2D, i, GL_RGB8, level.width, level.height, 0,
+                   GL_RGB, GL_UNSIGNED_BYTE, offset);
+    } else {
+      glCompressedTexImage2D(GL_TEXTURE_2D, i, image.format, level.width,
+                             level.height, 0, level.size, offset);
+    }
+  }
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL,
+                  image.levels.size() - 1);
+  // Anything else passing pixels would read them from the staging buffer
+  GLState::BindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+  image = TextureCache::Image();
   // Set texture wrap modes for the S and T directions
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, wrapS);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, wrapT);
   // Set filtering mode for magnification and minimification
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
   // Unbind
-  glBindTexture(GL_TEXTURE_2D, 0);
-  // Free image, since the data is now on the GPU
-  stbi_image_free(data);
+  GLState::BindTexture(GL_TEXTURE_2D, 0);
+  return bytes;
 }
 
 void Texture::setWrapModes(GLint wrapS, GLint wrapT)
 {
-  // Must be called after init()
-  glBindTexture(GL_TEXTURE_2D, tid);
+  // Kept for upload() if the texture isn't loaded yet
+  this->wrapS = wrapS;
+  this->wrapT = wrapT;
+  if(!tid) {
+    return;
+  }
+  GLState::BindTexture(GL_TEXTURE_2D, tid);
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, wrapS);
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, wrapT);
 }
 
 void Texture::bind(GLint handle)
 {
-  glActiveTexture(GL_TEXTURE0 + unit);
-  glBindTexture(GL_TEXTURE_2D, tid);
+  GLState::ActiveTexture(GL_TEXTURE0 + unit);
+  GLState::BindTexture(GL_TEXTURE_2D, tid ? tid : Placeholder());
   glUniform1i(handle, unit);
 }
 
 void Texture::unbind()
 {
-  glActiveTexture(GL_TEXTURE0 + unit);
-  glBindTexture(GL_TEXTURE_2D, 0);
+  GLState::ActiveTexture(GL_TEXTURE0 + unit);
+  GLState::BindTexture(GL_TEXTURE_2D, 0);
 }
 
 std::string Texture::getName() {
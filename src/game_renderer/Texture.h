@@ -5,8 +5,15 @@
 #define GLEW_STATIC
 #include <GL/glew.h>
 
+#include <memory>
 #include <string>
 
+#include "TextureCache.h"
+
+namespace AssetLoader {
+struct Job;
+}
+
 class Texture
 {
 public:
@@ -14,21 +21,35 @@ public:
   virtual ~Texture();
   void setFilename(const std::string &f) { filename = f; }
   void setName(const std::string &f) {name = f; }
+  // Loads the image through AssetLoader, cooked by TextureCache, it binds as
+  // a grey placeholder until it's uploaded
   void init();
+  // Allocates width x height RGB8 without mipmaps instead of loading a file,
+  // for VideoTexture to stream frames into
+  void initStreamed(int width, int height);
   void setUnit(GLint u) { unit = u; }
   GLint getUnit() const { return unit; }
   void bind(GLint handle);
   void unbind();
-  void setWrapModes(GLint wrapS, GLint wrapT); // Must be called after init()
+  void setWrapModes(GLint wrapS, GLint wrapT);
   std::string getName();
+  GLuint getID() const { return tid; }
 	
 private:
+  void decode();
+  size_t upload();
+
   std::string filename;
-  int width;
-  int height;
   GLint unit;
   GLuint tid;
   std::string name;
+  GLint wrapS;
+  GLint wrapT;
+  // picked by init() for decode() to cook
+  GLenum format;
+  // between decode() and upload()
+  TextureCache::Image image;
+  std::shared_ptr<AssetLoader::Job> job;
 	
 };
 
@@ -0,0 +1,209 @@
+#include "TextureCache.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+
+#include "BlockCompression.h"
+#include "CacheFile.h"
+#include "stb_image.h"
+
+#define TEXTURE_CACHE_EXTENSION ".tex"
+#define TEXTURE_CACHE_MAGIC 0x58455452  // "RTEX"
+
+namespace TextureCache {
+
+namespace {
+
+bool enabled = true;
+
+struct Header {
+  CacheFile::Stamp stamp;
+  uint32_t format;
+  uint32_t width;
+  uint32_t height;
+  uint32_t level_count;
+  uint64_t level_sizes[TEXTURE_CACHE_MAX_LEVELS];
+};
+
+size_t LevelSize(GLenum format, int width, int height) {
+  if (format == GL_COMPRESSED_RGB_S3TC_DXT1_EXT) {
+    return BlockCompression::Bc1Size(width, height);
+  }
+  return (size_t)width * height * 3;
+}
+
+// The level below rgb, each pixel the average of the 2x2 above it. Odd
+// sizes repeat their last row or column.
+std::vector<unsigned char> Downsample(const std::vector<unsigned char>& rgb,
+                                      int width,
+                                      int height) {
+  int next_width = std::max(width / 2, 1);
+  int next_height = std::max(height / 2, 1);
+  std::vector<unsigned char> next((size_t)next_width * next_height * 3);
+  for (int y = 0; y < next_height; y++) {
+    int y0 = std::min(2 * y, height - 1), y1 = std::min(2 * y + 1, height - 1);
+    for (int x = 0; x < next_width; x++) {
+      int x0 = std::min(2 * x, width - 1), x1 = std::min(2 * x + 1, width - 1);
+      for (int c = 0; c < 3; c++) {
+        int sum = rgb[((size_t)y0 * width + x0) * 3 + c] +
+                  rgb[((size_t)y0 * width + x1) * 3 + c] +
+                  rgb[((size_t)y1 * width + x0) * 3 + c] +
+                  rgb[((size_t)y1 * width + x1) * 3 + c];
+        next[((size_t)y * next_width + x) * 3 + c] = (sum + 2) / 4;
+      }
+    }
+  }
+  return next;
+}
+
+// The levels image should have for a width by height texture in format
+void Layout(GLenum format, int width, int height, Image& image) {
+  image.format = format;
+  image.levels.clear();
+  size_t offset = 0;
+  while (true) {
+    Level level = {width, height, offset, LevelSize(format, width, height)};
+    image.levels.push_back(level);
+    offset += level.size;
+    if (width == 1 && height == 1) {
+      break;
+    }
+    width = std::max(width / 2, 1);
+    height = std::max(height / 2, 1);
+  }
+}
+
+}  // namespace
+
+bool IsSupported(GLenum format) {
+  return format == GL_RGB8 || format == GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+}
+
+bool Cook(const std::string& source_path, GLenum format, Image& image) {
+  if (!IsSupported(format)) {
+    return false;
+  }
+  int width, height, ncomps;
+  // asked for RGB, whatever the file has
+  unsigned char* decoded =
+      stbi_load(source_path.c_str(), &width, &height, &ncomps, 3);
+  if (!decoded) {
+    std::cerr << source_path << " not found" << std::endl;
+    return false;
+  }
+  if (ncomps != 3) {
+    std::cerr << source_path << " has " << ncomps
+              << " components, only RGB is kept" << std::endl;
+  }
+  // stb_image starts at the top row
+  size_t row = (size_t)width * 3;
+  std::vector<unsigned char> rgb(row * height);
+  for (int y = 0; y < height; y++) {
+    memcpy(&rgb[(height - 1 - y) * row], decoded + y * row, row);
+  }
+  stbi_image_free(decoded);
+
+  Layout(format, width, height, image);
+  image.data.resize(image.levels.back().offset + image.levels.back().size);
+  for (size_t i = 0; i < image.levels.size(); i++) {
+    const Level& level = image.levels[i];
+    if (i > 0) {
+      const Level& above = image.levels[i - 1];
+      rgb = Downsample(rgb, above.width, above.height);
+    }
+    if (format == GL_COMPRESSED_RGB_S3TC_DXT1_EXT) {
+      std::vector<unsigned char> blocks =
+          BlockCompression::CompressBc1(&rgb[0], level.width, level.height);
+      memcpy(&image.data[level.offset], &blocks[0], level.size);
+    } else {
+      memcpy(&image.data[level.offset], &rgb[0], level.size);
+    }
+  }
+  return true;
+}
+
+bool Load(const std::string& source_path, GLenum format, Image& image) {
+  if (Read(source_path, format, image)) {
+    return true;
+  }
+  if (!Cook(source_path, format, image)) {
+    return false;
+  }
+  Write(source_path, image);
+  return true;
+}
+
+bool Read(const std::string& source_path, GLenum format, Image& image) {
+  if (!enabled) {
+    return false;
+  }
+  std::string path = CacheFile::GetPath(source_path, TEXTURE_CACHE_EXTENSION);
+  std::unique_ptr<MappedFile> cache = CacheFile::Map(
+      path, TEXTURE_CACHE_MAGIC, TEXTURE_CACHE_VERSION, sizeof(Header));
+  if (!cache) {
+    return false;
+  }
+  Header header;
+  memcpy(&header, cache->GetData(), sizeof(Header));
+  if (header.format != format || header.width < 1 || header.height < 1 ||
+      header.level_count > TEXTURE_CACHE_MAX_LEVELS) {
+    return false;  // another format is cooked again over it
+  }
+  Layout(format, header.width, header.height, image);
+  if (image.levels.size() != header.level_count) {
+    return false;
+  }
+  for (size_t i = 0; i < image.levels.size(); i++) {
+    if (image.levels[i].size != header.level_sizes[i]) {
+      return false;
+    }
+  }
+  size_t data_size = image.levels.back().offset + image.levels.back().size;
+  if (cache->GetSize() != sizeof(Header) + data_size) {
+    return false;  // cut short
+  }
+  if (!CacheFile::IsCurrent(*cache, path, source_path)) {
+    return false;
+  }
+
+  const char* data = cache->GetData() + sizeof(Header);
+  image.data.assign(data, data + data_size);
+  return true;
+}
+
+bool Write(const std::string& source_path, const Image& image) {
+  if (!enabled || image.levels.empty() ||
+      image.levels.size() > TEXTURE_CACHE_MAX_LEVELS) {
+    return false;
+  }
+  Header header = {};
+  if (!CacheFile::MakeStamp(source_path, TEXTURE_CACHE_MAGIC,
+                            TEXTURE_CACHE_VERSION, header.stamp)) {
+    return false;
+  }
+  header.format = image.format;
+  header.width = image.levels[0].width;
+  header.height = image.levels[0].height;
+  header.level_count = image.levels.size();
+  for (size_t i = 0; i < image.levels.size(); i++) {
+    header.level_sizes[i] = image.levels[i].size;
+  }
+
+  CacheFile::Parts parts;
+  parts.push_back(std::make_pair(&header, sizeof(Header)));
+  parts.push_back(std::make_pair(image.data.data(), image.data.size()));
+  return CacheFile::Write(
+      CacheFile::GetPath(source_path, TEXTURE_CACHE_EXTENSION), parts);
+}
+
+void SetEnabled(bool new_enabled) {
+  enabled = new_enabled;
+}
+
+bool GetEnabled() {
+  return enabled;
+}
+
+}  // namespace TextureCache
@@ -0,0 +1,61 @@
+#ifndef TEXTURE_CACHE_H_
+#define TEXTURE_CACHE_H_
+
+#define GLEW_STATIC
+#include <GL/glew.h>
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Textures cooked the way the GPU keeps them: decoded, mipmapped down to 1x1
+// and compressed, saved as <name>.tex in the cache directory (see CacheFile.h)
+// so later runs upload them a level at a time instead of decoding and
+// compressing again.
+//
+// A cache is used when its format matches and the image's modification time
+// and size, or failing that its hash, match the ones it was cooked from.
+// Bump TEXTURE_CACHE_VERSION whenever the way textures are cooked changes.
+namespace TextureCache {
+
+#define TEXTURE_CACHE_VERSION 1
+// Enough levels for 32768x32768
+#define TEXTURE_CACHE_MAX_LEVELS 16
+
+struct Level {
+  int width;
+  int height;
+  // into Image::data
+  size_t offset;
+  size_t size;
+};
+
+struct Image {
+  // GL_COMPRESSED_RGB_S3TC_DXT1_EXT, or GL_RGB8 for RGB8 rows packed
+  // without padding
+  GLenum format;
+  // full size first, halving down to 1x1
+  std::vector<Level> levels;
+  std::vector<unsigned char> data;
+};
+
+// Whether a texture in format can be cooked
+bool IsSupported(GLenum format);
+
+// source_path decoded to RGB, bottom row first as GL wants it, then
+// mipmapped and compressed to format. False if it can't be decoded.
+bool Cook(const std::string& source_path, GLenum format, Image& image);
+// source_path cooked to format through the cache
+bool Load(const std::string& source_path, GLenum format, Image& image);
+
+// False when there's no cache for source_path in format or it's out of date
+bool Read(const std::string& source_path, GLenum format, Image& image);
+bool Write(const std::string& source_path, const Image& image);
+
+// Off, Read() finds nothing and Write() writes nothing
+void SetEnabled(bool enabled);
+bool GetEnabled();
+
+}  // namespace TextureCache
+
+#endif
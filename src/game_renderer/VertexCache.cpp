@@ -0,0 +1,181 @@
+#include "VertexCache.h"
+
+#include <algorithm>
+#include <cmath>
+
+// Forsyth's scoring constants
+#define LAST_TRIANGLE_SCORE 0.75f
+#define CACHE_DECAY_POWER 1.5f
+#define VALENCE_BOOST_SCALE 2.0f
+#define VALENCE_BOOST_POWER 0.5f
+
+namespace VertexCache {
+
+namespace {
+
+// A vertex's score at cache_position, -1 when it's not in the cache, with
+// remaining triangles still to go out
+float VertexScore(int cache_position, unsigned int remaining) {
+  if (remaining == 0) {
+    return -1.0f;  // nothing needs it any more
+  }
+  float score = 0.0f;
+  if (cache_position >= 0) {
+    if (cache_position < 3) {
+      // the last triangle's vertices score the same, whichever order they
+      // went in, so it isn't favoured to go out again
+      score = LAST_TRIANGLE_SCORE;
+    } else {
+      score = std::pow(1.0f - (cache_position - 3) /
+                                  (float)(VERTEX_CACHE_SIZE - 3),
+                       CACHE_DECAY_POWER);
+    }
+  }
+  // vertices with few triangles left go first, so none are left stranded
+  return score +
+         VALENCE_BOOST_SCALE * std::pow((float)remaining, -VALENCE_BOOST_POWER);
+}
+
+}  // namespace
+
+std::vector<unsigned int> Optimize(const std::vector<unsigned int>& elements,
+                                   size_t vertex_count) {
+  size_t triangle_count = elements.size() / 3;
+
+  // each vertex's triangles that haven't gone out, packed one vertex after
+  // another
+  std::vector<unsigned int> remaining(vertex_count, 0);
+  for (unsigned int element : elements) {
+    remaining[element]++;
+  }
+  std::vector<size_t> first_triangle(vertex_count + 1, 0);
+  for (size_t v = 0; v < vertex_count; v++) {
+    first_triangle[v + 1] = first_triangle[v] + remaining[v];
+  }
+  std::vector<unsigned int> vertex_triangles(elements.size());
+  std::vector<size_t> filled(first_triangle.begin(), first_triangle.end() - 1);
+  for (size_t t = 0; t < triangle_count; t++) {
+    for (int k = 0; k < 3; k++) {
+      vertex_triangles[filled[elements[3 * t + k]]++] = t;
+    }
+  }
+
+  std::vector<int> cache_position(vertex_count, -1);
+  std::vector<float> vertex_score(vertex_count);
+  for (size_t v = 0; v < vertex_count; v++) {
+    vertex_score[v] = VertexScore(-1, remaining[v]);
+  }
+  std::vector<float> triangle_score(triangle_count);
+  for (size_t t = 0; t < triangle_count; t++) {
+    triangle_score[t] = vertex_score[elements[3 * t]] +
+                        vertex_score[elements[3 * t + 1]] +
+                        vertex_score[elements[3 * t + 2]];
+  }
+  std::vector<bool> emitted(triangle_count, false);
+
+  std::vector<unsigned int> optimized;
+  optimized.reserve(triangle_count * 3);
+  std::vector<unsigned int> cache;
+  std::vector<unsigned int> next_cache;
+  cache.reserve(VERTEX_CACHE_SIZE + 3);
+  next_cache.reserve(VERTEX_CACHE_SIZE + 3);
+  // every triangle before it has gone out
+  size_t first_left = 0;
+  long best = -1;
+  while (optimized.size() < triangle_count * 3) {
+    if (best < 0) {
+      // Nothing in the cache has triangles left, so start somewhere new.
+      // Forsyth looks for the best score of all, taking the next one keeps
+      // it linear for nearly the same order.
+      while (emitted[first_left]) {
+        first_left++;
+      }
+      best = first_left;
+    }
+    emitted[best] = true;
+    const unsigned int* triangle = &elements[3 * best];
+    optimized.insert(optimized.end(), triangle, triangle + 3);
+
+    for (int k = 0; k < 3; k++) {
+      unsigned int v = triangle[k];
+      unsigned int* begin = &vertex_triangles[first_triangle[v]];
+      unsigned int* end = begin + remaining[v];
+      *std::find(begin, end, (unsigned int)best) = *(end - 1);
+      remaining[v]--;
+    }
+
+    // its vertices go to the front of the cache, pushing the oldest out
+    next_cache.assign(triangle, triangle + 3);
+    for (unsigned int v : cache) {
+      if (v != triangle[0] && v != triangle[1] && v != triangle[2]) {
+        next_cache.push_back(v);
+      }
+    }
+    for (size_t i = 0; i < next_cache.size(); i++) {
+      unsigned int v = next_cache[i];
+      cache_position[v] = i < VERTEX_CACHE_SIZE ? (int)i : -1;
+      vertex_score[v] = VertexScore(cache_position[v], remaining[v]);
+    }
+
+    // rescore the triangles of every vertex that moved, the best goes next
+    best = -1;
+    float best_score = -1.0f;
+    for (unsigned int v : next_cache) {
+      for (size_t i = first_triangle[v]; i < first_triangle[v] + remaining[v];
+           i++) {
+        unsigned int t = vertex_triangles[i];
+        triangle_score[t] = vertex_score[elements[3 * t]] +
+                            vertex_score[elements[3 * t + 1]] +
+                            vertex_score[elements[3 * t + 2]];
+        if (triangle_score[t] > best_score) {
+          best = t;
+          best_score = triangle_score[t];
+        }
+      }
+    }
+    if (next_cache.size() > VERTEX_CACHE_SIZE) {
+      next_cache.resize(VERTEX_CACHE_SIZE);
+    }
+    cache.swap(next_cache);
+  }
+  return optimized;
+}
+
+std::vector<unsigned int> FetchOrder(const std::vector<unsigned int>& elements,
+                                     size_t vertex_count) {
+  const unsigned int unused = vertex_count;
+  std::vector<unsigned int> order(vertex_count, unused);
+  unsigned int next = 0;
+  for (unsigned int element : elements) {
+    if (order[element] == unused) {
+      order[element] = next++;
+    }
+  }
+  for (unsigned int& index : order) {
+    if (index == unused) {
+      index = next++;
+    }
+  }
+  return order;
+}
+
+float Acmr(const std::vector<unsigned int>& elements,
+           size_t vertex_count,
+           int cache_size) {
+  if (elements.empty()) {
+    return 0.0f;
+  }
+  // the miss count when each vertex last went into the cache, it's still in
+  // it for the next cache_size misses
+  std::vector<long long> entered(vertex_count, -(long long)cache_size - 1);
+  long long misses = 0;
+  for (unsigned int element : elements) {
+    if (misses - entered[element] > cache_size) {
+      entered[element] = misses;
+      misses++;
+    }
+  }
+  return misses / (elements.size() / 3.0f);
+}
+
+}  // namespace VertexCache
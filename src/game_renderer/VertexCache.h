@@ -0,0 +1,36 @@
+#ifndef VERTEX_CACHE_H_
+#define VERTEX_CACHE_H_
+
+#include <cstddef>
+#include <vector>
+
+// Orders meshes for the GPU's post transform cache, which keeps the last few
+// vertices the vertex shader ran on so triangles that share them don't run
+// it again.
+//
+// Optimize() is Tom Forsyth's linear speed vertex cache optimisation. Each
+// vertex scores higher the more recently it went into a modelled cache and
+// the fewer triangles it has left, and the triangle whose vertices score
+// highest goes next.
+namespace VertexCache {
+
+// Cache size Optimize() models, and that the misses are reported against
+#define VERTEX_CACHE_SIZE 32
+
+// The triangles of elements reordered for the cache
+std::vector<unsigned int> Optimize(const std::vector<unsigned int>& elements,
+                                   size_t vertex_count);
+// Each vertex's new index, numbering vertices in the order elements first
+// use them, so fetches walk the vertex buffer forwards. Vertices elements
+// doesn't use go last.
+std::vector<unsigned int> FetchOrder(const std::vector<unsigned int>& elements,
+                                     size_t vertex_count);
+// Average vertex shader runs per triangle through a FIFO cache of
+// cache_size, from 0.5 at best to 3 at worst
+float Acmr(const std::vector<unsigned int>& elements,
+           size_t vertex_count,
+           int cache_size = VERTEX_CACHE_SIZE);
+
+}  // namespace VertexCache
+
+#endif
@@ -1,32 +1,260 @@
 #include "VideoTexture.h"
 #include "FileSystemUtils.h"
-#include "GameRenderer.h"
-#include <string>
+#include "GLState.h"
+#include "json.hpp"
+#include "stb_image.h"
+#include <string.h>
+#include <algorithm>
+#include <fstream>
 #include <iostream>
+#include <string>
 
-VideoTexture::VideoTexture() {}
+namespace {
 
-VideoTexture::~VideoTexture() {}
+// Decodes path into out, bottom row first, if it's width x height
+bool DecodeFrame(const std::string& path,
+                 int width,
+                 int height,
+                 unsigned char* out) {
+  int w, h, ncomps;
+  unsigned char* data = stbi_load(path.c_str(), &w, &h, &ncomps, 3);
+  if (!data) {
+    std::cerr << path << " not found" << std::endl;
+    return false;
+  }
+  bool fits = w == width && h == height;
+  if (fits) {
+    size_t row = (size_t)width * 3;
+    for (int y = 0; y < height; y++) {
+      memcpy(out + (height - 1 - y) * row, data + y * row, row);
+    }
+  } else {
+    std::cerr << path << " isn't " << width << "x" << height << std::endl;
+  }
+  stbi_image_free(data);
+  return fits;
+}
 
-VideoTexture::VideoTexture(std::string folder_path) {
+}  // namespace
+
+VideoTexture::VideoTexture()
+    : frame_rate(VIDEO_FRAME_RATE),
+      width(0),
+      height(0),
+      shown(-1),
+      shown_frames(0),
+      dropped_frames(0),
+      next_frame(0),
+      stopping(false) {}
+
+VideoTexture::~VideoTexture() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  freed.notify_all();
+  if (worker.joinable()) {
+    worker.join();
+  }
+  for (Slot& slot : slots) {
+    if (slot.buffer) {
+      GLState::BindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.buffer);
+      if (slot.mapped) {
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+      }
+      glDeleteBuffers(1, &slot.buffer);
+    }
+  }
+  GLState::BindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+  if (texture) {
+    GLuint tid = texture->getID();
+    glDeleteTextures(1, &tid);
+    // GLState may still think it's bound
+    GLState::Invalidate();
+  }
+}
+
+VideoTexture::VideoTexture(std::string folder_path, double frame_rate)
+    : VideoTexture() {
+  this->frame_rate = frame_rate;
   std::vector<std::string> texture_files =
       FileSystemUtils::ListFiles(std::string(folder_path), "*.json");
+  if (texture_files.empty()) {
+    return;
+  }
+  nlohmann::json first;
   for (int i = 0; i < texture_files.size(); i++) {
-    textures.push_back(GameRenderer::TextureFromJSON(texture_files[i]));
+    std::ifstream json_input_stream(texture_files[i], std::ifstream::in);
+    nlohmann::json json_handler;
+    json_input_stream >> json_handler;
+    std::string filename = json_handler["filename"];
+    frame_paths.push_back(std::string(ASSET_DIR) + "/textures/" + filename);
+    if (i == 0) {
+      first = json_handler;
+    }
+  }
+  int ncomps;
+  if (!stbi_info(frame_paths[0].c_str(), &width, &height, &ncomps)) {
+    std::cerr << frame_paths[0] << " not found" << std::endl;
+    frame_paths.clear();
+    return;
+  }
+
+  texture = std::make_shared<Texture>();
+  texture->setName(first["name"]);
+  texture->setUnit(first["unit"]);
+  texture->setWrapModes(first["wrap_mode_x"], first["wrap_mode_y"]);
+  texture->initStreamed(width, height);
+  size_t bytes = (size_t)width * height * 3;
+  for (Slot& slot : slots) {
+    glGenBuffers(1, &slot.buffer);
+    GLState::BindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.buffer);
+    glBufferData(GL_PIXEL_UNPACK_BUFFER, bytes, NULL, GL_STREAM_DRAW);
+    slot.mapped = (unsigned char*)glMapBufferRange(
+        GL_PIXEL_UNPACK_BUFFER, 0, bytes,
+        GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
   }
-  cur_frame = 0;
+  GLState::BindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+  worker = std::thread(&VideoTexture::Decode, this);
 }
 
 std::shared_ptr<Texture> VideoTexture::GetCurFrame() {
-  return textures.at(cur_frame);
+  return texture;
 }
 
-void VideoTexture::IncrementFrame() {
-  if (!(cur_frame + 1 == textures.size())) {
-    cur_frame++;
+void VideoTexture::Update(double seconds) {
+  if (frame_paths.empty()) {
+    return;
+  }
+  int due = std::min(std::max((int)(seconds * frame_rate), 0),
+                     (int)frame_paths.size() - 1);
+  if (due == shown) {
+    return;
+  }
+  Slot* best = nullptr;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (due < shown) {
+      // rewound, nothing before due was missed
+      shown = due - 1;
+      next_frame = due;
+    }
+    if (next_frame < due) {
+      next_frame = due;  // the decoding fell behind, skip to what's due
+    }
+    // the latest decoded frame that's due is shown, the others have passed
+    // or, after a rewind, won't come up
+    for (Slot& slot : slots) {
+      if (!slot.ready) {
+        continue;
+      }
+      if (slot.frame > shown && slot.frame <= due &&
+          (!best || slot.frame > best->frame)) {
+        if (best) {
+          best->frame = -1;
+          best->ready = false;
+        }
+        best = &slot;
+      } else if (slot.frame <= due || slot.frame >= next_frame) {
+        slot.frame = -1;
+        slot.ready = false;
+      }
+    }
+  }
+  freed.notify_all();
+  if (!best) {
+    return;
+  }
+  dropped_frames += best->frame - shown - 1;
+  shown = best->frame;
+  shown_frames++;
+  Upload(*best);
+}
+
+// Copies slot into the texture and hands it back to the worker
+void VideoTexture::Upload(Slot& slot) {
+  GLState::BindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.buffer);
+  if (glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER)) {
+    GLState::BindTexture(GL_TEXTURE_2D, texture->getID());
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, GL_RGB,
+                    GL_UNSIGNED_BYTE, (const void*)0);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+  }
+  // orphaned, so mapping it doesn't wait on the copy
+  unsigned char* mapped = (unsigned char*)glMapBufferRange(
+      GL_PIXEL_UNPACK_BUFFER, 0, (size_t)width * height * 3,
+      GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+  GLState::BindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    slot.mapped = mapped;
+    slot.frame = -1;
+    slot.ready = false;
+  }
+  freed.notify_all();
+}
+
+// On the worker
+void VideoTexture::Decode() {
+  std::unique_lock<std::mutex> lock(mutex);
+  while (true) {
+    Slot* slot = nullptr;
+    freed.wait(lock, [this, &slot] {
+      if (stopping) {
+        return true;
+      }
+      if (next_frame >= (int)frame_paths.size()) {
+        return false;
+      }
+      for (Slot& free_slot : slots) {
+        if (free_slot.frame < 0 && free_slot.mapped) {
+          slot = &free_slot;
+          return true;
+        }
+      }
+      return false;
+    });
+    if (stopping) {
+      return;
+    }
+    int frame = next_frame++;
+    slot->frame = frame;
+    unsigned char* out = slot->mapped;
+    lock.unlock();
+    bool decoded = DecodeFrame(frame_paths[frame], width, height, out);
+    lock.lock();
+    if (decoded) {
+      slot->ready = true;
+    } else {
+      slot->frame = -1;  // skipped, it'll count as dropped
+    }
   }
 }
 
 void VideoTexture::ResetFrameCount() {
-  cur_frame = 0;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    next_frame = 0;
+    for (Slot& slot : slots) {
+      if (slot.ready && slot.frame != 0) {
+        slot.frame = -1;
+        slot.ready = false;
+      }
+    }
+  }
+  freed.notify_all();
+  shown = -1;
+}
+
+int VideoTexture::GetFrameCount() {
+  return frame_paths.size();
+}
+
+uint64_t VideoTexture::GetShownFrames() {
+  return shown_frames;
+}
+
+uint64_t VideoTexture::GetDroppedFrames() {
+  return dropped_frames;
 }
@@ -3,21 +3,74 @@
 #define __VIDEO_TEXTURE__
 
 #include "Texture.h"
+#include <condition_variable>
+#include <cstdint>
 #include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
 #include <vector>
 
+// frames a second, when the folder doesn't say otherwise
+#define VIDEO_FRAME_RATE 30.0
+// frames decoded ahead, each in its own staging buffer
+#define VIDEO_RING_FRAMES 3
+
+// Streams the frames of a folder through a single texture. A thread decodes
+// the frames coming up into a ring of mapped pixel unpack buffers and
+// Update() copies the one that's due into the texture, so memory holds
+// VIDEO_RING_FRAMES + 1 frames however long the video is.
+//
+// Frames whose time passes before they're decoded are skipped and counted as
+// dropped. Every frame must be the size of the first.
 class VideoTexture
 {
 public:
   VideoTexture();
-  VideoTexture(std::string folder_path);
+  // folder_path holds a texture JSON per frame, played in name order
+  VideoTexture(std::string folder_path, double frame_rate = VIDEO_FRAME_RATE);
+  // The texture frames stream into, null without any. It's only valid as
+  // long as the VideoTexture.
   std::shared_ptr<Texture> GetCurFrame();
-  void IncrementFrame();
+  // Shows the frame due seconds in, holding the last one past the end. It
+  // keeps the one before while the due frame is still decoding.
+  void Update(double seconds);
+  // Back to the first frame
   void ResetFrameCount();
+  int GetFrameCount();
+  uint64_t GetShownFrames();
+  uint64_t GetDroppedFrames();
   virtual ~VideoTexture();
 
 private:
-  std::vector<std::shared_ptr<Texture>> textures;
-  int cur_frame;
+  struct Slot {
+    GLuint buffer = 0;
+    // the worker may decode into it while it's set
+    unsigned char* mapped = nullptr;
+    // -1 when free
+    int frame = -1;
+    bool ready = false;
+  };
+
+  void Decode();
+  void Upload(Slot& slot);
+
+  std::vector<std::string> frame_paths;
+  double frame_rate;
+  int width;
+  int height;
+  std::shared_ptr<Texture> texture;
+  // the frame in the texture, -1 for none
+  int shown;
+  uint64_t shown_frames;
+  uint64_t dropped_frames;
+
+  // the worker's, guarded by mutex
+  std::mutex mutex;
+  std::condition_variable freed;
+  Slot slots[VIDEO_RING_FRAMES];
+  int next_frame;
+  bool stopping;
+  std::thread worker;
 };
 #endif
@@ -1,19 +1,47 @@
 #include "ViewFrustumCulling.h"
 
+#include <cmath>
 #include <iostream>
 #include <ctime>
 
+#if defined(__SSE__) || defined(_M_X64)
+#include <xmmintrin.h>
+#define VFC_SSE
+#endif
+
 namespace ViewFrustumCulling {
 
+namespace {
+
+// Signed distance of the box corner farthest along plane's normal
+float FarthestDistance(const glm::vec4& plane,
+                       const glm::vec3& center,
+                       const glm::vec3& extent) {
+  float distance = center.x * plane.x + center.y * plane.y +
+                   center.z * plane.z + plane.w;
+  float reach = extent.x * std::fabs(plane.x) + extent.y * std::fabs(plane.y) +
+                extent.z * std::fabs(plane.z);
+  return distance + reach;
+}
+
+// Signed distance of the box corner nearest along plane's normal
+float NearestDistance(const glm::vec4& plane,
+                      const glm::vec3& center,
+                      const glm::vec3& extent) {
+  float distance = center.x * plane.x + center.y * plane.y +
+                   center.z * plane.z + plane.w;
+  float reach = extent.x * std::fabs(plane.x) + extent.y * std::fabs(plane.y) +
+                extent.z * std::fabs(plane.z);
+  return distance - reach;
+}
+
+}  // namespace
+
 // Code from CPE-476 lab
-std::shared_ptr<std::vector<glm::vec4>> GetViewFrustumPlanes(glm::mat4 P,
-                                                             glm::mat4 V) {
+Frustum GetFrustum(glm::mat4 P, glm::mat4 V) {
   glm::vec4 Left, Right, Bottom, Top, Near, Far;
-  glm::vec3 normal;
   float normal_length;
-  std::shared_ptr<std::vector<glm::vec4>> planes =
-      std::make_shared<std::vector<glm::vec4>>();
-  planes->reserve(6);
+  Frustum frustum;
 
   glm::mat4 comp = P * V;
 
@@ -58,14 +86,129 @@ std::shared_ptr<std::vector<glm::vec4>> GetViewFrustumPlanes(glm::mat4 P,
   normal_length = glm::length(glm::vec3(Far.x, Far.y, Far.z));
   Far = Far / normal_length;
 
-  planes->push_back(Left);
-  planes->push_back(Right);
-  planes->push_back(Bottom);
-  planes->push_back(Top);
-  planes->push_back(Near);
-  planes->push_back(Far);
+  frustum.planes[VFC_LEFT] = Left;
+  frustum.planes[VFC_RIGHT] = Right;
+  frustum.planes[VFC_BOTTOM] = Bottom;
+  frustum.planes[VFC_TOP] = Top;
+  frustum.planes[VFC_NEAR] = Near;
+  frustum.planes[VFC_FAR] = Far;
 
-  return planes;
+  return frustum;
+}
+
+std::shared_ptr<std::vector<glm::vec4>> GetViewFrustumPlanes(glm::mat4 P,
+                                                             glm::mat4 V) {
+  Frustum frustum = GetFrustum(P, V);
+  return std::make_shared<std::vector<glm::vec4>>(frustum.planes,
+                                                  frustum.planes + 6);
+}
+
+void BoxArray::Clear() {
+  center_x.clear();
+  center_y.clear();
+  center_z.clear();
+  extent_x.clear();
+  extent_y.clear();
+  extent_z.clear();
+}
+
+void BoxArray::Add(AxisAlignedBox box) {
+  glm::vec3 center = (box.GetMax() + box.GetMin()) * 0.5f;
+  glm::vec3 extent = (box.GetMax() - box.GetMin()) * 0.5f;
+  center_x.push_back(center.x);
+  center_y.push_back(center.y);
+  center_z.push_back(center.z);
+  extent_x.push_back(extent.x);
+  extent_y.push_back(extent.y);
+  extent_z.push_back(extent.z);
+}
+
+bool IsCulled(AxisAlignedBox box, const Frustum& frustum) {
+  glm::vec3 center = (box.GetMax() + box.GetMin()) * 0.5f;
+  glm::vec3 extent = (box.GetMax() - box.GetMin()) * 0.5f;
+  for (const glm::vec4& plane : frustum.planes) {
+    if (FarthestDistance(plane, center, extent) <= 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+Containment Classify(AxisAlignedBox box,
+                     const Frustum& frustum,
+                     unsigned char& plane_mask,
+                     unsigned char& first_plane) {
+  glm::vec3 center = (box.GetMax() + box.GetMin()) * 0.5f;
+  glm::vec3 extent = (box.GetMax() - box.GetMin()) * 0.5f;
+  for (int i = 0; i < 6; i++) {
+    int plane = (first_plane + i) % 6;
+    if (!(plane_mask & (1 << plane))) {
+      continue;
+    }
+    if (FarthestDistance(frustum.planes[plane], center, extent) <= 0) {
+      first_plane = plane;
+      return Containment::OUTSIDE;
+    }
+    if (NearestDistance(frustum.planes[plane], center, extent) > 0) {
+      plane_mask &= ~(1 << plane);
+    }
+  }
+  return plane_mask ? Containment::INTERSECTING : Containment::INSIDE;
+}
+
+void CullBoxes(const BoxArray& boxes,
+               const Frustum& frustum,
+               unsigned char* culled,
+               unsigned char plane_mask) {
+  size_t count = boxes.Size();
+  size_t i = 0;
+#ifdef VFC_SSE
+  for (; i + 4 <= count; i += 4) {
+    __m128 center_x = _mm_loadu_ps(&boxes.center_x[i]);
+    __m128 center_y = _mm_loadu_ps(&boxes.center_y[i]);
+    __m128 center_z = _mm_loadu_ps(&boxes.center_z[i]);
+    __m128 extent_x = _mm_loadu_ps(&boxes.extent_x[i]);
+    __m128 extent_y = _mm_loadu_ps(&boxes.extent_y[i]);
+    __m128 extent_z = _mm_loadu_ps(&boxes.extent_z[i]);
+    __m128 outside = _mm_setzero_ps();
+    for (int p = 0; p < 6; p++) {
+      if (!(plane_mask & (1 << p))) {
+        continue;
+      }
+      const glm::vec4& plane = frustum.planes[p];
+      // same order of operations as FarthestDistance, so both agree exactly
+      __m128 distance = _mm_add_ps(
+          _mm_add_ps(
+              _mm_add_ps(_mm_mul_ps(center_x, _mm_set1_ps(plane.x)),
+                         _mm_mul_ps(center_y, _mm_set1_ps(plane.y))),
+              _mm_mul_ps(center_z, _mm_set1_ps(plane.z))),
+          _mm_set1_ps(plane.w));
+      __m128 reach = _mm_add_ps(
+          _mm_add_ps(_mm_mul_ps(extent_x, _mm_set1_ps(std::fabs(plane.x))),
+                     _mm_mul_ps(extent_y, _mm_set1_ps(std::fabs(plane.y)))),
+          _mm_mul_ps(extent_z, _mm_set1_ps(std::fabs(plane.z))));
+      outside = _mm_or_ps(
+          outside,
+          _mm_cmple_ps(_mm_add_ps(distance, reach), _mm_setzero_ps()));
+    }
+    int mask = _mm_movemask_ps(outside);
+    for (int lane = 0; lane < 4; lane++) {
+      culled[i + lane] = (mask >> lane) & 1;
+    }
+  }
+#endif
+  for (; i < count; i++) {
+    glm::vec3 center(boxes.center_x[i], boxes.center_y[i], boxes.center_z[i]);
+    glm::vec3 extent(boxes.extent_x[i], boxes.extent_y[i], boxes.extent_z[i]);
+    culled[i] = 0;
+    for (int p = 0; p < 6; p++) {
+      if ((plane_mask & (1 << p)) &&
+          FarthestDistance(frustum.planes[p], center, extent) <= 0) {
+        culled[i] = 1;
+        break;
+      }
+    }
+  }
 }
 
 float DistToPlane(float A, float B, float C, float D, glm::vec3 point) {
@@ -86,7 +229,7 @@ bool IsCulled(AxisAlignedBox box,
   // Left edge of box
   box_vertices.push_back(box.GetMin());
   box_vertices.push_back(vec3(box.GetMin().x, box.GetMax().y, box.GetMin().z));
-  box_vertices.push_back(vec3(box.GetMin().x, box.GetMin().y, box.GetMin().z));
+  box_vertices.push_back(vec3(box.GetMin().x, box.GetMax().y, box.GetMax().z));
   box_vertices.push_back(vec3(box.GetMin().x, box.GetMin().y, box.GetMax().z));
 
   int cull_count = 0;
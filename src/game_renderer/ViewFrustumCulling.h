@@ -8,14 +8,57 @@
 #define VFC_TOP 3
 #define VFC_NEAR 4
 #define VFC_FAR 5
+#define VFC_ALL_PLANES 0x3f
 
+#include <cstddef>
+#include <vector>
 #include <glm/gtc/type_ptr.hpp>
 #include "game_state/AxisAlignedBox.h"
 
 namespace ViewFrustumCulling {
+
+// The planes indexed by VFC_*, normalized so the inside is positive
+struct Frustum {
+  glm::vec4 planes[6];
+};
+
+// Boxes as centers and half extents, one array per component, so CullBoxes
+// can load four boxes' worth of each at once. Clear() keeps the memory.
+struct BoxArray {
+  std::vector<float> center_x, center_y, center_z;
+  std::vector<float> extent_x, extent_y, extent_z;
+
+  void Clear();
+  void Add(AxisAlignedBox box);
+  size_t Size() const { return center_x.size(); }
+};
+
+enum class Containment { OUTSIDE, INTERSECTING, INSIDE };
+
+Frustum GetFrustum(glm::mat4 P, glm::mat4 V);
 std::shared_ptr<std::vector<glm::vec4>> GetViewFrustumPlanes(glm::mat4 P,
                                                              glm::mat4 V);
 float DistToPlane(float A, float B, float C, float D, glm::vec3 point);
+// Culled when the box is entirely behind one of the planes: when the corner
+// farthest along the plane's normal, at center + |normal| . extent from it,
+// is behind it (<= 0)
+bool IsCulled(AxisAlignedBox box, const Frustum& frustum);
+// Tests box against the planes whose bits are set in plane_mask, starting
+// with first_plane. Clears the bits of planes the box is entirely in front
+// of, which its contents then needn't be tested against, and sets
+// first_plane to the plane that culls it, which likely does again next frame.
+// Outside exactly when IsCulled() against the planes in plane_mask.
+Containment Classify(AxisAlignedBox box,
+                     const Frustum& frustum,
+                     unsigned char& plane_mask,
+                     unsigned char& first_plane);
+// Sets culled[i] to IsCulled() of box i against the planes in plane_mask,
+// four boxes at a time with SSE
+void CullBoxes(const BoxArray& boxes,
+               const Frustum& frustum,
+               unsigned char* culled,
+               unsigned char plane_mask = VFC_ALL_PLANES);
+// The original test of the eight corners, kept to check the above against
 bool IsCulled(AxisAlignedBox box,
               std::shared_ptr<std::vector<glm::vec4>> planes);
 }
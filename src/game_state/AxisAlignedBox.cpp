@@ -38,6 +38,22 @@ AxisAlignedBox::AxisAlignedBox(glm::vec3 min, glm::vec3 max)
 
 AxisAlignedBox::AxisAlignedBox(std::shared_ptr<Shape> model,
                                glm::mat4 transform) {
+  // Without a rotation each axis is scaled and moved on its own, so the
+  // corners of the model's box land on the same min and max as the extreme
+  // vertices would
+  float model_min[3], model_max[3];
+  if (transform[0][1] == 0 && transform[0][2] == 0 && transform[1][0] == 0 &&
+      transform[1][2] == 0 && transform[2][0] == 0 && transform[2][1] == 0 &&
+      model->GetBounds(model_min, model_max)) {
+    glm::vec3 one(transform *
+                  glm::vec4(model_min[0], model_min[1], model_min[2], 1.0f));
+    glm::vec3 other(transform *
+                    glm::vec4(model_max[0], model_max[1], model_max[2], 1.0f));
+    min = glm::min(one, other);
+    max = glm::max(one, other);
+    return;
+  }
+
   bool first = true;
   std::vector<float> pos_buf = model->GetPositions();
   for (int i = 0; i < pos_buf.size(); i += 3) {
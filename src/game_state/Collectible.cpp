@@ -14,7 +14,9 @@ Collectible::Collectible(const std::string& shape_path,
                          glm::vec3 scale)
     : GameObject(shape_path, position, rotation_axis, rotation_angle, scale),
       isCollected(isCollected),
-      ticksSinceCollected(ticksSinceCollected) {}
+      ticksSinceCollected(ticksSinceCollected),
+      original_rotation_axis(rotation_axis),
+      original_rotation_angle(rotation_angle) {}
 
 Collectible::~Collectible() {}
 
@@ -27,6 +29,12 @@ void Collectible::SetUncollected() {
   this->ticksSinceCollected = 0;
 }
 
+void Collectible::Reset() {
+  SetUncollected();
+  SetRotationAxis(original_rotation_axis);
+  SetRotationAngle(original_rotation_angle);
+}
+
 bool Collectible::GetCollected() const {
   return this->isCollected;
 }
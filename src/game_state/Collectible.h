@@ -17,6 +17,8 @@ class Collectible : public GameObject {
 
   void SetCollected();
   void SetUncollected();
+  // uncollects and puts the collectible back in its original orientation
+  void Reset();
   void IncrementTicksCollected(float inc_amt);
   bool GetCollected() const;
   int GetTicksCollected();
@@ -27,6 +29,8 @@ class Collectible : public GameObject {
  protected:
   bool isCollected;
   float ticksSinceCollected;
+  glm::vec3 original_rotation_axis;
+  float original_rotation_angle;
 };
 
 #endif
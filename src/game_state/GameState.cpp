@@ -7,6 +7,7 @@
 
 #define PASSIVE_PARTICLE_COUNT 3000
 #define JUMP_PARTICLE_COUNT 300
+#define DEFAULT_RANDOM_SEED 476
 
 GameState::GameState(std::shared_ptr<Level> level,
                      std::shared_ptr<GameCamera> camera,
@@ -18,8 +19,15 @@ GameState::GameState(std::shared_ptr<Level> level,
       player(player),
       sky(sky),
       window(window),
-      particles(std::make_shared<ParticleGenerator>(PASSIVE_PARTICLE_COUNT)),
-      jump_particles(std::make_shared<ParticleGenerator>(JUMP_PARTICLE_COUNT)),
+      random_seed(DEFAULT_RANDOM_SEED),
+      randoms{std::make_shared<RandomGenerator>(),
+              std::make_shared<RandomGenerator>(),
+              std::make_shared<RandomGenerator>()},
+      particles(std::make_shared<ParticleGenerator>(randoms[PARTICLE_RANDOM],
+                                                    PASSIVE_PARTICLE_COUNT)),
+      jump_particles(std::make_shared<ParticleGenerator>(
+          randoms[JUMP_PARTICLE_RANDOM],
+          JUMP_PARTICLE_COUNT)),
       elapsed_ticks(0),
       start_tick(0),
       start_time(0),
@@ -27,6 +35,7 @@ GameState::GameState(std::shared_ptr<Level> level,
       game_end_tick(0),
       game_end_time(0) {
   objectsInView = new std::unordered_set<std::shared_ptr<GameObject>>();
+  SeedRandom(random_seed);
   this->music_end_tick =
       level->getMusic()->getDuration().asMicroseconds() * TICKS_PER_MICRO +
       GetMusicStartTick();
@@ -120,12 +129,22 @@ void GameState::SetStartTime() {
   elapsed_ticks = 0;
   start_tick = elapsed_ticks;
   start_time = glfwGetTime();
+  start_generation++;
 }
 
 void GameState::SetItemsInView(
     std::unordered_set<std::shared_ptr<GameObject>>* objects) {
   delete objectsInView;
   this->objectsInView = objects;
+  view_generation++;
+}
+
+uint64_t GameState::GetViewGeneration() {
+  return view_generation;
+}
+
+uint64_t GameState::GetStartGeneration() {
+  return start_generation;
 }
 
 std::unordered_set<std::shared_ptr<GameObject>>* GameState::GetObjectsInView() {
@@ -147,36 +166,38 @@ void GameState::SetPlayingState(PlayingState playing_state) {
   game_end_time = glfwGetTime();
 
   // update music
-  std::shared_ptr<sf::Music> music = GetLevel()->getMusic();
-  switch (playing_state) {
-    case GameState::PlayingState::PLAYING:
-      // on resume start the music back up
-      if (music->getStatus() != sf::SoundSource::Status::Playing) {
-        if (previously_paused) {
-          effects.Unpause();
-          while (!effects.ComingBackFromAPause())
-            ;  // coming in from a pause
-          previously_paused = false;
+  if (!muted) {
+    std::shared_ptr<sf::Music> music = GetLevel()->getMusic();
+    switch (playing_state) {
+      case GameState::PlayingState::PLAYING:
+        // on resume start the music back up
+        if (music->getStatus() != sf::SoundSource::Status::Playing) {
+          if (previously_paused) {
+            effects.Unpause();
+            while (!effects.ComingBackFromAPause())
+              ;  // coming in from a pause
+            previously_paused = false;
+          }
+          music->play();
         }
-        music->play();
-      }
-      break;
-    case GameState::PlayingState::PAUSED:
-      // pause the music
-      if (music->getStatus() == sf::SoundSource::Status::Playing) {
-        music->pause();
-        effects.Pause();
-        previously_paused = true;
-      }
-      break;
-    case GameState::PlayingState::FAILURE:
-    case GameState::PlayingState::SUCCESS:
-      // stop the music
-      if (music->getStatus() == sf::SoundSource::Status::Playing) {
-        music->stop();
-        effects.Death();
-      }
-      break;
+        break;
+      case GameState::PlayingState::PAUSED:
+        // pause the music
+        if (music->getStatus() == sf::SoundSource::Status::Playing) {
+          music->pause();
+          effects.Pause();
+          previously_paused = true;
+        }
+        break;
+      case GameState::PlayingState::FAILURE:
+      case GameState::PlayingState::SUCCESS:
+        // stop the music
+        if (music->getStatus() == sf::SoundSource::Status::Playing) {
+          music->stop();
+          effects.Death();
+        }
+        break;
+    }
   }
 
   // unlock cursor when paused or game over
@@ -192,6 +213,29 @@ void GameState::SetPlayingState(PlayingState playing_state) {
   }
 }
 
+void GameState::SetMuted(bool muted) {
+  this->muted = muted;
+}
+
+bool GameState::IsMuted() {
+  return muted;
+}
+
+std::shared_ptr<RandomGenerator> GameState::GetRandom(RandomStream stream) {
+  return randoms[stream];
+}
+
+uint64_t GameState::GetRandomSeed() {
+  return random_seed;
+}
+
+void GameState::SeedRandom(uint64_t seed) {
+  random_seed = seed;
+  for (int i = 0; i < RANDOM_STREAM_COUNT; i++) {
+    randoms[i]->Seed(seed ^ ((i + 1) * 0xD1B54A32D192ED03ULL));
+  }
+}
+
 SoundEffects GameState::GetSoundEffects() {
   return effects;
 }
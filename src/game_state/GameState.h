@@ -19,10 +19,19 @@
 #include "LevelEditorState.h"
 #include "SoundEffects.h"
 #include "ParticleGenerator.h"
+#include "RandomGenerator.h"
 
 class GameState {
  public:
   enum PlayingState { PLAYING, PAUSED, FAILURE, SUCCESS };
+  // every subsystem draws from its own stream so they can't shift each
+  // other's sequences
+  enum RandomStream {
+    PARTICLE_RANDOM,
+    JUMP_PARTICLE_RANDOM,
+    RENDERER_RANDOM,
+    RANDOM_STREAM_COUNT
+  };
 
   GameState(std::shared_ptr<Level> level,
             std::shared_ptr<GameCamera> camera,
@@ -53,6 +62,13 @@ class GameState {
   double GetProgressRatio();
   bool ReachedEndOfLevel();
   SoundEffects GetSoundEffects();
+  // incremented every time the objects in view are replaced
+  uint64_t GetViewGeneration();
+  // incremented every time SetStartTime() starts the level over
+  uint64_t GetStartGeneration();
+  bool IsMuted();
+  std::shared_ptr<RandomGenerator> GetRandom(RandomStream stream);
+  uint64_t GetRandomSeed();
 
   void AddVideoTexture(std::string name, std::shared_ptr<VideoTexture> texture);
   void SetLevel(std::shared_ptr<Level> level);
@@ -63,6 +79,10 @@ class GameState {
   void SetLevelEditorState(
       std::shared_ptr<LevelEditorState> level_editor_state);
   void SetPlayingState(PlayingState playing_state);
+  // when muted nothing in the simulation plays music or sound effects
+  void SetMuted(bool muted);
+  // reseeds every random stream, derived from the one seed
+  void SeedRandom(uint64_t seed);
 
  private:
   std::shared_ptr<Level> level;
@@ -73,6 +93,8 @@ class GameState {
   std::unordered_set<std::shared_ptr<GameObject>>* objectsInView;
   std::shared_ptr<LevelEditorState> level_editor_state;
   GLFWwindow* window;
+  uint64_t random_seed;
+  std::shared_ptr<RandomGenerator> randoms[RANDOM_STREAM_COUNT];
   std::shared_ptr<ParticleGenerator> particles;
   std::shared_ptr<ParticleGenerator> jump_particles;
   SoundEffects effects;
@@ -85,6 +107,9 @@ class GameState {
   uint64_t game_end_tick;  // tick when the game was won or lost
   double game_end_time;    // value of glfwGetTime() when game was won/lost
   bool previously_paused = false;
+  uint64_t view_generation = 0;
+  uint64_t start_generation = 0;
+  bool muted = false;
 };
 
 #endif
@@ -9,12 +9,17 @@
 #define OBJS_IN_LEAF 20
 #define DISTANCE 10
 #define OCT 8
+// views that cull the tree, the scene and the minimap every frame and the
+// shadow maps' strips when they're drawn
+#define OCTREE_CULLING_VIEWS 3
 
 class Node {
  public:
   std::vector<std::shared_ptr<GameObject>>* objects;
   AxisAlignedBox boundingBox;
   std::vector<Node*>* children;
+  // per view, the frustum plane that last culled this node
+  unsigned char culling_planes[OCTREE_CULLING_VIEWS] = {};
 
   Node(std::vector<std::shared_ptr<GameObject>>* items,
        AxisAlignedBox bb,
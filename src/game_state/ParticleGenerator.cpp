@@ -10,31 +10,49 @@
 
 #include <algorithm>
 
-static GLfloat RandomVelocity() {
-  return ((rand() % 10) - 5) / 100.0f;
+#include "GLState.h"
+#include "RenderStats.h"
+
+// random bits used by each spawned particle
+#define RANDOMS_PER_SPAWN 8
+
+static GLfloat RandomVelocity(uint32_t bits) {
+  return RandomGenerator::ToInt(bits, -5, 4) / 100.0f;
+}
+
+static GLfloat RandomColor(uint32_t bits) {
+  return 0.1 + RandomGenerator::ToInt(bits, 0, 99) / 100.0f;
 }
 
-static GLfloat RandomColor() {
-  return 0.1 + ((rand() % 100) / 100.0f);
+static GLfloat RandomSpread(uint32_t bits) {
+  return RandomGenerator::ToInt(bits, -5, 5) / 10.0f;
 }
 
-ParticleGenerator::ParticleGenerator(GLuint amount) : amount(amount) {
+ParticleGenerator::ParticleGenerator(std::shared_ptr<RandomGenerator> random,
+                                     GLuint amount)
+    : amount(amount), random(random) {
   this->init();
 }
 
 void ParticleGenerator::Update(GLuint newParticles,
                                std::shared_ptr<Player> object,
                                glm::vec3 offset) {
+  random_bits.resize(newParticles * RANDOMS_PER_SPAWN);
+  random->FillUInts(random_bits.data(), random_bits.size());
+
   for (GLuint i = 0; i < newParticles; ++i) {
+    const uint32_t* bits = &random_bits[i * RANDOMS_PER_SPAWN];
     int unusedParticle = this->firstUnusedParticle();
 
-    glm::vec3 new_velocity(std::abs(RandomVelocity() * 5),
-                           std::abs(RandomVelocity()),
-                           RandomVelocity() + object->GetZVelocity() * 0.5f);
+    glm::vec3 new_velocity(std::abs(RandomVelocity(bits[0]) * 5),
+                           std::abs(RandomVelocity(bits[1])),
+                           RandomVelocity(bits[2]) +
+                               object->GetZVelocity() * 0.5f);
 
     this->respawn(this->particles[unusedParticle], object, new_velocity,
-                  glm::vec4(RandomColor(), RandomColor(), RandomColor(), 1.0f),
-                  offset);
+                  glm::vec4(RandomColor(bits[3]), RandomColor(bits[4]),
+                            RandomColor(bits[5]), 1.0f),
+                  RandomSpread(bits[6]), offset);
   }
 
   for (GLuint i = 0; i < this->amount; ++i) {
@@ -48,26 +66,19 @@ void ParticleGenerator::Update(GLuint newParticles,
 }
 
 void ParticleGenerator::DrawParticles(const std::shared_ptr<Program> prog) {
-  int h_pos = -1;
-
-  glDepthMask(GL_FALSE);
+  GLState::DepthMask(GL_FALSE);
+  GLState::BindVertexArray(this->VAO);
   for (Particle particle : this->particles) {
     if (particle.Life > 0.0f) {
-      glUniform3f(prog->getUniform("Offset"), particle.Position.x,
-                  particle.Position.y, particle.Position.z);
-      glUniform4f(prog->getUniform("Color"), particle.Color.x, particle.Color.y,
-                  particle.Color.z, 1.0f);
-      glBindVertexArray(this->VAO);
-      h_pos = prog->getAttribute("vertPos");
-      glEnableVertexAttribArray(h_pos);
-      glBindBuffer(GL_ARRAY_BUFFER, VBO);
-      glVertexAttribPointer(h_pos, 4, GL_FLOAT, GL_FALSE, 0, (const void*)0);
+      prog->setUniform(Uniform::Offset, particle.Position);
+      prog->setUniform(Uniform::Color,
+                       glm::vec4(glm::vec3(particle.Color), 1.0f));
       glDrawArrays(GL_TRIANGLES, 0, 6);
-      glBindVertexArray(0);
+      RenderStats::DrawCalls(1);
     }
   }
 
-  glDepthMask(GL_TRUE);
+  GLState::DepthMask(GL_TRUE);
 }
 
 void ParticleGenerator::init() {
@@ -76,16 +87,17 @@ void ParticleGenerator::init() {
                              1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 0.0f, 1.0f, 0.0f};
   glGenVertexArrays(1, &this->VAO);
   glGenBuffers(1, &VBO);
-  glBindVertexArray(this->VAO);
+  GLState::BindVertexArray(this->VAO);
 
-  glBindBuffer(GL_ARRAY_BUFFER, VBO);
+  GLState::BindBuffer(GL_ARRAY_BUFFER, VBO);
   glBufferData(GL_ARRAY_BUFFER, sizeof(particle_quad), particle_quad,
                GL_STATIC_DRAW);
 
-  glEnableVertexAttribArray(0);
-  glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(GLfloat),
-                        (GLvoid*)0);
-  glBindVertexArray(0);
+  GLState::EnableVertexAttribArray(AttributeLocation(Attribute::vertPos));
+  GLState::VertexAttribPointer(AttributeLocation(Attribute::vertPos), 4,
+                               GL_FLOAT, GL_FALSE, 4 * sizeof(GLfloat),
+                               (GLvoid*)0);
+  GLState::BindVertexArray(0);
 
   for (GLuint i = 0; i < this->amount; ++i) {
     this->particles.push_back(Particle());
@@ -121,12 +133,12 @@ void ParticleGenerator::respawn(Particle& particle,
                                 std::shared_ptr<Player> object,
                                 glm::vec3 velocity,
                                 glm::vec4 color,
+                                GLfloat spread,
                                 glm::vec3 offset) {
-  GLfloat random = ((rand() % 11) - 5) / 10.0f;
   particle.Position =
-      glm::vec3(object->GetPosition().x + offset.x + random * 1.3 - 0.5,
-                object->GetPosition().y + offset.y + random,
-                object->GetPosition().z + offset.z + random);
+      glm::vec3(object->GetPosition().x + offset.x + spread * 1.3 - 0.5,
+                object->GetPosition().y + offset.y + spread,
+                object->GetPosition().z + offset.z + spread);
   particle.Color = color;
   particle.Life = 80.0f;
   particle.Velocity = velocity;
@@ -136,19 +148,25 @@ void ParticleGenerator::respawn(Particle& particle,
 void ParticleGenerator::SpawnAll(std::shared_ptr<Player> player,
                                  glm::vec3 offset,
                                  glm::vec3 color_multiplier) {
-  for (Particle& particle : particles) {
-    float rotation = (rand() / (float)RAND_MAX) * M_PI * 2;
-    float magnitude = rand() / (float)RAND_MAX;
+  random_bits.resize(particles.size() * RANDOMS_PER_SPAWN);
+  random->FillUInts(random_bits.data(), random_bits.size());
+
+  for (size_t i = 0; i < particles.size(); i++) {
+    const uint32_t* bits = &random_bits[i * RANDOMS_PER_SPAWN];
+    float rotation = RandomGenerator::ToFloat(bits[0]) * M_PI * 2;
+    float magnitude = RandomGenerator::ToFloat(bits[1]);
     glm::vec3 new_velocity(magnitude * std::cos(rotation),
-                           std::abs(RandomVelocity()),
+                           std::abs(RandomVelocity(bits[2])),
                            magnitude * std::sin(rotation));
     new_velocity *= 0.1f;
     new_velocity +=
         glm::vec3(-DELTA_X_PER_TICK / 2, 0, player->GetZVelocity() / 2);
 
-    glm::vec3 new_color(RandomColor(), RandomColor(), RandomColor());
+    glm::vec3 new_color(RandomColor(bits[3]), RandomColor(bits[4]),
+                        RandomColor(bits[5]));
     new_color *= color_multiplier;
 
-    respawn(particle, player, new_velocity, glm::vec4(new_color, 1.0f), offset);
+    respawn(particles[i], player, new_velocity, glm::vec4(new_color, 1.0f),
+            RandomSpread(bits[6]), offset);
   }
 }
@@ -13,6 +13,7 @@
 #include "GameCamera.h"
 #include "Player.h"
 #include "Program.h"
+#include "RandomGenerator.h"
 
 #define DEFAULT_PARTICLE_COUNT 5000
 #define PLAYER_PARTICLE_OFFSET glm::vec3(-0.3, -1.1, -0.5)
@@ -27,7 +28,8 @@ class ParticleGenerator {
     Particle() : Position(0.0f), Velocity(0.0f), Color(1.0f), Life(0.0f) {}
   };
 
-  ParticleGenerator(GLuint amount = DEFAULT_PARTICLE_COUNT);
+  ParticleGenerator(std::shared_ptr<RandomGenerator> random,
+                    GLuint amount = DEFAULT_PARTICLE_COUNT);
   void Update(GLuint newParticles,
               std::shared_ptr<Player> object,
               glm::vec3 offset = glm::vec3(0.0f, 0.0f, 0.0f));
@@ -40,6 +42,9 @@ class ParticleGenerator {
 
  private:
   GLuint amount;
+  std::shared_ptr<RandomGenerator> random;
+  // reused between spawns so bulk generation doesn't allocate
+  std::vector<uint32_t> random_bits;
   GLuint VBO;
   GLuint VAO;
   void init();
@@ -48,6 +53,7 @@ class ParticleGenerator {
                std::shared_ptr<Player> object,
                glm::vec3 velocity,
                glm::vec4 color,
+               GLfloat spread,
                glm::vec3 offset = glm::vec3(0.0f, 0.0f, 0.0f));
 
   // sorts based on distance from camera
@@ -38,7 +38,11 @@ Player::Player(glm::vec3 position,
       score(0),
       time_warp(1),
       animation(Animation::JUMPING),
-      wheel_rotation_speed(0) {
+      current_tick(0),
+      animation_start_tick(0),
+      duck_start_tick(0),
+      wheel_rotation_speed(0),
+      duck_dir(DuckDir::NONE) {
   rear_wheel = std::make_shared<PhysicalObject>(
       WHEEL_MESH, glm::vec3(-1.2, -0.3, 0), glm::vec3(0, 0, -1), 0,
       glm::vec3(WHEEL_SCALE, WHEEL_SCALE, WHEEL_SCALE));
@@ -83,6 +87,8 @@ void Player::Reset() {
   x_velocity = DELTA_X_PER_TICK;
   can_double_jump = blocked_up_z = blocked_down_z = false;
   trip_n = Trip::GOPHER;
+  duck_dir = DuckDir::NONE;
+  duck_start_tick = 0;
   RemoveGround();
 }
 
@@ -14,6 +14,7 @@
 #include "Logging.h"
 #include "MovingObject.h"
 #include "Octree.h"
+#include "Profiler.h"
 #include "TimingConstants.h"
 #include "VideoTexture.h"
 
@@ -44,6 +45,7 @@ void GameUpdater::PostGameUpdate(std::shared_ptr<GameState> game_state) {
 }
 
 void GameUpdater::Update(std::shared_ptr<GameState> game_state) {
+  PROFILE_SCOPE("GameUpdater::Update");
   if (game_state->ReachedEndOfLevel()) {
     game_state->SetPlayingState(GameState::PlayingState::SUCCESS);
     game_state->IncrementTicks(game_state->GetPlayer()->GetTimeWarp());
@@ -57,7 +59,8 @@ void GameUpdater::Update(std::shared_ptr<GameState> game_state) {
 
   // check to see if the music should start on this tick
   std::shared_ptr<sf::Music> music = game_state->GetLevel()->getMusic();
-  if (game_state->GetMusicStartTick() == game_state->GetElapsedTicks()) {
+  if (game_state->GetMusicStartTick() == game_state->GetElapsedTicks() &&
+      !game_state->IsMuted()) {
     music->play();
     music->setLoop(false);
   }
@@ -120,19 +123,20 @@ void GameUpdater::Reset(std::shared_ptr<GameState> game_state) {
   player_updater.ChangeAnimation(game_state, Player::Animation::JUMPING);
   game_state->SetPlayingState(GameState::PlayingState::PLAYING);
   game_state->GetSky()->SetPosition(glm::vec3(0, 0, -10));
-  game_state->GetVideoTextures()["sky"]->ResetFrameCount();
+  for (auto& video_texture : game_state->GetVideoTextures()) {
+    video_texture.second->ResetFrameCount();
+  }
 
-  // TODO - iterate over all video textures and reset their playback
   // reset collectibles and moving objects
   for (std::shared_ptr<GameObject> obj :
        *game_state->GetLevel()->getObjects()) {
     if (obj->GetType() == ObjectType::COLLECTIBLE) {
       std::shared_ptr<Collectible> c =
           std::static_pointer_cast<Collectible>(obj);
-      c->SetUncollected();
+      c->Reset();
     }
-    // reset the moving objects
-    if (obj->GetSecondaryType() == SecondaryType::MOVING_PLATFORM) {
+    // reset the moving objects, monsters included
+    if (GameObject::Moves(obj->GetSecondaryType())) {
       std::shared_ptr<MovingObject> movingObj =
           std::dynamic_pointer_cast<MovingObject>(obj);
       movingObj->Reset();
@@ -283,6 +287,7 @@ uint64_t GameUpdater::CalculateTargetTicks(
 }
 
 void GameUpdater::UpdateParticles(std::shared_ptr<GameState> game_state) {
+  PROFILE_SCOPE("UpdateParticles");
   std::shared_ptr<Player> player = game_state->GetPlayer();
 
   game_state->GetParticles()->SortParticles(game_state->GetCamera());
@@ -13,6 +13,7 @@
 #include "Octree.h"
 #include "Player.h"
 #include "CollisionCalculator.h"
+#include "Profiler.h"
 #include "DroppingPlatform.h"
 
 #define COLLISION_TOLERANCE_Y 0.420f
@@ -137,6 +138,7 @@ void PlayerUpdater::PowerUpPlayer(std::shared_ptr<GameState> game_state) {
 }
 
 void PlayerUpdater::CollisionCheck(std::shared_ptr<GameState> game_state) {
+  PROFILE_SCOPE("CollisionCheck");
   std::shared_ptr<Player> player = game_state->GetPlayer();
 
   // Determine colliding objects.
@@ -158,7 +160,9 @@ void PlayerUpdater::CollisionCheck(std::shared_ptr<GameState> game_state) {
   // Collect the collectibles we are colliding with.
   for (std::shared_ptr<Collectible> collectible : colliding_collectibles) {
     if (!collectible->GetCollected()) {
-      game_state->GetSoundEffects().OhYes();
+      if (!game_state->IsMuted()) {
+        game_state->GetSoundEffects().OhYes();
+      }
       collectible->SetCollected();
       game_state->GetPlayer()->SetScore(game_state->GetPlayer()->GetScore() +
                                         1);
@@ -0,0 +1,454 @@
+#include "Replay.h"
+
+#include <GLFW/glfw3.h>
+
+#include <algorithm>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <unordered_map>
+
+#include "Collectible.h"
+#include "GameRenderer.h"
+#include "Logging.h"
+
+#define REPLAY_MAGIC "RRRP"
+// 2 widened rng_seed to 64 bits
+#define REPLAY_VERSION 2
+
+#define FNV_OFFSET_BASIS 14695981039346656037ULL
+#define FNV_PRIME 1099511628211ULL
+
+namespace {
+
+// The file is little endian regardless of the machine that wrote it
+void WriteU8(std::ostream& out, uint8_t value) {
+  out.put(value);
+}
+
+void WriteU32(std::ostream& out, uint32_t value) {
+  for (int i = 0; i < 4; i++) {
+    out.put((value >> (8 * i)) & 0xFF);
+  }
+}
+
+void WriteU64(std::ostream& out, uint64_t value) {
+  for (int i = 0; i < 8; i++) {
+    out.put((value >> (8 * i)) & 0xFF);
+  }
+}
+
+void WriteFloat(std::ostream& out, float value) {
+  uint32_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  WriteU32(out, bits);
+}
+
+void WriteVec3(std::ostream& out, glm::vec3 value) {
+  WriteFloat(out, value.x);
+  WriteFloat(out, value.y);
+  WriteFloat(out, value.z);
+}
+
+void WriteString(std::ostream& out, const std::string& value) {
+  WriteU32(out, value.size());
+  out.write(value.data(), value.size());
+}
+
+bool ReadU8(std::istream& in, uint8_t* value) {
+  char c;
+  if (!in.get(c)) {
+    return false;
+  }
+  *value = (uint8_t)c;
+  return true;
+}
+
+bool ReadU32(std::istream& in, uint32_t* value) {
+  *value = 0;
+  for (int i = 0; i < 4; i++) {
+    uint8_t byte;
+    if (!ReadU8(in, &byte)) {
+      return false;
+    }
+    *value |= (uint32_t)byte << (8 * i);
+  }
+  return true;
+}
+
+bool ReadU64(std::istream& in, uint64_t* value) {
+  *value = 0;
+  for (int i = 0; i < 8; i++) {
+    uint8_t byte;
+    if (!ReadU8(in, &byte)) {
+      return false;
+    }
+    *value |= (uint64_t)byte << (8 * i);
+  }
+  return true;
+}
+
+bool ReadFloat(std::istream& in, float* value) {
+  uint32_t bits;
+  if (!ReadU32(in, &bits)) {
+    return false;
+  }
+  std::memcpy(value, &bits, sizeof(bits));
+  return true;
+}
+
+bool ReadVec3(std::istream& in, glm::vec3* value) {
+  return ReadFloat(in, &value->x) && ReadFloat(in, &value->y) &&
+         ReadFloat(in, &value->z);
+}
+
+bool ReadString(std::istream& in, std::string* value) {
+  uint32_t size;
+  if (!ReadU32(in, &size)) {
+    return false;
+  }
+  value->resize(size);
+  return size == 0 || in.read(&(*value)[0], size);
+}
+
+// FNV-1a, fed one value at a time
+class Hasher {
+ public:
+  Hasher() : hash(FNV_OFFSET_BASIS) {}
+
+  void Add(const void* data, size_t size) {
+    const uint8_t* bytes = (const uint8_t*)data;
+    for (size_t i = 0; i < size; i++) {
+      hash ^= bytes[i];
+      hash *= FNV_PRIME;
+    }
+  }
+  void Add(uint64_t value) { Add(&value, sizeof(value)); }
+  void Add(float value) { Add(&value, sizeof(value)); }
+  void Add(glm::vec3 value) {
+    Add(value.x);
+    Add(value.y);
+    Add(value.z);
+  }
+
+  uint64_t Get() { return hash; }
+
+ private:
+  uint64_t hash;
+};
+
+std::unordered_map<GameObject*, uint32_t> IndexObjects(
+    std::shared_ptr<GameState> game_state) {
+  std::unordered_map<GameObject*, uint32_t> indices;
+  std::shared_ptr<std::vector<std::shared_ptr<GameObject>>> objects =
+      game_state->GetLevel()->getObjects();
+  for (uint32_t i = 0; i < objects->size(); i++) {
+    indices[objects->at(i).get()] = i;
+  }
+  return indices;
+}
+
+}  // namespace
+
+bool Replay::Save(const std::string& path) const {
+  std::ofstream out(path, std::ios::binary);
+  if (!out) {
+    LOG_ERROR("Couldn't open " << path);
+    return false;
+  }
+
+  out.write(REPLAY_MAGIC, 4);
+  WriteU32(out, REPLAY_VERSION);
+  WriteU32(out, flags);
+  WriteString(out, music_path);
+  WriteString(out, level_path);
+  WriteU64(out, level_hash);
+  WriteU64(out, rng_seed);
+  WriteU32(out, framebuffer_width);
+  WriteU32(out, framebuffer_height);
+  WriteVec3(out, camera_position);
+  WriteVec3(out, camera_look_at);
+  WriteVec3(out, camera_player_spacing);
+  WriteFloat(out, camera_forward_spacing);
+
+  WriteU32(out, initial_view.size());
+  for (uint32_t index : initial_view) {
+    WriteU32(out, index);
+  }
+
+  // Steps only store the input that changed since the step before
+  WriteU32(out, steps.size());
+  for (const Step& step : steps) {
+    WriteU8(out, step.flags);
+    if (step.flags & STEP_KEYS_CHANGED) {
+      WriteU32(out, step.input.keys_down);
+      WriteU32(out, step.input.keys_pressed);
+    }
+    if (step.flags & STEP_CURSOR_MOVED) {
+      WriteFloat(out, step.input.cursor_dx);
+      WriteFloat(out, step.input.cursor_dy);
+    }
+  }
+
+  WriteU64(out, final_checksum);
+  return out.good();
+}
+
+bool Replay::Load(const std::string& path) {
+  std::ifstream in(path, std::ios::binary);
+  if (!in) {
+    LOG_ERROR("Couldn't open " << path);
+    return false;
+  }
+
+  char magic[4];
+  uint32_t version;
+  if (!in.read(magic, 4) || std::memcmp(magic, REPLAY_MAGIC, 4) != 0 ||
+      !ReadU32(in, &version)) {
+    LOG_ERROR(path << " is not a replay");
+    return false;
+  }
+  if (version != REPLAY_VERSION) {
+    LOG_ERROR(path << " is replay version " << version << ", expected "
+                   << REPLAY_VERSION);
+    return false;
+  }
+
+  uint32_t width, height, view_count, step_count;
+  bool ok = ReadU32(in, &flags) && ReadString(in, &music_path) &&
+            ReadString(in, &level_path) && ReadU64(in, &level_hash) &&
+            ReadU64(in, &rng_seed) && ReadU32(in, &width) &&
+            ReadU32(in, &height) && ReadVec3(in, &camera_position) &&
+            ReadVec3(in, &camera_look_at) &&
+            ReadVec3(in, &camera_player_spacing) &&
+            ReadFloat(in, &camera_forward_spacing) &&
+            ReadU32(in, &view_count);
+  framebuffer_width = width;
+  framebuffer_height = height;
+
+  initial_view.clear();
+  for (uint32_t i = 0; ok && i < view_count; i++) {
+    uint32_t index;
+    ok = ReadU32(in, &index);
+    initial_view.push_back(index);
+  }
+
+  ok = ok && ReadU32(in, &step_count);
+  steps.clear();
+  Step step = Step();
+  for (uint32_t i = 0; ok && i < step_count; i++) {
+    ok = ReadU8(in, &step.flags);
+    if (ok && (step.flags & STEP_KEYS_CHANGED)) {
+      ok = ReadU32(in, &step.input.keys_down) &&
+           ReadU32(in, &step.input.keys_pressed);
+    }
+    step.input.cursor_dx = step.input.cursor_dy = 0;
+    if (ok && (step.flags & STEP_CURSOR_MOVED)) {
+      ok = ReadFloat(in, &step.input.cursor_dx) &&
+           ReadFloat(in, &step.input.cursor_dy);
+    }
+    steps.push_back(step);
+  }
+
+  ok = ok && ReadU64(in, &final_checksum);
+  if (!ok) {
+    LOG_ERROR(path << " is truncated");
+  }
+  return ok;
+}
+
+uint64_t Replay::LevelHash(std::shared_ptr<GameState> game_state) {
+  Hasher hasher;
+  for (std::shared_ptr<GameObject> obj :
+       *game_state->GetLevel()->getObjects()) {
+    hasher.Add((uint64_t)obj->GetSecondaryType());
+    hasher.Add(obj->GetPosition());
+    hasher.Add(obj->GetScale());
+  }
+  return hasher.Get();
+}
+
+uint64_t Replay::StateChecksum(std::shared_ptr<GameState> game_state) {
+  std::shared_ptr<Player> player = game_state->GetPlayer();
+  Hasher hasher;
+  hasher.Add((uint64_t)player->GetScore());
+  hasher.Add(player->GetPosition());
+  hasher.Add((uint64_t)game_state->GetElapsedTicks());
+  hasher.Add((uint64_t)game_state->GetPlayingState());
+
+  std::shared_ptr<std::vector<std::shared_ptr<GameObject>>> objects =
+      game_state->GetLevel()->getObjects();
+  for (uint64_t i = 0; i < objects->size(); i++) {
+    if (objects->at(i)->GetType() == ObjectType::COLLECTIBLE &&
+        std::static_pointer_cast<Collectible>(objects->at(i))
+            ->GetCollected()) {
+      hasher.Add(i);
+    }
+  }
+  return hasher.Get();
+}
+
+ReplayRecorder::ReplayRecorder() : recording(false), last_view_generation(0) {}
+
+ReplayRecorder::~ReplayRecorder() {
+  if (recording) {
+    InputBindings::SetInputMode(InputBindings::InputMode::LIVE);
+  }
+}
+
+void ReplayRecorder::Start(std::shared_ptr<GameState> game_state,
+                           const std::string& music_path,
+                           const std::string& level_path) {
+  replay = Replay();
+#ifdef DEBUG
+  replay.flags |= Replay::FLAG_DEBUG_BUILD;
+#endif
+  replay.music_path = music_path;
+  replay.level_path = level_path;
+  replay.level_hash = Replay::LevelHash(game_state);
+
+  replay.rng_seed = std::time(nullptr);
+  game_state->SeedRandom(replay.rng_seed);
+
+  glfwGetFramebufferSize(game_state->GetWindow(), &replay.framebuffer_width,
+                         &replay.framebuffer_height);
+
+  std::shared_ptr<GameCamera> camera = game_state->GetCamera();
+  replay.camera_position = camera->getPosition();
+  replay.camera_look_at = camera->getLookAt();
+  replay.camera_player_spacing = camera->GetCameraPlayerSpacing();
+  replay.camera_forward_spacing = camera->GetForwardSpacing();
+
+  std::unordered_map<GameObject*, uint32_t> indices = IndexObjects(game_state);
+  for (std::shared_ptr<GameObject> obj : *game_state->GetObjectsInView()) {
+    replay.initial_view.push_back(indices[obj.get()]);
+  }
+  std::sort(replay.initial_view.begin(), replay.initial_view.end());
+
+  last_view_generation = game_state->GetViewGeneration();
+  last_input = InputBindings::InputTick();
+  recording = true;
+  InputBindings::SetInputMode(InputBindings::InputMode::RECORDING);
+}
+
+void ReplayRecorder::BeginStep(std::shared_ptr<GameState> game_state) {
+  InputBindings::ResetInputTick();
+}
+
+void ReplayRecorder::EndStep(std::shared_ptr<GameState> game_state) {
+  Replay::Step step;
+  step.flags = 0;
+  step.input = InputBindings::GetInputTick();
+
+  // the view is only ever replaced by rendering, which happens between steps
+  if (game_state->GetViewGeneration() != last_view_generation) {
+    step.flags |= Replay::STEP_VIEW_UPDATED;
+    last_view_generation = game_state->GetViewGeneration();
+  }
+  if (step.input.keys_down != last_input.keys_down ||
+      step.input.keys_pressed != last_input.keys_pressed) {
+    step.flags |= Replay::STEP_KEYS_CHANGED;
+  }
+  if (step.input.cursor_dx != 0 || step.input.cursor_dy != 0) {
+    step.flags |= Replay::STEP_CURSOR_MOVED;
+  }
+
+  last_input = step.input;
+  replay.steps.push_back(step);
+}
+
+bool ReplayRecorder::Finish(std::shared_ptr<GameState> game_state,
+                            const std::string& path) {
+  recording = false;
+  InputBindings::SetInputMode(InputBindings::InputMode::LIVE);
+  replay.final_checksum = Replay::StateChecksum(game_state);
+  if (!replay.Save(path)) {
+    return false;
+  }
+  LOG("Wrote " << replay.steps.size() << " steps to " << path);
+  return true;
+}
+
+bool ReplayRecorder::IsRecording() {
+  return recording;
+}
+
+ReplayPlayer::ReplayPlayer() : final_checksum(0), elapsed_seconds(0) {}
+
+ReplayPlayer::~ReplayPlayer() {}
+
+bool ReplayPlayer::Play(const Replay& replay,
+                        std::shared_ptr<GameState> game_state,
+                        GameUpdater& game_updater) {
+#ifdef DEBUG
+  bool debug_build = true;
+#else
+  bool debug_build = false;
+#endif
+  if (debug_build != (bool)(replay.flags & Replay::FLAG_DEBUG_BUILD)) {
+    // debug builds can always double jump
+    LOG_ERROR("Replay was recorded in a "
+              << (debug_build ? "release" : "debug")
+              << " build and will not play back the same way");
+    return false;
+  }
+
+  game_state->SetMuted(true);
+  game_updater.Reset(game_state);
+  if (Replay::LevelHash(game_state) != replay.level_hash) {
+    LOG_ERROR("Replay was recorded on a different level");
+    return false;
+  }
+
+  std::shared_ptr<GameCamera> camera = game_state->GetCamera();
+  camera->setPosition(replay.camera_position);
+  camera->setLookAt(replay.camera_look_at);
+  camera->SetCameraPlayerSpacing(replay.camera_player_spacing);
+  camera->SetForwardSpacing(replay.camera_forward_spacing);
+
+  std::shared_ptr<std::vector<std::shared_ptr<GameObject>>> objects =
+      game_state->GetLevel()->getObjects();
+  std::unordered_set<std::shared_ptr<GameObject>>* initial_view =
+      new std::unordered_set<std::shared_ptr<GameObject>>();
+  for (uint32_t index : replay.initial_view) {
+    if (index >= objects->size()) {
+      LOG_ERROR("Replay refers to object " << index << " out of "
+                                           << objects->size());
+      delete initial_view;
+      return false;
+    }
+    initial_view->insert(objects->at(index));
+  }
+  game_state->SetItemsInView(initial_view);
+
+  game_state->SeedRandom(replay.rng_seed);
+  float aspect = replay.framebuffer_width / (float)replay.framebuffer_height;
+
+  double start_time = glfwGetTime();
+  InputBindings::SetInputMode(InputBindings::InputMode::REPLAYING);
+  for (const Replay::Step& step : replay.steps) {
+    if (step.flags & Replay::STEP_VIEW_UPDATED) {
+      GameRenderer::UpdateMinimapView(game_state, aspect);
+    }
+    InputBindings::SetInputTick(step.input);
+    game_updater.Update(game_state);
+
+    // the player resumed from the pause menu before the next step
+    if (game_state->GetPlayingState() == GameState::PlayingState::PAUSED) {
+      game_state->SetPlayingState(GameState::PlayingState::PLAYING);
+    }
+  }
+  InputBindings::SetInputMode(InputBindings::InputMode::LIVE);
+  elapsed_seconds = glfwGetTime() - start_time;
+
+  final_checksum = Replay::StateChecksum(game_state);
+  return final_checksum == replay.final_checksum;
+}
+
+uint64_t ReplayPlayer::GetFinalChecksum() {
+  return final_checksum;
+}
+
+double ReplayPlayer::GetElapsedSeconds() {
+  return elapsed_seconds;
+}
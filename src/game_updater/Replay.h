@@ -0,0 +1,102 @@
+#ifndef REPLAY_H_
+#define REPLAY_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "GameState.h"
+#include "GameUpdater.h"
+#include "InputBindings.h"
+
+// A replay is one attempt at a level, starting right after
+// GameUpdater::Reset(). It holds what the simulation can't recompute on its
+// own: the level it was played on, the seeds, the camera and objects in view
+// at the start, and the input read during every call to GameUpdater::Update().
+// It ends with a checksum of the final game state, so playing it back tells
+// whether physics and collisions still behave the same.
+struct Replay {
+  // bits of Step::flags
+  static const uint8_t STEP_VIEW_UPDATED = 1 << 0;  // a frame was culled
+  static const uint8_t STEP_KEYS_CHANGED = 1 << 1;
+  static const uint8_t STEP_CURSOR_MOVED = 1 << 2;
+
+  // bits of Replay::flags
+  static const uint32_t FLAG_DEBUG_BUILD = 1 << 0;
+
+  struct Step {
+    uint8_t flags;
+    InputBindings::InputTick input;
+  };
+
+  uint32_t flags = 0;
+  std::string music_path;
+  std::string level_path;
+  uint64_t level_hash = 0;
+  uint64_t rng_seed = 0;
+  int framebuffer_width = 0;
+  int framebuffer_height = 0;
+  glm::vec3 camera_position;
+  glm::vec3 camera_look_at;
+  glm::vec3 camera_player_spacing;
+  float camera_forward_spacing = 0;
+  std::vector<uint32_t> initial_view;  // indices into Level::getObjects()
+  std::vector<Step> steps;
+  uint64_t final_checksum = 0;
+
+  bool Save(const std::string& path) const;
+  bool Load(const std::string& path);
+
+  // Hash of every object in the level, taken right after a reset
+  static uint64_t LevelHash(std::shared_ptr<GameState> game_state);
+  // Hash of the score, player position, tick count and collected set
+  static uint64_t StateChecksum(std::shared_ptr<GameState> game_state);
+};
+
+// Hooked around GameUpdater::Update() by the game loop.
+class ReplayRecorder {
+ public:
+  ReplayRecorder();
+  ~ReplayRecorder();
+
+  // Call right after GameUpdater::Reset()
+  void Start(std::shared_ptr<GameState> game_state,
+             const std::string& music_path,
+             const std::string& level_path);
+  void BeginStep(std::shared_ptr<GameState> game_state);
+  void EndStep(std::shared_ptr<GameState> game_state);
+  // Stops recording and writes the replay to path
+  bool Finish(std::shared_ptr<GameState> game_state, const std::string& path);
+  bool IsRecording();
+
+ private:
+  Replay replay;
+  bool recording;
+  uint64_t last_view_generation;
+  InputBindings::InputTick last_input;
+};
+
+// Drives the simulation through a replay as fast as possible, without
+// rendering or sound.
+class ReplayPlayer {
+ public:
+  ReplayPlayer();
+  ~ReplayPlayer();
+
+  // game_state must be freshly built from the replay's level. Returns true
+  // if the final state matches the recorded checksum.
+  bool Play(const Replay& replay,
+            std::shared_ptr<GameState> game_state,
+            GameUpdater& game_updater);
+
+  uint64_t GetFinalChecksum();
+  double GetElapsedSeconds();
+
+ private:
+  uint64_t final_checksum;
+  double elapsed_seconds;
+};
+
+#endif
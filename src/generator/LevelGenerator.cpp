@@ -1,5 +1,6 @@
 // bnbeck
 #include <iostream>
+#include <fstream>
 #include <cstdlib>
 #include <time.h>
 
@@ -13,6 +14,9 @@
 #include "MoonRock.h"
 #include "PlainRock.h"
 #include "Monster.h"
+#include "FileSystemUtils.h"
+#include "LevelJson.h"
+#include "json.hpp"
 
 #define COLLECT 3.2f
 #define EPISILON 0.05f
@@ -265,3 +269,25 @@ std::shared_ptr<Level> LevelGenerator::generateLevel() {
 
   return level;
 }
+
+std::shared_ptr<Level> LevelGenerator::LoadLevel(
+    const std::string& music_path,
+    const std::string& level_path) {
+  LevelGenerator* level_generator;
+  if (FileSystemUtils::FileExists(level_path)) {
+    std::ifstream input(level_path);
+    nlohmann::json leveljson;
+    input >> leveljson;
+
+    std::vector<std::shared_ptr<GameObject>> level = leveljson;
+    std::shared_ptr<std::vector<std::shared_ptr<GameObject>>> lvl =
+        std::make_shared<std::vector<std::shared_ptr<GameObject>>>(level);
+
+    level_generator = new LevelGenerator(music_path, lvl);
+  } else {
+    level_generator = new LevelGenerator(music_path);
+  }
+  std::shared_ptr<Level> level = level_generator->generateLevel();
+  delete level_generator;
+  return level;
+}
@@ -31,6 +31,11 @@ class LevelGenerator {
   std::shared_ptr<Level> generateLevel();
   std::shared_ptr<std::vector<std::shared_ptr<GameObject>>> Generate();
 
+  // Loads the level at level_path, or generates one from the music if there
+  // is no level file there.
+  static std::shared_ptr<Level> LoadLevel(const std::string& music_path,
+                                          const std::string& level_path);
+
  private:
   std::shared_ptr<Aquila::WaveFile> wav;
   std::shared_ptr<sf::Music> music;
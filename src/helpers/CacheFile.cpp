@@ -0,0 +1,127 @@
+#include "CacheFile.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#include "FileSystemUtils.h"
+
+namespace CacheFile {
+
+namespace {
+
+// FNV-1a
+uint64_t Hash(const std::string& text) {
+  uint64_t hash = 14695981039346656037ull;
+  for (char c : text) {
+    hash = (hash ^ (unsigned char)c) * 1099511628211ull;
+  }
+  return hash;
+}
+
+}  // namespace
+
+std::string GetPath(const std::string& source_path, const char* extension) {
+  std::string asset_dir = ASSET_DIR "/";
+  if (source_path.compare(0, asset_dir.size(), asset_dir) == 0) {
+    return CACHE_DIR "/" + source_path.substr(asset_dir.size()) + extension;
+  }
+  // kept apart by the whole path, named by the file for finding them
+  size_t name = source_path.find_last_of("/\\");
+  name = name == std::string::npos ? 0 : name + 1;
+  char hash[17];
+  snprintf(hash, sizeof(hash), "%016llx",
+           (unsigned long long)Hash(source_path));
+  return CACHE_DIR "/other/" + std::string(hash) + "_" +
+         source_path.substr(name) + extension;
+}
+
+bool MakeStamp(const std::string& source_path,
+               uint32_t magic,
+               uint32_t version,
+               Stamp& stamp) {
+  stamp.magic = magic;
+  stamp.version = version;
+  if (!FileSystemUtils::GetStamp(source_path, stamp.source_mtime,
+                                 stamp.source_size)) {
+    return false;
+  }
+  stamp.source_hash = MappedFile(source_path).Hash();
+  return true;
+}
+
+std::unique_ptr<MappedFile> Map(const std::string& path,
+                                uint32_t magic,
+                                uint32_t version,
+                                size_t header_size) {
+  std::unique_ptr<MappedFile> cache(new MappedFile(path));
+  if (cache->GetSize() < std::max(header_size, sizeof(Stamp))) {
+    return nullptr;
+  }
+  Stamp stamp;
+  memcpy(&stamp, cache->GetData(), sizeof(Stamp));
+  if (stamp.magic != magic || stamp.version != version) {
+    return nullptr;
+  }
+  return cache;
+}
+
+bool IsCurrent(const MappedFile& cache,
+               const std::string& path,
+               const std::string& source_path) {
+  Stamp stamp;
+  uint64_t source_mtime, source_size, cache_mtime, cache_size;
+  if (cache.GetSize() < sizeof(Stamp) ||
+      !FileSystemUtils::GetStamp(source_path, source_mtime, source_size) ||
+      !FileSystemUtils::GetStamp(path, cache_mtime, cache_size)) {
+    return false;
+  }
+  memcpy(&stamp, cache.GetData(), sizeof(Stamp));
+  // times are whole seconds, so a source saved again within a second of the
+  // stamp keeps its time and only the hash can tell
+  if (stamp.source_mtime == source_mtime && stamp.source_size == source_size &&
+      cache_mtime > source_mtime + 1) {
+    return true;
+  }
+  MappedFile source(source_path);
+  if (source.GetSize() != source_size || source.Hash() != stamp.source_hash) {
+    return false;
+  }
+  // the same file with a new time
+  stamp.source_mtime = source_mtime;
+  std::fstream patch(path, std::ios::in | std::ios::out | std::ios::binary);
+  patch.write((const char*)&stamp, sizeof(Stamp));
+  patch.close();
+  if (!patch) {
+    // still current, it'll just be hashed again next time
+    std::cerr << "Couldn't update " << path << std::endl;
+  }
+  return true;
+}
+
+bool Write(const std::string& path, const Parts& parts) {
+  size_t directory = path.find_last_of("/\\");
+  if (directory != std::string::npos &&
+      !FileSystemUtils::MakeDirectories(path.substr(0, directory))) {
+    return false;
+  }
+  std::string temp_path = path + ".tmp";
+  {
+    std::ofstream out(temp_path, std::ios::binary | std::ios::trunc);
+    for (const std::pair<const void*, size_t>& part : parts) {
+      if (part.second) {
+        out.write((const char*)part.first, part.second);
+      }
+    }
+    if (!out) {
+      std::cerr << "Couldn't write " << temp_path << std::endl;
+      std::remove(temp_path.c_str());
+      return false;
+    }
+  }
+  return FileSystemUtils::MoveIntoPlace(temp_path, path);
+}
+
+}  // namespace CacheFile
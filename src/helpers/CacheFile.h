@@ -0,0 +1,66 @@
+#ifndef CACHE_FILE_H_
+#define CACHE_FILE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "MappedFile.h"
+
+// Files made from an asset and saved so later runs can skip making them
+// again. They're kept under CACHE_DIR, apart from the assets, at the place
+// their asset has under ASSET_DIR.
+//
+// Every cache starts with a Stamp, which its header has as its first member.
+// Caches are written as is, so they only move between builds of the same
+// compiler.
+namespace CacheFile {
+
+struct Stamp {
+  // which kind of cache, and the version of the way it's made
+  uint32_t magic;
+  uint32_t version;
+  // of the asset it was made from
+  uint64_t source_mtime;
+  uint64_t source_size;
+  uint64_t source_hash;
+};
+
+// data and size of each part of a cache, in order
+typedef std::vector<std::pair<const void*, size_t>> Parts;
+
+// Where the cache of source_path with extension goes
+std::string GetPath(const std::string& source_path, const char* extension);
+
+// Stamp for a cache of source_path as it is now, false if it isn't there
+bool MakeStamp(const std::string& source_path,
+               uint32_t magic,
+               uint32_t version,
+               Stamp& stamp);
+
+// The cache at path, or null if there's none with this magic and version at
+// least header_size long
+std::unique_ptr<MappedFile> Map(const std::string& path,
+                                uint32_t magic,
+                                uint32_t version,
+                                size_t header_size);
+// Whether cache, mapped from path, was made from source_path as it is now:
+// the modification time and size match, or failing that the hash does, as
+// it will after a checkout touches the file. Times are whole seconds, so
+// the hash is also checked while the source's time is within a second of
+// the cache's. A hash match saves the new time in the cache, so it isn't
+// hashed again.
+bool IsCurrent(const MappedFile& cache,
+               const std::string& path,
+               const std::string& source_path);
+
+// Writes parts aside and moves them into place at path, so a cache is never
+// read half done
+bool Write(const std::string& path, const Parts& parts);
+
+}  // namespace CacheFile
+
+#endif
@@ -2,9 +2,12 @@
 
 #include "FileSystemUtils.h"
 
+#include <sys/stat.h>
+#include <cstdio>
 #include <iostream>
 #include <fstream>
 #ifdef _WIN32
+#include <direct.h>
 #include <windows.h>
 #else
 #include <glob.h>
@@ -43,4 +46,46 @@ std::vector<std::string> ListFiles(const std::string& path,
 bool FileExists(const std::string& path) {
   return std::ifstream(path).good();
 }
+
+bool GetStamp(const std::string& path, uint64_t& mtime, uint64_t& size) {
+  struct stat info;
+  if (stat(path.c_str(), &info) != 0) {
+    return false;
+  }
+  mtime = info.st_mtime;
+  size = info.st_size;
+  return true;
+}
+
+bool MoveIntoPlace(const std::string& temp_path, const std::string& path) {
+#ifdef _WIN32
+  std::remove(path.c_str());  // rename doesn't replace there
+#endif
+  if (std::rename(temp_path.c_str(), path.c_str()) != 0) {
+    std::cerr << "Couldn't write " << path << std::endl;
+    std::remove(temp_path.c_str());
+    return false;
+  }
+  return true;
+}
+
+bool MakeDirectories(const std::string& path) {
+  // each one up to path, failing where it's there already or is a drive
+  size_t end = 0;
+  while (end != std::string::npos) {
+    end = path.find_first_of("/\\", end + 1);
+    std::string directory = path.substr(0, end);
+#ifdef _WIN32
+    _mkdir(directory.c_str());
+#else
+    mkdir(directory.c_str(), 0755);
+#endif
+  }
+  struct stat info;
+  if (stat(path.c_str(), &info) != 0 || !(info.st_mode & S_IFDIR)) {
+    std::cerr << "Couldn't make " << path << std::endl;
+    return false;
+  }
+  return true;
+}
 }
@@ -2,6 +2,7 @@
 #ifndef __FILE_SYS_UTILS__
 #define __FILE_SYS_UTILS__
 
+#include <cstdint>
 #include <vector>
 #include <string>
 
@@ -11,6 +12,16 @@ std::vector<std::string> ListFiles(const std::string& path,
                                    const std::string& pattern);
 
 bool FileExists(const std::string& path);
+
+// The modification time (seconds) and size of path, false if it isn't there
+bool GetStamp(const std::string& path, uint64_t& mtime, uint64_t& size);
+
+// Renames temp_path over path, so readers see the old file or the new one but
+// never half of one. temp_path is removed if it can't be.
+bool MoveIntoPlace(const std::string& temp_path, const std::string& path);
+
+// Makes the directory path and any above it that aren't there yet
+bool MakeDirectories(const std::string& path);
 }
 
 #endif
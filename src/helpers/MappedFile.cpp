@@ -0,0 +1,51 @@
+#include "MappedFile.h"
+
+#include <fstream>
+#include <iterator>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile(const std::string& path) {
+#ifndef _WIN32
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return;
+  }
+  struct stat info;
+  if (fstat(fd, &info) == 0 && info.st_size > 0) {
+    void* mapped = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (mapped != MAP_FAILED) {
+      data = (const char*)mapped;
+      size = info.st_size;
+    }
+  }
+  close(fd);  // the mapping stays
+#else
+  std::ifstream in(path, std::ios::binary);
+  contents.assign(std::istreambuf_iterator<char>(in),
+                  std::istreambuf_iterator<char>());
+  data = contents.empty() ? nullptr : &contents[0];
+  size = contents.size();
+#endif
+}
+
+MappedFile::~MappedFile() {
+#ifndef _WIN32
+  if (data) {
+    munmap((void*)data, size);
+  }
+#endif
+}
+
+uint64_t MappedFile::Hash() const {
+  uint64_t hash = 14695981039346656037ull;
+  for (size_t i = 0; i < size; i++) {
+    hash = (hash ^ (unsigned char)data[i]) * 1099511628211ull;
+  }
+  return hash;
+}
@@ -0,0 +1,32 @@
+#ifndef MAPPED_FILE_H_
+#define MAPPED_FILE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// A whole file, read only. Mapped where there's mmap, read in elsewhere.
+// Empty when the file can't be opened.
+class MappedFile {
+ public:
+  explicit MappedFile(const std::string& path);
+  ~MappedFile();
+
+  const char* GetData() const { return data; }
+  size_t GetSize() const { return size; }
+  // FNV-1a of the contents
+  uint64_t Hash() const;
+
+ private:
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  const char* data = nullptr;
+  size_t size = 0;
+#ifdef _WIN32
+  std::vector<char> contents;
+#endif
+};
+
+#endif
@@ -0,0 +1,245 @@
+#include "Profiler.h"
+
+#include <GLFW/glfw3.h>
+#include <imgui.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <vector>
+
+#include "InputBindings.h"
+#include "Logging.h"
+
+#define PROFILER_TRACE_PATH "rhythm_runner_trace.json"
+#define FLAME_ROW_HEIGHT 18.0f
+// Zones past this in one frame are dropped while others are open, and once
+// none are the frame starts over. Frames only get this long when nothing ends
+// them, as when loading or running headless.
+#define MAX_ZONES_PER_FRAME 65536
+
+namespace Profiler {
+
+namespace {
+
+struct ZoneRecord {
+  const char* name;
+  uint64_t start_ns;
+  uint64_t end_ns;
+  int depth;
+};
+
+struct Frame {
+  uint64_t start_ns;
+  uint64_t end_ns;
+  std::vector<ZoneRecord> zones;
+};
+
+Frame frames[PROFILER_HISTORY];
+int current_frame = 0;
+int finished_frames = 0;
+std::vector<int> open_zones;  // indices into the current frame's zones
+bool paused = false;
+bool show_overlay = false;
+
+uint64_t NowNs() {
+  static const std::chrono::steady_clock::time_point epoch =
+      std::chrono::steady_clock::now();
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now() - epoch)
+      .count();
+}
+
+// i frames ago, 0 being the last finished frame
+const Frame& FinishedFrame(int i) {
+  return frames[(current_frame - 1 - i + PROFILER_HISTORY) % PROFILER_HISTORY];
+}
+
+double ToMs(uint64_t ns) {
+  return ns / 1000000.0;
+}
+
+ImU32 ZoneColor(const char* name) {
+  // stable color per zone name
+  uint32_t hash = 2166136261u;
+  for (const char* c = name; *c; c++) {
+    hash = (hash ^ (uint8_t)*c) * 16777619u;
+  }
+  return IM_COL32(80 + (hash & 0x7F), 80 + ((hash >> 8) & 0x7F),
+                  80 + ((hash >> 16) & 0x7F), 255);
+}
+
+void DrawFlameGraph(const Frame& frame) {
+  int max_depth = 0;
+  for (const ZoneRecord& zone : frame.zones) {
+    max_depth = std::max(max_depth, zone.depth);
+  }
+
+  ImVec2 origin = ImGui::GetCursorScreenPos();
+  float width = ImGui::GetContentRegionAvailWidth();
+  float height = (max_depth + 1) * FLAME_ROW_HEIGHT;
+  ImGui::InvisibleButton("flame", ImVec2(width, height));
+
+  ImDrawList* draw_list = ImGui::GetWindowDrawList();
+  double frame_ns = std::max<uint64_t>(frame.end_ns - frame.start_ns, 1);
+  for (const ZoneRecord& zone : frame.zones) {
+    ImVec2 min(origin.x + (zone.start_ns - frame.start_ns) / frame_ns * width,
+               origin.y + zone.depth * FLAME_ROW_HEIGHT);
+    ImVec2 max(origin.x + (zone.end_ns - frame.start_ns) / frame_ns * width,
+               min.y + FLAME_ROW_HEIGHT - 1);
+    if (max.x - min.x < 1) {
+      max.x = min.x + 1;
+    }
+    draw_list->AddRectFilled(min, max, ZoneColor(zone.name));
+    if (ImGui::CalcTextSize(zone.name).x < max.x - min.x) {
+      draw_list->AddText(ImVec2(min.x + 2, min.y), IM_COL32_BLACK, zone.name);
+    }
+    if (ImGui::IsMouseHoveringRect(min, max)) {
+      ImGui::SetTooltip("%s: %.3f ms", zone.name,
+                        ToMs(zone.end_ns - zone.start_ns));
+    }
+  }
+}
+
+void DrawTotals(const Frame& frame) {
+  // total time per zone name, including nested zones
+  std::map<std::string, std::pair<uint64_t, int>> totals;
+  for (const ZoneRecord& zone : frame.zones) {
+    std::pair<uint64_t, int>& total = totals[zone.name];
+    total.first += zone.end_ns - zone.start_ns;
+    total.second++;
+  }
+  std::vector<std::pair<uint64_t, std::string>> sorted;
+  for (auto& total : totals) {
+    sorted.push_back(std::make_pair(total.second.first, total.first));
+  }
+  std::sort(sorted.rbegin(), sorted.rend());
+
+  for (auto& total : sorted) {
+    ImGui::Text("%8.3f ms  x%-4d %s", ToMs(total.first),
+                totals[total.second].second, total.second.c_str());
+  }
+}
+
+}  // namespace
+
+void Zone::Begin(const char* name) {
+  std::vector<ZoneRecord>& zones = frames[current_frame].zones;
+  if (zones.size() >= MAX_ZONES_PER_FRAME) {
+    if (!open_zones.empty()) {
+      open_zones.push_back(-1);
+      return;
+    }
+    zones.clear();
+    frames[current_frame].start_ns = NowNs();
+  }
+  ZoneRecord zone;
+  zone.name = name;
+  zone.start_ns = NowNs();
+  zone.end_ns = zone.start_ns;
+  zone.depth = open_zones.size();
+  open_zones.push_back(zones.size());
+  zones.push_back(zone);
+}
+
+void Zone::End() {
+  if (open_zones.back() >= 0) {
+    frames[current_frame].zones[open_zones.back()].end_ns = NowNs();
+  }
+  open_zones.pop_back();
+}
+
+void EndFrame() {
+  uint64_t now = NowNs();
+  if (!open_zones.empty()) {
+    LOG_ERROR("frame ended with " << open_zones.size() << " zones open");
+    return;
+  }
+
+  frames[current_frame].end_ns = now;
+  if (!paused) {
+    current_frame = (current_frame + 1) % PROFILER_HISTORY;
+    finished_frames = std::min(finished_frames + 1, PROFILER_HISTORY);
+  }
+
+  // vectors keep their capacity, so steady state recording doesn't allocate
+  frames[current_frame].zones.clear();
+  frames[current_frame].start_ns = now;
+}
+
+double GetLastFrameMs() {
+  if (finished_frames == 0) {
+    return 0;
+  }
+  const Frame& frame = FinishedFrame(0);
+  return ToMs(frame.end_ns - frame.start_ns);
+}
+
+void ImGuiRender() {
+  if (InputBindings::KeyPressed(GLFW_KEY_F3)) {
+    show_overlay = !show_overlay;
+  }
+  if (!show_overlay || finished_frames == 0) {
+    return;
+  }
+
+  ImGui::SetNextWindowSize(ImVec2(700, 400), ImGuiSetCond_FirstUseEver);
+  ImGui::Begin("Profiler [F3]", &show_overlay);
+
+  float frame_ms[PROFILER_HISTORY];
+  for (int i = 0; i < finished_frames; i++) {
+    const Frame& frame = FinishedFrame(finished_frames - 1 - i);
+    frame_ms[i] = ToMs(frame.end_ns - frame.start_ns);
+  }
+  char overlay[32];
+  snprintf(overlay, sizeof(overlay), "%.2f ms", frame_ms[finished_frames - 1]);
+  ImGui::PlotLines("frame", frame_ms, finished_frames, 0, overlay, 0.0f,
+                   33.3f, ImVec2(0, 60));
+
+  ImGui::Checkbox("Pause", &paused);
+  ImGui::SameLine();
+  if (ImGui::Button("Write Chrome trace")) {
+    WriteChromeTrace(PROFILER_TRACE_PATH);
+  }
+
+  const Frame& frame = FinishedFrame(0);
+  DrawFlameGraph(frame);
+  DrawTotals(frame);
+
+  ImGui::End();
+}
+
+bool WriteChromeTrace(const std::string& path) {
+  std::ofstream out(path);
+  if (!out) {
+    LOG_ERROR("Couldn't open " << path);
+    return false;
+  }
+
+  // complete ("X") events, timestamps in microseconds
+  out << std::fixed << std::setprecision(3) << "{\"traceEvents\":[";
+  bool first = true;
+  for (int i = finished_frames - 1; i >= 0; i--) {
+    const Frame& frame = FinishedFrame(i);
+    out << (first ? "" : ",") << "\n{\"name\":\"frame\",\"ph\":\"X\",\"ts\":"
+        << frame.start_ns / 1000.0
+        << ",\"dur\":" << (frame.end_ns - frame.start_ns) / 1000.0
+        << ",\"pid\":0,\"tid\":0}";
+    first = false;
+    for (const ZoneRecord& zone : frame.zones) {
+      out << ",\n{\"name\":\"" << zone.name << "\",\"ph\":\"X\",\"ts\":"
+          << zone.start_ns / 1000.0
+          << ",\"dur\":" << (zone.end_ns - zone.start_ns) / 1000.0
+          << ",\"pid\":0,\"tid\":0}";
+    }
+  }
+  out << "\n]}\n";
+
+  LOG("Wrote " << finished_frames << " frames to " << path);
+  return out.good();
+}
+
+}  // namespace Profiler
@@ -0,0 +1,66 @@
+#ifndef PROFILER_H_
+#define PROFILER_H_
+
+#include <cstdint>
+#include <string>
+
+// Scoped CPU timers. Put PROFILE_SCOPE("name") at the top of a block to time
+// it; zones opened inside it nest under it. The last PROFILER_HISTORY frames
+// are kept in a ring buffer for the overlay and for Chrome trace export
+// (chrome://tracing or ui.perfetto.dev).
+//
+// Built with -DPROFILING (the PROFILING cmake option). Without it every macro
+// expands to nothing. Zone names must be string literals, and zones must only
+// be opened on the main thread.
+#ifdef PROFILING
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_SCOPE(name) \
+  Profiler::Zone PROFILE_CONCAT(profile_zone_, __LINE__)(name)
+#define PROFILE_END_FRAME() Profiler::EndFrame()
+#define PROFILE_IMGUI_RENDER() Profiler::ImGuiRender()
+
+#else
+
+#define PROFILE_SCOPE(name) \
+  do {                      \
+  } while (0)
+#define PROFILE_END_FRAME() \
+  do {                      \
+  } while (0)
+#define PROFILE_IMGUI_RENDER() \
+  do {                         \
+  } while (0)
+
+#endif
+
+#define PROFILER_HISTORY 300
+
+namespace Profiler {
+
+class Zone {
+ public:
+  explicit Zone(const char* name) { Begin(name); }
+  ~Zone() { End(); }
+
+ private:
+  static void Begin(const char* name);
+  static void End();
+};
+
+// Closes the current frame and starts recording the next one
+void EndFrame();
+
+// Duration of the most recently finished frame
+double GetLastFrameMs();
+
+// Draws the overlay, toggled with F3
+void ImGuiRender();
+
+// Writes every frame in the history as Chrome trace JSON
+bool WriteChromeTrace(const std::string& path);
+
+}  // namespace Profiler
+
+#endif
@@ -0,0 +1,102 @@
+#include "RandomGenerator.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+uint64_t SplitMix64(uint64_t* x) {
+  uint64_t z = (*x += 0x9E3779B97F4A7C15ULL);
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+  return z ^ (z >> 31);
+}
+
+inline uint32_t RotateLeft(uint32_t x, int k) {
+  return (x << k) | (x >> (32 - k));
+}
+
+}  // namespace
+
+RandomGenerator::RandomGenerator(uint64_t seed) {
+  Seed(seed);
+}
+
+void RandomGenerator::Seed(uint64_t seed) {
+  // splitmix64 never gives all zeros over two calls, which xoshiro can't take
+  for (int lane = 0; lane < LANES; lane++) {
+    uint64_t a = SplitMix64(&seed);
+    uint64_t b = SplitMix64(&seed);
+    state[0][lane] = a;
+    state[1][lane] = a >> 32;
+    state[2][lane] = b;
+    state[3][lane] = b >> 32;
+  }
+  block_position = BLOCK_SIZE;
+}
+
+void RandomGenerator::NextBlock(uint32_t* out) {
+  uint32_t s0[LANES], s1[LANES], s2[LANES], s3[LANES];
+  std::memcpy(s0, state[0], sizeof(s0));
+  std::memcpy(s1, state[1], sizeof(s1));
+  std::memcpy(s2, state[2], sizeof(s2));
+  std::memcpy(s3, state[3], sizeof(s3));
+
+  for (int i = 0; i < BLOCK_SIZE; i += LANES) {
+    for (int lane = 0; lane < LANES; lane++) {
+      out[i + lane] = s0[lane] + s3[lane];
+      uint32_t t = s1[lane] << 9;
+      s2[lane] ^= s0[lane];
+      s3[lane] ^= s1[lane];
+      s1[lane] ^= s2[lane];
+      s0[lane] ^= s3[lane];
+      s2[lane] ^= t;
+      s3[lane] = RotateLeft(s3[lane], 11);
+    }
+  }
+
+  std::memcpy(state[0], s0, sizeof(s0));
+  std::memcpy(state[1], s1, sizeof(s1));
+  std::memcpy(state[2], s2, sizeof(s2));
+  std::memcpy(state[3], s3, sizeof(s3));
+}
+
+uint32_t RandomGenerator::NextUInt() {
+  if (block_position == BLOCK_SIZE) {
+    NextBlock(block);
+    block_position = 0;
+  }
+  return block[block_position++];
+}
+
+float RandomGenerator::NextFloat() {
+  return ToFloat(NextUInt());
+}
+
+int RandomGenerator::NextInt(int min, int max) {
+  return ToInt(NextUInt(), min, max);
+}
+
+void RandomGenerator::FillUInts(uint32_t* out, size_t count) {
+  if (count == 0) {
+    return;
+  }
+
+  // finish the current block first so single draws and bulk draws share one
+  // sequence
+  size_t from_block = std::min(count, (size_t)(BLOCK_SIZE - block_position));
+  std::memcpy(out, block + block_position, from_block * sizeof(uint32_t));
+  block_position += from_block;
+  out += from_block;
+  count -= from_block;
+
+  while (count >= (size_t)BLOCK_SIZE) {
+    NextBlock(out);
+    out += BLOCK_SIZE;
+    count -= BLOCK_SIZE;
+  }
+
+  for (size_t i = 0; i < count; i++) {
+    out[i] = NextUInt();
+  }
+}
@@ -0,0 +1,47 @@
+#ifndef RANDOM_GENERATOR_H_
+#define RANDOM_GENERATOR_H_
+
+#include <cstddef>
+#include <cstdint>
+
+// Seeded xoshiro128+ running four independent lanes side by side, so a whole
+// block of numbers comes out of one loop the compiler can vectorize. Single
+// draws are served from the current block, which keeps the sequence the same
+// no matter how it is consumed. Not thread safe: give every subsystem that
+// needs randomness its own generator.
+class RandomGenerator {
+ public:
+  explicit RandomGenerator(uint64_t seed = 0);
+
+  void Seed(uint64_t seed);
+
+  uint32_t NextUInt();
+  float NextFloat();  // [0, 1)
+  int NextInt(int min, int max);  // [min, max]
+
+  // Bulk generation, for loops that need many randoms at once
+  void FillUInts(uint32_t* out, size_t count);
+
+  // Turn raw bits from FillUInts() into the same ranges as above
+  static float ToFloat(uint32_t bits) {
+    // the low bits of xoshiro128+ are its weakest, so use the top 24
+    return (bits >> 8) * (1.0f / 16777216.0f);
+  }
+  static int ToInt(uint32_t bits, int min, int max) {
+    uint64_t range = (uint64_t)(max - min) + 1;
+    return min + (int)((bits * range) >> 32);
+  }
+
+ private:
+  static const int LANES = 4;
+  static const int BLOCK_SIZE = 16 * LANES;
+
+  void NextBlock(uint32_t* out);
+
+  // state word i of every lane is contiguous
+  uint32_t state[4][LANES];
+  uint32_t block[BLOCK_SIZE];
+  int block_position;
+};
+
+#endif